@@ -0,0 +1,101 @@
+// Compares the original char by char command line parser with the arena backed tokenizer
+// on command lines of growing size, like the ones produced by pasting JSON payloads
+#include <chrono>
+#include <cctype>
+#include <format>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "CommandLineParser.h"
+
+namespace {
+
+auto legacyParseCommandLine(const std::string& input) -> std::optional<std::vector<std::string>> {
+    std::vector<std::string> cmdAndArgs;
+    std::string current;
+    bool inSingle = false;
+    bool inDouble = false;
+    bool escape = false;
+
+    for (char inChar : input) {
+        if (escape) {
+            current += inChar;
+            escape = false;
+        } else if (inChar == '\\') {
+            escape = true;
+        } else if (inChar == '\'' && !inDouble) {
+            inSingle = !inSingle;
+        } else if (inChar == '"' && !inSingle) {
+            inDouble = !inDouble;
+        } else if ((isspace(inChar) != 0) && !inSingle && !inDouble) {
+            if (!current.empty()) {
+                cmdAndArgs.push_back(current);
+                current.clear();
+            }
+        } else {
+            current += inChar;
+        }
+    }
+    if (escape || inSingle || inDouble) {
+        return std::nullopt;
+    }
+    if (!current.empty()) {
+        cmdAndArgs.push_back(current);
+    }
+    return cmdAndArgs;
+}
+
+auto makeJsonCommandLine(size_t targetSize) -> std::string {
+    std::string payload = "{";
+    for (size_t index = 0; payload.size() < targetSize; index++) {
+        payload.append(std::format(R"("field_{}": {{"name": "item {}", "tags": ["a b", "c\"d"], "ok": true}}, )", index, index));
+    }
+    payload.append(R"("last": null})");
+    return "post --endpoint /api/items --data '" + payload + "' --verbose";
+}
+
+template<typename Parse>
+auto measure(std::string_view name, const std::string& line, size_t iterations, const Parse& parse) -> void {
+    size_t wordsSeen = 0;
+    const auto startTime = std::chrono::steady_clock::now();
+    for (size_t iteration = 0; iteration < iterations; iteration++) {
+        wordsSeen += parse(line);
+    }
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - startTime;
+
+    constexpr double NanosPerSecond = 1e9;
+    constexpr double BytesPerMegabyte = 1024.0 * 1024.0;
+    const auto nanosPerLine = elapsed.count() * NanosPerSecond / static_cast<double>(iterations);
+    const auto megabytesPerSecond = static_cast<double>(line.size() * iterations) / BytesPerMegabyte / elapsed.count();
+
+    std::cout << std::format("  {:<22} {:>12.1f} ns/line {:>10.1f} MB/s  ({} words)\n",
+                             name, nanosPerLine, megabytesPerSecond, wordsSeen / iterations);
+}
+
+} // namespace
+
+auto main() -> int {
+    constexpr size_t TotalBytesPerCase = 64UL * 1024UL * 1024UL;
+
+    for (const size_t lineSize : {256UL, 2048UL, 8192UL, 32768UL}) {
+        const auto line = makeJsonCommandLine(lineSize);
+        const auto iterations = std::max<size_t>(1, TotalBytesPerCase / line.size());
+        std::cout << std::format("line of {} bytes, {} iterations\n", line.size(), iterations);
+
+        measure("legacy parser", line, iterations, [](const std::string& input) {
+            return legacyParseCommandLine(input).value_or(std::vector<std::string>{}).size();
+        });
+        measure("ParseCommandLine", line, iterations, [](const std::string& input) {
+            return replmk::ParseCommandLine(input).value_or(std::vector<std::string>{}).size();
+        });
+
+        replmk::CommandLineTokens tokens;
+        measure("CommandLineTokens", line, iterations, [&tokens](const std::string& input) {
+            return tokens.Tokenize(input) ? tokens.Tokens().size() : 0;
+        });
+    }
+
+    return 0;
+}
@@ -0,0 +1,358 @@
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <format>
+#include <iterator>
+#include <utility>
+
+#include "AnsiText.h"
+
+namespace replmk {
+
+namespace {
+
+constexpr char EscapeCharacter = '\x1b';
+constexpr char BellCharacter = '\x07';
+// an operating system command is the longest, with hyperlinks or clipboard contents
+constexpr size_t MaxSequenceLength = 4096;
+constexpr size_t MaxParametersLength = 256;
+
+constexpr unsigned ForegroundColor = 38;
+constexpr unsigned BackgroundColor = 48;
+constexpr unsigned PaletteColorMode = 5;
+constexpr unsigned RgbColorMode = 2;
+constexpr unsigned BasicColors = 8;
+
+struct AttributeCode {
+    unsigned code;
+    uint8_t attributes;
+    bool set;
+};
+
+constexpr auto attributeMask(TextAttribute attribute) -> uint8_t {
+    return static_cast<uint8_t>(attribute);
+}
+
+constexpr std::array<AttributeCode, 15> AttributeCodes{{
+    {.code = 1, .attributes = attributeMask(TextAttribute::Bold), .set = true},
+    {.code = 2, .attributes = attributeMask(TextAttribute::Dim), .set = true},
+    {.code = 3, .attributes = attributeMask(TextAttribute::Italic), .set = true},
+    {.code = 4, .attributes = attributeMask(TextAttribute::Underline), .set = true},
+    {.code = 5, .attributes = attributeMask(TextAttribute::Blink), .set = true},
+    {.code = 6, .attributes = attributeMask(TextAttribute::Blink), .set = true},
+    {.code = 7, .attributes = attributeMask(TextAttribute::Inverse), .set = true},
+    {.code = 9, .attributes = attributeMask(TextAttribute::Strikethrough), .set = true},
+    // doubly underlined, shown as underlined
+    {.code = 21, .attributes = attributeMask(TextAttribute::Underline), .set = true},
+    {.code = 22, .attributes = attributeMask(TextAttribute::Bold) | attributeMask(TextAttribute::Dim), .set = false},
+    {.code = 23, .attributes = attributeMask(TextAttribute::Italic), .set = false},
+    {.code = 24, .attributes = attributeMask(TextAttribute::Underline), .set = false},
+    {.code = 25, .attributes = attributeMask(TextAttribute::Blink), .set = false},
+    {.code = 27, .attributes = attributeMask(TextAttribute::Inverse), .set = false},
+    {.code = 29, .attributes = attributeMask(TextAttribute::Strikethrough), .set = false}
+}};
+
+constexpr std::array<std::pair<TextAttribute, std::string_view>, 7> AttributeParameters{{
+    {TextAttribute::Bold, "1"},
+    {TextAttribute::Dim, "2"},
+    {TextAttribute::Italic, "3"},
+    {TextAttribute::Underline, "4"},
+    {TextAttribute::Blink, "5"},
+    {TextAttribute::Inverse, "7"},
+    {TextAttribute::Strikethrough, "9"}
+}};
+
+auto split(std::string_view text, char separator) -> std::vector<std::string_view> {
+    std::vector<std::string_view> parts;
+    for (auto end = text.find(separator); end != std::string_view::npos; end = text.find(separator)) {
+        parts.push_back(text.substr(0, end));
+        text.remove_prefix(end + 1);
+    }
+    parts.push_back(text);
+    return parts;
+}
+
+// an empty parameter is 0, like one that isn't a number
+auto parseNumber(std::string_view text) -> unsigned {
+    unsigned value = 0;
+    const auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+    return error == std::errc{} and end == text.data() + text.size() ? value : 0;
+}
+
+auto colorComponent(std::string_view text) -> uint8_t {
+    return static_cast<uint8_t>(std::min(parseNumber(text), 255U));
+}
+
+auto paletteColor(std::string_view text) -> TextColor {
+    return TextColor{.kind = ColorKind::Palette, .index = colorComponent(text)};
+}
+
+auto rgbColor(std::string_view red, std::string_view green, std::string_view blue) -> TextColor {
+    return TextColor{.kind = ColorKind::Rgb, .red = colorComponent(red), .green = colorComponent(green), .blue = colorComponent(blue)};
+}
+
+auto applyCode(unsigned code, TextStyle& style) -> void {
+    constexpr unsigned ForegroundFirst = 30;
+    constexpr unsigned BackgroundFirst = 40;
+    constexpr unsigned BrightForegroundFirst = 90;
+    constexpr unsigned BrightBackgroundFirst = 100;
+    constexpr unsigned DefaultForeground = 39;
+    constexpr unsigned DefaultBackground = 49;
+
+    if (code == 0) {
+        style = TextStyle{};
+        return;
+    }
+    if (const auto attribute = std::ranges::find(AttributeCodes, code, &AttributeCode::code); attribute != AttributeCodes.end()) {
+        style.attributes = attribute->set ? static_cast<uint8_t>(style.attributes | attribute->attributes)
+                                          : static_cast<uint8_t>(style.attributes & ~attribute->attributes);
+        return;
+    }
+    const auto basicColor = [](unsigned index) {
+        return TextColor{.kind = ColorKind::Palette, .index = static_cast<uint8_t>(index)};
+    };
+    if (code >= ForegroundFirst and code < ForegroundFirst + BasicColors) {
+        style.foreground = basicColor(code - ForegroundFirst);
+    } else if (code >= BackgroundFirst and code < BackgroundFirst + BasicColors) {
+        style.background = basicColor(code - BackgroundFirst);
+    } else if (code >= BrightForegroundFirst and code < BrightForegroundFirst + BasicColors) {
+        style.foreground = basicColor(code - BrightForegroundFirst + BasicColors);
+    } else if (code >= BrightBackgroundFirst and code < BrightBackgroundFirst + BasicColors) {
+        style.background = basicColor(code - BrightBackgroundFirst + BasicColors);
+    } else if (code == DefaultForeground) {
+        style.foreground = TextColor{};
+    } else if (code == DefaultBackground) {
+        style.background = TextColor{};
+    }
+}
+
+// 38 and 48 followed by 5;index or 2;red;green;blue, returning how many of the parameters after start it used
+auto readExtendedColor(const std::vector<std::string_view>& parameters, size_t start, TextColor& color) -> size_t {
+    if (start >= parameters.size()) {
+        return 0;
+    }
+    const auto mode = parseNumber(parameters[start]);
+    if (mode == PaletteColorMode and start + 1 < parameters.size()) {
+        color = paletteColor(parameters[start + 1]);
+        return 2;
+    }
+    if (mode == RgbColorMode and start + 3 < parameters.size()) {
+        color = rgbColor(parameters[start + 1], parameters[start + 2], parameters[start + 3]);
+        return 4;
+    }
+    // not a color that can be read, neither can the parameters after it
+    return parameters.size() - start;
+}
+
+// a parameter with subparameters, like 38:2::255:0:0 or 4:3 for a curly underline
+auto applySubparameters(const std::vector<std::string_view>& subparameters, TextStyle& style) -> void {
+    const auto code = parseNumber(subparameters.front());
+    if (code != ForegroundColor and code != BackgroundColor) {
+        constexpr unsigned Underline = 4;
+        constexpr unsigned NotUnderlined = 24;
+        const bool underlineOff = code == Underline and subparameters.size() > 1 and parseNumber(subparameters[1]) == 0;
+        applyCode(underlineOff ? NotUnderlined : code, style);
+        return;
+    }
+
+    auto& color = code == ForegroundColor ? style.foreground : style.background;
+    const auto mode = subparameters.size() > 1 ? parseNumber(subparameters[1]) : 0;
+    if (mode == PaletteColorMode and subparameters.size() > 2) {
+        color = paletteColor(subparameters[2]);
+    }
+    // with the color space before the components, often left empty, or without it
+    constexpr size_t WithColorSpace = 6;
+    if (mode == RgbColorMode and subparameters.size() >= WithColorSpace) {
+        color = rgbColor(subparameters[3], subparameters[4], subparameters[5]);
+    } else if (mode == RgbColorMode and subparameters.size() == WithColorSpace - 1) {
+        color = rgbColor(subparameters[2], subparameters[3], subparameters[4]);
+    }
+}
+
+auto appendColor(std::string& parameters, const TextColor& color, unsigned first, unsigned brightFirst, unsigned extended) -> void {
+    // the components are written as numbers, not characters
+    const auto number = [](uint8_t component) {
+        return static_cast<unsigned>(component);
+    };
+    if (color.kind == ColorKind::Rgb) {
+        parameters.append(std::format(";{};{};{};{};{}", extended, RgbColorMode, number(color.red), number(color.green), number(color.blue)));
+    } else if (color.kind == ColorKind::Palette and color.index < BasicColors) {
+        parameters.append(std::format(";{}", first + color.index));
+    } else if (color.kind == ColorKind::Palette and color.index < 2 * BasicColors) {
+        parameters.append(std::format(";{}", brightFirst + color.index - BasicColors));
+    } else if (color.kind == ColorKind::Palette) {
+        parameters.append(std::format(";{};{};{}", extended, PaletteColorMode, number(color.index)));
+    }
+}
+
+auto isBetween(char byte, unsigned first, unsigned last) -> bool {
+    const auto value = static_cast<unsigned char>(byte);
+    return value >= first and value <= last;
+}
+
+// ESC [ parameters are digits, ';' and ':', other ones are private and not SGR
+auto isSgrParameters(std::string_view parameters) -> bool {
+    return std::ranges::all_of(parameters, [](char character) {
+        return (character >= '0' and character <= '9') or character == ';' or character == ':';
+    });
+}
+
+} // namespace
+
+auto applySgr(std::string_view parameters, TextStyle& style) -> void {
+    const auto values = split(parameters, ';');
+    for (size_t index = 0; index < values.size(); index++) {
+        if (values[index].find(':') != std::string_view::npos) {
+            applySubparameters(split(values[index], ':'), style);
+            continue;
+        }
+        const auto code = parseNumber(values[index]);
+        if (code == ForegroundColor or code == BackgroundColor) {
+            index += readExtendedColor(values, index + 1, code == ForegroundColor ? style.foreground : style.background);
+            continue;
+        }
+        applyCode(code, style);
+    }
+}
+
+auto formatSgr(const TextStyle& style) -> std::string {
+    std::string parameters{"0"};
+    for (const auto& [attribute, parameter] : AttributeParameters) {
+        if (style.Has(attribute)) {
+            parameters.append(";").append(parameter);
+        }
+    }
+    constexpr unsigned ForegroundFirst = 30;
+    constexpr unsigned BackgroundFirst = 40;
+    constexpr unsigned BrightForegroundFirst = 90;
+    constexpr unsigned BrightBackgroundFirst = 100;
+    appendColor(parameters, style.foreground, ForegroundFirst, BrightForegroundFirst, ForegroundColor);
+    appendColor(parameters, style.background, BackgroundFirst, BrightBackgroundFirst, BackgroundColor);
+    return parameters;
+}
+
+auto styledPieces(const std::vector<StyleSpan>& spans, size_t offset, size_t length) -> std::vector<StyledPiece> {
+    std::vector<StyledPiece> pieces;
+    const auto end = offset + length;
+    // the last span starting at offset or before gives the style the text starts with
+    auto span = std::ranges::upper_bound(spans, offset, {}, &StyleSpan::offset);
+    auto style = span == spans.begin() ? TextStyle{} : std::prev(span)->style;
+    auto position = offset;
+    for (; span != spans.end() and span->offset < end; ++span) {
+        pieces.push_back(StyledPiece{.offset = position, .length = span->offset - position, .style = style});
+        position = span->offset;
+        style = span->style;
+    }
+    pieces.push_back(StyledPiece{.offset = position, .length = end - position, .style = style});
+    return pieces;
+}
+
+auto AnsiTextParser::AppendText(std::string_view visible, std::string& text, std::vector<StyleSpan>& spans) const -> void {
+    if (visible.empty()) {
+        return;
+    }
+    // a span is only started by text, styles set and reset again before any leave nothing behind
+    const TextStyle current = spans.empty() ? TextStyle{} : spans.back().style;
+    if (current != this->style) {
+        spans.push_back(StyleSpan{.offset = text.size(), .style = this->style});
+    }
+    text.append(visible);
+}
+
+auto AnsiTextParser::ReadSequenceByte(char byte) -> bool {
+    if (++this->sequenceLength > MaxSequenceLength) {
+        this->Interrupt();
+        return false;
+    }
+
+    switch (this->state) {
+        case State::Escape:
+            if (byte == '[') {
+                this->state = State::ControlSequence;
+                this->parameters.clear();
+            } else if (byte == ']') {
+                this->state = State::OperatingSystemCommand;
+            } else if (byte == EscapeCharacter) {
+                this->sequenceLength = 1;
+            } else if (isBetween(byte, 0x20, 0x2F)) {
+                this->state = State::EscapeIntermediate;
+            } else {
+                // a sequence of its own, like ESC 7 saving the cursor, or a control character read as text
+                this->state = State::Text;
+                return isBetween(byte, 0x30, 0x7E);
+            }
+            return true;
+        case State::EscapeIntermediate:
+            if (isBetween(byte, 0x20, 0x2F)) {
+                return true;
+            }
+            this->state = State::Text;
+            return isBetween(byte, 0x30, 0x7E);
+        case State::ControlSequence:
+            if (isBetween(byte, 0x20, 0x3F)) {
+                if (this->parameters.size() < MaxParametersLength) {
+                    this->parameters.push_back(byte);
+                }
+                return true;
+            }
+            this->state = State::Text;
+            if (not isBetween(byte, 0x40, 0x7E)) {
+                return false;
+            }
+            if (byte == 'm' and this->parameters.size() < MaxParametersLength and isSgrParameters(this->parameters)) {
+                applySgr(this->parameters, this->style);
+            }
+            return true;
+        case State::OperatingSystemCommand:
+            if (byte == BellCharacter) {
+                this->state = State::Text;
+            } else if (byte == EscapeCharacter) {
+                this->state = State::OperatingSystemCommandEscape;
+            } else if (isBetween(byte, 0x00, 0x1F)) {
+                // a title is not spread over lines, the command is cut
+                this->state = State::Text;
+                return false;
+            }
+            return true;
+        case State::OperatingSystemCommandEscape:
+            // ESC \ ends the command, any other ESC starts a new sequence
+            this->state = byte == '\\' ? State::Text : State::Escape;
+            return byte == '\\';
+        case State::Text:
+            return false;
+    }
+    return false;
+}
+
+auto AnsiTextParser::Feed(std::string_view chunk, std::string& text, std::vector<StyleSpan>& spans) -> void {
+    size_t position = 0;
+    while (position < chunk.size()) {
+        if (this->state != State::Text) {
+            // a byte not part of the sequence is read again, as text or the start of the next sequence
+            if (this->ReadSequenceByte(chunk[position])) {
+                position++;
+            }
+            continue;
+        }
+        const auto escape = std::min(chunk.find(EscapeCharacter, position), chunk.size());
+        this->AppendText(chunk.substr(position, escape - position), text, spans);
+        if (escape < chunk.size()) {
+            this->state = State::Escape;
+            this->sequenceLength = 1;
+        }
+        position = escape + 1;
+    }
+}
+
+auto AnsiTextParser::Interrupt() -> void {
+    this->state = State::Text;
+    this->parameters.clear();
+    this->sequenceLength = 0;
+}
+
+auto AnsiTextParser::Reset() -> void {
+    this->Interrupt();
+    this->style = TextStyle{};
+}
+
+} // namespace replmk
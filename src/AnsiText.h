@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace replmk {
+
+enum class TextAttribute: uint8_t {
+    Bold = 1U << 0U,
+    Dim = 1U << 1U,
+    Italic = 1U << 2U,
+    Underline = 1U << 3U,
+    Blink = 1U << 4U,
+    Inverse = 1U << 5U,
+    Strikethrough = 1U << 6U
+};
+
+enum class ColorKind: uint8_t {
+    Default,
+    // one of the 256 of the palette, the first 16 being the basic and the bright ones
+    Palette,
+    Rgb
+};
+
+struct TextColor {
+    ColorKind kind{ColorKind::Default};
+    uint8_t index{0};
+    uint8_t red{0};
+    uint8_t green{0};
+    uint8_t blue{0};
+
+    auto operator==(const TextColor&) const -> bool = default;
+};
+
+struct TextStyle {
+    TextColor foreground{};
+    TextColor background{};
+    // TextAttribute flags
+    uint8_t attributes{0};
+
+    [[nodiscard]] auto Has(TextAttribute attribute) const -> bool {
+        return (this->attributes & static_cast<uint8_t>(attribute)) != 0;
+    }
+
+    auto operator==(const TextStyle&) const -> bool = default;
+};
+
+// the text from offset on has the style, up to the next span. Text before the first span has the default style
+struct StyleSpan {
+    size_t offset{0};
+    TextStyle style{};
+};
+
+// a part of a text with one style
+struct StyledPiece {
+    size_t offset{0};
+    size_t length{0};
+    TextStyle style{};
+};
+
+// the SGR parameters, the part of ESC [ ... m between the bracket and the m, change the style
+auto applySgr(std::string_view parameters, TextStyle& style) -> void;
+
+// the SGR parameters setting the style from the default one
+[[nodiscard]] auto formatSgr(const TextStyle& style) -> std::string;
+
+// the styles of the text from offset to offset + length, a piece for each
+[[nodiscard]] auto styledPieces(const std::vector<StyleSpan>& spans, size_t offset, size_t length) -> std::vector<StyledPiece>;
+
+/**
+ * Takes the escape sequences out of an output as it arrives, keeping the styles SGR sequences give the text that is left
+ * as spans. A sequence cut between two chunks is completed by the next one. The others, like cursor movements or window
+ * titles, are dropped, since the output is not a terminal screen they could act on
+ */
+class AnsiTextParser final {
+  private:
+    enum class State: uint8_t {
+        Text,
+        Escape,
+        EscapeIntermediate,
+        ControlSequence,
+        OperatingSystemCommand,
+        OperatingSystemCommandEscape
+    };
+
+    State state{State::Text};
+    TextStyle style{};
+    // the parameters of the control sequence read so far
+    std::string parameters;
+    // of the sequence being read, which is given up on when too long
+    size_t sequenceLength{0};
+
+    auto AppendText(std::string_view visible, std::string& text, std::vector<StyleSpan>& spans) const -> void;
+    // false when the byte ended the sequence without being part of it, and is to be read as text
+    auto ReadSequenceByte(char byte) -> bool;
+
+  public:
+    auto Feed(std::string_view chunk, std::string& text, std::vector<StyleSpan>& spans) -> void;
+    // a sequence cut in the middle, by output left out, is dropped. The style stays
+    auto Interrupt() -> void;
+    auto Reset() -> void;
+};
+
+} // namespace replmk
@@ -0,0 +1,267 @@
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cmath>
+#include <format>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+#include "ArgumentSchema.h"
+
+namespace replmk {
+
+namespace {
+
+constexpr std::array<std::string_view, 4> TrueBooleanValues = {"true", "yes", "on", "1"};
+constexpr std::array<std::string_view, 4> FalseBooleanValues = {"false", "no", "off", "0"};
+
+auto argumentTypeAsString(ArgumentType argType) -> std::string_view {
+    switch (argType) {
+    case ArgumentType::String:
+        return "string";
+    case ArgumentType::Integer:
+        return "int";
+    case ArgumentType::Float:
+        return "float";
+    case ArgumentType::Boolean:
+        return "bool";
+    case ArgumentType::Enum:
+        return "enum";
+    case ArgumentType::Unknown:
+        return "unknown";
+    default:
+        return "unknown";
+    }
+}
+
+auto joinValues(const std::vector<std::string>& values, std::string_view separator) -> std::string {
+    std::string joined;
+    for (const auto& value : values) {
+        if (not joined.empty()) {
+            joined.append(separator);
+        }
+        joined.append(value);
+    }
+    return joined;
+}
+
+template<typename Number>
+auto parseNumber(std::string_view value) -> std::optional<Number> {
+    Number parsed{};
+    const auto* const valueEnd = value.data() + value.size(); //NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    const auto [ptr, errorCode] = std::from_chars(value.data(), valueEnd, parsed);
+    if (errorCode != std::errc{} or ptr != valueEnd) {
+        return std::nullopt;
+    }
+    return parsed;
+}
+
+auto parseNumericArgument(const ArgumentSpec& spec, std::string_view value) -> std::optional<double> {
+    if (spec.argType == ArgumentType::Integer) {
+        const auto parsed = parseNumber<long long>(value);
+        if (not parsed.has_value()) {
+            return std::nullopt;
+        }
+        return static_cast<double>(parsed.value());
+    }
+    // from_chars reads nan and inf too, but nan compares to no bound and neither is a number a command expects
+    const auto parsed = parseNumber<double>(value);
+    if (not parsed.has_value() or not std::isfinite(parsed.value())) {
+        return std::nullopt;
+    }
+    return parsed;
+}
+
+auto checkRange(const ArgumentSpec& spec, std::string_view value, double number) -> std::expected<void, std::string> {
+    if (spec.minValue.has_value() and number < spec.minValue.value()) {
+        return std::unexpected{std::format("Argument '{}' must be at least {}, got '{}'", spec.name, spec.minValue.value(), value)};
+    }
+    if (spec.maxValue.has_value() and number > spec.maxValue.value()) {
+        return std::unexpected{std::format("Argument '{}' must be at most {}, got '{}'", spec.name, spec.maxValue.value(), value)};
+    }
+    return {};
+}
+
+auto validateArgument(const ArgumentSpec& spec, const std::string& value) -> std::expected<void, std::string> {
+    switch (spec.argType) {
+    case ArgumentType::Integer:
+    case ArgumentType::Float: {
+        const auto number = parseNumericArgument(spec, value);
+        if (not number.has_value()) {
+            return std::unexpected{std::format("Argument '{}' expects a value of type {}, got '{}'", spec.name, argumentTypeAsString(spec.argType), value)};
+        }
+        return checkRange(spec, value, number.value());
+    }
+    case ArgumentType::Boolean:
+        if (std::ranges::find(TrueBooleanValues, value) == TrueBooleanValues.end() and
+                std::ranges::find(FalseBooleanValues, value) == FalseBooleanValues.end()) {
+            return std::unexpected{std::format("Argument '{}' expects a boolean value, got '{}'", spec.name, value)};
+        }
+        return {};
+    case ArgumentType::Enum:
+        if (std::ranges::find(spec.allowedValues, value) == spec.allowedValues.end()) {
+            return std::unexpected{std::format("Argument '{}' must be one of [{}], got '{}'", spec.name, joinValues(spec.allowedValues, ", "), value)};
+        }
+        return {};
+    case ArgumentType::String:
+    case ArgumentType::Unknown:
+    default:
+        break;
+    }
+
+    if (spec.compiledPattern and not std::regex_match(value, *spec.compiledPattern)) {
+        return std::unexpected{std::format("Argument '{}' does not match the pattern '{}', got '{}'", spec.name, spec.pattern, value)};
+    }
+    return {};
+}
+
+auto formatArgumentUsage(const ArgumentSpec& spec) -> std::string {
+    std::string usage = spec.name;
+    if (spec.argType == ArgumentType::Enum) {
+        usage.append(":").append(joinValues(spec.allowedValues, "|"));
+    } else if (spec.argType != ArgumentType::String) {
+        usage.append(":").append(argumentTypeAsString(spec.argType));
+    }
+    if (spec.variadic) {
+        usage.append("...");
+    }
+    return spec.required ? std::format("<{}>", usage) : std::format("[{}]", usage);
+}
+
+auto formatRange(const ArgumentSpec& spec) -> std::string {
+    if (spec.minValue.has_value() and spec.maxValue.has_value()) {
+        return std::format(" between {} and {}", spec.minValue.value(), spec.maxValue.value());
+    }
+    if (spec.minValue.has_value()) {
+        return std::format(" at least {}", spec.minValue.value());
+    }
+    if (spec.maxValue.has_value()) {
+        return std::format(" at most {}", spec.maxValue.value());
+    }
+    return "";
+}
+
+} // namespace
+
+auto compileArgumentSpec(ArgumentSpec& spec) -> bool {
+    if (spec.argType == ArgumentType::Unknown) {
+        return false;
+    }
+    if (spec.argType == ArgumentType::Enum and spec.allowedValues.empty()) {
+        return false;
+    }
+    if (spec.pattern.empty()) {
+        return true;
+    }
+    // only string values are matched against a pattern, anywhere else it would be silently ignored
+    if (spec.argType != ArgumentType::String) {
+        return false;
+    }
+
+    try {
+        spec.compiledPattern = std::make_shared<const std::regex>(spec.pattern, std::regex::ECMAScript | std::regex::optimize);
+    } catch (const std::regex_error&) {
+        return false;
+    }
+    return true;
+}
+
+auto isArgumentSchemaConsistent(const ArgumentSchema& schema) -> bool {
+    bool seenOptional = false;
+    for (size_t index = 0; index < schema.arguments.size(); index++) {
+        const auto& spec = schema.arguments.at(index);
+        // required arguments cannot follow optional ones and only the last argument can be variadic
+        if (spec.required and seenOptional) {
+            return false;
+        }
+        if (spec.variadic and index + 1 != schema.arguments.size()) {
+            return false;
+        }
+        seenOptional = seenOptional or not spec.required;
+    }
+    return true;
+}
+
+auto validateArguments(const ArgumentSchema& schema, const std::vector<std::string>& args) -> std::expected<void, std::string> {
+    if (schema.empty()) {
+        return {};
+    }
+
+    const auto& specs = schema.arguments;
+    for (size_t index = 0; index < args.size(); index++) {
+        if (index >= specs.size() and not specs.back().variadic) {
+            return std::unexpected{std::format("Too many arguments, expected at most {} but got {}", specs.size(), args.size())};
+        }
+
+        const auto& spec = specs.at(std::min(index, specs.size() - 1));
+        if (auto result = validateArgument(spec, args.at(index)); not result.has_value()) {
+            return result;
+        }
+    }
+
+    for (size_t index = args.size(); index < specs.size(); index++) {
+        if (specs.at(index).required) {
+            return std::unexpected{std::format("Missing required argument '{}'", specs.at(index).name)};
+        }
+    }
+
+    return {};
+}
+
+auto formatArgumentsUsage(const ArgumentSchema& schema) -> std::string {
+    std::string usage;
+    for (const auto& spec : schema.arguments) {
+        if (not usage.empty()) {
+            usage.append(" ");
+        }
+        usage.append(formatArgumentUsage(spec));
+    }
+    return usage;
+}
+
+auto formatArgumentsHelp(const ArgumentSchema& schema) -> std::string {
+    std::string help;
+    for (const auto& spec : schema.arguments) {
+        const auto typeDescription = spec.argType == ArgumentType::Enum
+                                     ? std::format("one of {}", joinValues(spec.allowedValues, ", "))
+                                     : std::string{argumentTypeAsString(spec.argType)};
+        const auto patternDescription = spec.pattern.empty() ? std::string{} : std::format(" matching '{}'", spec.pattern);
+
+        help.append(std::format("    {}: {}{}{}{}{}\n", spec.name,
+                                spec.required ? "" : "optional ",
+                                typeDescription, formatRange(spec), patternDescription,
+                                spec.description.empty() ? "" : ". " + spec.description));
+    }
+    return help;
+}
+
+auto completeArgument(const ArgumentSchema& schema, size_t position, std::string_view prefix) -> std::vector<std::string> {
+    if (schema.empty()) {
+        return {};
+    }
+    if (position >= schema.arguments.size() and not schema.arguments.back().variadic) {
+        return {};
+    }
+
+    const auto& spec = schema.arguments.at(std::min(position, schema.arguments.size() - 1));
+
+    std::vector<std::string> candidates;
+    const auto addIfMatches = [&candidates, prefix](std::string_view value) {
+        if (value.starts_with(prefix)) {
+            candidates.emplace_back(value);
+        }
+    };
+
+    if (spec.argType == ArgumentType::Enum) {
+        std::ranges::for_each(spec.allowedValues, addIfMatches);
+    } else if (spec.argType == ArgumentType::Boolean) {
+        addIfMatches(TrueBooleanValues.front());
+        addIfMatches(FalseBooleanValues.front());
+    }
+
+    return candidates;
+}
+
+} // namespace replmk
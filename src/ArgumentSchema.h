@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstdint>
+#include <expected>
+#include <memory>
+#include <optional>
+#include <regex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace replmk {
+
+enum class ArgumentType: uint8_t {
+    Unknown,
+    String,
+    Integer,
+    Float,
+    Boolean,
+    Enum
+};
+
+[[nodiscard]] inline auto toArgumentType(const std::string& typeString) -> ArgumentType {
+    if (typeString == "string") {
+        return ArgumentType::String;
+    }
+    if (typeString == "int") {
+        return ArgumentType::Integer;
+    }
+    if (typeString == "float") {
+        return ArgumentType::Float;
+    }
+    if (typeString == "bool") {
+        return ArgumentType::Boolean;
+    }
+    if (typeString == "enum") {
+        return ArgumentType::Enum;
+    }
+    return ArgumentType::Unknown;
+}
+
+/**
+ * Describes a single positional argument of a command.
+ * The pattern, when present, is compiled once at load time by compileArgumentSpec. Only string arguments can have one
+ */
+struct ArgumentSpec {
+    std::string name;
+    std::string description;
+    ArgumentType argType{ArgumentType::String};
+    bool required{true};
+    bool variadic{false};
+
+    std::vector<std::string> allowedValues;
+    std::optional<double> minValue;
+    std::optional<double> maxValue;
+
+    std::string pattern;
+    std::shared_ptr<const std::regex> compiledPattern;
+};
+
+/**
+ * Positional arguments accepted by a command. An empty schema accepts anything
+ */
+struct ArgumentSchema {
+    std::vector<ArgumentSpec> arguments;
+
+    [[nodiscard]] auto empty() const -> bool {
+        return arguments.empty();
+    }
+};
+
+[[nodiscard]]
+auto compileArgumentSpec(ArgumentSpec& spec) -> bool;
+
+[[nodiscard]]
+auto isArgumentSchemaConsistent(const ArgumentSchema& schema) -> bool;
+
+[[nodiscard]]
+auto validateArguments(const ArgumentSchema& schema, const std::vector<std::string>& args) -> std::expected<void, std::string>;
+
+[[nodiscard]]
+auto formatArgumentsUsage(const ArgumentSchema& schema) -> std::string;
+
+[[nodiscard]]
+auto formatArgumentsHelp(const ArgumentSchema& schema) -> std::string;
+
+[[nodiscard]]
+auto completeArgument(const ArgumentSchema& schema, size_t position, std::string_view prefix) -> std::vector<std::string>;
+
+} // namespace replmk
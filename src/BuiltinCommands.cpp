@@ -0,0 +1,304 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <format>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <vector>
+#include <charconv>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "BuiltinCommands.h"
+
+namespace replmk {
+
+namespace {
+
+// the only builtin expanding session variables in its arguments
+constexpr std::string_view ExpandingBuiltinName = "echo";
+
+auto isVariableNameChar(char character, bool first) -> bool {
+    const bool isAlpha = (character >= 'a' and character <= 'z') or (character >= 'A' and character <= 'Z') or character == '_';
+    return isAlpha or (not first and character >= '0' and character <= '9');
+}
+
+auto isValidVariableName(std::string_view name) -> bool {
+    if (name.empty() or not isVariableNameChar(name.front(), true)) {
+        return false;
+    }
+    return std::ranges::all_of(name, [](char character) {
+        return isVariableNameChar(character, false);
+    });
+}
+
+auto lookupVariable(const Session& session, const std::string& name) -> std::string {
+    if (const auto found = session.variables.find(name); found != session.variables.end()) {
+        return found->second;
+    }
+    const char* envValue = std::getenv(name.c_str()); //NOLINT(concurrency-mt-unsafe)
+    return envValue == nullptr ? "" : envValue;
+}
+
+auto currentSessionDirectory(const Session& session) -> std::filesystem::path {
+    return resolveSessionPath(session, ".").lexically_normal().parent_path();
+}
+
+auto joinArgs(const std::vector<std::string>& args, size_t first) -> std::string {
+    std::string joined;
+    for (size_t index = first; index < args.size(); index++) {
+        if (index > first) {
+            joined.append(" ");
+        }
+        joined.append(args.at(index));
+    }
+    return joined;
+}
+
+// variables are already expanded by executeBuiltin, where it knows which arguments were quoted
+auto builtinEcho(const std::vector<std::string>& args, [[maybe_unused]] Session& session,
+                 const CommandOutputCallbacks& callbacks, [[maybe_unused]] const BuiltinCommandRunner& runner) -> bool {
+    callbacks.onStdOut(joinArgs(args, 0) + "\n");
+    return true;
+}
+
+auto builtinChangeDirectory(const std::vector<std::string>& args, Session& session,
+                            const CommandOutputCallbacks& callbacks, [[maybe_unused]] const BuiltinCommandRunner& runner) -> bool {
+    std::filesystem::path target = args.empty() ? lookupVariable(session, "HOME") : args.front();
+    if (target == "-") {
+        target = session.previousWorkingDirectory;
+    }
+    if (target.empty()) {
+        callbacks.onStdErr("cd: no target directory\n");
+        return false;
+    }
+
+    std::error_code errorCode;
+    const auto resolved = std::filesystem::canonical(resolveSessionPath(session, target), errorCode);
+    if (errorCode or not std::filesystem::is_directory(resolved, errorCode)) {
+        callbacks.onStdErr(std::format("cd: {}: not a directory\n", target.string()));
+        return false;
+    }
+
+    session.previousWorkingDirectory = currentSessionDirectory(session);
+    session.workingDirectory = resolved;
+    return true;
+}
+
+auto builtinPrintWorkingDirectory([[maybe_unused]] const std::vector<std::string>& args, Session& session,
+                                  const CommandOutputCallbacks& callbacks, [[maybe_unused]] const BuiltinCommandRunner& runner) -> bool {
+    callbacks.onStdOut(currentSessionDirectory(session).string() + "\n");
+    return true;
+}
+
+auto builtinSetVariable(const std::vector<std::string>& args, Session& session,
+                        const CommandOutputCallbacks& callbacks, [[maybe_unused]] const BuiltinCommandRunner& runner) -> bool {
+    if (args.empty()) {
+        std::string listing;
+        for (const auto& [name, value] : session.variables) {
+            listing.append(std::format("{}={}\n", name, value));
+        }
+        callbacks.onStdOut(listing);
+        return true;
+    }
+
+    // both 'set NAME value' and 'set NAME=value' are accepted
+    const auto& first = args.front();
+    const auto equalsPos = first.find('=');
+    const auto name = first.substr(0, equalsPos);
+    const auto value = equalsPos == std::string::npos ? joinArgs(args, 1) : first.substr(equalsPos + 1);
+
+    if (not isValidVariableName(name)) {
+        callbacks.onStdErr(std::format("set: invalid variable name '{}'\n", name));
+        return false;
+    }
+
+    session.variables.insert_or_assign(name, value);
+    return true;
+}
+
+auto builtinUnsetVariable(const std::vector<std::string>& args, Session& session,
+                          const CommandOutputCallbacks& callbacks, [[maybe_unused]] const BuiltinCommandRunner& runner) -> bool {
+    if (args.empty()) {
+        callbacks.onStdErr("unset: missing variable name\n");
+        return false;
+    }
+    for (const auto& name : args) {
+        session.variables.erase(name);
+    }
+    return true;
+}
+
+auto catFile(const std::filesystem::path& filePath, const CommandOutputCallbacks& callbacks) -> bool {
+    constexpr size_t MaxChunkSize = 64UL * 1024UL;
+
+    const int fileDescriptor = open(filePath.c_str(), O_RDONLY | O_CLOEXEC); //NOLINT(cppcoreguidelines-pro-type-vararg)
+    if (fileDescriptor < 0) {
+        return false;
+    }
+
+    struct stat fileStat {};
+    const bool statOk = fstat(fileDescriptor, &fileStat) == 0 and not S_ISDIR(fileStat.st_mode);
+    // the size is only a hint for the first read, files can still grow while being read
+    std::string chunk(statOk ? std::clamp<size_t>(static_cast<size_t>(fileStat.st_size), 1, MaxChunkSize) : 0, '\0');
+
+    off_t offset = 0;
+    ssize_t bytesRead = statOk ? 1 : -1;
+    while (bytesRead > 0) {
+        bytesRead = pread(fileDescriptor, chunk.data(), chunk.size(), offset);
+        if (bytesRead > 0) {
+            callbacks.onStdOut(std::string_view(chunk.data(), static_cast<size_t>(bytesRead)));
+            offset += bytesRead;
+            chunk.resize(MaxChunkSize);
+        }
+    }
+    close(fileDescriptor);
+    return bytesRead == 0;
+}
+
+auto builtinCat(const std::vector<std::string>& args, Session& session,
+                const CommandOutputCallbacks& callbacks, [[maybe_unused]] const BuiltinCommandRunner& runner) -> bool {
+    bool allRead = true;
+    for (const auto& fileName : args) {
+        if (not catFile(resolveSessionPath(session, fileName), callbacks)) {
+            callbacks.onStdErr(std::format("cat: {}: cannot be read\n", fileName));
+            allRead = false;
+        }
+    }
+    return allRead;
+}
+
+auto builtinSleep(const std::vector<std::string>& args, Session& session,
+                  const CommandOutputCallbacks& callbacks, [[maybe_unused]] const BuiltinCommandRunner& runner) -> bool {
+    double seconds = 0;
+    const auto& secondsArg = args.empty() ? std::string{} : args.front();
+    const auto* const argEnd = secondsArg.data() + secondsArg.size(); //NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    const auto [ptr, errorCode] = std::from_chars(secondsArg.data(), argEnd, seconds);
+    if (args.size() != 1 or errorCode != std::errc{} or ptr != argEnd or seconds < 0) {
+        callbacks.onStdErr("sleep: expected a single, non negative, number of seconds\n");
+        return false;
+    }
+
+    // in short steps, so a cancelled command, or a killed job, doesn't have to wait for the whole duration.
+    // In the foreground, the interface handles its events between steps, reading Ctrl+C among them
+    const auto wakeUpTime = std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(seconds));
+    while (std::chrono::steady_clock::now() < wakeUpTime) {
+        if (session.control.IsCancelRequested()) {
+            return false;
+        }
+        session.control.WaitWithIdle([&wakeUpTime](std::chrono::milliseconds interval) {
+            std::this_thread::sleep_for(std::min<std::chrono::steady_clock::duration>(interval, wakeUpTime - std::chrono::steady_clock::now()));
+            return std::chrono::steady_clock::now() >= wakeUpTime;
+        });
+    }
+    return not session.control.IsCancelRequested();
+}
+
+auto builtinTime(const std::vector<std::string>& args, [[maybe_unused]] Session& session,
+                 const CommandOutputCallbacks& callbacks, const BuiltinCommandRunner& runner) -> bool {
+    if (args.empty()) {
+        callbacks.onStdErr("time: missing command\n");
+        return false;
+    }
+
+    const auto startTime = std::chrono::steady_clock::now();
+    const bool result = runner(args);
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - startTime;
+
+    callbacks.onStdOut(std::format("\nreal {:.3f}s\n", elapsed.count()));
+    return result;
+}
+
+} // namespace
+
+auto getBuiltinCommandRegistry() -> const BuiltinCommandRegistry& {
+    static const BuiltinCommandRegistry registry{
+        {"cd", builtinChangeDirectory},
+        {"pwd", builtinPrintWorkingDirectory},
+        {"set", builtinSetVariable},
+        {"unset", builtinUnsetVariable},
+        {"echo", builtinEcho},
+        {"cat", builtinCat},
+        {"sleep", builtinSleep},
+        {"time", builtinTime},
+    };
+    return registry;
+}
+
+auto isBuiltinCommand(std::string_view builtinName) -> bool {
+    return getBuiltinCommandRegistry().contains(builtinName);
+}
+
+auto executeBuiltin(std::string_view builtinName, const std::vector<std::string>& args, Session& session,
+                    const CommandOutputCallbacks& callbacks, const BuiltinCommandRunner& runner,
+                    const std::vector<bool>& literalArgs) -> bool {
+    const auto& registry = getBuiltinCommandRegistry();
+    const auto builtin = registry.find(builtinName);
+    if (builtin == registry.end()) {
+        callbacks.onStdErr(std::format("Unknown builtin '{}'\n", builtinName));
+        return false;
+    }
+    if (builtinName != ExpandingBuiltinName) {
+        return builtin->second(args, session, callbacks, runner);
+    }
+
+    // words lose their quotes when tokenized, literalArgs is what is left of the single quotes and escapes
+    std::vector<std::string> expandedArgs;
+    expandedArgs.reserve(args.size());
+    for (size_t index = 0; index < args.size(); index++) {
+        const bool literal = index < literalArgs.size() and literalArgs.at(index);
+        expandedArgs.push_back(literal ? args.at(index) : expandSessionVariables(session, args.at(index)));
+    }
+    return builtin->second(expandedArgs, session, callbacks, runner);
+}
+
+auto resolveSessionPath(const Session& session, const std::filesystem::path& path) -> std::filesystem::path {
+    if (path.is_absolute()) {
+        return path;
+    }
+
+    std::error_code errorCode;
+    const auto base = session.workingDirectory.empty() ? std::filesystem::current_path(errorCode) : session.workingDirectory;
+    return base / path;
+}
+
+auto expandSessionVariables(const Session& session, std::string_view text) -> std::string {
+    std::string expanded;
+    expanded.reserve(text.size());
+
+    size_t pos = 0;
+    while (pos < text.size()) {
+        const auto dollarPos = text.find('$', pos);
+        expanded.append(text.substr(pos, dollarPos - pos));
+        if (dollarPos == std::string_view::npos) {
+            break;
+        }
+
+        const bool braced = dollarPos + 1 < text.size() and text.at(dollarPos + 1) == '{';
+        const auto nameStart = dollarPos + (braced ? 2 : 1);
+        auto nameEnd = nameStart;
+        while (nameEnd < text.size() and isVariableNameChar(text.at(nameEnd), nameEnd == nameStart)) {
+            nameEnd++;
+        }
+
+        const bool closed = not braced or (nameEnd < text.size() and text.at(nameEnd) == '}');
+        if (nameEnd == nameStart or not closed) {
+            // not a variable reference, keep the dollar sign as is
+            expanded.push_back('$');
+            pos = dollarPos + 1;
+            continue;
+        }
+
+        expanded.append(lookupVariable(session, std::string{text.substr(nameStart, nameEnd - nameStart)}));
+        pos = nameEnd + (braced ? 1 : 0);
+    }
+
+    return expanded;
+}
+
+} // namespace replmk
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <functional>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "ProcessExecutor.h"
+#include "Session.h"
+
+namespace replmk {
+
+// runs a catalog command, given as name followed by its arguments. Used by builtins wrapping other commands
+using BuiltinCommandRunner = std::function<bool(const std::vector<std::string>&)>;
+
+/**
+ * Builtin commands run inside the REPL process, without fork or exec.
+ * They write their output through the same callbacks used for spawned processes
+ */
+using BuiltinCommandFunction = std::function<bool(const std::vector<std::string>& args, Session& session,
+                                                  const CommandOutputCallbacks& callbacks, const BuiltinCommandRunner& runner)>;
+
+using BuiltinCommandRegistry = std::map<std::string, BuiltinCommandFunction, std::less<>>;
+
+[[nodiscard]]
+auto getBuiltinCommandRegistry() -> const BuiltinCommandRegistry&;
+
+[[nodiscard]]
+auto isBuiltinCommand(std::string_view builtinName) -> bool;
+
+// session variables are expanded in the arguments of echo, except in those marked by literalArgs
+auto executeBuiltin(std::string_view builtinName, const std::vector<std::string>& args, Session& session,
+                    const CommandOutputCallbacks& callbacks, const BuiltinCommandRunner& runner,
+                    const std::vector<bool>& literalArgs = {}) -> bool;
+
+// resolves a path the way a spawned process running in the session working directory would see it
+[[nodiscard]]
+auto resolveSessionPath(const Session& session, const std::filesystem::path& path) -> std::filesystem::path;
+
+[[nodiscard]]
+auto expandSessionVariables(const Session& session, std::string_view text) -> std::string;
+
+} // namespace replmk
@@ -1,10 +1,14 @@
 #pragma once
 
+#include <chrono>
 #include <string>
 #include <cstdint>
 #include <map>
 #include <vector>
 
+#include "ArgumentSchema.h"
+#include "ResourceLimits.h"
+
 namespace replmk {
 
 enum class CommandType: uint8_t {
@@ -12,10 +16,29 @@ enum class CommandType: uint8_t {
     Single,
     Shell,
     Script,
+    Builtin,
+    Plugin,
+    Follow,
     InternalHelp,
-    InternalExit
+    InternalExit,
+    InternalJobs,
+    InternalForeground,
+    InternalTail,
+    InternalKill,
+    InternalRun,
+    InternalRefresh,
+    InternalWatch,
+    InternalStats
 };
 
+// handled by the REPL itself instead of being run
+[[nodiscard]] inline auto isInternalCommandType(CommandType cmdType) -> bool {
+    return cmdType == CommandType::InternalHelp or cmdType == CommandType::InternalExit or cmdType == CommandType::InternalJobs or
+           cmdType == CommandType::InternalForeground or cmdType == CommandType::InternalTail or cmdType == CommandType::InternalKill or
+           cmdType == CommandType::InternalRun or cmdType == CommandType::InternalRefresh or cmdType == CommandType::InternalWatch or
+           cmdType == CommandType::InternalStats;
+}
+
 [[nodiscard]] inline auto toCommandType(const std::string& typeString) {
     if (typeString == "single") {
         return CommandType::Single;
@@ -26,6 +49,15 @@ enum class CommandType: uint8_t {
     if (typeString == "script") {
         return CommandType::Script;
     }
+    if (typeString == "builtin") {
+        return CommandType::Builtin;
+    }
+    if (typeString == "plugin") {
+        return CommandType::Plugin;
+    }
+    if (typeString == "follow") {
+        return CommandType::Follow;
+    }
     // these shouldn't really be used in definitions
     if (typeString == "internal_help") {
         return CommandType::InternalHelp;
@@ -45,14 +77,54 @@ inline auto trimString(const std::string& str) -> std::string {
     return str.substr(start, end - start + 1);
 }
 
+// output of identical runs is replayed, instead of running the command again, until ttl passes or a file changes
+struct CommandCachePolicy {
+    std::chrono::seconds ttl{0};
+    // relative paths are resolved against the session working directory, '~/' against the home directory
+    std::vector<std::string> dependsOnFiles{};
+
+    [[nodiscard]] auto IsEnabled() const -> bool {
+        return this->ttl.count() > 0;
+    }
+};
+
+// outputs larger than head and tail together keep only their first and last bytes, the middle is counted and left out
+struct OutputRetentionPolicy {
+    uint64_t headBytes{0};
+    uint64_t tailBytes{0};
+    // the whole output is written to a file of its own too, so what was left out can still be read
+    bool keepFullOutput{false};
+
+    [[nodiscard]] auto IsEnabled() const -> bool {
+        return this->headBytes + this->tailBytes > 0;
+    }
+};
+
 struct Command {
     CommandType cmdType{CommandType::Unknown};
 
     std::string name;
     std::string description;
     std::string exec;
+
+    ArgumentSchema argsSchema{};
+
+    // plugin commands only. exec is the shared object path and symbol the function it exports
+    std::string symbol{};
+    bool isolated{false};
+
+    // single and shell commands only, run in a pseudo-terminal instead of with pipes
+    bool pty{false};
+    // single and shell commands only, stopped once they run for longer. Zero for no limit
+    std::chrono::seconds timeout{0};
+    // single and shell commands only, what the command may use while it runs
+    ResourceLimits limits{};
+
+    CommandCachePolicy cache{};
+    // the one of the definition unless the command has its own, no limit when neither does
+    OutputRetentionPolicy outputRetention{};
 };
 
-using CommandCatalog = std::map<std::string, Command>;
+using CommandCatalog = std::map<std::string, Command, std::less<>>;
 using ResolvedCommand = std::tuple<Command, std::vector<std::string>> ;
 }
@@ -0,0 +1,291 @@
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include "CommandCache.h"
+
+namespace replmk {
+
+namespace {
+
+constexpr std::string_view EntryHeader = "replmk-cache 1\n";
+constexpr std::string_view EntryExtension = ".entry";
+constexpr uint64_t FnvOffsetBasis = 14695981039346656037ULL;
+constexpr uint64_t FnvPrime = 1099511628211ULL;
+
+// FNV-1a, only used to name files. Entries keep their whole key, so a collision is a miss and never a wrong output
+auto hashBytes(std::string_view bytes) -> uint64_t {
+    uint64_t hash = FnvOffsetBasis;
+    for (const char byte : bytes) {
+        hash ^= static_cast<unsigned char>(byte);
+        hash *= FnvPrime;
+    }
+    return hash;
+}
+
+auto commandFilePrefix(std::string_view commandName) -> std::string {
+    return std::format("{:016x}-", hashBytes(commandName));
+}
+
+// length prefixed, so no value can be mistaken for the next one
+auto appendField(std::string& text, std::string_view field) -> void {
+    text.append(std::to_string(field.size())).append(":").append(field).append("\n");
+}
+
+auto readWholeFile(const std::filesystem::path& filePath) -> std::optional<std::string> {
+    std::ifstream file{filePath, std::ios::binary};
+    if (not file.is_open()) {
+        return std::nullopt;
+    }
+    return std::string{std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{}};
+}
+
+// '~/' at the start stands for the home directory, like in a shell
+auto expandHomeDirectory(const std::string& filePath) -> std::filesystem::path {
+    const auto* home = std::getenv("HOME"); //NOLINT(concurrency-mt-unsafe)
+    if (not filePath.starts_with("~/") or home == nullptr) {
+        return filePath;
+    }
+    return std::filesystem::path{home} / filePath.substr(2);
+}
+
+auto fileFingerprint(const std::filesystem::path& filePath) -> std::string {
+    std::error_code sizeError;
+    std::error_code timeError;
+    const auto fileSize = std::filesystem::file_size(filePath, sizeError);
+    const auto modificationTime = std::filesystem::last_write_time(filePath, timeError);
+    const auto content = readWholeFile(filePath);
+    if (sizeError or timeError or not content.has_value()) {
+        return "missing";
+    }
+    return std::format("{} {} {:016x}", fileSize, modificationTime.time_since_epoch().count(), hashBytes(content.value()));
+}
+
+// a decimal length, a newline and that many bytes, taken from the front of entry
+auto takeField(std::string_view& entry) -> std::optional<std::string_view> {
+    const auto lengthEnd = entry.find('\n');
+    if (lengthEnd == std::string_view::npos) {
+        return std::nullopt;
+    }
+    size_t length = 0;
+    const auto* const lengthTextEnd = entry.data() + lengthEnd; //NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    const auto [ptr, errorCode] = std::from_chars(entry.data(), lengthTextEnd, length);
+    if (errorCode != std::errc{} or ptr != lengthTextEnd or entry.size() - lengthEnd - 1 < length) {
+        return std::nullopt;
+    }
+    const auto field = entry.substr(lengthEnd + 1, length);
+    entry.remove_prefix(lengthEnd + 1 + length);
+    return field;
+}
+
+auto appendEntryField(std::string& entry, std::string_view field) -> void {
+    entry.append(std::to_string(field.size())).append("\n").append(field);
+}
+
+} // namespace
+
+auto parseCacheTtl(std::string_view text) -> std::optional<std::chrono::seconds> {
+    uint64_t amount = 0;
+    const auto* const textEnd = text.data() + text.size(); //NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    const auto [unitStart, errorCode] = std::from_chars(text.data(), textEnd, amount);
+    if (errorCode != std::errc{} or amount == 0) {
+        return std::nullopt;
+    }
+
+    constexpr uint64_t SecondsPerMinute = 60;
+    constexpr uint64_t SecondsPerHour = 60 * SecondsPerMinute;
+    constexpr uint64_t SecondsPerDay = 24 * SecondsPerHour;
+    const std::string_view unit{unitStart, textEnd};
+    uint64_t multiplier = 0;
+    if (unit.empty() or unit == "s") {
+        multiplier = 1;
+    } else if (unit == "m") {
+        multiplier = SecondsPerMinute;
+    } else if (unit == "h") {
+        multiplier = SecondsPerHour;
+    } else if (unit == "d") {
+        multiplier = SecondsPerDay;
+    } else {
+        return std::nullopt;
+    }
+    return std::chrono::seconds{static_cast<std::chrono::seconds::rep>(amount * multiplier)};
+}
+
+auto defaultCommandCacheDirectory() -> std::filesystem::path {
+    if (const auto* cacheHome = std::getenv("XDG_CACHE_HOME"); cacheHome != nullptr and *cacheHome != '\0') { //NOLINT(concurrency-mt-unsafe)
+        return std::filesystem::path{cacheHome} / "replmk";
+    }
+    if (const auto* home = std::getenv("HOME"); home != nullptr and *home != '\0') { //NOLINT(concurrency-mt-unsafe)
+        return std::filesystem::path{home} / ".cache" / "replmk";
+    }
+    return std::filesystem::temp_directory_path() / "replmk-cache";
+}
+
+auto CommandCacheKey::FileName() const -> std::string {
+    return std::format("{}{:016x}{}", commandFilePrefix(this->commandName), hashBytes(this->text), EntryExtension);
+}
+
+auto makeCommandCacheKey(const Command& command, const std::vector<std::string>& args, const std::filesystem::path& workingDirectory,
+                         const std::map<std::string, std::string>& variables, const std::vector<bool>& literalArgs) -> CommandCacheKey {
+    CommandCacheKey key{.commandName = command.name, .text = {}};
+    auto& text = key.text;
+
+    appendField(text, std::to_string(static_cast<int>(command.cmdType)));
+    appendField(text, command.name);
+    appendField(text, command.exec);
+    appendField(text, command.symbol);
+
+    appendField(text, std::to_string(args.size()));
+    for (const auto& arg : args) {
+        appendField(text, arg);
+    }
+    std::string literalFlags;
+    for (const bool literal : literalArgs) {
+        literalFlags.push_back(literal ? '1' : '0');
+    }
+    appendField(text, literalFlags);
+
+    appendField(text, workingDirectory.string());
+    appendField(text, std::to_string(variables.size()));
+    for (const auto& [name, value] : variables) {
+        appendField(text, name);
+        appendField(text, value);
+    }
+
+    // the inherited environment, sorted, so the same variables make the same key whatever their order.
+    // Entries outlive the REPL, and a later one started under another KUBECONFIG or PATH must not replay them
+    std::vector<std::string_view> environment;
+    for (char** envEntry = environ; *envEntry != nullptr; envEntry++) { //NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+        environment.emplace_back(*envEntry);
+    }
+    std::ranges::sort(environment);
+    appendField(text, std::to_string(environment.size()));
+    for (const auto& entry : environment) {
+        appendField(text, entry);
+    }
+
+    for (const auto& dependency : command.cache.dependsOnFiles) {
+        const auto dependencyPath = expandHomeDirectory(dependency);
+        const auto resolvedPath = dependencyPath.is_absolute() or workingDirectory.empty() ? dependencyPath : workingDirectory / dependencyPath;
+        appendField(text, resolvedPath.string());
+        appendField(text, fileFingerprint(resolvedPath));
+    }
+    return key;
+}
+
+auto CommandCache::Find(const CommandCacheKey& key, std::chrono::seconds ttl) const -> std::optional<CachedOutput> {
+    if (not this->IsEnabled()) {
+        return std::nullopt;
+    }
+
+    const auto entryPath = this->directory / key.FileName();
+    const auto content = readWholeFile(entryPath);
+    if (not content.has_value()) {
+        return std::nullopt;
+    }
+
+    std::string_view entry = content.value();
+    if (not entry.starts_with(EntryHeader)) {
+        return std::nullopt;
+    }
+    entry.remove_prefix(EntryHeader.size());
+
+    const auto createdField = takeField(entry);
+    const auto keyField = takeField(entry);
+    const auto stdOutField = takeField(entry);
+    const auto stdErrField = takeField(entry);
+    if (not createdField or not keyField or not stdOutField or not stdErrField or keyField.value() != key.text) {
+        return std::nullopt;
+    }
+
+    std::chrono::system_clock::rep createdTicks = 0;
+    const auto* const createdEnd = createdField->data() + createdField->size(); //NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    if (std::from_chars(createdField->data(), createdEnd, createdTicks).ec != std::errc{}) {
+        return std::nullopt;
+    }
+
+    const auto age = std::chrono::system_clock::now() - std::chrono::system_clock::time_point{std::chrono::system_clock::duration{createdTicks}};
+    if (age >= ttl or age.count() < 0) {
+        std::error_code errorCode;
+        std::filesystem::remove(entryPath, errorCode);
+        return std::nullopt;
+    }
+    return CachedOutput{.stdOut = std::string{stdOutField.value()}, .stdErr = std::string{stdErrField.value()}, .age = age};
+}
+
+auto CommandCache::Store(const CommandCacheKey& key, std::string_view stdOut, std::string_view stdErr) const -> bool {
+    if (not this->IsEnabled()) {
+        return false;
+    }
+
+    std::error_code errorCode;
+    std::filesystem::create_directories(this->directory, errorCode);
+    if (errorCode) {
+        return false;
+    }
+
+    std::string entry{EntryHeader};
+    appendEntryField(entry, std::to_string(std::chrono::system_clock::now().time_since_epoch().count()));
+    appendEntryField(entry, key.text);
+    appendEntryField(entry, stdOut);
+    appendEntryField(entry, stdErr);
+
+    // unique per process and thread, jobs may store the same key at the same time
+    const auto entryPath = this->directory / key.FileName();
+    auto temporaryPath = entryPath;
+    temporaryPath += std::format(".{}.{}.tmp", ::getpid(), std::hash<std::thread::id>{}(std::this_thread::get_id()));
+    {
+        std::ofstream file{temporaryPath, std::ios::binary | std::ios::trunc};
+        if (not file.write(entry.data(), static_cast<std::streamsize>(entry.size()))) {
+            file.close();
+            std::filesystem::remove(temporaryPath, errorCode);
+            return false;
+        }
+    }
+
+    std::filesystem::rename(temporaryPath, entryPath, errorCode);
+    if (errorCode) {
+        std::filesystem::remove(temporaryPath, errorCode);
+        return false;
+    }
+    return true;
+}
+
+auto CommandCache::Forget(std::optional<std::string_view> commandName) const -> size_t {
+    if (not this->IsEnabled()) {
+        return 0;
+    }
+
+    const auto prefix = commandName.has_value() ? commandFilePrefix(commandName.value()) : std::string{};
+    size_t forgotten = 0;
+    std::error_code errorCode;
+    for (const auto& file : std::filesystem::directory_iterator{this->directory, errorCode}) {
+        const auto fileName = file.path().filename().string();
+        if (fileName.starts_with(prefix) and fileName.ends_with(EntryExtension) and std::filesystem::remove(file.path(), errorCode)) {
+            forgotten++;
+        }
+    }
+    return forgotten;
+}
+
+auto formatCacheHit(const Command& command, const CachedOutput& cached) -> std::string {
+    const auto seconds = std::chrono::duration_cast<std::chrono::seconds>(cached.age).count();
+    return std::format("(cached output from {}s ago, 'refresh {}' runs it again)\n", seconds, command.name);
+}
+
+} // namespace replmk
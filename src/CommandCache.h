@@ -0,0 +1,88 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <filesystem>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Command.h"
+
+namespace replmk {
+
+// '30', '30s', '5m', '2h' or '1d'. Empty when the text is none of those or zero
+[[nodiscard]] auto parseCacheTtl(std::string_view text) -> std::optional<std::chrono::seconds>;
+
+// where results are kept unless told otherwise, under $XDG_CACHE_HOME or ~/.cache
+[[nodiscard]] auto defaultCommandCacheDirectory() -> std::filesystem::path;
+
+/**
+ * Everything the output of a cached command depends on: the command, its arguments, working directory,
+ * session variables, the environment of the REPL and the size, modification time and content of the files it declares
+ */
+struct CommandCacheKey {
+    std::string commandName;
+    std::string text;
+
+    // named after hashes of the command and the key, so entries of a command can be found without reading them
+    [[nodiscard]] auto FileName() const -> std::string;
+};
+
+// literalArgs marks the arguments builtins don't expand variables in, '$X' and $X print different things
+[[nodiscard]] auto makeCommandCacheKey(const Command& command, const std::vector<std::string>& args, const std::filesystem::path& workingDirectory,
+                                       const std::map<std::string, std::string>& variables,
+                                       const std::vector<bool>& literalArgs = {}) -> CommandCacheKey;
+
+struct CachedOutput {
+    std::string stdOut{};
+    std::string stdErr{};
+    std::chrono::system_clock::duration age{};
+};
+
+/**
+ * Output of successful runs of commands declaring a cache, one file per key in a directory.
+ * Files are written whole to a temporary name and renamed, so REPLs and jobs sharing the directory never read half an entry
+ */
+class CommandCache final {
+  private:
+    // empty when caching is off
+    std::filesystem::path directory;
+
+  public:
+    CommandCache() = default;
+    CommandCache(const CommandCache&) = delete;
+    CommandCache(CommandCache&&) = delete;
+
+    auto operator=(const CommandCache&) -> CommandCache& = delete;
+    auto operator=(CommandCache&&) -> CommandCache& = delete;
+
+    auto SetDirectory(std::filesystem::path cacheDirectory) -> void {
+        this->directory = std::move(cacheDirectory);
+    }
+
+    [[nodiscard]] auto Directory() const -> const std::filesystem::path& {
+        return this->directory;
+    }
+
+    [[nodiscard]] auto IsEnabled() const -> bool {
+        return not this->directory.empty();
+    }
+
+    // the stored output when there is one for the key younger than ttl. Expired entries are removed
+    [[nodiscard]] auto Find(const CommandCacheKey& key, std::chrono::seconds ttl) const -> std::optional<CachedOutput>;
+
+    auto Store(const CommandCacheKey& key, std::string_view stdOut, std::string_view stdErr) const -> bool;
+
+    // removes the entries of a command, or every entry, returning how many there were
+    auto Forget(std::optional<std::string_view> commandName) const -> size_t;
+
+    ~CommandCache() = default;
+};
+
+// the line telling a cached output was replayed instead of running the command
+[[nodiscard]] auto formatCacheHit(const Command& command, const CachedOutput& cached) -> std::string;
+
+} // namespace replmk
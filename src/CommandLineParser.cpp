@@ -0,0 +1,385 @@
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <utility>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "CommandLineParser.h"
+
+namespace replmk {
+
+namespace {
+
+enum class QuoteState: uint8_t {
+    Unquoted,
+    SingleQuoted,
+    DoubleQuoted
+};
+
+constexpr char EscapeChar = '\\';
+constexpr char VariableChar = '$';
+constexpr char SingleQuoteChar = '\'';
+constexpr char DoubleQuoteChar = '"';
+constexpr char SequenceChar = ';';
+constexpr char AmpersandChar = '&';
+constexpr char PipeChar = '|';
+constexpr char RedirectChar = '>';
+constexpr char StdErrDescriptorChar = '2';
+
+// same set as isspace in the C locale
+constexpr auto isWordSeparator(char character) -> bool {
+    return character == ' ' or (character >= '\t' and character <= '\r');
+}
+
+constexpr auto isSpecialChar(char character, QuoteState state) -> bool {
+    switch (state) {
+    case QuoteState::SingleQuoted:
+        return character == SingleQuoteChar or character == EscapeChar;
+    case QuoteState::DoubleQuoted:
+        return character == DoubleQuoteChar or character == EscapeChar;
+    case QuoteState::Unquoted:
+    default:
+        return character == SingleQuoteChar or character == DoubleQuoteChar or character == EscapeChar or
+               character == SequenceChar or character == AmpersandChar or character == PipeChar or character == RedirectChar or
+               isWordSeparator(character);
+    }
+}
+
+#if defined(__SSE2__)
+constexpr size_t SimdBlockSize = sizeof(__m128i);
+
+// bit i is set when block[i] is special in the given state
+auto specialCharsMask(__m128i block, QuoteState state) -> uint32_t {
+    constexpr char FirstControlSeparator = '\t';
+    constexpr char ControlSeparatorsRange = '\r' - '\t';
+
+    __m128i hits = _mm_cmpeq_epi8(block, _mm_set1_epi8(EscapeChar));
+    if (state != QuoteState::DoubleQuoted) {
+        hits = _mm_or_si128(hits, _mm_cmpeq_epi8(block, _mm_set1_epi8(SingleQuoteChar)));
+    }
+    if (state != QuoteState::SingleQuoted) {
+        hits = _mm_or_si128(hits, _mm_cmpeq_epi8(block, _mm_set1_epi8(DoubleQuoteChar)));
+    }
+    if (state == QuoteState::Unquoted) {
+        // '\t' to '\r' in one go: (c - '\t') as unsigned is at most the range when min leaves it unchanged
+        const __m128i shifted = _mm_sub_epi8(block, _mm_set1_epi8(FirstControlSeparator));
+        const __m128i inRange = _mm_cmpeq_epi8(_mm_min_epu8(shifted, _mm_set1_epi8(ControlSeparatorsRange)), shifted);
+        hits = _mm_or_si128(hits, _mm_or_si128(inRange, _mm_cmpeq_epi8(block, _mm_set1_epi8(' '))));
+        hits = _mm_or_si128(hits, _mm_cmpeq_epi8(block, _mm_set1_epi8(SequenceChar)));
+        hits = _mm_or_si128(hits, _mm_cmpeq_epi8(block, _mm_set1_epi8(AmpersandChar)));
+        hits = _mm_or_si128(hits, _mm_cmpeq_epi8(block, _mm_set1_epi8(PipeChar)));
+        hits = _mm_or_si128(hits, _mm_cmpeq_epi8(block, _mm_set1_epi8(RedirectChar)));
+    }
+    return static_cast<uint32_t>(_mm_movemask_epi8(hits));
+}
+#endif
+
+// position of the next character that ends a plain run in the given state, or line.size()
+auto findSpecialChar(std::string_view line, size_t pos, QuoteState state) -> size_t {
+#if defined(__SSE2__)
+    while (pos + SimdBlockSize <= line.size()) {
+        const auto block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(line.data() + pos)); //NOLINT(cppcoreguidelines-pro-type-reinterpret-cast,cppcoreguidelines-pro-bounds-pointer-arithmetic)
+        if (const auto mask = specialCharsMask(block, state); mask != 0) {
+            return pos + static_cast<size_t>(std::countr_zero(mask));
+        }
+        pos += SimdBlockSize;
+    }
+#endif
+    while (pos < line.size() and not isSpecialChar(line[pos], state)) {
+        pos++;
+    }
+    return pos;
+}
+
+// writes unescaped words back to back, each followed by a NUL, into a buffer sized for the whole line
+class WordWriter {
+  private:
+    std::span<char> buffer;
+    size_t writePos{0};
+    size_t wordStart{0};
+
+  public:
+    explicit WordWriter(std::span<char> outBuffer) : buffer(outBuffer) {}
+
+    auto Append(std::string_view text) -> void {
+        std::memcpy(this->buffer.subspan(this->writePos).data(), text.data(), text.size());
+        this->writePos += text.size();
+    }
+
+    // returns true when a word was added
+    auto FinishWord(std::pmr::vector<std::string_view>& words) -> bool {
+        // empty words, like a lone "", are dropped
+        if (this->writePos == this->wordStart) {
+            return false;
+        }
+        words.emplace_back(this->buffer.subspan(this->wordStart, this->writePos - this->wordStart).data(), this->writePos - this->wordStart);
+        this->buffer[this->writePos++] = '\0';
+        this->wordStart = this->writePos;
+        return true;
+    }
+
+    [[nodiscard]] auto PendingWord() const -> std::string_view {
+        return {this->buffer.subspan(this->wordStart, this->writePos - this->wordStart).data(), this->writePos - this->wordStart};
+    }
+
+    auto DiscardWord() -> void {
+        this->writePos = this->wordStart;
+    }
+};
+
+auto toggleQuote(QuoteState state, char quoteChar) -> QuoteState {
+    const auto quotedState = quoteChar == SingleQuoteChar ? QuoteState::SingleQuoted : QuoteState::DoubleQuoted;
+    return state == QuoteState::Unquoted ? quotedState : QuoteState::Unquoted;
+}
+
+auto trimWhitespace(std::string_view text) -> std::string_view {
+    while (not text.empty() and isWordSeparator(text.front())) {
+        text.remove_prefix(1);
+    }
+    while (not text.empty() and isWordSeparator(text.back())) {
+        text.remove_suffix(1);
+    }
+    return text;
+}
+
+// a single '&' with nothing but whitespace after it, anywhere else it is a regular character
+auto isBackgroundMarker(std::string_view line, size_t pos) -> bool {
+    return line[pos] == AmpersandChar and trimWhitespace(line.substr(pos + 1)).empty();
+}
+
+// operator starting at pos, if any, and its length. A single '&' is a regular character
+auto matchOperator(std::string_view line, size_t pos) -> std::pair<CommandOperator, size_t> {
+    const char operatorChar = line[pos];
+    if (operatorChar == SequenceChar) {
+        return {CommandOperator::Sequence, 1};
+    }
+    if (pos + 1 < line.size() and line[pos + 1] == operatorChar) {
+        return {operatorChar == AmpersandChar ? CommandOperator::AndThen : CommandOperator::OrElse, 2};
+    }
+    if (operatorChar == PipeChar) {
+        return {CommandOperator::Pipe, 1};
+    }
+    return {CommandOperator::None, 1};
+}
+
+// closes the current segment when an operator, or the end of the line, is reached
+class SegmentBuilder {
+  private:
+    std::string_view source;
+    size_t firstWord{0};
+    size_t sourceStart{0};
+
+    // index of the first redirection token, the command words end there
+    std::optional<size_t> redirectionsStart;
+    SegmentRedirection* pendingTarget{nullptr};
+    SegmentRedirection stdOutRedirection;
+    SegmentRedirection stdErrRedirection;
+
+  public:
+    explicit SegmentBuilder(std::string_view sourceLine) : source(sourceLine) {}
+
+    [[nodiscard]] auto Close(std::pmr::vector<CommandSegment>& segments, const std::pmr::vector<std::string_view>& words,
+                             size_t sourceEnd, CommandOperator followedBy) -> bool {
+        if (this->pendingTarget != nullptr) {
+            return false;
+        }
+
+        const auto wordCount = this->redirectionsStart.value_or(words.size()) - this->firstWord;
+        if (wordCount == 0) {
+            // only a trailing ';' may be left without a command, like in a shell
+            const bool trailingSequence = followedBy == CommandOperator::None and not this->redirectionsStart.has_value() and
+                                          (segments.empty() or segments.back().followedBy == CommandOperator::Sequence);
+            return trailingSequence;
+        }
+
+        segments.push_back(CommandSegment{
+            .firstWord = this->firstWord,
+            .wordCount = wordCount,
+            .source = trimWhitespace(this->source.substr(this->sourceStart, sourceEnd - this->sourceStart)),
+            .followedBy = followedBy,
+            .stdOutRedirection = this->stdOutRedirection,
+            .stdErrRedirection = this->stdErrRedirection
+        });
+        return true;
+    }
+
+    // called with the redirection token already added to words. A stream can only be redirected once
+    [[nodiscard]] auto BeginRedirection(const std::pmr::vector<std::string_view>& words, bool stdErr, bool append) -> bool {
+        auto& redirection = stdErr ? this->stdErrRedirection : this->stdOutRedirection;
+        if (this->pendingTarget != nullptr or redirection.IsSet()) {
+            return false;
+        }
+        if (not this->redirectionsStart.has_value()) {
+            this->redirectionsStart = words.size() - 1;
+        }
+        redirection.append = append;
+        this->pendingTarget = &redirection;
+        return true;
+    }
+
+    // once redirections start, the only words allowed are their targets
+    [[nodiscard]] auto OnWord(const std::pmr::vector<std::string_view>& words) -> bool {
+        if (this->pendingTarget != nullptr) {
+            this->pendingTarget->target = words.back();
+            this->pendingTarget = nullptr;
+            return true;
+        }
+        return not this->redirectionsStart.has_value();
+    }
+
+    // words, or redirections, seen since the segment started
+    [[nodiscard]] auto HasWords(const std::pmr::vector<std::string_view>& words) const -> bool {
+        return words.size() > this->firstWord;
+    }
+
+    auto StartAfterOperator(const std::pmr::vector<std::string_view>& words, size_t sourcePos) -> void {
+        this->firstWord = words.size();
+        this->sourceStart = sourcePos;
+        this->redirectionsStart.reset();
+        this->stdOutRedirection = {};
+        this->stdErrRedirection = {};
+    }
+};
+
+constexpr auto redirectionText(bool stdErr, bool append) -> std::string_view {
+    if (stdErr) {
+        return append ? "2>>" : "2>";
+    }
+    return append ? ">>" : ">";
+}
+
+constexpr auto operatorText(CommandOperator cmdOperator) -> std::string_view {
+    switch (cmdOperator) {
+    case CommandOperator::Sequence:
+        return ";";
+    case CommandOperator::AndThen:
+        return "&&";
+    case CommandOperator::OrElse:
+        return "||";
+    case CommandOperator::Pipe:
+        return "|";
+    case CommandOperator::None:
+    default:
+        return "";
+    }
+}
+
+} // namespace
+
+auto CommandLineTokens::Tokenize(std::string_view line) -> bool {
+    // drop the previous words before rewinding the arena they live in
+    this->tokens = std::pmr::vector<std::string_view>{&this->arena};
+    this->segments = std::pmr::vector<CommandSegment>{&this->arena};
+    this->literalWords = std::pmr::vector<size_t>{&this->arena};
+    this->background = false;
+    this->arena.release();
+
+    // unescaped words plus their terminators never take more room than the line plus one NUL.
+    // The line itself is copied too, segments keep their source text
+    auto* outBuffer = static_cast<char*>(this->arena.allocate(line.size() + 1, 1));
+    auto* sourceBuffer = static_cast<char*>(this->arena.allocate(line.size() + 1, 1));
+    std::memcpy(sourceBuffer, line.data(), line.size());
+    line = std::string_view{sourceBuffer, line.size()};
+
+    WordWriter writer{std::span<char>{outBuffer, line.size() + 1}};
+    SegmentBuilder segmentBuilder{line};
+
+    const auto fail = [this]() {
+        this->tokens.clear();
+        this->segments.clear();
+        this->literalWords.clear();
+        this->background = false;
+        return false;
+    };
+    // set when a '$' of the pending word was single quoted or escaped
+    bool literalWord = false;
+    const auto finishWord = [this, &writer, &segmentBuilder, &literalWord]() -> bool {
+        const bool literal = std::exchange(literalWord, false);
+        if (not writer.FinishWord(this->tokens)) {
+            return true;
+        }
+        if (literal) {
+            this->literalWords.push_back(this->tokens.size() - 1);
+        }
+        return segmentBuilder.OnWord(this->tokens);
+    };
+
+    auto state = QuoteState::Unquoted;
+    size_t pos = 0;
+    size_t lineEnd = line.size();
+    while (pos < line.size()) {
+        const auto specialPos = findSpecialChar(line, pos, state);
+        const auto plainText = line.substr(pos, specialPos - pos);
+        literalWord = literalWord or (state == QuoteState::SingleQuoted and plainText.contains(VariableChar));
+        writer.Append(plainText);
+        if (specialPos == line.size()) {
+            break;
+        }
+
+        const char specialChar = line[specialPos];
+        pos = specialPos + 1;
+        if (specialChar == EscapeChar) {
+            if (pos == line.size()) {
+                return fail();
+            }
+            literalWord = literalWord or line[pos] == VariableChar;
+            writer.Append(line.substr(pos, 1));
+            pos++;
+        } else if (specialChar == SingleQuoteChar or specialChar == DoubleQuoteChar) {
+            state = toggleQuote(state, specialChar);
+        } else if (isWordSeparator(specialChar)) {
+            if (not finishWord()) {
+                return fail();
+            }
+        } else if (specialChar == RedirectChar) {
+            // '2>' only when the 2 is a word of its own, 'a2>' is the word 'a2' redirected to stdout
+            const bool stdErr = writer.PendingWord() == std::string_view{&StdErrDescriptorChar, 1} and line[specialPos - 1] == StdErrDescriptorChar;
+            if (stdErr) {
+                writer.DiscardWord();
+            } else if (not finishWord()) {
+                return fail();
+            }
+            const bool append = pos < line.size() and line[pos] == RedirectChar;
+            pos += append ? 1 : 0;
+            this->tokens.push_back(redirectionText(stdErr, append));
+            if (not segmentBuilder.BeginRedirection(this->tokens, stdErr, append)) {
+                return fail();
+            }
+        } else if (isBackgroundMarker(line, specialPos)) {
+            if (not finishWord() or not segmentBuilder.HasWords(this->tokens)) {
+                return fail();
+            }
+            this->background = true;
+            lineEnd = specialPos;
+            break;
+        } else if (const auto [cmdOperator, operatorLength] = matchOperator(line, specialPos); cmdOperator == CommandOperator::None) {
+            writer.Append(line.substr(specialPos, operatorLength));
+        } else {
+            if (not finishWord() or not segmentBuilder.Close(this->segments, this->tokens, specialPos, cmdOperator)) {
+                return fail();
+            }
+            this->tokens.push_back(operatorText(cmdOperator));
+            pos = specialPos + operatorLength;
+            segmentBuilder.StartAfterOperator(this->tokens, pos);
+        }
+    }
+
+    if (state != QuoteState::Unquoted) {
+        return fail();
+    }
+    if (not finishWord() or not segmentBuilder.Close(this->segments, this->tokens, lineEnd, CommandOperator::None)) {
+        return fail();
+    }
+    if (this->background) {
+        this->tokens.emplace_back("&");
+    }
+    return true;
+}
+
+} // namespace replmk
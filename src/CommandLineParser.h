@@ -1,47 +1,123 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include <memory_resource>
+#include <optional>
+#include <span>
 #include <string>
+#include <string_view>
 #include <vector>
-#include <optional>
 
 namespace replmk {
 
+// unquoted operators joining the commands of a line
+enum class CommandOperator: uint8_t {
+    None,
+    Sequence, // ;
+    AndThen,  // &&
+    OrElse,   // ||
+    Pipe      // |
+};
 
-inline auto ParseCommandLine(const std::string& input) -> std::optional<std::vector<std::string>> {
-    std::vector<std::string> cmdAndArgs;
-    std::string current;
-    bool inSingle = false;
-    bool inDouble = false;
-    bool escape = false;
-
-    for (char inChar : input) {
-        if (escape) {
-            current += inChar;
-            escape = false;
-        } else if (inChar == '\\') {
-            escape = true;
-        } else if (inChar == '\'' && !inDouble) {
-            inSingle = !inSingle;
-        } else if (inChar == '"' && !inSingle) {
-            inDouble = !inDouble;
-        } else if ((isspace(inChar) != 0) && !inSingle && !inDouble) {
-            if (!current.empty()) {
-                cmdAndArgs.push_back(current);
-                current.clear();
-            }
-        } else {
-            current += inChar;
-        }
-    }
-    if (escape || inSingle || inDouble) {
-        return std::nullopt;
+// file named after an unquoted '>' or '>>', or '2>' and '2>>' for stderr
+struct SegmentRedirection {
+    // empty when the stream isn't redirected
+    std::string_view target{};
+    bool append{false};
+
+    [[nodiscard]] auto IsSet() const -> bool {
+        return not this->target.empty();
     }
-    if (!current.empty()) {
-        cmdAndArgs.push_back(current);
+};
+
+/**
+ * Words of one command in a line, and the operator separating it from the next one.
+ * source is the original, still quoted, text of the command, without surrounding whitespace.
+ * Redirections go after the words of the command and are not part of them
+ */
+struct CommandSegment {
+    size_t firstWord{0};
+    size_t wordCount{0};
+    std::string_view source{};
+    CommandOperator followedBy{CommandOperator::None};
+    SegmentRedirection stdOutRedirection{};
+    SegmentRedirection stdErrRedirection{};
+};
+
+/**
+ * Splits a command line into words in a single pass, honouring single and double quotes and backslash escapes.
+ * Words are written, unescaped and NUL terminated, into a monotonic arena owned by this object, so tokenizing
+ * does not allocate per character or per word. The views returned are valid until the next Tokenize call.
+ * Unquoted operators end a segment and are kept as words of their own, so Tokens still sees the whole line.
+ * A lone '&' ending the line asks for the whole line to run in the background, it is the last word but in no segment
+ */
+class CommandLineTokens final {
+  private:
+    static constexpr size_t InlineArenaSize = 1024;
+
+    std::array<std::byte, InlineArenaSize> inlineArena{};
+    std::pmr::monotonic_buffer_resource arena{inlineArena.data(), inlineArena.size()};
+    std::pmr::vector<std::string_view> tokens{&arena};
+    std::pmr::vector<CommandSegment> segments{&arena};
+    // indexes, in order, of the words with a single quoted or escaped '$'
+    std::pmr::vector<size_t> literalWords{&arena};
+    bool background{false};
+
+  public:
+    CommandLineTokens() = default;
+    CommandLineTokens(const CommandLineTokens&) = delete;
+    CommandLineTokens(CommandLineTokens&&) = delete;
+
+    auto operator=(const CommandLineTokens&) -> CommandLineTokens& = delete;
+    auto operator=(CommandLineTokens&&) -> CommandLineTokens& = delete;
+
+    // returns false, with no tokens, when a quote isn't closed, the line ends with an escape, an operator has no command
+    // or a redirection has no file or is followed by more words
+    [[nodiscard]] auto Tokenize(std::string_view line) -> bool;
+
+    [[nodiscard]] auto Tokens() const -> std::span<const std::string_view> {
+        return this->tokens;
     }
-    return cmdAndArgs;
-}
 
+    // one per command in the line. A line without operators has a single segment, empty lines have none
+    [[nodiscard]] auto Segments() const -> std::span<const CommandSegment> {
+        return this->segments;
+    }
 
+    [[nodiscard]] auto IsBackground() const -> bool {
+        return this->background;
+    }
+
+    [[nodiscard]] auto SegmentWords(const CommandSegment& segment) const -> std::span<const std::string_view> {
+        return std::span{this->tokens}.subspan(segment.firstWord, segment.wordCount);
+    }
+
+    // true when a '$' in the word was single quoted or escaped, so variables are not expanded in it
+    [[nodiscard]] auto IsLiteralWord(size_t tokenIndex) const -> bool {
+        return std::ranges::binary_search(this->literalWords, tokenIndex);
+    }
+
+    [[nodiscard]] auto Arena() -> std::pmr::memory_resource* {
+        return &this->arena;
+    }
+
+    ~CommandLineTokens() = default;
+};
+
+[[nodiscard]]
+inline auto ToStrings(std::span<const std::string_view> words) -> std::vector<std::string> {
+    return {words.begin(), words.end()};
+}
+
+inline auto ParseCommandLine(std::string_view input) -> std::optional<std::vector<std::string>> {
+    CommandLineTokens tokens;
+    if (not tokens.Tokenize(input)) {
+        return std::nullopt;
+    }
+    return ToStrings(tokens.Tokens());
+}
 
 } // namespace replmk
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "Command.h"
+#include "OutputFilters.h"
+
+namespace replmk {
+
+// when a step runs, based on the result of the last step that did run
+enum class StepCondition: uint8_t {
+    Always,    // first step, or after ';'
+    OnSuccess, // after '&&'
+    OnFailure  // after '||'
+};
+
+struct PlannedCommand {
+    const Command* command{nullptr};
+    std::vector<std::string> args{};
+    // one per argument, true where a '$' was single quoted or escaped so builtins don't expand variables in it
+    std::vector<bool> literalArgs{};
+};
+
+// '> file', '>> file' or the same with '2' for stderr, after the last command of a step
+struct OutputRedirection {
+    // as typed, relative paths are resolved against the session working directory. Empty when not redirected
+    std::string target{};
+    bool append{false};
+
+    [[nodiscard]] auto IsSet() const -> bool {
+        return not this->target.empty();
+    }
+};
+
+// '@each', the command of the step runs once per item with '{}' in its arguments replaced by the item
+struct FanOutPlan {
+    // 0 for one per processor
+    size_t concurrency{0};
+    // given after ':::'
+    std::vector<std::string> items{};
+    // commands piped into '@each', the lines they write, through the filters, are the items
+    std::vector<PlannedCommand> itemsPipeline{};
+    std::vector<OutputFilterSpec> itemsFilters{};
+};
+
+struct CommandPlanStep {
+    // a single command, or the commands of a pipeline joined with '|'
+    std::vector<PlannedCommand> pipeline{};
+    // the step as typed, shown as the prompt of its output entry
+    std::string source{};
+    StepCondition condition{StepCondition::Always};
+    // '@' filters after the last command, applied to the step stdout in the REPL
+    std::vector<OutputFilterSpec> outputFilters{};
+    OutputRedirection stdOutRedirection{};
+    OutputRedirection stdErrRedirection{};
+    std::optional<FanOutPlan> fanOut{};
+
+    [[nodiscard]] auto IsPipeline() const -> bool {
+        return this->pipeline.size() > 1;
+    }
+};
+
+struct CommandPlanError {
+    // source of the first command not found, empty when the line is wrong in some other way
+    std::string unknownCommand{};
+    std::string message{};
+};
+
+/**
+ * Catalog commands of a single input line, in execution order.
+ * Every command is resolved before the first one runs, so an unknown name anywhere runs nothing
+ */
+using CommandPlan = std::vector<CommandPlanStep>;
+
+[[nodiscard]] inline auto shouldRunStep(StepCondition condition, bool lastResult) -> bool {
+    switch (condition) {
+    case StepCondition::OnSuccess:
+        return lastResult;
+    case StepCondition::OnFailure:
+        return not lastResult;
+    case StepCondition::Always:
+    default:
+        return true;
+    }
+}
+
+} // namespace replmk
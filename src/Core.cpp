@@ -1,11 +1,20 @@
 #include "Core.h"
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <cstdlib>
 #include <filesystem>
 #include <utility>
 #include <optional>
 #include <format>
+#include <memory>
+#include <span>
+#include <thread>
+#include <tuple>
+
+#include <unistd.h>
 
 #include "Command.h"
 #include "CommandLineParser.h"
@@ -13,9 +22,35 @@
 #include "ProcessExecutor.h"
 #include "AutoCleanableScriptFile.h"
 #include "CommandHistory.h"
+#include "BuiltinCommands.h"
+#include "PluginCommands.h"
+#include "OutputFilters.h"
+#include "OutputRedirection.h"
+#include "JobTable.h"
+#include "FanOut.h"
+#include "Workflow.h"
+#include "CommandCache.h"
+#include "Watch.h"
+#include "FileFollower.h"
+#include "OutputRetention.h"
 
 namespace replmk {
 
+auto optionalIntegerArgument(std::string name, std::string description, double minValue) -> ArgumentSpec {
+    return ArgumentSpec{
+        .name = std::move(name),
+        .description = std::move(description),
+        .argType = ArgumentType::Integer,
+        .required = false,
+        .variadic = false,
+        .allowedValues = {},
+        .minValue = minValue,
+        .maxValue = std::nullopt,
+        .pattern = {},
+        .compiledPattern = nullptr
+    };
+}
+
 [[nodiscard]]
 auto buildInternalCommandCatalog(const REPLModifiers& modifiers) -> CommandCatalog {
     const auto helpCmd = Command{
@@ -27,45 +62,140 @@ auto buildInternalCommandCatalog(const REPLModifiers& modifiers) -> CommandCatal
 
     const auto exitCmd = Command{
         .cmdType = CommandType::InternalExit,
-        .name = MapGetOrDefault(modifiers, definition::AltExitCmdNameLabel, "exit"),
+        .name = MapGetOrDefault(modifiers, definition::AltExitCmdNameLabel, definition::DefaultExitKeyword),
         .description= MapGetOrDefault(modifiers, definition::AltExitCmdDescLabel, "Exit the application"),
         .exec = "",
     };
 
+    const auto jobIdArgument = optionalIntegerArgument("job", "Id of the job, the most recent one by default", 1);
+    const auto jobsCmd = Command{
+        .cmdType = CommandType::InternalJobs,
+        .name = definition::JobsKeyword,
+        .description = "List the commands started in the background with a trailing '&'",
+        .exec = "",
+    };
+
+    const auto foregroundCmd = Command{
+        .cmdType = CommandType::InternalForeground,
+        .name = definition::ForegroundKeyword,
+        .description = "Show the output of a background job and wait for it to finish",
+        .exec = "",
+        .argsSchema = {.arguments = {jobIdArgument}},
+    };
+
+    const auto tailCmd = Command{
+        .cmdType = CommandType::InternalTail,
+        .name = definition::TailKeyword,
+        .description = "Show the last lines of the output of a background job",
+        .exec = "",
+        .argsSchema = {.arguments = {jobIdArgument, optionalIntegerArgument("lines", "How many lines, 10 by default", 0)}},
+    };
+
+    const auto killCmd = Command{
+        .cmdType = CommandType::InternalKill,
+        .name = definition::KillKeyword,
+        .description = "Terminate a background job, or forget it once it has finished",
+        .exec = "",
+        .argsSchema = {.arguments = {jobIdArgument}},
+    };
+
+    const auto runCmd = Command{
+        .cmdType = CommandType::InternalRun,
+        .name = definition::RunKeyword,
+        .description = "Run a workflow of the definition, independent steps in parallel. Lists the workflows when no name is given",
+        .exec = "",
+        .argsSchema = {.arguments = {ArgumentSpec{
+            .name = "workflow",
+            .description = "Name of the workflow",
+            .argType = ArgumentType::String,
+            .required = false,
+            .variadic = false,
+            .allowedValues = {},
+            .minValue = std::nullopt,
+            .maxValue = std::nullopt,
+            .pattern = {},
+            .compiledPattern = nullptr
+        }}},
+    };
+
+    const auto refreshCmd = Command{
+        .cmdType = CommandType::InternalRefresh,
+        .name = definition::RefreshKeyword,
+        .description = "Forget the cached output of a command, or of all of them, so they run again",
+        .exec = "",
+        .argsSchema = {.arguments = {ArgumentSpec{
+            .name = "command",
+            .description = "Name of the command",
+            .argType = ArgumentType::String,
+            .required = false,
+            .variadic = false,
+            .allowedValues = {},
+            .minValue = std::nullopt,
+            .maxValue = std::nullopt,
+            .pattern = {},
+            .compiledPattern = nullptr
+        }}},
+    };
+
+    const auto watchCmd = Command{
+        .cmdType = CommandType::InternalWatch,
+        .name = definition::WatchKeyword,
+        .description = "Run a command every 2 seconds, or every -n seconds, showing only its latest output and what changed, until Ctrl+C",
+        .exec = "",
+    };
+
+    const auto statsCmd = Command{
+        .cmdType = CommandType::InternalStats,
+        .name = definition::StatsKeyword,
+        .description = "Rank the commands of the output history by how long they took and how much memory they used",
+        .exec = "",
+        .argsSchema = {.arguments = {optionalIntegerArgument("count", "How many commands in each ranking, 10 by default", 1)}},
+    };
+
     return {
         {helpCmd.name, helpCmd,},
-        {exitCmd.name, exitCmd,}
+        {exitCmd.name, exitCmd,},
+        {jobsCmd.name, jobsCmd,},
+        {foregroundCmd.name, foregroundCmd,},
+        {tailCmd.name, tailCmd,},
+        {killCmd.name, killCmd,},
+        {runCmd.name, runCmd,},
+        {refreshCmd.name, refreshCmd,},
+        {watchCmd.name, watchCmd,},
+        {statsCmd.name, statsCmd,}
     };
 }
 
 [[nodiscard]]
-auto resolveCommandLine(const CommandCatalog& externalCommands, const CommandCatalog& internalCommands,
-                        std::string_view fullCommandLine) -> std::optional<ResolvedCommand> {//NOLINT(bugprone-easily-swappable-parameters)
-
-    const auto maybeParsed = ParseCommandLine(std::string(fullCommandLine));
-    if(not maybeParsed.has_value()) {
-        return std::nullopt;
+auto findCommand(const CommandCatalog& externalCommands, const CommandCatalog& internalCommands, std::string_view cmdName) -> const Command* {//NOLINT(bugprone-easily-swappable-parameters)
+    if(const auto maybeExternalCmd = externalCommands.find(cmdName); maybeExternalCmd != externalCommands.end()) {
+        return &maybeExternalCmd->second;
     }
 
-    const auto& cmdAndArgs = maybeParsed.value();
-    if(cmdAndArgs.empty()) {
-        return std::nullopt;
+    if(const auto maybeInternalCmd = internalCommands.find(cmdName); maybeInternalCmd != internalCommands.end()) {
+        return &maybeInternalCmd->second;
     }
 
-    const auto& cmdName = cmdAndArgs.at(0);
-    const auto argsOnly = std::vector<std::string>(std::next(cmdAndArgs.begin()), cmdAndArgs.end());
+    return nullptr;
+}
+
+[[nodiscard]]
+auto resolveCommandLine(const CommandCatalog& externalCommands, const CommandCatalog& internalCommands,
+                        std::string_view fullCommandLine) -> std::optional<ResolvedCommand> {//NOLINT(bugprone-easily-swappable-parameters)
 
-    const auto maybeExternalCmd = externalCommands.find(cmdName);
-    if(maybeExternalCmd != externalCommands.end()) {
-        return std::make_tuple(maybeExternalCmd->second, argsOnly);
+    CommandLineTokens tokens;
+    if(not tokens.Tokenize(fullCommandLine) or tokens.Segments().empty()) {
+        return std::nullopt;
     }
 
-    const auto maybeInternalCmd = internalCommands.find(cmdName);
-    if(maybeInternalCmd != internalCommands.end()) {
-        return std::make_tuple(maybeInternalCmd->second, argsOnly);
+    // a single command is expected here, anything after an operator is ignored
+    const auto words = tokens.SegmentWords(tokens.Segments().front());
+    const auto* command = findCommand(externalCommands, internalCommands, words.front());
+    if(command == nullptr) {
+        return {};
     }
 
-    return {};
+    return std::make_tuple(*command, ToStrings(words.subspan(1)));
 }
 
 auto handleHelpDisplay(const std::vector<std::string>& args,
@@ -80,9 +210,16 @@ auto handleHelpDisplay(const std::vector<std::string>& args,
         const auto& commandName = args.at(0);
         const auto maybeTargetCommand = externalCommands.find(commandName);
         if(maybeTargetCommand != externalCommands.end()) {
+            const auto& targetCommand = maybeTargetCommand->second;
+            auto commandHelp = std::format(CommandFormatString, targetCommand.name, targetCommand.description);
+            if(not targetCommand.argsSchema.empty()) {
+                commandHelp.append(std::format("  Usage: {} {}\n", targetCommand.name, formatArgumentsUsage(targetCommand.argsSchema)));
+                commandHelp.append(formatArgumentsHelp(targetCommand.argsSchema));
+            }
+
             outBuffers.AddNewEntry({
                 .prompt = "",
-                .stdOutEntry = std::format(CommandFormatString, maybeTargetCommand->second.name, maybeTargetCommand->second.description),
+                .stdOutEntry = commandHelp,
                 .stdErrEntry = ""
             });
             return;
@@ -130,22 +267,116 @@ auto handleInternalCommands(const Command& command, const std::vector<std::strin
     return false;
 }
 
-[[nodiscard]]
-auto executeSingleCommandLine(const Command& command, const std::vector<std::string>& args, OutputBuffers& outBuffers) -> bool {
-    CommandOutputCallbacks callbacks{
-        .onStdOut = [&outBuffers](std::string_view chunk) {
-            outBuffers.AppendToLastStdOutEntry(chunk);
-        },
-        .onStdErr = [&outBuffers](std::string_view chunk) {
-            outBuffers.AppendToLastStdErrEntry(chunk);
+auto findJob(Session& session, const Command& command, const std::vector<std::string>& args, const CommandOutputCallbacks& callbacks) -> Job* {
+    // already validated as a positive integer
+    const auto jobId = args.empty() ? std::nullopt : std::optional<size_t>{std::stoul(args.front())};
+    auto* job = session.jobs.Find(jobId);
+    if(job == nullptr and jobId.has_value()) {
+        callbacks.onStdErr(std::format("{}: no job {}\n", command.name, jobId.value()));
+    } else if(job == nullptr) {
+        callbacks.onStdErr(std::format("{}: there are no background jobs\n", command.name));
+    }
+    return job;
+}
+
+auto formatJobLine(const Job& job) -> std::string {
+    const auto pids = job.Processes();
+    std::string pidsText = pids.empty() ? "-" : "";
+    for(const auto pid: pids) {
+        pidsText.append(pidsText.empty() ? "" : ",").append(std::to_string(pid));
+    }
+    const std::chrono::duration<double> elapsed = job.Elapsed();
+    return std::format("[{}] {:<8} {:<12} {:>8.1f}s {:>10} bytes  {}\n", job.Id(), jobStateName(job.State()), pidsText,
+                       elapsed.count(), job.BytesProduced(), job.CommandLine());
+}
+
+auto foregroundJob(Session& session, Job& job, const CommandOutputCallbacks& callbacks) -> bool {
+    // the interface keeps handling its events while fg waits. Cancelling fg, with Ctrl+C, kills the job and its
+    // process groups like it would a command started in the foreground
+    JobOutputCursor cursor;
+    while(job.IsRunning()) {
+        if(session.control.IsCancelRequested()) {
+            job.Kill();
         }
+        job.CopyOutput(cursor, callbacks);
+        session.control.WaitWithIdle([&job](std::chrono::milliseconds interval) {
+            std::this_thread::sleep_for(interval);
+            return not job.IsRunning();
+        });
+    }
+    job.CopyOutput(cursor, callbacks);
+
+    const bool result = job.State() == JobState::Succeeded;
+    session.jobs.Remove(job.Id());
+    return result;
+}
+
+auto tailJob(const Job& job, const std::vector<std::string>& args, const CommandOutputCallbacks& callbacks) -> bool {
+    constexpr size_t DefaultTailLines = 10;
+    const auto lineCount = args.size() > 1 ? std::stoul(args.at(1)) : DefaultTailLines;
+
+    const auto makeTail = [lineCount](const OnCommandOutput& output) {
+        std::vector<OutputFilter> filters;
+        filters.emplace_back(TailFilter{lineCount});
+        return std::make_unique<OutputFilterChain>(std::move(filters), CommandOutputCallbacks{.onStdOut = output, .onStdErr = output});
     };
-    return executeAndCaptureOutputs(command.exec, args, callbacks);
+    const auto stdOutTail = makeTail(callbacks.onStdOut);
+    const auto stdErrTail = makeTail(callbacks.onStdErr);
+
+    JobOutputCursor cursor;
+    job.CopyOutput(cursor, CommandOutputCallbacks{
+        .onStdOut = [&stdOutTail](std::string_view chunk) {
+            stdOutTail->Feed(chunk);
+        },
+        .onStdErr = [&stdErrTail](std::string_view chunk) {
+            stdErrTail->Feed(chunk);
+        }
+    });
+    stdOutTail->Finish();
+    stdErrTail->Finish();
+    return true;
 }
 
-[[nodiscard]]
-auto executeShellScriptCommand(const Command& command, const std::vector<std::string>& args, OutputBuffers& outBuffers) -> bool {
-    CommandOutputCallbacks callbacks{
+auto executeJobCommand(const Command& command, const std::vector<std::string>& args, Session& session, const CommandOutputCallbacks& callbacks) -> bool {
+    if(command.cmdType == CommandType::InternalJobs) {
+        if(session.jobs.Jobs().empty()) {
+            callbacks.onStdOut("There are no background jobs\n");
+        }
+        for(const auto& [jobId, job]: session.jobs.Jobs()) {
+            callbacks.onStdOut(formatJobLine(*job));
+        }
+        return true;
+    }
+
+    auto* job = findJob(session, command, args, callbacks);
+    if(job == nullptr) {
+        return false;
+    }
+
+    if(command.cmdType == CommandType::InternalForeground) {
+        return foregroundJob(session, *job, callbacks);
+    }
+
+    if(command.cmdType == CommandType::InternalTail) {
+        return tailJob(*job, args, callbacks);
+    }
+
+    if(command.cmdType == CommandType::InternalKill) {
+        if(job->IsRunning()) {
+            job->Kill();
+            callbacks.onStdOut(std::format("[{}] terminating '{}'\n", job->Id(), job->CommandLine()));
+            return true;
+        }
+        callbacks.onStdOut(std::format("[{}] forgot '{}', it had already finished\n", job->Id(), job->CommandLine()));
+        session.jobs.Remove(job->Id());
+        return true;
+    }
+
+    return false;
+}
+
+auto makeOutputBuffersCallbacks(OutputBuffers& outBuffers) -> CommandOutputCallbacks {
+    return CommandOutputCallbacks{
         .onStdOut = [&outBuffers](std::string_view chunk) {
             outBuffers.AppendToLastStdOutEntry(chunk);
         },
@@ -153,7 +384,43 @@ auto executeShellScriptCommand(const Command& command, const std::vector<std::st
             outBuffers.AppendToLastStdErrEntry(chunk);
         }
     };
+}
+
+auto makeExecutionOptions(Session& session) -> ExecutionOptions {
+    return ExecutionOptions{
+        .workingDirectory = session.workingDirectory,
+        .environment = session.variables,
+        .control = &session.control,
+        .pty = false,
+        .timeout = std::chrono::milliseconds{0},
+        .limits = {}
+    };
+}
 
+// a command running on its own, not as a stage, can have a pseudo-terminal
+auto makeExecutionOptions(Session& session, const Command& command) -> ExecutionOptions {
+    auto options = makeExecutionOptions(session);
+    options.pty = command.pty;
+    options.timeout = command.timeout;
+    options.limits = command.limits;
+    return options;
+}
+
+[[nodiscard]]
+auto executeSingleCommandLine(const Command& command, const std::vector<std::string>& args, const CommandOutputCallbacks& callbacks,
+                              const ExecutionOptions& options) -> bool {
+    return executeAndCaptureOutputs(command.exec, args, callbacks, options);
+}
+
+[[nodiscard]]
+auto executeSingleCommandLine(const Command& command, const std::vector<std::string>& args, OutputBuffers& outBuffers,
+                              const ExecutionOptions& options) -> bool {
+    return executeSingleCommandLine(command, args, makeOutputBuffersCallbacks(outBuffers), options);
+}
+
+[[nodiscard]]
+auto executeShellScriptCommand(const Command& command, const std::vector<std::string>& args, const CommandOutputCallbacks& callbacks,
+                               const ExecutionOptions& options) -> bool {
     const auto maybeScriptPath = io::MakeUniqueTempScriptFilePath();
 
     if(not maybeScriptPath.has_value()) {
@@ -163,43 +430,154 @@ auto executeShellScriptCommand(const Command& command, const std::vector<std::st
     io::AutoCleanableScriptFile scriptFileGenerator;
     const auto& scriptPath = maybeScriptPath.value();
     if(scriptFileGenerator.WriteScript(scriptPath, command.exec)) {
-        return executeAndCaptureOutputs(scriptPath.string(), args, callbacks);
+        return executeAndCaptureOutputs(scriptPath.string(), args, callbacks, options);
     }
 
     return false;
 }
 
-auto executeCommandLine(const CommandCatalog& externalCommands, const CommandCatalog& internalCommands, OutputBuffers& outBuffers,
-                        std::string_view fullCommandLine, const OnInternalCommandEvent& onInternalCmd) -> bool {
+[[nodiscard]]
+auto executeShellScriptCommand(const Command& command, const std::vector<std::string>& args, OutputBuffers& outBuffers,
+                               const ExecutionOptions& options) -> bool {
+    return executeShellScriptCommand(command, args, makeOutputBuffersCallbacks(outBuffers), options);
+}
 
-    const auto maybeCmdAndArgs = resolveCommandLine(externalCommands, internalCommands, fullCommandLine);
+// flags of the last argCount arguments, for a command run with the tail of the arguments of another one
+[[nodiscard]]
+auto trailingLiteralArgs(const std::vector<bool>& literalArgs, size_t argCount) -> std::vector<bool> {
+    if(literalArgs.size() < argCount) {
+        return {};
+    }
+    return {std::prev(literalArgs.end(), static_cast<std::ptrdiff_t>(argCount)), literalArgs.end()};
+}
 
-    if(not maybeCmdAndArgs.has_value()) {
-        const auto& foundIter = std::ranges::find_if(internalCommands, [](const auto& cmd) -> bool {
-            return cmd.second.cmdType == CommandType::InternalHelp;
-        });
+[[nodiscard]]
+auto executeBuiltinCommand(const Command& command, const std::vector<std::string>& args, const std::vector<bool>& literalArgs,
+                           Session& session, const CommandOutputCallbacks& callbacks, const BuiltinCommandRunner& runner) -> bool {
+    return executeBuiltin(command.exec, args, session, callbacks, runner, literalArgs);
+}
+
+[[nodiscard]]
+auto executePluginCommand(const Command& command, const std::vector<std::string>& args, Session& session,
+                          const CommandOutputCallbacks& callbacks) -> bool {
+    const auto commandFn = session.plugins.Resolve(command.exec, command.symbol);
+    if(not commandFn.has_value()) {
+        callbacks.onStdErr(commandFn.error() + "\n");
+        return false;
+    }
+
+    if(command.isolated) {
+        return runIsolatedPluginCommand(commandFn.value(), command.name, args, callbacks, makeExecutionOptions(session));
+    }
+    return runPluginCommand(commandFn.value(), command.name, args, callbacks, session.control);
+}
+
+// the files of the definition, then the ones typed after the command, relative to the session working directory
+auto followedFilePaths(const Command& command, const std::vector<std::string>& args, const Session& session) -> std::vector<std::filesystem::path> {
+    std::vector<std::filesystem::path> paths;
+    for(const auto& path: splitFollowedPaths(command.exec)) {
+        paths.push_back(resolveSessionPath(session, path));
+    }
+    for(const auto& path: args) {
+        paths.push_back(resolveSessionPath(session, path));
+    }
+    return paths;
+}
 
-        const auto helpCmdName = [&foundIter, &internalCommands]() -> std::string {
-            if(foundIter == internalCommands.end()) {
-                return definition::DefaultHelpKeyword;
+auto formatInvalidArguments(const Command& command, const std::string& error) -> std::string {
+    return std::format("{}\nUsage: {} {}\n", error, command.name, formatArgumentsUsage(command.argsSchema));
+}
+
+auto reportInvalidArguments(const Command& command, const std::string& error, const CommandOutputCallbacks& callbacks) -> void {
+    callbacks.onStdErr(formatInvalidArguments(command, error));
+}
+
+auto reportUnknownCommand(const CommandCatalog& internalCommands, OutputBuffers& outBuffers, std::string_view commandText) -> void {
+    const auto& foundIter = std::ranges::find_if(internalCommands, [](const auto& cmd) -> bool {
+        return cmd.second.cmdType == CommandType::InternalHelp;
+    });
+
+    const auto helpCmdName = [&foundIter, &internalCommands]() -> std::string {
+        if(foundIter == internalCommands.end()) {
+            return definition::DefaultHelpKeyword;
+        }
+        return foundIter->second.name;
+    }();
+
+    outBuffers.AppendToLastStdErrEntry(
+        std::format("Could not find the command '{}'. Type '{}' to see available commands",
+                    commandText, helpCmdName));
+}
+
+// steps of a workflow are planned like command lines, defined further down
+auto executeWorkflowCommand(const CommandCatalog& externalCommands, const CommandCatalog& internalCommands, OutputBuffers& outBuffers,
+                            const CommandOutputCallbacks& callbacks, Session& session, const Command& command,
+                            const std::vector<std::string>& args) -> bool;
+
+// runs the watched command through executeResolvedCommand, defined further down
+auto executeWatchCommand(const CommandCatalog& externalCommands, const CommandCatalog& internalCommands, OutputBuffers& outBuffers,
+                         const CommandOutputCallbacks& callbacks, Session& session, const Command& command,
+                         const std::vector<std::string>& args, const std::vector<bool>& literalArgs,
+                         const OnInternalCommandEvent& onInternalCmd) -> bool;
+
+// from every entry of the output, the history loaded at start included
+auto showExecutionStats(const OutputBuffers& outBuffers, const std::vector<std::string>& args, const CommandOutputCallbacks& callbacks) -> bool {
+    constexpr size_t DefaultRankingSize = 10;
+    // already validated as a positive integer
+    const auto count = args.empty() ? DefaultRankingSize : std::stoul(args.front());
+
+    std::vector<ExecutionStats> recorded;
+    outBuffers.VisitEntries([&recorded](const std::vector<OutputBufferEntry>& entries) {
+        for(const auto& entry: entries) {
+            if(entry.stats.has_value()) {
+                recorded.push_back(entry.stats.value());
             }
-            return foundIter->second.name;
-        }();
+        }
+    });
+    callbacks.onStdOut(formatStatsRanking(summarizeExecutionStats(recorded), count));
+    return true;
+}
+
+auto executeResolvedCommand(const CommandCatalog& externalCommands, const CommandCatalog& internalCommands, OutputBuffers& outBuffers,
+                            const CommandOutputCallbacks& callbacks, Session& session, const Command& command,
+                            const std::vector<std::string>& args, const std::vector<bool>& literalArgs,
+                            const OnInternalCommandEvent& onInternalCmd) -> bool {
 
-        outBuffers.AppendToLastStdErrEntry(
-            std::format("Could not find the command '{}'. Type '{}' to see available commands",
-                        fullCommandLine, helpCmdName));
+    // reject malformed invocations before paying for a process spawn
+    if(const auto validation = validateArguments(command.argsSchema, args); not validation.has_value()) {
+        reportInvalidArguments(command, validation.error(), callbacks);
         return false;
     }
 
-    const auto& [command, args] = maybeCmdAndArgs.value();
-
     if (command.cmdType == CommandType::Single) {
-        return executeSingleCommandLine(command, args, outBuffers);
+        return executeSingleCommandLine(command, args, callbacks, makeExecutionOptions(session, command));
     }
 
     if (command.cmdType == CommandType::Shell) {
-        return executeShellScriptCommand(command, args, outBuffers);
+        return executeShellScriptCommand(command, args, callbacks, makeExecutionOptions(session, command));
+    }
+
+    if (command.cmdType == CommandType::Builtin) {
+        const BuiltinCommandRunner runner = [&](const std::vector<std::string>& cmdAndArgs) -> bool {
+            const auto* nestedCommand = findCommand(externalCommands, internalCommands, cmdAndArgs.front());
+            if(nestedCommand == nullptr) {
+                reportUnknownCommand(internalCommands, outBuffers, cmdAndArgs.front());
+                return false;
+            }
+            const auto nestedArgs = std::vector<std::string>(std::next(cmdAndArgs.begin()), cmdAndArgs.end());
+            // builtins run a tail of their own arguments
+            return executeResolvedCommand(externalCommands, internalCommands, outBuffers, callbacks, session, *nestedCommand, nestedArgs,
+                                          trailingLiteralArgs(literalArgs, nestedArgs.size()), onInternalCmd);
+        };
+        return executeBuiltinCommand(command, args, literalArgs, session, callbacks, runner);
+    }
+
+    if (command.cmdType == CommandType::Plugin) {
+        return executePluginCommand(command, args, session, callbacks);
+    }
+
+    if (command.cmdType == CommandType::Follow) {
+        return followFiles(followedFilePaths(command, args, session), callbacks, session.control);
     }
 
     if (command.cmdType == CommandType::Script) {
@@ -207,19 +585,1049 @@ auto executeCommandLine(const CommandCatalog& externalCommands, const CommandCat
         return false;
     }
 
+    if (command.cmdType == CommandType::InternalJobs or command.cmdType == CommandType::InternalForeground or
+        command.cmdType == CommandType::InternalTail or command.cmdType == CommandType::InternalKill) {
+        return executeJobCommand(command, args, session, callbacks);
+    }
+
+    if (command.cmdType == CommandType::InternalRun) {
+        return executeWorkflowCommand(externalCommands, internalCommands, outBuffers, callbacks, session, command, args);
+    }
+
+    if (command.cmdType == CommandType::InternalRefresh) {
+        const auto forgotten = session.cache.Forget(args.empty() ? std::nullopt : std::optional<std::string_view>{args.front()});
+        callbacks.onStdOut(args.empty() ? std::format("Forgot {} cached results\n", forgotten)
+                                        : std::format("Forgot {} cached results of '{}'\n", forgotten, args.front()));
+        return true;
+    }
+
+    if (command.cmdType == CommandType::InternalStats) {
+        return showExecutionStats(outBuffers, args, callbacks);
+    }
+
+    if (command.cmdType == CommandType::InternalWatch) {
+        return executeWatchCommand(externalCommands, internalCommands, outBuffers, callbacks, session, command, args, literalArgs, onInternalCmd);
+    }
+
     // else, handle internal commands
     return handleInternalCommands(command, args, externalCommands, internalCommands, onInternalCmd, outBuffers);
 }
 
+auto toStepCondition(CommandOperator previousOperator) -> StepCondition {
+    switch(previousOperator) {
+    case CommandOperator::AndThen:
+        return StepCondition::OnSuccess;
+    case CommandOperator::OrElse:
+        return StepCondition::OnFailure;
+    case CommandOperator::Sequence:
+    case CommandOperator::Pipe:
+    case CommandOperator::None:
+    default:
+        return StepCondition::Always;
+    }
+}
+
+auto appendOutputFilter(CommandPlan& plan, const CommandSegment& segment, std::span<const std::string_view> words,
+                        CommandOperator previousOperator) -> std::expected<void, CommandPlanError> {
+    if(previousOperator != CommandOperator::Pipe) {
+        return std::unexpected{CommandPlanError{
+            .unknownCommand = {},
+            .message = std::format("'{}' filters the output of a command, use it after '|'", words.front())
+        }};
+    }
+
+    auto spec = OutputFilterSpec{
+        .name = std::string{words.front().substr(1)},
+        .args = ToStrings(words.subspan(1))
+    };
+    // filters are built again for each run, this only checks their arguments
+    if(const auto filter = makeOutputFilter(spec); not filter.has_value()) {
+        return std::unexpected{CommandPlanError{.unknownCommand = {}, .message = filter.error()}};
+    }
+
+    plan.back().outputFilters.push_back(std::move(spec));
+    plan.back().source.append(" | ").append(segment.source);
+    return {};
+}
+
+// which of the last argCount words of the segment had a single quoted or escaped '$'
+[[nodiscard]]
+auto trailingLiteralArgs(const CommandLineTokens& tokens, const CommandSegment& segment, size_t argCount) -> std::vector<bool> {
+    const auto firstArg = segment.firstWord + segment.wordCount - argCount;
+    std::vector<bool> literalArgs(argCount);
+    for(size_t index = 0; index < argCount; index++) {
+        literalArgs[index] = tokens.IsLiteralWord(firstArg + index);
+    }
+    return literalArgs;
+}
+
+auto planFanOut(const CommandCatalog& externalCommands, const CommandCatalog& internalCommands, CommandPlan& plan,
+                const CommandLineTokens& tokens, const CommandSegment& segment, std::span<const std::string_view> words, CommandOperator previousOperator) -> std::expected<void, CommandPlanError> {
+    const auto planError = [](std::string message) {
+        return std::unexpected{CommandPlanError{.unknownCommand = {}, .message = std::move(message)}};
+    };
+
+    auto arguments = parseFanOutArguments(words.subspan(1));
+    if(not arguments.has_value()) {
+        return planError(std::move(arguments.error()));
+    }
+
+    const auto& commandName = arguments->commandWords.front();
+    const auto* command = findCommand(externalCommands, internalCommands, commandName);
+    if(command == nullptr) {
+        return std::unexpected{CommandPlanError{.unknownCommand = commandName, .message = {}}};
+    }
+    if(isInternalCommandType(command->cmdType)) {
+        return planError(std::format("'{}' can't be run by {}", command->name, FanOutKeyword));
+    }
+
+    auto planned = PlannedCommand{
+        .command = command,
+        .args = {std::next(arguments->commandWords.begin()), arguments->commandWords.end()},
+        .literalArgs = trailingLiteralArgs(tokens, segment, arguments->commandWords.size() - 1)
+    };
+    auto fanOut = FanOutPlan{
+        .concurrency = arguments->concurrency,
+        .items = std::move(arguments->items),
+        .itemsPipeline = {},
+        .itemsFilters = {}
+    };
+
+    if(previousOperator == CommandOperator::Pipe) {
+        auto& producer = plan.back();
+        if(arguments->hasItemsSeparator) {
+            return planError(std::format("{} takes its items either after '{}' or from a pipe, not both", FanOutKeyword, FanOutItemsSeparator));
+        }
+        if(producer.fanOut.has_value()) {
+            return planError(std::format("The output of {} can't be the items of another one", FanOutKeyword));
+        }
+        // the producer step becomes the source of the items, its filters pick them
+        fanOut.itemsPipeline = std::move(producer.pipeline);
+        fanOut.itemsFilters = std::move(producer.outputFilters);
+        producer.pipeline = {std::move(planned)};
+        producer.outputFilters = {};
+        producer.fanOut = std::move(fanOut);
+        producer.source.append(" | ").append(segment.source);
+        return {};
+    }
+
+    if(not arguments->hasItemsSeparator) {
+        return planError(std::format("{} needs items, after '{}' or from a command piped into it", FanOutKeyword, FanOutItemsSeparator));
+    }
+    plan.push_back(CommandPlanStep{
+        .pipeline = {std::move(planned)},
+        .source = std::string{segment.source},
+        .condition = toStepCondition(previousOperator),
+        .outputFilters = {},
+        .stdOutRedirection = {},
+        .stdErrRedirection = {},
+        .fanOut = std::move(fanOut)
+    });
+    return {};
+}
+
+auto applySegmentRedirections(CommandPlanStep& step, const CommandSegment& segment) -> std::expected<void, CommandPlanError> {
+    if(not segment.stdOutRedirection.IsSet() and not segment.stdErrRedirection.IsSet()) {
+        return {};
+    }
+    if(segment.followedBy == CommandOperator::Pipe) {
+        return std::unexpected{CommandPlanError{
+            .unknownCommand = {},
+            .message = std::format("Redirections must come after the last command of a pipeline, found '{}'", segment.source)
+        }};
+    }
+    if(const auto cmdType = step.pipeline.front().command->cmdType; cmdType == CommandType::InternalHelp or cmdType == CommandType::InternalExit) {
+        return std::unexpected{CommandPlanError{
+            .unknownCommand = {},
+            .message = std::format("The output of '{}' can't be redirected", step.pipeline.front().command->name)
+        }};
+    }
+
+    for(const auto& redirection: {segment.stdOutRedirection, segment.stdErrRedirection}) {
+        if(redirection.target.starts_with('&')) {
+            return std::unexpected{CommandPlanError{
+                .unknownCommand = {},
+                .message = std::format("Redirecting to a descriptor, like '>{}', is not supported", redirection.target)
+            }};
+        }
+    }
+
+    const auto toPlanRedirection = [](const SegmentRedirection& redirection) {
+        return OutputRedirection{.target = std::string{redirection.target}, .append = redirection.append};
+    };
+    step.stdOutRedirection = toPlanRedirection(segment.stdOutRedirection);
+    step.stdErrRedirection = toPlanRedirection(segment.stdErrRedirection);
+    return {};
+}
+
+auto buildCommandPlan(const CommandCatalog& externalCommands, const CommandCatalog& internalCommands,
+                      const CommandLineTokens& tokens) -> std::expected<CommandPlan, CommandPlanError> {
+    CommandPlan plan;
+    plan.reserve(tokens.Segments().size());
+
+    auto previousOperator = CommandOperator::None;
+    for(const auto& segment: tokens.Segments()) {
+        const auto words = tokens.SegmentWords(segment);
+        if(words.front() == FanOutKeyword) {
+            if(auto planned = planFanOut(externalCommands, internalCommands, plan, tokens, segment, words, previousOperator); not planned.has_value()) {
+                return std::unexpected{std::move(planned.error())};
+            }
+            if(auto redirected = applySegmentRedirections(plan.back(), segment); not redirected.has_value()) {
+                return std::unexpected{std::move(redirected.error())};
+            }
+            previousOperator = segment.followedBy;
+            continue;
+        }
+        if(isOutputFilterName(words.front())) {
+            if(auto appended = appendOutputFilter(plan, segment, words, previousOperator); not appended.has_value()) {
+                return std::unexpected{std::move(appended.error())};
+            }
+            if(auto redirected = applySegmentRedirections(plan.back(), segment); not redirected.has_value()) {
+                return std::unexpected{std::move(redirected.error())};
+            }
+            previousOperator = segment.followedBy;
+            continue;
+        }
+
+        const auto* command = findCommand(externalCommands, internalCommands, words.front());
+        if(command == nullptr) {
+            return std::unexpected{CommandPlanError{.unknownCommand = std::string{segment.source}, .message = {}}};
+        }
+
+        auto plannedCommand = PlannedCommand{
+            .command = command,
+            .args = ToStrings(words.subspan(1)),
+            .literalArgs = trailingLiteralArgs(tokens, segment, words.size() - 1)
+        };
+
+        if(previousOperator == CommandOperator::Pipe) {
+            if(plan.back().fanOut.has_value()) {
+                return std::unexpected{CommandPlanError{
+                    .unknownCommand = {},
+                    .message = std::format("The output of {} can only go through output filters, found '{}'", FanOutKeyword, segment.source)
+                }};
+            }
+            if(not plan.back().outputFilters.empty()) {
+                // filtered output stays in the REPL, it can't be fed to another process
+                return std::unexpected{CommandPlanError{
+                    .unknownCommand = {},
+                    .message = std::format("Output filters must come after the last command of a pipeline, found '{}'", segment.source)
+                }};
+            }
+            plan.back().pipeline.push_back(std::move(plannedCommand));
+            plan.back().source.append(" | ").append(segment.source);
+        } else {
+            plan.push_back(CommandPlanStep{
+                .pipeline = {std::move(plannedCommand)},
+                .source = std::string{segment.source},
+                .condition = toStepCondition(previousOperator),
+                .outputFilters = {},
+                .stdOutRedirection = {},
+                .stdErrRedirection = {},
+                .fanOut = {}
+            });
+        }
+        if(auto redirected = applySegmentRedirections(plan.back(), segment); not redirected.has_value()) {
+            return std::unexpected{std::move(redirected.error())};
+        }
+        previousOperator = segment.followedBy;
+    }
+    return plan;
+}
+
+/**
+ * Builtin, plugin and follow stages run their code in a child forked from the REPL, which by then has other threads:
+ * jobs, fan-out and workflow workers, the process monitor. Only the forking thread goes on in the child, and any lock
+ * another thread held stays locked there for good. The C library takes care of its own allocator and stream locks,
+ * but the child must never touch REPL state guarded by a mutex or shared with the interface, like ExecutionControl
+ * or OutputBuffers. Stage code only writes to its descriptors and gets a control of its own
+ */
+auto makePipelineStage(const PlannedCommand& planned, Session& session, std::vector<std::unique_ptr<io::AutoCleanableScriptFile>>& scripts)
+-> std::expected<PipelineStage, std::string> {
+    const auto& command = *planned.command;
+
+    switch(command.cmdType) {
+    case CommandType::Single:
+        return PipelineStage{.cmd = command.exec, .args = planned.args, .childMain = {}, .limits = command.limits};
+
+    case CommandType::Shell: {
+        const auto maybeScriptPath = io::MakeUniqueTempScriptFilePath();
+        auto& script = scripts.emplace_back(std::make_unique<io::AutoCleanableScriptFile>());
+        if(not maybeScriptPath.has_value() or not script->WriteScript(maybeScriptPath.value(), command.exec)) {
+            return std::unexpected{std::format("Could not write the script of '{}'", command.name)};
+        }
+        return PipelineStage{.cmd = maybeScriptPath.value().string(), .args = planned.args, .childMain = {}, .limits = command.limits};
+    }
+
+    case CommandType::Builtin: {
+        // like a shell subshell, a builtin changes a copy of the session, made here, with a control no interface runs through
+        auto stageSession = std::make_shared<Session>();
+        stageSession->workingDirectory = session.workingDirectory;
+        stageSession->previousWorkingDirectory = session.previousWorkingDirectory;
+        stageSession->variables = session.variables;
+        return PipelineStage{.cmd = {}, .args = {}, .childMain = [stageSession, &command, &planned]() -> int {
+            const auto callbacks = makeFileDescriptorCallbacks(STDOUT_FILENO, STDERR_FILENO);
+            const BuiltinCommandRunner noNestedCommands = [&callbacks](const std::vector<std::string>&) {
+                callbacks.onStdErr("Builtins can't run other commands inside a pipeline\n");
+                return false;
+            };
+            return executeBuiltin(command.exec, planned.args, *stageSession, callbacks, noNestedCommands, planned.literalArgs) ? EXIT_SUCCESS : EXIT_FAILURE;
+        }, .limits = {}};
+    }
+
+    case CommandType::Plugin: {
+        // resolved here, in the REPL, so the library is loaded once and shared by every forked stage
+        const auto commandFn = session.plugins.Resolve(command.exec, command.symbol);
+        if(not commandFn.has_value()) {
+            return std::unexpected{commandFn.error()};
+        }
+        return PipelineStage{.cmd = {}, .args = {}, .childMain = makeForkedPluginMain(commandFn.value(), command.name, planned.args), .limits = {}};
+    }
+
+    case CommandType::Follow:
+        // follows until the stage is terminated, nothing in the child asks it to stop
+        return PipelineStage{.cmd = {}, .args = {}, .childMain = [paths = followedFilePaths(command, planned.args, session)]() -> int {
+            const ExecutionControl neverCancelled;
+            return followFiles(paths, makeFileDescriptorCallbacks(STDOUT_FILENO, STDERR_FILENO), neverCancelled) ? EXIT_SUCCESS : EXIT_FAILURE;
+        }, .limits = {}};
+
+    case CommandType::Unknown:
+    case CommandType::Script:
+    case CommandType::InternalHelp:
+    case CommandType::InternalExit:
+    case CommandType::InternalJobs:
+    case CommandType::InternalForeground:
+    case CommandType::InternalTail:
+    case CommandType::InternalKill:
+    case CommandType::InternalRun:
+    case CommandType::InternalRefresh:
+    case CommandType::InternalWatch:
+    case CommandType::InternalStats:
+    default:
+        return std::unexpected{std::format("'{}' can't be used in a pipeline", command.name)};
+    }
+}
+
+// the pipeline can't outlive any of its stages, the shortest timeout stops all of them
+auto makePipelineOptions(Session& session, const std::vector<PlannedCommand>& pipeline) -> ExecutionOptions {
+    auto options = makeExecutionOptions(session);
+    for(const auto& planned: pipeline) {
+        const auto timeout = std::chrono::milliseconds{planned.command->timeout};
+        if(timeout.count() > 0 and (options.timeout.count() == 0 or timeout < options.timeout)) {
+            options.timeout = timeout;
+        }
+    }
+    return options;
+}
+
+auto executePipeline(const CommandOutputCallbacks& callbacks, Session& session, const std::vector<PlannedCommand>& pipeline) -> bool {
+    std::vector<std::unique_ptr<io::AutoCleanableScriptFile>> scripts;
+    std::vector<PipelineStage> stages;
+    stages.reserve(pipeline.size());
+
+    for(const auto& planned: pipeline) {
+        if(const auto validation = validateArguments(planned.command->argsSchema, planned.args); not validation.has_value()) {
+            reportInvalidArguments(*planned.command, validation.error(), callbacks);
+            return false;
+        }
+
+        auto stage = makePipelineStage(planned, session, scripts);
+        if(not stage.has_value()) {
+            callbacks.onStdErr(stage.error() + "\n");
+            return false;
+        }
+        stages.push_back(std::move(stage.value()));
+    }
+
+    return executePipelineAndCaptureOutputs(stages, callbacks, makePipelineOptions(session, pipeline));
+}
+
+// the items given after ':::', or the lines written by the command giving them, through its filters
+auto collectFanOutItems(const CommandOutputCallbacks& callbacks, Session& session, const FanOutPlan& fanOut) -> std::optional<std::vector<std::string>> {
+    if(fanOut.itemsPipeline.empty()) {
+        return fanOut.items;
+    }
+
+    std::string itemsOutput;
+    const auto producerCallbacks = CommandOutputCallbacks{
+        .onStdOut = [&itemsOutput](std::string_view chunk) {
+            itemsOutput.append(chunk);
+        },
+        .onStdErr = callbacks.onStdErr
+    };
+
+    std::vector<OutputFilter> filters;
+    for(const auto& spec: fanOut.itemsFilters) {
+        filters.push_back(makeOutputFilter(spec).value());
+    }
+    OutputFilterChain filterChain{std::move(filters), producerCallbacks};
+    const bool produced = executePipeline(filterChain.Callbacks(), session, fanOut.itemsPipeline);
+    filterChain.Finish();
+
+    if(not produced) {
+        callbacks.onStdErr(std::format("{}: the command giving the items failed, nothing was run\n", FanOutKeyword));
+        return std::nullopt;
+    }
+    return splitFanOutItems(itemsOutput);
+}
+
+// every stage is ready before the first item starts, workers only run them
+auto makeFanOutStages(const PlannedCommand& planned, const std::vector<std::string>& items, Session& session,
+                      std::vector<PlannedCommand>& itemCommands, std::vector<std::unique_ptr<io::AutoCleanableScriptFile>>& scripts)
+-> std::vector<std::expected<PipelineStage, std::string>> {
+    itemCommands.reserve(items.size());
+    for(const auto& item: items) {
+        itemCommands.push_back(PlannedCommand{
+            .command = planned.command,
+            .args = substituteFanOutItem(planned.args, item),
+            .literalArgs = planned.literalArgs
+        });
+    }
+
+    // single and shell stages only differ in their arguments, a shell script is written once
+    const bool argumentsOnly = planned.command->cmdType == CommandType::Single or planned.command->cmdType == CommandType::Shell;
+    std::optional<PipelineStage> reusableStage;
+
+    std::vector<std::expected<PipelineStage, std::string>> stages;
+    stages.reserve(items.size());
+    for(const auto& itemCommand: itemCommands) {
+        if(const auto validation = validateArguments(itemCommand.command->argsSchema, itemCommand.args); not validation.has_value()) {
+            stages.emplace_back(std::unexpected{formatInvalidArguments(*itemCommand.command, validation.error())});
+        } else if(reusableStage.has_value()) {
+            auto stage = reusableStage.value();
+            stage.args = itemCommand.args;
+            stages.emplace_back(std::move(stage));
+        } else {
+            auto stage = makePipelineStage(itemCommand, session, scripts);
+            if(stage.has_value() and argumentsOnly) {
+                reusableStage = stage.value();
+            }
+            stages.push_back(std::move(stage));
+        }
+    }
+    return stages;
+}
+
+auto executeFanOut(const CommandOutputCallbacks& callbacks, Session& session, const CommandPlanStep& step) -> bool {
+    const auto& fanOut = step.fanOut.value();
+    const auto items = collectFanOutItems(callbacks, session, fanOut);
+    if(not items.has_value()) {
+        return false;
+    }
+
+    std::vector<PlannedCommand> itemCommands;
+    std::vector<std::unique_ptr<io::AutoCleanableScriptFile>> scripts;
+    const auto stages = makeFanOutStages(step.pipeline.front(), items.value(), session, itemCommands, scripts);
+    // each item gets the whole timeout of the command
+    const auto options = makePipelineOptions(session, step.pipeline);
+
+    const FanOutTask task = [&stages, &options](size_t index, const CommandOutputCallbacks& itemCallbacks) -> bool {
+        const auto& stage = stages.at(index);
+        if(not stage.has_value()) {
+            itemCallbacks.onStdErr(stage.error());
+            return false;
+        }
+        return executePipelineAndCaptureOutputs({stage.value()}, itemCallbacks, options);
+    };
+
+    const auto summary = runFanOut(items->size(), fanOut.concurrency, task, session.control, [&callbacks, &items](const FanOutItemResult& result) {
+        const auto& item = items->at(result.index);
+        callbacks.onStdOut(formatFanOutItemOutput(item, result));
+        if(not result.stdErr.empty()) {
+            callbacks.onStdErr(formatFanOutItemErrors(item, result));
+        }
+    });
+    callbacks.onStdOut(formatFanOutSummary(summary));
+    return summary.failed == 0 and summary.notRun == 0;
+}
+
+// a workflow step is one command, or pipeline, with optional output filters
+auto planWorkflowStep(const CommandCatalog& externalCommands, const CommandCatalog& internalCommands, const WorkflowStep& step)
+-> std::expected<CommandPlan, std::string> {
+    CommandLineTokens tokens;
+    if(not tokens.Tokenize(step.commandLine) or tokens.Segments().empty()) {
+        return std::unexpected{std::format("step '{}' has no command to run", step.name)};
+    }
+
+    auto plan = buildCommandPlan(externalCommands, internalCommands, tokens);
+    if(not plan.has_value()) {
+        if(not plan.error().unknownCommand.empty()) {
+            return std::unexpected{std::format("step '{}': could not find the command '{}'", step.name, plan.error().unknownCommand)};
+        }
+        return std::unexpected{std::format("step '{}': {}", step.name, plan.error().message)};
+    }
+
+    const auto& planStep = plan->front();
+    if(tokens.IsBackground() or plan->size() != 1) {
+        return std::unexpected{std::format("step '{}' must run a single command or pipeline, without ';', '&&', '||' or '&'", step.name)};
+    }
+    if(planStep.fanOut.has_value() or planStep.stdOutRedirection.IsSet() or planStep.stdErrRedirection.IsSet()) {
+        return std::unexpected{std::format("step '{}' can't use {} or redirections", step.name, FanOutKeyword)};
+    }
+    for(const auto& planned: planStep.pipeline) {
+        if(isInternalCommandType(planned.command->cmdType)) {
+            return std::unexpected{std::format("step '{}': '{}' can't run in a workflow", step.name, planned.command->name)};
+        }
+        if(const auto validation = validateArguments(planned.command->argsSchema, planned.args); not validation.has_value()) {
+            return std::unexpected{std::format("step '{}': {}", step.name, validation.error())};
+        }
+    }
+    return std::move(plan.value());
+}
+
+auto listWorkflows(const Session& session, const CommandOutputCallbacks& callbacks) -> bool {
+    if(session.workflows.empty()) {
+        callbacks.onStdOut("There are no workflows\n");
+    }
+    for(const auto& [name, workflow]: session.workflows) {
+        callbacks.onStdOut(std::format("- {}:  {} ({} steps, {})\n", name, workflow.description, workflow.steps.size(),
+                                       workflowPolicyName(workflow.policy)));
+    }
+    return true;
+}
+
+auto executeWorkflowCommand(const CommandCatalog& externalCommands, const CommandCatalog& internalCommands, OutputBuffers& outBuffers,
+                            const CommandOutputCallbacks& callbacks, Session& session, const Command& command,
+                            const std::vector<std::string>& args) -> bool {
+    if(args.empty()) {
+        return listWorkflows(session, callbacks);
+    }
+
+    const auto found = session.workflows.find(args.front());
+    if(found == session.workflows.end()) {
+        callbacks.onStdErr(std::format("{}: no workflow '{}'. Type '{}' to list them\n", command.name, args.front(), command.name));
+        return false;
+    }
+    const auto& workflow = found->second;
+    const auto dependencies = resolveWorkflowDependencies(workflow);
+    if(not dependencies.has_value()) {
+        callbacks.onStdErr(dependencies.error() + "\n");
+        return false;
+    }
+
+    // every step is planned, and its processes ready to start, before the first one runs. Builtin stages point into the plans
+    std::vector<CommandPlan> plans;
+    plans.reserve(workflow.steps.size());
+    for(const auto& step: workflow.steps) {
+        auto plan = planWorkflowStep(externalCommands, internalCommands, step);
+        if(not plan.has_value()) {
+            callbacks.onStdErr(std::format("{}: {}\n", workflow.name, plan.error()));
+            return false;
+        }
+        plans.push_back(std::move(plan.value()));
+    }
+
+    std::vector<std::unique_ptr<io::AutoCleanableScriptFile>> scripts;
+    std::vector<std::vector<PipelineStage>> stepStages(workflow.steps.size());
+    for(size_t index = 0; index < plans.size(); index++) {
+        for(const auto& planned: plans[index].front().pipeline) {
+            auto stage = makePipelineStage(planned, session, scripts);
+            if(not stage.has_value()) {
+                callbacks.onStdErr(std::format("{}: step '{}': {}\n", workflow.name, workflow.steps[index].name, stage.error()));
+                return false;
+            }
+            stepStages[index].push_back(std::move(stage.value()));
+        }
+    }
+
+    // a step stops at the timeout of its own commands
+    std::vector<ExecutionOptions> stepOptions;
+    stepOptions.reserve(plans.size());
+    for(const auto& plan: plans) {
+        stepOptions.push_back(makePipelineOptions(session, plan.front().pipeline));
+    }
+    const WorkflowStepTask task = [&plans, &stepStages, &stepOptions](size_t index, const CommandOutputCallbacks& stepCallbacks) -> bool {
+        const auto& filterSpecs = plans.at(index).front().outputFilters;
+        const auto& options = stepOptions.at(index);
+        if(filterSpecs.empty()) {
+            return executePipelineAndCaptureOutputs(stepStages.at(index), stepCallbacks, options);
+        }
+
+        std::vector<OutputFilter> filters;
+        filters.reserve(filterSpecs.size());
+        for(const auto& spec: filterSpecs) {
+            filters.push_back(makeOutputFilter(spec).value());
+        }
+        OutputFilterChain filterChain{std::move(filters), stepCallbacks};
+        const bool result = executePipelineAndCaptureOutputs(stepStages.at(index), filterChain.Callbacks(), options);
+        filterChain.Finish();
+        return result;
+    };
+
+    callbacks.onStdOut(std::format("{}: {} steps, {}\n", workflow.name, workflow.steps.size(), workflowPolicyName(workflow.policy)));
+
+    // each step gets an entry of its own, in the order they finish
+    const auto summary = runWorkflow(workflow, dependencies.value(), task, session.control, [&outBuffers, &workflow](const WorkflowStepResult& result) {
+        outBuffers.AddNewEntry({
+            .prompt = definition::PlanStepPromptPrefix + formatWorkflowStepHeader(workflow.steps.at(result.index), result),
+            .stdOutEntry = result.stdOut,
+            .stdErrEntry = result.stdErr
+        });
+    });
+    outBuffers.AddNewEntry({
+        .prompt = "",
+        .stdOutEntry = formatWorkflowSummary(workflow, summary),
+        .stdErrEntry = ""
+    });
+    return summary.failed == 0 and summary.skipped == 0;
+}
+
+auto executeWatchCommand(const CommandCatalog& externalCommands, const CommandCatalog& internalCommands, OutputBuffers& outBuffers,
+                         const CommandOutputCallbacks& callbacks, Session& session, const Command& command,
+                         const std::vector<std::string>& args, const std::vector<bool>& literalArgs,
+                         const OnInternalCommandEvent& onInternalCmd) -> bool {
+    const auto watch = parseWatchArguments(args);
+    if(not watch.has_value()) {
+        callbacks.onStdErr(std::format("{}: {}\nUsage: {} [-n seconds] command [args...]\n", command.name, watch.error(), command.name));
+        return false;
+    }
+
+    const auto& watchedName = watch->commandWords.front();
+    const auto* watched = findCommand(externalCommands, internalCommands, watchedName);
+    if(watched == nullptr) {
+        reportUnknownCommand(internalCommands, outBuffers, watchedName);
+        return false;
+    }
+    if(isInternalCommandType(watched->cmdType)) {
+        callbacks.onStdErr(std::format("{}: '{}' can't be watched\n", command.name, watched->name));
+        return false;
+    }
+    const std::vector<std::string> watchedArgs(std::next(watch->commandWords.begin()), watch->commandWords.end());
+    const auto watchedLiteralArgs = trailingLiteralArgs(literalArgs, watchedArgs.size());
+    if(const auto validation = validateArguments(watched->argsSchema, watchedArgs); not validation.has_value()) {
+        reportInvalidArguments(*watched, validation.error(), callbacks);
+        return false;
+    }
+
+    // every run replaces the output of the previous one in the entry of the line, so memory stays the size of one run
+    std::string previousOutput;
+    bool lastResult = false;
+    const auto runs = runWatch(watch->interval, session.control, [&](size_t run) {
+        std::string stdOut;
+        std::string stdErr;
+        lastResult = executeResolvedCommand(externalCommands, internalCommands, outBuffers, CommandOutputCallbacks{
+            .onStdOut = [&stdOut](std::string_view chunk) {
+                stdOut.append(chunk);
+            },
+            .onStdErr = [&stdErr](std::string_view chunk) {
+                stdErr.append(chunk);
+            }
+        }, session, *watched, watchedArgs, watchedLiteralArgs, onInternalCmd);
+
+        // a run cut short by Ctrl+C is dropped, the last complete one stays
+        if(session.control.IsCancelRequested() and run > 1) {
+            return;
+        }
+        const auto changes = diffLines(previousOutput, stdOut);
+        auto header = formatWatchHeader(watch.value(), run, changes, std::chrono::system_clock::now());
+        outBuffers.ReplaceLastEntryOutput(header.append(stdOut), stdErr);
+        previousOutput = std::move(stdOut);
+    });
+
+    if(not runs.has_value()) {
+        callbacks.onStdErr(std::format("{}: {}\n", command.name, runs.error()));
+        return false;
+    }
+    return lastResult;
+}
+
+// opens the file and points the stream callback and descriptor to it, when the stream is redirected at all
+auto redirectOutput(const Session& session, const OutputRedirection& redirection, OutputRedirectionFile& file,
+                    OnCommandOutput& onOutput, int& outputFd) -> std::expected<void, std::string> {
+    if(not redirection.IsSet()) {
+        return {};
+    }
+    if(auto opened = file.Open(resolveSessionPath(session, redirection.target), redirection.append); not opened.has_value()) {
+        return opened;
+    }
+    onOutput = file.Writer();
+    outputFd = file.Descriptor();
+    return {};
+}
+
+// replays the output of an identical earlier run when there is one, or runs the command and keeps its output when it succeeds
+auto executeCachedCommand(const CommandCatalog& externalCommands, const CommandCatalog& internalCommands, OutputBuffers& outBuffers,
+                          const CommandOutputCallbacks& callbacks, Session& session, const PlannedCommand& planned,
+                          const OnInternalCommandEvent& onInternalCmd, std::optional<CachedOutput>& cacheHit) -> bool {
+    const auto& command = *planned.command;
+    const auto run = [&](const CommandOutputCallbacks& runCallbacks) {
+        return executeResolvedCommand(externalCommands, internalCommands, outBuffers, runCallbacks, session, command, planned.args,
+                                      planned.literalArgs, onInternalCmd);
+    };
+    if(not validateArguments(command.argsSchema, planned.args).has_value()) {
+        return run(callbacks);
+    }
+
+    const auto key = makeCommandCacheKey(command, planned.args, session.workingDirectory, session.variables, planned.literalArgs);
+    if(auto cached = session.cache.Find(key, command.cache.ttl); cached.has_value()) {
+        callbacks.onStdOut(cached->stdOut);
+        callbacks.onStdErr(cached->stdErr);
+        cacheHit = std::move(cached);
+        return true;
+    }
+
+    // no descriptors, the output has to go through the REPL to be kept
+    std::string stdOut;
+    std::string stdErr;
+    const bool result = run(CommandOutputCallbacks{
+        .onStdOut = [&stdOut, &callbacks](std::string_view chunk) {
+            stdOut.append(chunk);
+            callbacks.onStdOut(chunk);
+        },
+        .onStdErr = [&stdErr, &callbacks](std::string_view chunk) {
+            stdErr.append(chunk);
+            callbacks.onStdErr(chunk);
+        }
+    });
+    if(result and not session.control.IsCancelRequested()) {
+        session.cache.Store(key, stdOut, stdErr);
+    }
+    return result;
+}
+
+// bytes written by the command, counted from several threads when it runs processes in parallel
+struct OutputByteCounts {
+    std::atomic<uint64_t> stdOut{0};
+    std::atomic<uint64_t> stdErr{0};
+};
+
+// descriptors given to children directly are not seen here, their files are counted instead.
+// The control counts the whole command line as it goes, for the status bar
+auto countOutputBytes(const CommandOutputCallbacks& callbacks, OutputByteCounts& counts, ExecutionControl& control) -> CommandOutputCallbacks {
+    return CommandOutputCallbacks{
+        .onStdOut = [&counts, &control, onStdOut = callbacks.onStdOut](std::string_view chunk) {
+            counts.stdOut += chunk.size();
+            control.CountOutput(chunk);
+            onStdOut(chunk);
+        },
+        .onStdErr = [&counts, &control, onStdErr = callbacks.onStdErr](std::string_view chunk) {
+            counts.stdErr += chunk.size();
+            control.CountOutput(chunk);
+            onStdErr(chunk);
+        },
+        .stdOutFd = callbacks.stdOutFd,
+        .stdErrFd = callbacks.stdErrFd
+    };
+}
+
+// only processes are measured, commands run inside the REPL would record nothing but zeros.
+// every stage of a pipeline is a process of its own, a lone command only when it runs one
+auto isMeasuredStep(const CommandPlanStep& step) -> bool {
+    if(step.pipeline.size() > 1) {
+        return true;
+    }
+    const auto& command = *step.pipeline.front().command;
+    return command.cmdType == CommandType::Single or command.cmdType == CommandType::Shell or
+           (command.cmdType == CommandType::Plugin and command.isolated);
+}
+
+auto stepCommandNames(const CommandPlanStep& step) -> std::string {
+    std::string names;
+    for(const auto& planned: step.pipeline) {
+        names.append(names.empty() ? "" : " | ").append(planned.command->name);
+    }
+    return names;
+}
+
+// the strictest policy among the commands of the step
+auto stepOutputRetention(const CommandPlanStep& step) -> OutputRetentionPolicy {
+    std::vector<OutputRetentionPolicy> policies;
+    policies.reserve(step.pipeline.size());
+    for(const auto& planned: step.pipeline) {
+        policies.push_back(planned.command->outputRetention);
+    }
+    return combineOutputRetention(policies);
+}
+
+auto executePlanStep(const CommandCatalog& externalCommands, const CommandCatalog& internalCommands, OutputBuffers& outBuffers,
+                     Session& session, const CommandPlanStep& step, const OnInternalCommandEvent& onInternalCmd) -> bool {
+    std::optional<CachedOutput> cacheHit;
+    const auto runStep = [&](const CommandOutputCallbacks& callbacks) -> bool {
+        if(step.fanOut.has_value()) {
+            return executeFanOut(callbacks, session, step);
+        }
+        if(step.IsPipeline()) {
+            return executePipeline(callbacks, session, step.pipeline);
+        }
+        const auto& planned = step.pipeline.front();
+        if(planned.command->cache.IsEnabled() and session.cache.IsEnabled()) {
+            return executeCachedCommand(externalCommands, internalCommands, outBuffers, callbacks, session, planned, onInternalCmd, cacheHit);
+        }
+        return executeResolvedCommand(externalCommands, internalCommands, outBuffers, callbacks, session, *planned.command, planned.args,
+                                      planned.literalArgs, onInternalCmd);
+    };
+
+    auto callbacks = makeOutputBuffersCallbacks(outBuffers);
+    OutputRedirectionFile stdOutFile;
+    OutputRedirectionFile stdErrFile;
+    auto redirected = redirectOutput(session, step.stdOutRedirection, stdOutFile, callbacks.onStdOut, callbacks.stdOutFd);
+    if(redirected.has_value()) {
+        redirected = redirectOutput(session, step.stdErrRedirection, stdErrFile, callbacks.onStdErr, callbacks.stdErrFd);
+    }
+    if(not redirected.has_value()) {
+        outBuffers.AppendToLastStdErrEntry(redirected.error() + "\n");
+        return false;
+    }
+
+    // streams going to the buffers keep their start and end only, redirected ones are all written to their file
+    const auto retentionPolicy = stepOutputRetention(step);
+    const auto fullOutputPath = [&session, &step, &retentionPolicy](std::string_view streamName) -> std::filesystem::path {
+        if(not retentionPolicy.keepFullOutput) {
+            return {};
+        }
+        const auto directory = session.fullOutputDirectory.empty() ? std::filesystem::temp_directory_path() : session.fullOutputDirectory;
+        return makeFullOutputPath(directory, step.pipeline.front().command->name, streamName);
+    };
+    std::optional<OutputRetention> stdOutRetention;
+    std::optional<OutputRetention> stdErrRetention;
+    if(retentionPolicy.IsEnabled() and not step.stdOutRedirection.IsSet()) {
+        stdOutRetention.emplace(retentionPolicy, callbacks.onStdOut, [&outBuffers](const ElidedOutput& elided) {
+            outBuffers.MarkLastStdOutElided(elided);
+        }, fullOutputPath("stdout"));
+        callbacks.onStdOut = stdOutRetention->Callback();
+    }
+    if(retentionPolicy.IsEnabled() and not step.stdErrRedirection.IsSet()) {
+        stdErrRetention.emplace(retentionPolicy, callbacks.onStdErr, [&outBuffers](const ElidedOutput& elided) {
+            outBuffers.MarkLastStdErrElided(elided);
+        }, fullOutputPath("stderr"));
+        callbacks.onStdErr = stdErrRetention->Callback();
+    }
+
+    // processes of an earlier step are not part of this one
+    std::ignore = session.control.TakeProcessUsage();
+    OutputByteCounts byteCounts;
+    const auto startTime = std::chrono::steady_clock::now();
+    bool result = false;
+    if(step.outputFilters.empty()) {
+        result = runStep(countOutputBytes(callbacks, byteCounts, session.control));
+    } else {
+        std::vector<OutputFilter> filters;
+        filters.reserve(step.outputFilters.size());
+        for(const auto& spec: step.outputFilters) {
+            // already validated when the plan was built
+            filters.push_back(makeOutputFilter(spec).value());
+        }
+
+        OutputFilterChain filterChain{std::move(filters), callbacks};
+        result = runStep(countOutputBytes(filterChain.Callbacks(), byteCounts, session.control));
+        filterChain.Finish();
+    }
+    if(stdOutRetention.has_value()) {
+        stdOutRetention->Finish();
+    }
+    if(stdErrRetention.has_value()) {
+        stdErrRetention->Finish();
+    }
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - startTime;
+
+    if(isMeasuredStep(step)) {
+        auto stats = session.control.TakeProcessUsage();
+        stats.command = stepCommandNames(step);
+        stats.wallTime = std::chrono::duration_cast<std::chrono::milliseconds>(elapsed);
+        stats.stdOutBytes = stdOutFile.BytesWritten().value_or(byteCounts.stdOut);
+        stats.stdErrBytes = stdErrFile.BytesWritten().value_or(byteCounts.stdErr);
+        outBuffers.SetLastEntryStats(std::move(stats));
+    }
+
+    // redirected output never reaches the buffers, only a line saying where it went
+    if(step.stdOutRedirection.IsSet()) {
+        outBuffers.AppendToLastStdOutEntry(formatRedirectionSummary("stdout", stdOutFile, elapsed));
+    }
+    if(step.stdErrRedirection.IsSet()) {
+        outBuffers.AppendToLastStdOutEntry(formatRedirectionSummary("stderr", stdErrFile, elapsed));
+    }
+    if(cacheHit.has_value()) {
+        outBuffers.AppendToLastStdOutEntry(formatCacheHit(*step.pipeline.front().command, cacheHit.value()));
+    }
+    return result;
+}
+
+auto executeCommandPlan(const CommandCatalog& externalCommands, const CommandCatalog& internalCommands, OutputBuffers& outBuffers,
+                        Session& session, const CommandPlan& plan, const OnInternalCommandEvent& onInternalCmd) -> bool {
+    // a lone command, or pipeline, writes to the entry created for the line, like it always did
+    if(plan.size() == 1) {
+        return executePlanStep(externalCommands, internalCommands, outBuffers, session, plan.front(), onInternalCmd);
+    }
+
+    bool lastResult = true;
+    for(const auto& step: plan) {
+        if(not shouldRunStep(step.condition, lastResult)) {
+            continue;
+        }
+
+        outBuffers.AddNewEntry({
+            .prompt = definition::PlanStepPromptPrefix + step.source + "\n",
+            .stdOutEntry = "",
+            .stdErrEntry = ""
+        });
+        lastResult = executePlanStep(externalCommands, internalCommands, outBuffers, session, step, onInternalCmd);
+
+        if(step.pipeline.front().command->cmdType == CommandType::InternalExit) {
+            break;
+        }
+    }
+    return lastResult;
+}
+
+auto startBackgroundJob(const CommandCatalog& externalCommands, const CommandCatalog& internalCommands, OutputBuffers& outBuffers,
+                        Session& session, const CommandPlan& plan, std::string_view fullCommandLine) -> bool {
+    for(const auto& step: plan) {
+        for(const auto& planned: step.pipeline) {
+            if(isInternalCommandType(planned.command->cmdType)) {
+                outBuffers.AppendToLastStdErrEntry(std::format("'{}' can't run in the background\n", planned.command->name));
+                return false;
+            }
+        }
+    }
+
+    auto commandLine = trimString(std::string{fullCommandLine});
+    commandLine = trimString(commandLine.substr(0, commandLine.size() - 1));
+
+    // the plan points into the catalogs of the REPL, the job plans the line again from catalogs of its own
+    auto& job = session.jobs.Start(commandLine, session, [externalCommands, internalCommands, commandLine](Session& jobSession, OutputBuffers& jobBuffers) -> bool {
+        jobBuffers.AddNewEntry({
+            .prompt = "",
+            .stdOutEntry = "",
+            .stdErrEntry = ""
+        });
+
+        CommandLineTokens jobTokens;
+        if(not jobTokens.Tokenize(commandLine)) {
+            return false;
+        }
+        const auto jobPlan = buildCommandPlan(externalCommands, internalCommands, jobTokens);
+        if(not jobPlan.has_value()) {
+            return false;
+        }
+        return executeCommandPlan(externalCommands, internalCommands, jobBuffers, jobSession, jobPlan.value(), [](CommandType) {});
+    });
+
+    outBuffers.AppendToLastStdOutEntry(std::format("[{}] '{}' running in the background\n", job.Id(), job.CommandLine()));
+    return true;
+}
+
+auto executeCommandLine(const CommandCatalog& externalCommands, const CommandCatalog& internalCommands, OutputBuffers& outBuffers,
+                        Session& session, std::string_view fullCommandLine, const OnInternalCommandEvent& onInternalCmd) -> bool {
+
+    // tokenize straight from the view and look commands up in place, args are materialized only once
+    CommandLineTokens tokens;
+    if(not tokens.Tokenize(fullCommandLine) or tokens.Segments().empty()) {
+        reportUnknownCommand(internalCommands, outBuffers, fullCommandLine);
+        return false;
+    }
+
+    const auto plan = buildCommandPlan(externalCommands, internalCommands, tokens);
+    if(not plan.has_value()) {
+        if(not plan.error().unknownCommand.empty()) {
+            reportUnknownCommand(internalCommands, outBuffers, plan.error().unknownCommand);
+        } else {
+            outBuffers.AppendToLastStdErrEntry(plan.error().message + "\n");
+        }
+        return false;
+    }
+
+    if(tokens.IsBackground()) {
+        return startBackgroundJob(externalCommands, internalCommands, outBuffers, session, plan.value(), fullCommandLine);
+    }
+    return executeCommandPlan(externalCommands, internalCommands, outBuffers, session, plan.value(), onInternalCmd);
+}
+
+[[nodiscard]]
+auto longestCommonPrefix(const std::vector<std::string>& candidates) -> std::string {
+    if(candidates.empty()) {
+        return "";
+    }
+
+    std::string_view prefix = candidates.front();
+    for(const auto& candidate: candidates) {
+        const auto [prefixEnd, candidateEnd] = std::ranges::mismatch(prefix, candidate);
+        prefix = prefix.substr(0, static_cast<size_t>(std::distance(prefix.begin(), prefixEnd)));
+    }
+    return std::string{prefix};
+}
+
+[[nodiscard]]
+auto completeCommandLine(const CommandCatalog& externalCommands, const CommandCatalog& internalCommands,
+                         std::string_view commandLine) -> std::string {//NOLINT(bugprone-easily-swappable-parameters)
+    CommandLineTokens tokens;
+    if(not tokens.Tokenize(commandLine)) {
+        return std::string{commandLine};
+    }
+
+    // only the command after the last operator is completed
+    std::vector<std::string> words;
+    if(const auto segments = tokens.Segments(); not segments.empty() and segments.back().followedBy == CommandOperator::None) {
+        words = ToStrings(tokens.SegmentWords(segments.back()));
+    }
+    if(commandLine.empty() or (isspace(commandLine.back()) != 0)) {
+        words.emplace_back();
+    }
+    if(words.empty()) {
+        return std::string{commandLine};
+    }
+
+    // quoted or escaped words can't be completed in place
+    const auto partialWord = words.back();
+    if(not commandLine.ends_with(partialWord)) {
+        return std::string{commandLine};
+    }
+
+    std::vector<std::string> candidates;
+    if(words.size() == 1 and isOutputFilterName(partialWord)) {
+        for(const auto filterName: OutputFilterNames) {
+            if(auto name = OutputFilterPrefix + std::string{filterName}; name.starts_with(partialWord)) {
+                candidates.push_back(std::move(name));
+            }
+        }
+        if(FanOutKeyword.starts_with(partialWord)) {
+            candidates.emplace_back(FanOutKeyword);
+        }
+    } else if(words.size() == 1) {
+        for(const auto* catalog: {&externalCommands, &internalCommands}) {
+            for(const auto& [name, cmd]: *catalog) {
+                if(name.starts_with(partialWord)) {
+                    candidates.push_back(name);
+                }
+            }
+        }
+    } else {
+        if(const auto* command = findCommand(externalCommands, internalCommands, words.front()); command != nullptr) {
+            candidates = completeArgument(command->argsSchema, words.size() - 2, partialWord);
+        }
+    }
+
+    if(candidates.empty()) {
+        return std::string{commandLine};
+    }
+
+    auto completedLine = std::string{commandLine.substr(0, commandLine.size() - partialWord.size())};
+    completedLine.append(longestCommonPrefix(candidates));
+    if(candidates.size() == 1) {
+        completedLine.append(" ");
+    }
+    return completedLine;
+}
+
+auto makeCommandCompletionAction(const CommandCatalog& externalCommands, const REPLModifiers& modifiers) -> CommandCompletionAction {
+    const auto internalCommands = buildInternalCommandCatalog(modifiers);
+
+    return [externalCommands, internalCommands](std::string_view commandLine) -> std::string {
+        return completeCommandLine(externalCommands, internalCommands, commandLine);
+    };
+}
+
 auto makeCommandProcessingAction(const CommandCatalog& externalCommands, const REPLModifiers& modifiers, OutputBuffers& outBuffers,
-                                 CommandHistory& cmdHistory, OutputHistory& outputHistory) -> CommandProcessingAction {
+                                 Session& session, CommandHistory& cmdHistory, OutputHistory& outputHistory) -> CommandProcessingAction {
     const auto internalCommands = buildInternalCommandCatalog(modifiers);
 
-    return [externalCommands, internalCommands, &outBuffers, &cmdHistory, &outputHistory](std::string_view fullCommandLine, const OnInternalCommandEvent& onInternalCmd) -> bool {
+    return [externalCommands, internalCommands, &outBuffers, &session, &cmdHistory, &outputHistory](std::string_view fullCommandLine, const OnInternalCommandEvent& onInternalCmd) -> bool {
 
         cmdHistory.Add(fullCommandLine);
         cmdHistory.Save();
-        const bool execResult = executeCommandLine(externalCommands, internalCommands, outBuffers, fullCommandLine, onInternalCmd);
+
+        session.control.BeginCommand();
+        const bool execResult = executeCommandLine(externalCommands, internalCommands, outBuffers, session, fullCommandLine, onInternalCmd);
+        session.control.EndCommand();
 
         if(not outputHistory.Save(outBuffers)) {
             // do nothing
@@ -4,34 +4,69 @@
 #include <vector>
 #include <string_view>
 #include <optional>
+#include <expected>
+#include <string>
 
 #include "OutputHistory.h"
 #include "REPLDefinition.h"
 #include "OutputBuffers.h"
 #include "Command.h"
 #include "CommandHistory.h"
+#include "ProcessExecutor.h"
+#include "BuiltinCommands.h"
+#include "Session.h"
+#include "CommandLineParser.h"
+#include "CommandPlan.h"
 
 namespace replmk {
 
 using OnInternalCommandEvent = std::function<void(CommandType)>;
 using CommandProcessingAction = std::function<bool(std::string_view, const OnInternalCommandEvent&)>;
+using CommandCompletionAction = std::function<std::string(std::string_view)>;
 
 // Internal command catalog and processing
 [[nodiscard]] auto buildInternalCommandCatalog(const REPLModifiers& modifiers) -> CommandCatalog;
 
+[[nodiscard]] auto findCommand(const CommandCatalog& externalCommands, const CommandCatalog& internalCommands, std::string_view cmdName) -> const Command*;
+
 [[nodiscard]] auto resolveCommandLine(const CommandCatalog& externalCommands, const CommandCatalog& internalCommands, std::string_view fullCommandLine) -> std::optional<ResolvedCommand>;
 
 auto handleHelpDisplay(const std::vector<std::string>& args, const CommandCatalog& externalCommands, const CommandCatalog& internalCommands, OutputBuffers& outBuffers) -> void;
 
 auto handleInternalCommands(const Command& command, const std::vector<std::string>& args, const CommandCatalog& externalCommands, const CommandCatalog& internalCommands, const OnInternalCommandEvent& onInternalCmd, OutputBuffers& outBuffers) -> bool;
 
-auto executeSingleCommandLine(const Command& command, const std::vector<std::string>& args, OutputBuffers& outBuffers) -> bool;
+[[nodiscard]] auto makeOutputBuffersCallbacks(OutputBuffers& outBuffers) -> CommandOutputCallbacks;
+
+[[nodiscard]] auto makeExecutionOptions(Session& session) -> ExecutionOptions;
+
+auto executeSingleCommandLine(const Command& command, const std::vector<std::string>& args, const CommandOutputCallbacks& callbacks, const ExecutionOptions& options = {}) -> bool;
+
+auto executeSingleCommandLine(const Command& command, const std::vector<std::string>& args, OutputBuffers& outBuffers, const ExecutionOptions& options = {}) -> bool;
+
+auto executeShellScriptCommand(const Command& command, const std::vector<std::string>& args, const CommandOutputCallbacks& callbacks, const ExecutionOptions& options = {}) -> bool;
+
+auto executeShellScriptCommand(const Command& command, const std::vector<std::string>& args, OutputBuffers& outBuffers, const ExecutionOptions& options = {}) -> bool;
+
+auto executeBuiltinCommand(const Command& command, const std::vector<std::string>& args, const std::vector<bool>& literalArgs, Session& session, const CommandOutputCallbacks& callbacks, const BuiltinCommandRunner& runner) -> bool;
+
+auto executePluginCommand(const Command& command, const std::vector<std::string>& args, Session& session, const CommandOutputCallbacks& callbacks) -> bool;
+
+// command output goes to the callbacks, internal commands still write their own entries to outBuffers.
+// literalArgs, empty or one per argument, marks the arguments builtins don't expand variables in
+auto executeResolvedCommand(const CommandCatalog& externalCommands, const CommandCatalog& internalCommands, OutputBuffers& outBuffers, const CommandOutputCallbacks& callbacks, Session& session, const Command& command, const std::vector<std::string>& args, const std::vector<bool>& literalArgs, const OnInternalCommandEvent& onInternalCmd) -> bool;
+
+// resolves every command and output filter of a tokenized line, stopping at the first one that can't be
+[[nodiscard]] auto buildCommandPlan(const CommandCatalog& externalCommands, const CommandCatalog& internalCommands, const CommandLineTokens& tokens) -> std::expected<CommandPlan, CommandPlanError>;
+
+auto executeCommandPlan(const CommandCatalog& externalCommands, const CommandCatalog& internalCommands, OutputBuffers& outBuffers, Session& session, const CommandPlan& plan, const OnInternalCommandEvent& onInternalCmd) -> bool;
+
+auto executeCommandLine(const CommandCatalog& externalCommands, const CommandCatalog& internalCommands, OutputBuffers& outBuffers, Session& session, std::string_view fullCommandLine, const OnInternalCommandEvent& onInternalCmd) -> bool;
 
-auto executeShellScriptCommand(const Command& command, const std::vector<std::string>& args, OutputBuffers& outBuffers) -> bool;
+[[nodiscard]] auto completeCommandLine(const CommandCatalog& externalCommands, const CommandCatalog& internalCommands, std::string_view commandLine) -> std::string;
 
-auto executeCommandLine(const CommandCatalog& externalCommands, const CommandCatalog& internalCommands, OutputBuffers& outBuffers, std::string_view fullCommandLine, const OnInternalCommandEvent& onInternalCmd) -> bool;
+auto makeCommandCompletionAction(const CommandCatalog& externalCommands, const REPLModifiers& modifiers) -> CommandCompletionAction;
 
-auto makeCommandProcessingAction(const CommandCatalog& externalCommands, const REPLModifiers& modifiers, OutputBuffers& outBuffers, CommandHistory& cmdHistory, OutputHistory& outputHistory) -> CommandProcessingAction;
+auto makeCommandProcessingAction(const CommandCatalog& externalCommands, const REPLModifiers& modifiers, OutputBuffers& outBuffers, Session& session, CommandHistory& cmdHistory, OutputHistory& outputHistory) -> CommandProcessingAction;
 
 template<typename Map, typename Key, typename Default>
 [[nodiscard]]
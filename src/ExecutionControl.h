@@ -0,0 +1,252 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <signal.h>
+#include <sys/resource.h>
+#include <sys/types.h>
+
+#include "ExecutionStats.h"
+
+namespace replmk {
+
+// columns and rows of text the output frame shows, the window size of commands running in a pseudo-terminal
+struct TerminalSize {
+    uint16_t columns{0};
+    uint16_t rows{0};
+};
+
+// what was typed for the stdin of the command since it was last taken, and whether end of file was asked for
+struct CommandInput {
+    std::string text{};
+    bool closed{false};
+};
+
+// stdout and stderr the command produced so far
+struct OutputProgress {
+    uint64_t bytes{0};
+    uint64_t lines{0};
+};
+
+/**
+ * Shared between the user interface and whatever is executing the current command.
+ * The interface requests cancellation, commands that support it poll IsCancelRequested.
+ * Processes spawned for the command are tracked while they run, so they can be signalled from another thread.
+ * Input typed while the command runs is queued here until the executor writes it to the command stdin.
+ * The resources used by the processes add up here too, once they have been waited for, and the output they produce
+ * is counted while they run so the interface can tell whether the command makes progress
+ */
+class ExecutionControl final {
+  private:
+    std::atomic<bool> cancelRequested{false};
+    std::atomic<bool> running{false};
+    std::atomic<std::chrono::steady_clock::rep> startTicks{0};
+    std::atomic<uint64_t> outputBytes{0};
+    std::atomic<uint64_t> outputLines{0};
+    // columns in the high half, rows in the low one, so both change at once
+    std::atomic<uint32_t> outputSize{0};
+
+    mutable std::mutex processesMutex;
+    std::vector<pid_t> processes;
+
+    mutable std::mutex usageMutex;
+    ExecutionStats processUsage;
+
+    mutable std::mutex inputMutex;
+    CommandInput input;
+    // running in a pseudo-terminal, the command gets every key instead of whole lines
+    std::atomic<bool> keystrokeInput{false};
+
+    // set once, before any command runs
+    std::function<void()> onIdle;
+    std::thread::id interactiveThread;
+    // only touched on the interactive thread, while the interface runs from a command waiting
+    mutable bool runningOnIdle{false};
+
+  public:
+    // longest a command waits before the interface gets its turn again
+    static constexpr auto IdleInterval = std::chrono::milliseconds{50};
+
+    ExecutionControl() = default;
+    ExecutionControl(const ExecutionControl&) = delete;
+    ExecutionControl(ExecutionControl&&) = delete;
+
+    auto operator=(const ExecutionControl&) -> ExecutionControl& = delete;
+    auto operator=(ExecutionControl&&) -> ExecutionControl& = delete;
+
+    auto BeginCommand() noexcept -> void {
+        cancelRequested.store(false);
+        {
+            const std::scoped_lock lock{inputMutex};
+            input = CommandInput{};
+        }
+        {
+            const std::scoped_lock lock{usageMutex};
+            processUsage = ExecutionStats{};
+        }
+        startTicks.store(std::chrono::steady_clock::now().time_since_epoch().count());
+        outputBytes.store(0);
+        outputLines.store(0);
+        running.store(true);
+    }
+
+    auto EndCommand() noexcept -> void {
+        running.store(false);
+    }
+
+    auto RequestCancel() noexcept -> void {
+        cancelRequested.store(true);
+    }
+
+    [[nodiscard]] auto IsCancelRequested() const noexcept -> bool {
+        return cancelRequested.load();
+    }
+
+    [[nodiscard]] auto IsRunning() const noexcept -> bool {
+        return running.load();
+    }
+
+    [[nodiscard]] auto StartTime() const noexcept -> std::chrono::steady_clock::time_point {
+        return std::chrono::steady_clock::time_point{std::chrono::steady_clock::duration{startTicks.load()}};
+    }
+
+    // called from whichever thread the output of the command arrives on
+    auto CountOutput(std::string_view chunk) noexcept -> void {
+        outputBytes += chunk.size();
+        outputLines += static_cast<uint64_t>(std::ranges::count(chunk, '\n'));
+    }
+
+    [[nodiscard]] auto Output() const noexcept -> OutputProgress {
+        return OutputProgress{.bytes = outputBytes.load(), .lines = outputLines.load()};
+    }
+
+    auto SetOutputSize(TerminalSize size) noexcept -> void {
+        outputSize.store((static_cast<uint32_t>(size.columns) << 16U) | size.rows);
+    }
+
+    // zero columns and rows until the interface knows the size
+    [[nodiscard]] auto OutputSize() const noexcept -> TerminalSize {
+        const auto packed = outputSize.load();
+        return TerminalSize{.columns = static_cast<uint16_t>(packed >> 16U), .rows = static_cast<uint16_t>(packed & 0xFFFFU)};
+    }
+
+    /**
+     * The interface keeps handling its events through onIdle, called by executors waiting for a command with nothing to show.
+     * Only commands executed on the thread setting it are interactive, the others read end of file from their stdin
+     */
+    auto SetOnIdle(std::function<void()> idleHandler) -> void {
+        onIdle = std::move(idleHandler);
+        interactiveThread = std::this_thread::get_id();
+    }
+
+    [[nodiscard]] auto IsInteractiveThread() const -> bool {
+        return onIdle and std::this_thread::get_id() == interactiveThread;
+    }
+
+    /**
+     * For commands checking on the interface without blocking, like plugins polling for cancellation. Waits go through
+     * WaitWithIdle instead. The interface is never entered again from its own events, that run inside onIdle
+     */
+    auto RunOnIdle() const -> void {
+        if (not this->IsInteractiveThread() or runningOnIdle) {
+            return;
+        }
+        runningOnIdle = true;
+        try {
+            onIdle();
+        } catch (...) {
+            runningOnIdle = false;
+            throw;
+        }
+        runningOnIdle = false;
+    }
+
+    /**
+     * Every wait of a command goes through here, so the interface keeps handling its events, Ctrl+C included, whatever
+     * the command waits for. waitStep blocks for at most the interval it is given and tells whether what it waits for
+     * happened. When it didn't, the interface gets its turn. The result is the one of waitStep
+     */
+    template<typename WaitStep>
+    auto WaitWithIdle(WaitStep&& waitStep) const -> bool {
+        const bool happened = std::forward<WaitStep>(waitStep)(IdleInterval);
+        if (not happened) {
+            this->RunOnIdle();
+        }
+        return happened;
+    }
+
+    auto SendInput(std::string_view text) -> void {
+        const std::scoped_lock lock{inputMutex};
+        input.text.append(text);
+    }
+
+    // Ctrl+D, the command reads end of file once what was sent before is written
+    auto CloseInput() -> void {
+        const std::scoped_lock lock{inputMutex};
+        input.closed = true;
+    }
+
+    [[nodiscard]] auto TakeInput() -> CommandInput {
+        const std::scoped_lock lock{inputMutex};
+        return std::exchange(input, CommandInput{});
+    }
+
+    auto SetKeystrokeInput(bool enabled) noexcept -> void {
+        keystrokeInput.store(enabled);
+    }
+
+    [[nodiscard]] auto IsKeystrokeInput() const noexcept -> bool {
+        return keystrokeInput.load();
+    }
+
+    auto AddProcess(pid_t pid) -> void {
+        const std::scoped_lock lock{processesMutex};
+        processes.push_back(pid);
+    }
+
+    // called once the process has been waited for
+    auto RemoveProcess(pid_t pid) -> void {
+        const std::scoped_lock lock{processesMutex};
+        std::erase(processes, pid);
+    }
+
+    [[nodiscard]] auto Processes() const -> std::vector<pid_t> {
+        const std::scoped_lock lock{processesMutex};
+        return processes;
+    }
+
+    auto AddProcessUsage(int waitStatus, const rusage& usage) -> void {
+        const std::scoped_lock lock{usageMutex};
+        addProcessUsage(processUsage, waitStatus, usage);
+    }
+
+    // what the processes waited for since the usage was last taken used, only the fields filled from rusage are set
+    [[nodiscard]] auto TakeProcessUsage() -> ExecutionStats {
+        const std::scoped_lock lock{usageMutex};
+        return std::exchange(processUsage, ExecutionStats{});
+    }
+
+    // executions run in process groups of their own, whatever their processes started is signalled too
+    auto SignalProcessGroups(int signalNumber) const -> void {
+        for (const auto pid : this->Processes()) {
+            // later stages of a pipeline are in the group of the first one, not leading one of their own
+            if (::kill(-pid, signalNumber) != 0) {
+                ::kill(pid, signalNumber);
+            }
+        }
+    }
+
+    ~ExecutionControl() = default;
+};
+
+} // namespace replmk
@@ -0,0 +1,191 @@
+#include <algorithm>
+#include <array>
+#include <format>
+#include <functional>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <sys/wait.h>
+
+#include "ExecutionStats.h"
+
+namespace replmk {
+
+namespace {
+
+constexpr std::string_view MissingField = "-";
+
+auto toMicroseconds(const timeval& time) -> std::chrono::microseconds {
+    return std::chrono::seconds{time.tv_sec} + std::chrono::microseconds{time.tv_usec};
+}
+
+auto serializeOptional(const std::optional<int>& value) -> std::string {
+    return value.has_value() ? std::to_string(value.value()) : std::string{MissingField};
+}
+
+// false when the text is neither a number nor the missing field
+auto parseOptional(const std::string& text, std::optional<int>& value) -> bool {
+    value.reset();
+    if (text == MissingField) {
+        return true;
+    }
+    try {
+        size_t parsed = 0;
+        value = std::stoi(text, &parsed);
+        return parsed == text.size();
+    } catch (...) {
+        return false;
+    }
+}
+
+auto formatSeconds(std::chrono::duration<double> duration) -> std::string {
+    return std::format("{:.2f}s", duration.count());
+}
+
+// names padded to the longest one, so the columns after them line up
+auto commandColumn(const std::vector<const CommandStatsSummary*>& ranked) -> std::vector<std::string> {
+    size_t width = 0;
+    for (const auto* summary : ranked) {
+        width = std::max(width, summary->command.size());
+    }
+    std::vector<std::string> names;
+    names.reserve(ranked.size());
+    for (const auto* summary : ranked) {
+        names.push_back(summary->command + std::string(width - summary->command.size(), ' '));
+    }
+    return names;
+}
+
+auto rankSummaries(const std::vector<CommandStatsSummary>& summaries, size_t count,
+                   const std::function<bool(const CommandStatsSummary&, const CommandStatsSummary&)>& isAbove) -> std::vector<const CommandStatsSummary*> {
+    std::vector<const CommandStatsSummary*> ranked;
+    ranked.reserve(summaries.size());
+    for (const auto& summary : summaries) {
+        ranked.push_back(&summary);
+    }
+    std::ranges::stable_sort(ranked, [&isAbove](const auto* first, const auto* second) {
+        return isAbove(*first, *second);
+    });
+    ranked.resize(std::min(count, ranked.size()));
+    return ranked;
+}
+
+} // namespace
+
+auto formatApproximateSize(uint64_t bytes) -> std::string {
+    constexpr double Kibibyte = 1024;
+    constexpr std::array<char, 3> Units{'K', 'M', 'G'};
+    auto size = static_cast<double>(bytes);
+    if (size < Kibibyte) {
+        return std::format("{}B", bytes);
+    }
+    char unit = Units.front();
+    for (const auto nextUnit : Units) {
+        unit = nextUnit;
+        size /= Kibibyte;
+        if (size < Kibibyte) {
+            break;
+        }
+    }
+    return std::format("{:.1f}{}", size, unit);
+}
+
+auto addProcessUsage(ExecutionStats& stats, int waitStatus, const rusage& usage) -> void {
+    stats.userCpu += toMicroseconds(usage.ru_utime);
+    stats.systemCpu += toMicroseconds(usage.ru_stime);
+    stats.maxRssKiB = std::max(stats.maxRssKiB, static_cast<uint64_t>(usage.ru_maxrss));
+    stats.majorFaults += static_cast<uint64_t>(usage.ru_majflt);
+    if (WIFEXITED(waitStatus)) {
+        stats.exitCode = WEXITSTATUS(waitStatus);
+        stats.signal.reset();
+    } else if (WIFSIGNALED(waitStatus)) {
+        stats.exitCode.reset();
+        stats.signal = WTERMSIG(waitStatus);
+    }
+}
+
+auto serializeExecutionStats(const ExecutionStats& stats) -> std::string {
+    return std::format("{} {} {} {} {} {} {} {} {} {}", stats.wallTime.count(), stats.userCpu.count(), stats.systemCpu.count(),
+                       stats.maxRssKiB, stats.majorFaults, stats.stdOutBytes, stats.stdErrBytes, serializeOptional(stats.exitCode),
+                       serializeOptional(stats.signal), stats.command);
+}
+
+auto parseExecutionStats(std::string_view text) -> std::optional<ExecutionStats> {
+    std::istringstream fields{std::string{text}};
+    int64_t wallTime = 0;
+    int64_t userCpu = 0;
+    int64_t systemCpu = 0;
+    ExecutionStats stats;
+    std::string exitCode;
+    std::string signal;
+    if (not (fields >> wallTime >> userCpu >> systemCpu >> stats.maxRssKiB >> stats.majorFaults >> stats.stdOutBytes >> stats.stdErrBytes >>
+             exitCode >> signal)) {
+        return std::nullopt;
+    }
+    // the single space separating it from the signal
+    fields.ignore(1);
+    if (not parseOptional(exitCode, stats.exitCode) or not parseOptional(signal, stats.signal) or not std::getline(fields, stats.command)) {
+        return std::nullopt;
+    }
+
+    stats.wallTime = std::chrono::milliseconds{wallTime};
+    stats.userCpu = std::chrono::microseconds{userCpu};
+    stats.systemCpu = std::chrono::microseconds{systemCpu};
+    return stats;
+}
+
+auto summarizeExecutionStats(const std::vector<ExecutionStats>& stats) -> std::vector<CommandStatsSummary> {
+    std::vector<CommandStatsSummary> summaries;
+    for (const auto& run : stats) {
+        auto summary = std::ranges::find(summaries, run.command, &CommandStatsSummary::command);
+        if (summary == summaries.end()) {
+            summary = summaries.insert(summaries.end(), CommandStatsSummary{.command = run.command});
+        }
+        summary->runs++;
+        if (run.Failed()) {
+            summary->failures++;
+        }
+        summary->totalWallTime += run.wallTime;
+        summary->maxWallTime = std::max(summary->maxWallTime, run.wallTime);
+        summary->totalCpu += run.userCpu + run.systemCpu;
+        summary->peakRssKiB = std::max(summary->peakRssKiB, run.maxRssKiB);
+        summary->majorFaults += run.majorFaults;
+        summary->outputBytes += run.stdOutBytes + run.stdErrBytes;
+    }
+    return summaries;
+}
+
+auto formatStatsRanking(const std::vector<CommandStatsSummary>& summaries, size_t count) -> std::string {
+    constexpr uint64_t Kibibyte = 1024;
+    if (summaries.empty()) {
+        return "No command ran yet\n";
+    }
+
+    std::string ranking = "Slowest commands, by average wall time:\n";
+    const auto slowest = rankSummaries(summaries, count, [](const auto& first, const auto& second) {
+        return first.AverageWallTime() > second.AverageWallTime();
+    });
+    const auto slowestNames = commandColumn(slowest);
+    for (size_t index = 0; index < slowest.size(); index++) {
+        const auto* summary = slowest.at(index);
+        ranking.append(std::format("  {}  {:>4} runs  avg {:>8}  max {:>8}  cpu {:>8}  {} failed\n", slowestNames.at(index), summary->runs, formatSeconds(summary->AverageWallTime()), formatSeconds(summary->maxWallTime),
+                                   formatSeconds(summary->totalCpu), summary->failures));
+    }
+
+    ranking.append("Heaviest commands, by peak memory:\n");
+    const auto heaviest = rankSummaries(summaries, count, [](const auto& first, const auto& second) {
+        return first.peakRssKiB > second.peakRssKiB;
+    });
+    const auto heaviestNames = commandColumn(heaviest);
+    for (size_t index = 0; index < heaviest.size(); index++) {
+        const auto* summary = heaviest.at(index);
+        ranking.append(std::format("  {}  {:>4} runs  max rss {:>7}  {} major faults  output {:>7}\n", heaviestNames.at(index), summary->runs, formatApproximateSize(summary->peakRssKiB * Kibibyte), summary->majorFaults,
+                                   formatApproximateSize(summary->outputBytes)));
+    }
+    return ranking;
+}
+
+} // namespace replmk
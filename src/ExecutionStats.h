@@ -0,0 +1,71 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <sys/resource.h>
+
+namespace replmk {
+
+// what one command line step cost, kept with its output
+struct ExecutionStats {
+    // names of the commands run, ' | ' between the stages of a pipeline
+    std::string command{};
+    std::chrono::milliseconds wallTime{0};
+    // of every process of the command, and of what they started and waited for
+    std::chrono::microseconds userCpu{0};
+    std::chrono::microseconds systemCpu{0};
+    // of the largest process, in KiB like getrusage reports it
+    uint64_t maxRssKiB{0};
+    uint64_t majorFaults{0};
+    uint64_t stdOutBytes{0};
+    uint64_t stdErrBytes{0};
+    // of the last process waited for, neither for commands running inside the REPL
+    std::optional<int> exitCode{};
+    std::optional<int> signal{};
+
+    [[nodiscard]] auto Failed() const -> bool {
+        return signal.has_value() or exitCode.value_or(0) != 0;
+    }
+};
+
+// adds a process once it has been waited for, with the usage wait4 reported
+auto addProcessUsage(ExecutionStats& stats, int waitStatus, const rusage& usage) -> void;
+
+// the fields on one line, the command last since it can contain spaces. How the output history keeps them
+[[nodiscard]] auto serializeExecutionStats(const ExecutionStats& stats) -> std::string;
+
+// empty when the text wasn't written by serializeExecutionStats
+[[nodiscard]] auto parseExecutionStats(std::string_view text) -> std::optional<ExecutionStats>;
+
+// rounded to one decimal of the largest unit it fills, like 8.0M
+[[nodiscard]] auto formatApproximateSize(uint64_t bytes) -> std::string;
+
+// every run of one command added up
+struct CommandStatsSummary {
+    std::string command{};
+    size_t runs{0};
+    size_t failures{0};
+    std::chrono::milliseconds totalWallTime{0};
+    std::chrono::milliseconds maxWallTime{0};
+    std::chrono::microseconds totalCpu{0};
+    uint64_t peakRssKiB{0};
+    uint64_t majorFaults{0};
+    uint64_t outputBytes{0};
+
+    [[nodiscard]] auto AverageWallTime() const -> std::chrono::milliseconds {
+        return runs == 0 ? std::chrono::milliseconds{0} : totalWallTime / static_cast<int64_t>(runs);
+    }
+};
+
+// one summary per command, in the order they first ran
+[[nodiscard]] auto summarizeExecutionStats(const std::vector<ExecutionStats>& stats) -> std::vector<CommandStatsSummary>;
+
+// the slowest commands, by average wall time, then the heaviest ones, by peak memory, at most count of each
+[[nodiscard]] auto formatStatsRanking(const std::vector<CommandStatsSummary>& summaries, size_t count) -> std::string;
+
+} // namespace replmk
@@ -0,0 +1,216 @@
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <condition_variable>
+#include <format>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "FanOut.h"
+
+namespace replmk {
+
+namespace {
+
+constexpr std::string_view ConcurrencyOption = "-j";
+auto parseConcurrency(std::string_view text) -> std::expected<size_t, std::string> {
+    size_t concurrency = 0;
+    const auto* const textEnd = text.data() + text.size(); //NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    const auto [ptr, errorCode] = std::from_chars(text.data(), textEnd, concurrency);
+    if (errorCode != std::errc{} or ptr != textEnd or concurrency == 0) {
+        return std::unexpected{std::format("{}: expected a positive number of concurrent runs after {}, got '{}'", FanOutKeyword, ConcurrencyOption, text)};
+    }
+    return concurrency;
+}
+
+auto effectiveConcurrency(size_t requested, size_t itemCount) -> size_t {
+    const size_t processors = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+    return std::max<size_t>(std::min(requested == 0 ? processors : requested, itemCount), 1);
+}
+
+} // namespace
+
+auto parseFanOutArguments(std::span<const std::string_view> words) -> std::expected<FanOutArguments, std::string> {
+    FanOutArguments arguments;
+
+    size_t index = 0;
+    if (index < words.size() and words[index].starts_with(ConcurrencyOption)) {
+        auto concurrencyText = words[index].substr(ConcurrencyOption.size());
+        if (concurrencyText.empty() and ++index < words.size()) {
+            concurrencyText = words[index];
+        }
+        const auto concurrency = parseConcurrency(concurrencyText);
+        if (not concurrency.has_value()) {
+            return std::unexpected{concurrency.error()};
+        }
+        arguments.concurrency = concurrency.value();
+        index++;
+    }
+
+    for (; index < words.size(); index++) {
+        if (words[index] == FanOutItemsSeparator) {
+            arguments.hasItemsSeparator = true;
+            arguments.items = {std::next(words.begin(), static_cast<std::ptrdiff_t>(index + 1)), words.end()};
+            break;
+        }
+        arguments.commandWords.emplace_back(words[index]);
+    }
+
+    if (arguments.commandWords.empty()) {
+        return std::unexpected{std::format("{}: expected a command to run for each item", FanOutKeyword)};
+    }
+    if (arguments.hasItemsSeparator and arguments.items.empty()) {
+        return std::unexpected{std::format("{}: no items after '{}'", FanOutKeyword, FanOutItemsSeparator)};
+    }
+    return arguments;
+}
+
+auto substituteFanOutItem(const std::vector<std::string>& args, std::string_view item) -> std::vector<std::string> {
+    std::vector<std::string> substituted;
+    substituted.reserve(args.size() + 1);
+
+    bool hasPlaceholder = false;
+    for (const auto& arg : args) {
+        auto& current = substituted.emplace_back();
+        size_t start = 0;
+        for (auto found = arg.find(FanOutPlaceholder); found != std::string::npos; found = arg.find(FanOutPlaceholder, start)) {
+            current.append(arg, start, found - start).append(item);
+            start = found + FanOutPlaceholder.size();
+            hasPlaceholder = true;
+        }
+        current.append(arg, start);
+    }
+
+    if (not hasPlaceholder) {
+        substituted.emplace_back(item);
+    }
+    return substituted;
+}
+
+auto splitFanOutItems(std::string_view output) -> std::vector<std::string> {
+    std::vector<std::string> items;
+    while (not output.empty()) {
+        const auto lineEnd = std::min(output.find('\n'), output.size());
+        auto line = output.substr(0, lineEnd);
+        if (line.ends_with('\r')) {
+            line.remove_suffix(1);
+        }
+        if (not line.empty()) {
+            items.emplace_back(line);
+        }
+        output.remove_prefix(std::min(lineEnd + 1, output.size()));
+    }
+    return items;
+}
+
+auto runFanOut(size_t itemCount, size_t concurrency, const FanOutTask& task, const ExecutionControl& control,
+               const OnFanOutItemDone& onItemDone) -> FanOutSummary {
+    const auto startTime = std::chrono::steady_clock::now();
+    FanOutSummary summary{.succeeded = 0, .failed = 0, .notRun = 0, .concurrency = effectiveConcurrency(concurrency, itemCount), .elapsed = {}};
+
+    std::mutex resultsMutex;
+    std::condition_variable resultsCondition;
+    std::vector<FanOutItemResult> finished;
+    size_t activeWorkers = summary.concurrency;
+    std::atomic<size_t> nextItem{0};
+    std::atomic<size_t> startedItems{0};
+
+    const auto worker = [&]() {
+        while (not control.IsCancelRequested()) {
+            const auto index = nextItem.fetch_add(1);
+            if (index >= itemCount) {
+                break;
+            }
+            startedItems.fetch_add(1);
+
+            FanOutItemResult result{.index = index, .succeeded = false, .stdOut = {}, .stdErr = {}, .elapsed = {}};
+            const auto itemStartTime = std::chrono::steady_clock::now();
+            result.succeeded = task(index, CommandOutputCallbacks{
+                .onStdOut = [&result](std::string_view chunk) {
+                    result.stdOut.append(chunk);
+                },
+                .onStdErr = [&result](std::string_view chunk) {
+                    result.stdErr.append(chunk);
+                }
+            });
+            result.elapsed = std::chrono::steady_clock::now() - itemStartTime;
+
+            const std::scoped_lock lock{resultsMutex};
+            finished.push_back(std::move(result));
+            resultsCondition.notify_one();
+        }
+
+        const std::scoped_lock lock{resultsMutex};
+        activeWorkers--;
+        resultsCondition.notify_one();
+    };
+
+    std::vector<std::jthread> workers;
+    workers.reserve(summary.concurrency);
+    for (size_t count = 0; count < summary.concurrency; count++) {
+        workers.emplace_back(worker);
+    }
+
+    // results are handed over here, on the calling thread, which may be the one drawing the interface.
+    // While no item finishes, the interface handles its events, Ctrl+C included
+    while (true) {
+        std::vector<FanOutItemResult> ready;
+        bool allDone = false;
+        control.WaitWithIdle([&](std::chrono::milliseconds interval) {
+            std::unique_lock lock{resultsMutex};
+            const bool handedOver = resultsCondition.wait_for(lock, interval, [&finished, &activeWorkers]() {
+                return not finished.empty() or activeWorkers == 0;
+            });
+            ready = std::exchange(finished, {});
+            allDone = activeWorkers == 0;
+            return handedOver;
+        });
+
+        for (const auto& result : ready) {
+            (result.succeeded ? summary.succeeded : summary.failed)++;
+            onItemDone(result);
+        }
+        if (allDone) {
+            break;
+        }
+    }
+
+    workers.clear();
+    summary.notRun = itemCount - startedItems.load();
+    summary.elapsed = std::chrono::steady_clock::now() - startTime;
+    return summary;
+}
+
+auto formatFanOutItemOutput(std::string_view item, const FanOutItemResult& result) -> std::string {
+    auto output = std::format("[{} {:.3f}s] {}\n", result.succeeded ? "ok" : "failed", result.elapsed.count(), item);
+    output.append(result.stdOut);
+    if (not result.stdOut.empty() and not result.stdOut.ends_with('\n')) {
+        output.push_back('\n');
+    }
+    return output;
+}
+
+auto formatFanOutItemErrors(std::string_view item, const FanOutItemResult& result) -> std::string {
+    std::string errors;
+    for (const auto& line : splitFanOutItems(result.stdErr)) {
+        errors.append(item).append(": ").append(line).push_back('\n');
+    }
+    return errors;
+}
+
+auto formatFanOutSummary(const FanOutSummary& summary) -> std::string {
+    auto text = std::format("{}: {} succeeded, {} failed", FanOutKeyword, summary.succeeded, summary.failed);
+    if (summary.notRun > 0) {
+        text.append(std::format(", {} not run", summary.notRun));
+    }
+    text.append(std::format(" in {:.3f}s, {} at a time\n", summary.elapsed.count(), summary.concurrency));
+    return text;
+}
+
+} // namespace replmk
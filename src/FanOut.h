@@ -0,0 +1,75 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <expected>
+#include <functional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "ExecutionControl.h"
+#include "ProcessExecutor.h"
+
+namespace replmk {
+
+constexpr std::string_view FanOutKeyword = "@each";
+constexpr std::string_view FanOutItemsSeparator = ":::";
+constexpr std::string_view FanOutPlaceholder = "{}";
+
+// what follows '@each' in a command line: [-jN] command [args...] [::: items...]
+struct FanOutArguments {
+    // 0 when not given, one per processor
+    size_t concurrency{0};
+    std::vector<std::string> commandWords{};
+    std::vector<std::string> items{};
+    bool hasItemsSeparator{false};
+};
+
+[[nodiscard]] auto parseFanOutArguments(std::span<const std::string_view> words) -> std::expected<FanOutArguments, std::string>;
+
+// '{}' replaced by the item in every argument, or the item added as the last argument when none has it
+[[nodiscard]] auto substituteFanOutItem(const std::vector<std::string>& args, std::string_view item) -> std::vector<std::string>;
+
+// non empty lines of a command output, the items of a fan-out fed by a pipe
+[[nodiscard]] auto splitFanOutItems(std::string_view output) -> std::vector<std::string>;
+
+struct FanOutItemResult {
+    size_t index{0};
+    bool succeeded{false};
+    std::string stdOut{};
+    std::string stdErr{};
+    std::chrono::duration<double> elapsed{};
+};
+
+struct FanOutSummary {
+    size_t succeeded{0};
+    size_t failed{0};
+    // items left when the fan-out was cancelled
+    size_t notRun{0};
+    size_t concurrency{0};
+    std::chrono::duration<double> elapsed{};
+};
+
+// runs on a worker thread, with callbacks collecting the output of that item only
+using FanOutTask = std::function<bool(size_t index, const CommandOutputCallbacks& callbacks)>;
+using OnFanOutItemDone = std::function<void(const FanOutItemResult& result)>;
+
+/**
+ * Runs task once per item, on at most concurrency worker threads at a time. The output of each item is collected apart
+ * and handed to onItemDone, on the calling thread, as soon as the item finishes, so results come in completion order.
+ * Once control asks for cancellation no new item starts, and the executions still running stop themselves as they share it
+ */
+auto runFanOut(size_t itemCount, size_t concurrency, const FanOutTask& task, const ExecutionControl& control,
+               const OnFanOutItemDone& onItemDone) -> FanOutSummary;
+
+// status line of an item followed by its output, which always ends with a newline
+[[nodiscard]] auto formatFanOutItemOutput(std::string_view item, const FanOutItemResult& result) -> std::string;
+
+// the errors of an item, each line prefixed with the item
+[[nodiscard]] auto formatFanOutItemErrors(std::string_view item, const FanOutItemResult& result) -> std::string;
+
+[[nodiscard]] auto formatFanOutSummary(const FanOutSummary& summary) -> std::string;
+
+} // namespace replmk
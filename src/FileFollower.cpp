@@ -0,0 +1,258 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <format>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "FileFollower.h"
+
+namespace replmk {
+
+namespace {
+
+constexpr size_t ReadChunkSize = 64 * 1024;
+constexpr size_t EventBufferSize = 4096;
+constexpr uint32_t FileEvents = IN_MODIFY | IN_MOVE_SELF | IN_DELETE_SELF;
+// a new file taking the name of a followed one, after it was rotated or when it didn't exist yet
+constexpr uint32_t DirectoryEvents = IN_CREATE | IN_MOVED_TO;
+
+struct FollowedFile {
+    std::filesystem::path path;
+    int fd{-1};
+    off_t offset{0};
+    int fileWatch{-1};
+    int directoryWatch{-1};
+};
+
+struct FollowState {
+    int inotifyFd{-1};
+    std::vector<FollowedFile> files{};
+    std::vector<char> chunk = std::vector<char>(ReadChunkSize);
+    // file whose bytes were shown last, and whether they ended a line
+    std::optional<size_t> lastShown{};
+    bool lastEndedLine{true};
+};
+
+// offset where the last lines of the file start, read backwards a chunk at a time
+auto findTailStart(int fd, off_t fileSize, size_t lines, std::vector<char>& chunk) -> off_t {
+    if (lines == 0) {
+        return fileSize;
+    }
+
+    // the newline ending the file ends the last line, it doesn't start another one
+    size_t newlinesSeen = 0;
+    off_t chunkEnd = fileSize;
+    while (chunkEnd > 0) {
+        const auto chunkStart = std::max<off_t>(0, chunkEnd - static_cast<off_t>(chunk.size()));
+        const auto bytesRead = ::pread(fd, chunk.data(), static_cast<size_t>(chunkEnd - chunkStart), chunkStart);
+        if (bytesRead <= 0) {
+            return 0;
+        }
+        for (auto position = bytesRead; position > 0; position--) {
+            const off_t offset = chunkStart + position - 1;
+            if (chunk[static_cast<size_t>(position - 1)] == '\n' and offset != fileSize - 1 and ++newlinesSeen == lines) {
+                return offset + 1;
+            }
+        }
+        chunkEnd = chunkStart;
+    }
+    return 0;
+}
+
+auto closeFollowed(FollowState& state, FollowedFile& file) -> void {
+    if (file.fileWatch >= 0) {
+        ::inotify_rm_watch(state.inotifyFd, file.fileWatch);
+        file.fileWatch = -1;
+    }
+    if (file.fd >= 0) {
+        ::close(file.fd);
+        file.fd = -1;
+    }
+}
+
+// everything past the offset of the file, the whole file again when it was truncated
+auto showAppended(FollowState& state, size_t index, const CommandOutputCallbacks& callbacks, const ExecutionControl& control) -> void {
+    auto& file = state.files.at(index);
+    if (file.fd < 0) {
+        return;
+    }
+
+    struct stat fileStatus{};
+    if (::fstat(file.fd, &fileStatus) == 0 and fileStatus.st_size < file.offset) {
+        callbacks.onStdErr(std::format("'{}' was truncated, reading it from the start\n", file.path.string()));
+        file.offset = 0;
+    }
+
+    while (not control.IsCancelRequested()) {
+        const auto bytesRead = ::pread(file.fd, state.chunk.data(), state.chunk.size(), file.offset);
+        if (bytesRead <= 0) {
+            return;
+        }
+
+        if (state.files.size() > 1 and state.lastShown != index) {
+            callbacks.onStdOut(std::format("{}==> {} <==\n", state.lastEndedLine ? "" : "\n", file.path.string()));
+        }
+        const std::string_view bytes{state.chunk.data(), static_cast<size_t>(bytesRead)};
+        callbacks.onStdOut(bytes);
+        state.lastShown = index;
+        state.lastEndedLine = bytes.ends_with('\n');
+        file.offset += bytesRead;
+    }
+}
+
+// starts from the last lines of a file followed from the beginning, or from its first byte when it appeared later
+auto openFollowed(FollowState& state, FollowedFile& file, std::optional<size_t> tailLines) -> bool {
+    file.fd = ::open(file.path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (file.fd < 0) {
+        return false;
+    }
+    file.fileWatch = ::inotify_add_watch(state.inotifyFd, file.path.c_str(), FileEvents);
+
+    struct stat fileStatus{};
+    const off_t fileSize = ::fstat(file.fd, &fileStatus) == 0 ? fileStatus.st_size : 0;
+    file.offset = tailLines.has_value() ? findTailStart(file.fd, fileSize, tailLines.value(), state.chunk) : 0;
+    return true;
+}
+
+auto isSameFile(int fd, const std::filesystem::path& path) -> bool {
+    struct stat openStatus{};
+    struct stat pathStatus{};
+    return ::fstat(fd, &openStatus) == 0 and ::stat(path.c_str(), &pathStatus) == 0 and openStatus.st_dev == pathStatus.st_dev and
+           openStatus.st_ino == pathStatus.st_ino;
+}
+
+auto handleEvent(FollowState& state, const inotify_event& event, const CommandOutputCallbacks& callbacks, const ExecutionControl& control) -> void {
+    for (size_t index = 0; index < state.files.size(); index++) {
+        auto& file = state.files[index];
+        if (event.wd == file.fileWatch and file.fd >= 0) {
+            // moved or deleted, what was written before that is still shown
+            showAppended(state, index, callbacks, control);
+            if ((event.mask & (IN_MOVE_SELF | IN_DELETE_SELF)) != 0) {
+                closeFollowed(state, file);
+            }
+            continue;
+        }
+
+        if (event.wd != file.directoryWatch or event.len == 0 or std::string_view{event.name} != file.path.filename().string()) {
+            continue;
+        }
+        if (file.fd >= 0) {
+            if (isSameFile(file.fd, file.path)) {
+                continue;
+            }
+            showAppended(state, index, callbacks, control);
+            closeFollowed(state, file);
+        }
+        if (openFollowed(state, file, std::nullopt)) {
+            callbacks.onStdErr(std::format("'{}' appeared, following it\n", file.path.string()));
+            showAppended(state, index, callbacks, control);
+        }
+    }
+}
+
+auto readEvents(FollowState& state, const CommandOutputCallbacks& callbacks, const ExecutionControl& control) -> void {
+    alignas(inotify_event) std::array<char, EventBufferSize> events{};
+    const auto bytesRead = ::read(state.inotifyFd, events.data(), events.size());
+    if (bytesRead <= 0) {
+        return;
+    }
+
+    size_t position = 0;
+    while (position + sizeof(inotify_event) <= static_cast<size_t>(bytesRead)) {
+        const auto* event = reinterpret_cast<const inotify_event*>(&events.at(position)); //NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+        handleEvent(state, *event, callbacks, control);
+        position += sizeof(inotify_event) + event->len;
+    }
+}
+
+} // namespace
+
+auto splitFollowedPaths(std::string_view exec) -> std::vector<std::string> {
+    constexpr std::string_view Whitespace = " \t\r\n";
+    std::vector<std::string> paths;
+    while (true) {
+        const auto start = exec.find_first_not_of(Whitespace);
+        if (start == std::string_view::npos) {
+            return paths;
+        }
+        exec.remove_prefix(start);
+        const auto end = std::min(exec.find_first_of(Whitespace), exec.size());
+        paths.emplace_back(exec.substr(0, end));
+        exec.remove_prefix(end);
+    }
+}
+
+auto followFiles(const std::vector<std::filesystem::path>& files, const CommandOutputCallbacks& callbacks, const ExecutionControl& control,
+                 size_t initialLines) -> bool {
+    if (files.empty()) {
+        callbacks.onStdErr("No file to follow\n");
+        return false;
+    }
+
+    FollowState state;
+    state.inotifyFd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (state.inotifyFd < 0) {
+        callbacks.onStdErr("Could not start watching files\n");
+        return false;
+    }
+
+    for (const auto& path : files) {
+        // the same file twice would share its watch
+        if (std::ranges::any_of(state.files, [&path](const FollowedFile& file) { return file.path == path; })) {
+            continue;
+        }
+
+        const auto directory = path.has_parent_path() ? path.parent_path() : std::filesystem::path{"."};
+        FollowedFile file{.path = path, .fd = -1, .offset = 0, .fileWatch = -1, .directoryWatch = -1};
+        file.directoryWatch = ::inotify_add_watch(state.inotifyFd, directory.c_str(), DirectoryEvents | IN_ONLYDIR);
+        if (file.directoryWatch < 0) {
+            callbacks.onStdErr(std::format("'{}' can't be followed, '{}' is not a directory that can be read\n", path.string(), directory.string()));
+            continue;
+        }
+        if (not openFollowed(state, file, initialLines)) {
+            callbacks.onStdErr(std::format("'{}' does not exist yet, it is followed once created\n", path.string()));
+        }
+        state.files.push_back(std::move(file));
+    }
+
+    if (state.files.empty()) {
+        ::close(state.inotifyFd);
+        return false;
+    }
+
+    for (size_t index = 0; index < state.files.size(); index++) {
+        showAppended(state, index, callbacks, control);
+    }
+
+    pollfd eventsPoll{.fd = state.inotifyFd, .events = POLLIN, .revents = 0};
+    while (not control.IsCancelRequested()) {
+        // a quiet file leaves the interface to its events, Ctrl+C included
+        int ready = 0;
+        control.WaitWithIdle([&eventsPoll, &ready](std::chrono::milliseconds interval) {
+            ready = ::poll(&eventsPoll, 1, static_cast<int>(interval.count()));
+            return ready != 0;
+        });
+        if (ready > 0) {
+            readEvents(state, callbacks, control);
+        }
+    }
+
+    for (auto& file : state.files) {
+        closeFollowed(state, file);
+    }
+    ::close(state.inotifyFd);
+    return true;
+}
+
+} // namespace replmk
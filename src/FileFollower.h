@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <string_view>
+#include <vector>
+
+#include "ExecutionControl.h"
+#include "ProcessExecutor.h"
+
+namespace replmk {
+
+// lines of each file shown before following it, like 'tail -f'
+constexpr size_t DefaultFollowLines = 10;
+
+// the exec of a follow command, one or more paths separated by whitespace
+[[nodiscard]] auto splitFollowedPaths(std::string_view exec) -> std::vector<std::string>;
+
+/**
+ * Shows the last lines of every file and then the bytes appended to them, as they are written, until control asks
+ * for cancellation. Files are read by the REPL itself, woken up by inotify, without starting any process.
+ * A file that is truncated is read again from the start, and one that is moved or deleted, when logs rotate, is followed
+ * again once a new file appears with its name. Files that don't exist yet are followed from the moment they are created.
+ * With several files a '==> path <==' line tells whose output comes next, whenever that changes.
+ * Fails when none of the files can be followed
+ */
+auto followFiles(const std::vector<std::filesystem::path>& files, const CommandOutputCallbacks& callbacks, const ExecutionControl& control,
+                 size_t initialLines = DefaultFollowLines) -> bool;
+
+} // namespace replmk
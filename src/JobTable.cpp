@@ -0,0 +1,157 @@
+#include <chrono>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+
+#include "JobTable.h"
+#include "Session.h"
+
+namespace replmk {
+
+auto jobStateName(JobState state) -> std::string_view {
+    switch(state) {
+    case JobState::Running:
+        return "Running";
+    case JobState::Succeeded:
+        return "Done";
+    case JobState::Failed:
+        return "Failed";
+    case JobState::Killed:
+        return "Killed";
+    default:
+        return "";
+    }
+}
+
+Job::Job(size_t jobId, std::string line, const Session& parentSession)
+    : id{jobId},
+      commandLine{std::move(line)},
+      startTime{std::chrono::system_clock::now()},
+      steadyStartTime{std::chrono::steady_clock::now()},
+      session{std::make_unique<Session>()} {
+    this->session->workingDirectory = parentSession.workingDirectory;
+    this->session->previousWorkingDirectory = parentSession.previousWorkingDirectory;
+    this->session->variables = parentSession.variables;
+    this->session->cache.SetDirectory(parentSession.cache.Directory());
+    this->session->fullOutputDirectory = parentSession.fullOutputDirectory;
+}
+
+auto Job::Start(JobBody body) -> void {
+    // before the thread starts, a Kill right after Start must not be forgotten
+    this->session->control.BeginCommand();
+    this->thread = std::thread{[this, jobBody = std::move(body)]() {
+        const bool result = jobBody(*this->session, this->outBuffers);
+        this->session->control.EndCommand();
+
+        this->elapsedTicks.store((std::chrono::steady_clock::now() - this->steadyStartTime).count());
+        if(this->killRequested.load()) {
+            this->state.store(JobState::Killed);
+        } else {
+            this->state.store(result ? JobState::Succeeded : JobState::Failed);
+        }
+    }};
+}
+
+auto Job::Elapsed() const -> std::chrono::steady_clock::duration {
+    if(this->IsRunning()) {
+        return std::chrono::steady_clock::now() - this->steadyStartTime;
+    }
+    return std::chrono::steady_clock::duration{this->elapsedTicks.load()};
+}
+
+auto Job::Processes() const -> std::vector<pid_t> {
+    return this->session->control.Processes();
+}
+
+auto Job::BytesProduced() const -> size_t {
+    size_t bytes = 0;
+    this->outBuffers.VisitEntries([&bytes](const std::vector<OutputBufferEntry>& entries) {
+        for(const auto& entry: entries) {
+            bytes += entry.stdOutEntry.size() + entry.stdErrEntry.size();
+        }
+    });
+    return bytes;
+}
+
+auto Job::CopyOutput(JobOutputCursor& cursor, const CommandOutputCallbacks& callbacks) const -> void {
+    std::string stdOut;
+    std::string stdErr;
+    this->outBuffers.VisitEntries([&cursor, &stdOut, &stdErr](const std::vector<OutputBufferEntry>& entries) {
+        for(; cursor.entryIndex < entries.size(); cursor.entryIndex++) {
+            const auto& entry = entries.at(cursor.entryIndex);
+            if(not cursor.promptCopied) {
+                stdOut.append(entry.prompt);
+            }
+            stdOut.append(entry.stdOutEntry, cursor.stdOutOffset);
+            stdErr.append(entry.stdErrEntry, cursor.stdErrOffset);
+
+            // the last entry may still grow, the cursor stays on it
+            if(cursor.entryIndex + 1 == entries.size()) {
+                cursor.stdOutOffset = entry.stdOutEntry.size();
+                cursor.stdErrOffset = entry.stdErrEntry.size();
+                cursor.promptCopied = true;
+                return;
+            }
+            cursor.stdOutOffset = 0;
+            cursor.stdErrOffset = 0;
+            cursor.promptCopied = false;
+        }
+    });
+
+    // outside the lock, the callbacks may take their time
+    if(not stdOut.empty()) {
+        callbacks.onStdOut(stdOut);
+    }
+    if(not stdErr.empty()) {
+        callbacks.onStdErr(stdErr);
+    }
+}
+
+auto Job::Kill() -> void {
+    if(not this->IsRunning()) {
+        return;
+    }
+    this->killRequested.store(true);
+    this->session->control.RequestCancel();
+}
+
+Job::~Job() {
+    if(not this->thread.joinable()) {
+        return;
+    }
+    this->Kill();
+    this->thread.join();
+}
+
+auto JobTable::Start(std::string commandLine, const Session& parentSession, JobBody body) -> Job& {
+    const auto jobId = this->nextId++;
+    auto& job = this->jobs.emplace(jobId, std::make_unique<Job>(jobId, std::move(commandLine), parentSession)).first->second;
+    job->Start(std::move(body));
+    return *job;
+}
+
+auto JobTable::Find(std::optional<size_t> jobId) -> Job* {
+    if(this->jobs.empty()) {
+        return nullptr;
+    }
+    if(not jobId.has_value()) {
+        return std::prev(this->jobs.end())->second.get();
+    }
+    const auto foundJob = this->jobs.find(jobId.value());
+    return foundJob == this->jobs.end() ? nullptr : foundJob->second.get();
+}
+
+auto JobTable::Remove(size_t jobId) -> void {
+    this->jobs.erase(jobId);
+}
+
+JobTable::~JobTable() {
+    // every job winds down at the same time, instead of each one waiting for the previous to finish
+    for(const auto& entry: this->jobs) {
+        entry.second->Kill();
+    }
+    this->jobs.clear();
+}
+
+} // namespace replmk
@@ -0,0 +1,145 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <sys/types.h>
+
+#include "OutputBuffers.h"
+#include "ProcessExecutor.h"
+
+namespace replmk {
+
+struct Session;
+
+enum class JobState: uint8_t {
+    Running,
+    Succeeded,
+    Failed,
+    Killed
+};
+
+[[nodiscard]] auto jobStateName(JobState state) -> std::string_view;
+
+// runs in the job thread, with the session and buffers of the job. The result is the one of the command line
+using JobBody = std::function<bool(Session& session, OutputBuffers& outBuffers)>;
+
+// how much of the output of a job was already copied somewhere else
+struct JobOutputCursor {
+    size_t entryIndex{0};
+    size_t stdOutOffset{0};
+    size_t stdErrOffset{0};
+    bool promptCopied{false};
+};
+
+/**
+ * Command line running in a thread of its own, next to the one the user keeps typing in.
+ * It gets a session copied from the one it was started from, so builtins like cd only change the job,
+ * and its output goes to its own buffers until the user asks for it
+ */
+class Job final {
+  private:
+    size_t id;
+    std::string commandLine;
+    std::chrono::system_clock::time_point startTime;
+    std::chrono::steady_clock::time_point steadyStartTime;
+    std::atomic<std::chrono::steady_clock::rep> elapsedTicks{0};
+    std::atomic<JobState> state{JobState::Running};
+    std::atomic<bool> killRequested{false};
+
+    std::unique_ptr<Session> session;
+    OutputBuffers outBuffers;
+    std::thread thread;
+
+  public:
+    Job(size_t jobId, std::string line, const Session& parentSession);
+    Job(const Job&) = delete;
+    Job(Job&&) = delete;
+
+    auto operator=(const Job&) -> Job& = delete;
+    auto operator=(Job&&) -> Job& = delete;
+
+    // separate from the constructor, the body may use the job as soon as the thread starts
+    auto Start(JobBody body) -> void;
+
+    [[nodiscard]] auto Id() const -> size_t {
+        return this->id;
+    }
+
+    [[nodiscard]] auto CommandLine() const -> const std::string& {
+        return this->commandLine;
+    }
+
+    [[nodiscard]] auto StartTime() const -> std::chrono::system_clock::time_point {
+        return this->startTime;
+    }
+
+    [[nodiscard]] auto State() const -> JobState {
+        return this->state.load();
+    }
+
+    [[nodiscard]] auto IsRunning() const -> bool {
+        return this->State() == JobState::Running;
+    }
+
+    // up to now while running, up to the end of the command line afterwards
+    [[nodiscard]] auto Elapsed() const -> std::chrono::steady_clock::duration;
+
+    // processes the job is waiting for right now, none while it runs builtins or plugins in-process
+    [[nodiscard]] auto Processes() const -> std::vector<pid_t>;
+
+    // stdout and stderr produced so far
+    [[nodiscard]] auto BytesProduced() const -> size_t;
+
+    // copies what was produced since the cursor, moving it forward. Prompts of the steps in the line go with stdout
+    auto CopyOutput(JobOutputCursor& cursor, const CommandOutputCallbacks& callbacks) const -> void;
+
+    // cancels the command line, like Ctrl+C does in the foreground: in-process commands stop and processes get SIGINT,
+    // then SIGKILL if they still run StopGracePeriod later. It finishes as Killed. Returns right away
+    auto Kill() -> void;
+
+    // waits for the command line to finish, killing it first
+    ~Job();
+};
+
+/**
+ * Background jobs of a session, by id. Ids start at 1 and are never reused in a session
+ */
+class JobTable final {
+  private:
+    std::map<size_t, std::unique_ptr<Job>> jobs;
+    size_t nextId{1};
+
+  public:
+    JobTable() = default;
+    JobTable(const JobTable&) = delete;
+    JobTable(JobTable&&) = delete;
+
+    auto operator=(const JobTable&) -> JobTable& = delete;
+    auto operator=(JobTable&&) -> JobTable& = delete;
+
+    auto Start(std::string commandLine, const Session& parentSession, JobBody body) -> Job&;
+
+    // the given job, or the most recent one when no id is given. Null when there is no such job
+    [[nodiscard]] auto Find(std::optional<size_t> jobId) -> Job*;
+
+    auto Remove(size_t jobId) -> void;
+
+    [[nodiscard]] auto Jobs() const -> const std::map<size_t, std::unique_ptr<Job>>& {
+        return this->jobs;
+    }
+
+    // kills every job still running before waiting for any of them
+    ~JobTable();
+};
+
+} // namespace replmk
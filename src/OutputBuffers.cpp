@@ -1,34 +1,251 @@
+#include <algorithm>
+#include <limits>
 #include <string>
 #include <string_view>
+#include <mutex>
+#include <utility>
 
 
 #include "OutputBuffers.h"
 
 namespace replmk {
 
+namespace {
+
+auto streamText(const OutputBufferEntry& entry, OutputStream stream) -> const std::string& {
+    return stream == OutputStream::StdOut ? entry.stdOutEntry : entry.stdErrEntry;
+}
+
+auto streamText(OutputBufferEntry& entry, OutputStream stream) -> std::string& {
+    return stream == OutputStream::StdOut ? entry.stdOutEntry : entry.stdErrEntry;
+}
+
+auto streamLines(OutputBufferEntry& entry, OutputStream stream) -> LineIndex& {
+    return stream == OutputStream::StdOut ? entry.stdOutLines : entry.stdErrLines;
+}
+
+auto streamStyles(OutputBufferEntry& entry, OutputStream stream) -> std::vector<StyleSpan>& {
+    return stream == OutputStream::StdOut ? entry.stdOutStyles : entry.stdErrStyles;
+}
+
+auto streamParser(OutputBufferEntry& entry, OutputStream stream) -> AnsiTextParser& {
+    return stream == OutputStream::StdOut ? entry.stdOutParser : entry.stdErrParser;
+}
+
+// the output is read again from its start, its styles with it
+auto parseOutput(OutputBufferEntry& entry, OutputStream stream, std::string_view output) -> void {
+    streamText(entry, stream).clear();
+    streamStyles(entry, stream).clear();
+    streamParser(entry, stream).Reset();
+    streamParser(entry, stream).Feed(output, streamText(entry, stream), streamStyles(entry, stream));
+}
+
+// entries read back from the history have no escape sequences left, their styles came with them
+auto parseInitialOutput(OutputBufferEntry& entry, OutputStream stream) -> void {
+    if (streamText(entry, stream).find('\x1b') == std::string::npos) {
+        return;
+    }
+    const std::string output = std::move(streamText(entry, stream));
+    parseOutput(entry, stream, output);
+}
+
+auto indexLines(OutputBufferEntry& entry) -> void {
+    entry.stdOutLines.Clear();
+    entry.stdOutLines.Extend(entry.stdOutEntry);
+    entry.stdErrLines.Clear();
+    entry.stdErrLines.Extend(entry.stdErrEntry);
+}
+
+auto hasMatchingLog(const OutputBufferEntry& entry) -> bool {
+    return entry.chunkLog.Length(OutputStream::StdOut) == entry.stdOutEntry.size() and
+           entry.chunkLog.Length(OutputStream::StdErr) == entry.stdErrEntry.size();
+}
+
+} // namespace
+
+auto OutputChunkLog::Append(OutputStream stream, size_t length) -> void {
+    const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - this->start);
+    const auto elapsedMilliseconds = static_cast<uint32_t>(std::min<int64_t>(elapsed.count(), std::numeric_limits<uint32_t>::max()));
+    while (length > 0) {
+        if (this->chunks.empty() or this->chunks.back().stream != stream or this->chunks.back().elapsedMilliseconds != elapsedMilliseconds or
+            this->chunks.back().length == std::numeric_limits<uint32_t>::max()) {
+            this->chunks.push_back(OutputChunk{.elapsedMilliseconds = elapsedMilliseconds, .length = 0, .stream = stream});
+        }
+        auto& last = this->chunks.back();
+        const auto added = static_cast<uint32_t>(std::min<size_t>(length, std::numeric_limits<uint32_t>::max() - last.length));
+        last.length += added;
+        length -= added;
+    }
+}
+
+auto OutputChunkLog::Restore(std::vector<OutputChunk> loadedChunks) -> void {
+    this->chunks = std::move(loadedChunks);
+}
+
+auto OutputChunkLog::Clear() -> void {
+    this->chunks.clear();
+}
+
+auto OutputChunkLog::Length(OutputStream stream) const -> uint64_t {
+    uint64_t length = 0;
+    for (const auto& chunk : this->chunks) {
+        if (chunk.stream == stream) {
+            length += chunk.length;
+        }
+    }
+    return length;
+}
+
+auto LineIndex::Extend(std::string_view text) -> void {
+    if (text.size() < this->indexedLength) {
+        this->Clear();
+    }
+    // find is a memchr, which the C library scans with vector instructions
+    for (auto newline = text.find('\n', this->indexedLength); newline != std::string_view::npos; newline = text.find('\n', newline + 1)) {
+        this->lineStarts.push_back(newline + 1);
+    }
+    this->indexedLength = text.size();
+}
+
+auto LineIndex::Clear() -> void {
+    this->lineStarts.clear();
+    this->indexedLength = 0;
+}
+
+auto LineIndex::LineCount() const -> size_t {
+    const size_t lastLineStart = this->lineStarts.empty() ? 0 : this->lineStarts.back();
+    return this->lineStarts.size() + (this->indexedLength > lastLineStart ? 1 : 0);
+}
+
+auto LineIndex::LineStart(size_t line) const -> size_t {
+    return line == 0 ? 0 : this->lineStarts.at(line - 1);
+}
+
+auto LineIndex::LineLength(size_t line) const -> size_t {
+    const auto end = line < this->lineStarts.size() ? this->lineStarts[line] - 1 : this->indexedLength;
+    return end - this->LineStart(line);
+}
+
+auto LineIndex::LineAt(size_t offset) const -> size_t {
+    return static_cast<size_t>(std::ranges::upper_bound(this->lineStarts, offset) - this->lineStarts.begin());
+}
+
+OutputLines::OutputLines(std::string_view indexedText, const LineIndex& lineIndex)
+    : text{indexedText.substr(0, lineIndex.IndexedLength())}, index{&lineIndex} {
+}
+
+auto OutputLines::Line(size_t line) const -> std::string_view {
+    return this->text.substr(this->index->LineStart(line), this->index->LineLength(line));
+}
+
+auto outputLines(const OutputBufferEntry& entry, OutputStream stream) -> OutputLines {
+    return stream == OutputStream::StdOut ? OutputLines{entry.stdOutEntry, entry.stdOutLines} : OutputLines{entry.stdErrEntry, entry.stdErrLines};
+}
+
+auto interleaveOutput(const OutputBufferEntry& entry, std::chrono::milliseconds minimumGap) -> std::vector<OutputRun> {
+    std::vector<OutputRun> runs;
+    if (not hasMatchingLog(entry)) {
+        for (const auto stream : {OutputStream::StdOut, OutputStream::StdErr}) {
+            if (not streamText(entry, stream).empty()) {
+                runs.push_back(OutputRun{.stream = stream, .offset = 0, .length = streamText(entry, stream).size(), .gapBefore = {}});
+            }
+        }
+        return runs;
+    }
+
+    size_t stdOutOffset = 0;
+    size_t stdErrOffset = 0;
+    uint32_t previousElapsed = 0;
+    for (const auto& chunk : entry.chunkLog.Chunks()) {
+        auto& offset = chunk.stream == OutputStream::StdOut ? stdOutOffset : stdErrOffset;
+        const std::chrono::milliseconds gap{chunk.elapsedMilliseconds - std::min(previousElapsed, chunk.elapsedMilliseconds)};
+        previousElapsed = chunk.elapsedMilliseconds;
+        if (not runs.empty() and runs.back().stream == chunk.stream and gap <= minimumGap) {
+            runs.back().length += chunk.length;
+        } else {
+            runs.push_back(OutputRun{.stream = chunk.stream, .offset = offset, .length = chunk.length, .gapBefore = gap});
+        }
+        offset += chunk.length;
+    }
+    return runs;
+}
+
 auto OutputBuffers::AddNewEntry(OutputBufferEntry&& entry) -> void {
+    parseInitialOutput(entry, OutputStream::StdOut);
+    parseInitialOutput(entry, OutputStream::StdErr);
+    // what the entry starts with arrived all at once, unless its log came with it
+    if (not hasMatchingLog(entry)) {
+        entry.chunkLog.Clear();
+        entry.chunkLog.Append(OutputStream::StdOut, entry.stdOutEntry.size());
+        entry.chunkLog.Append(OutputStream::StdErr, entry.stdErrEntry.size());
+    }
+    indexLines(entry);
     // I should really check for size before adding a new entry here
-
-    this->bufferEntries.push_back(std::move(entry));
+    {
+        const std::scoped_lock lock{this->entriesMutex};
+        this->bufferEntries.push_back(std::move(entry));
+    }
     this->SafeOnChange();
 }
 
 auto OutputBuffers::AppendToLastStdOutEntry(std::string_view text) -> bool {
-    return AppendToLastEntry(text, [](OutputBufferEntry& entry) -> std::string& {
-        return entry.stdOutEntry;
-    });
+    return AppendToLastEntry(text, OutputStream::StdOut);
 }
 
 auto OutputBuffers::AppendToLastStdErrEntry(std::string_view text) -> bool {
-    return AppendToLastEntry(text, [](OutputBufferEntry& entry) -> std::string& {
-        return entry.stdErrEntry;
-    });
+    return AppendToLastEntry(text, OutputStream::StdErr);
+}
+
+auto OutputBuffers::ReplaceLastEntryOutput(std::string_view stdOutText, std::string_view stdErrText) -> bool {
+    {
+        const std::scoped_lock lock{this->entriesMutex};
+        if(this->bufferEntries.empty()) {
+            return false;
+        }
+
+        auto& lastEntry = *std::prev(this->bufferEntries.end());
+        parseOutput(lastEntry, OutputStream::StdOut, stdOutText);
+        parseOutput(lastEntry, OutputStream::StdErr, stdErrText);
+        lastEntry.stdOutElided.reset();
+        lastEntry.stdErrElided.reset();
+        lastEntry.chunkLog.Clear();
+        lastEntry.chunkLog.Append(OutputStream::StdOut, lastEntry.stdOutEntry.size());
+        lastEntry.chunkLog.Append(OutputStream::StdErr, lastEntry.stdErrEntry.size());
+        indexLines(lastEntry);
+        lastEntry.generation++;
+    }
+
+    this->SafeOnChange();
+
+    return true;
+}
+
+auto OutputBuffers::SetLastEntryStats(ExecutionStats stats) -> bool {
+    const std::scoped_lock lock{this->entriesMutex};
+    if(this->bufferEntries.empty()) {
+        return false;
+    }
+    this->bufferEntries.back().stats = std::move(stats);
+    return true;
+}
+
+auto OutputBuffers::MarkLastStdOutElided(ElidedOutput elided) -> bool {
+    return MarkLastEntryElided(std::move(elided), OutputStream::StdOut);
+}
+
+auto OutputBuffers::MarkLastStdErrElided(ElidedOutput elided) -> bool {
+    return MarkLastEntryElided(std::move(elided), OutputStream::StdErr);
 }
 
 auto OutputBuffers::GetBuffer() const -> const std::vector<OutputBufferEntry>& {
     return this->bufferEntries;
 }
 
+auto OutputBuffers::VisitEntries(const std::function<void(const std::vector<OutputBufferEntry>&)>& visitor) const -> void {
+    const std::scoped_lock lock{this->entriesMutex};
+    visitor(this->bufferEntries);
+}
+
 auto OutputBuffers::SetOnOutputChangedEvent(OnOutputChangedEvent outputChangedCb) -> void {
     this->onOutputChanged = std::move(outputChangedCb);
 }
@@ -41,14 +258,39 @@ auto OutputBuffers::SafeOnChange() -> void {
     }
 }
 
-auto OutputBuffers::AppendToLastEntry(std::string_view text, const OutputEntryFieldSelector& fieldSelectorFn) -> bool {
-    if(this->bufferEntries.empty()) {
-        return false;
+auto OutputBuffers::AppendToLastEntry(std::string_view text, OutputStream stream) -> bool {
+    {
+        const std::scoped_lock lock{this->entriesMutex};
+        if(this->bufferEntries.empty()) {
+            return false;
+        }
+
+        auto& lastEntry = *std::prev(this->bufferEntries.end());
+        auto& output = streamText(lastEntry, stream);
+        const auto previousSize = output.size();
+        streamParser(lastEntry, stream).Feed(text, output, streamStyles(lastEntry, stream));
+        lastEntry.chunkLog.Append(stream, output.size() - previousSize);
+        streamLines(lastEntry, stream).Extend(output);
     }
 
-    auto& lastEntry = *std::prev(this->bufferEntries.end());
-    std::string& selectedField = fieldSelectorFn(lastEntry);
-    selectedField.append(text);
+    this->SafeOnChange();
+
+    return true;
+}
+
+auto OutputBuffers::MarkLastEntryElided(ElidedOutput elided, OutputStream stream) -> bool {
+    {
+        const std::scoped_lock lock{this->entriesMutex};
+        if(this->bufferEntries.empty()) {
+            return false;
+        }
+
+        auto& lastEntry = this->bufferEntries.back();
+        elided.offset = streamText(lastEntry, stream).size();
+        (stream == OutputStream::StdOut ? lastEntry.stdOutElided : lastEntry.stdErrElided) = std::move(elided);
+        // the end of the output can't finish a sequence its start began
+        streamParser(lastEntry, stream).Interrupt();
+    }
 
     this->SafeOnChange();
 
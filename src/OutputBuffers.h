@@ -1,30 +1,164 @@
 #pragma once
 
+#include <chrono>
+#include <cstdint>
 #include <string>
 #include <vector>
 #include <functional>
+#include <mutex>
+#include <optional>
 #include <string_view>
 
+#include "AnsiText.h"
+#include "ExecutionStats.h"
+
 namespace replmk {
 class OutputBuffers;
 
 using OnOutputChangedEvent = std::function<void(const OutputBuffers&)>;
+
+// the middle of an output too large to keep, left out at offset of the text that was kept
+struct ElidedOutput {
+    size_t offset{0};
+    uint64_t bytes{0};
+    uint64_t lines{0};
+    // empty unless the whole output was written there as well
+    std::string fullOutputPath{};
+};
+
+enum class OutputStream: uint8_t {
+    StdOut,
+    StdErr
+};
+
+// a piece of output as it arrived. It starts in its stream where the chunks of that stream before it end
+struct OutputChunk {
+    // since the entry was created
+    uint32_t elapsedMilliseconds{0};
+    uint32_t length{0};
+    OutputStream stream{OutputStream::StdOut};
+};
+
+/**
+ * Append-only record of the order and time the stdout and stderr of an entry arrived in. The text itself stays in the
+ * entry, chunks only say how long they are. Chunks of one stream arriving within the same millisecond are merged
+ */
+class OutputChunkLog final {
+  private:
+    std::chrono::steady_clock::time_point start{std::chrono::steady_clock::now()};
+    std::vector<OutputChunk> chunks;
+
+  public:
+    auto Append(OutputStream stream, size_t length) -> void;
+    // chunks read back from the output history, as they were logged
+    auto Restore(std::vector<OutputChunk> loadedChunks) -> void;
+    auto Clear() -> void;
+
+    [[nodiscard]] auto Chunks() const -> const std::vector<OutputChunk>& {
+        return this->chunks;
+    }
+
+    // of all the chunks of the stream
+    [[nodiscard]] auto Length(OutputStream stream) const -> uint64_t;
+};
+
+// consecutive chunks of one stream, in the order the entry output arrived
+struct OutputRun {
+    OutputStream stream{OutputStream::StdOut};
+    size_t offset{0};
+    size_t length{0};
+    // since the chunk before it arrived
+    std::chrono::milliseconds gapBefore{0};
+};
+
+/**
+ * Where the lines of a text start, extended as the text grows so that only what was appended is scanned. A line ends
+ * at its newline, the last one can be unfinished
+ */
+class LineIndex final {
+  private:
+    // one past each newline
+    std::vector<size_t> lineStarts;
+    size_t indexedLength{0};
+
+  public:
+    // text is the whole text, of which the first IndexedLength() bytes are indexed already. A shorter one is indexed again
+    auto Extend(std::string_view text) -> void;
+    auto Clear() -> void;
+
+    [[nodiscard]] auto IndexedLength() const -> size_t {
+        return this->indexedLength;
+    }
+
+    [[nodiscard]] auto LineCount() const -> size_t;
+    // the offset and length of the line, without its newline
+    [[nodiscard]] auto LineStart(size_t line) const -> size_t;
+    [[nodiscard]] auto LineLength(size_t line) const -> size_t;
+    // the line the byte at offset is part of
+    [[nodiscard]] auto LineAt(size_t offset) const -> size_t;
+};
+
+// the lines of one output of an entry, valid as long as the entry doesn't change
+class OutputLines final {
+  private:
+    std::string_view text;
+    const LineIndex* index;
+
+  public:
+    OutputLines(std::string_view indexedText, const LineIndex& lineIndex);
+
+    [[nodiscard]] auto LineCount() const -> size_t {
+        return this->index->LineCount();
+    }
+
+    [[nodiscard]] auto Line(size_t line) const -> std::string_view;
+};
+
 struct OutputBufferEntry {
     std::string prompt;
     std::string stdOutEntry;
     std::string stdErrEntry;
+    // what running the command cost, none for entries not written by a command
+    std::optional<ExecutionStats> stats{};
+    std::optional<ElidedOutput> stdOutElided{};
+    std::optional<ElidedOutput> stdErrElided{};
+    // covers both outputs once the entry was added to the buffers
+    OutputChunkLog chunkLog{};
+    // kept up to date with the outputs by the buffers
+    LineIndex stdOutLines{};
+    LineIndex stdErrLines{};
+    // the styles escape sequences gave the outputs, which keep only their text
+    std::vector<StyleSpan> stdOutStyles{};
+    std::vector<StyleSpan> stdErrStyles{};
+    // where the escape sequences of each output were left, for the next chunk to go on from
+    AnsiTextParser stdOutParser{};
+    AnsiTextParser stdErrParser{};
+    // counts the times the outputs were replaced rather than appended to, text of the same size can be new
+    uint64_t generation{0};
 };
 
-using OutputEntryFieldSelector = std::function<std::string&(OutputBufferEntry&)>;
+[[nodiscard]] auto outputLines(const OutputBufferEntry& entry, OutputStream stream) -> OutputLines;
 
+/**
+ * The output of the entry as it arrived, stdout and stderr interleaved. A run is split where more than minimumGap
+ * passed between two chunks, so the pause can be shown. Without a log matching the outputs, stdout comes before stderr
+ */
+[[nodiscard]] auto interleaveOutput(const OutputBufferEntry& entry, std::chrono::milliseconds minimumGap) -> std::vector<OutputRun>;
+
+/**
+ * Entries can be added and appended to from any one thread while others read them through VisitEntries.
+ * The change event runs on the writing thread, outside the lock
+ */
 class OutputBuffers final {
   private:
     OnOutputChangedEvent onOutputChanged;
 
+    mutable std::mutex entriesMutex;
     std::vector<OutputBufferEntry> bufferEntries;
 
     auto SafeOnChange() -> void;
-    auto AppendToLastEntry(std::string_view text, const OutputEntryFieldSelector& fieldSelectorFn) -> bool;
+    auto AppendToLastEntry(std::string_view text, OutputStream stream) -> bool;
+    auto MarkLastEntryElided(ElidedOutput elided, OutputStream stream) -> bool;
   public:
     OutputBuffers() = default;
     OutputBuffers(const OutputBuffers&)=delete;
@@ -37,8 +171,19 @@ class OutputBuffers final {
     auto AddNewEntry(OutputBufferEntry&& entry) -> void;
     auto AppendToLastStdOutEntry(std::string_view text) -> bool;
     auto AppendToLastStdErrEntry(std::string_view text) -> bool;
+    // the output of the last entry changes in place, for commands showing the same output again, refreshed
+    auto ReplaceLastEntryOutput(std::string_view stdOutText, std::string_view stdErrText) -> bool;
+    // not shown, so nothing has to be drawn again
+    auto SetLastEntryStats(ExecutionStats stats) -> bool;
+    // what was left out goes where the output kept so far ends, the offset of elided is ignored
+    auto MarkLastStdOutElided(ElidedOutput elided) -> bool;
+    auto MarkLastStdErrElided(ElidedOutput elided) -> bool;
 
+    // unlocked, only for the thread writing to these buffers
     auto GetBuffer() const -> const std::vector<OutputBufferEntry>&;
+
+    // the entries can't change while the visitor runs
+    auto VisitEntries(const std::function<void(const std::vector<OutputBufferEntry>&)>& visitor) const -> void;
     ~OutputBuffers() = default;
 };
 
@@ -0,0 +1,217 @@
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstring>
+#include <format>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include "OutputFilters.h"
+
+namespace replmk {
+
+namespace {
+
+constexpr size_t DefaultFilterLineCount = 10;
+
+auto foldCase(std::string_view text, std::string& folded) -> void {
+    folded.resize(text.size());
+    std::ranges::transform(text, folded.begin(), [](char character) {
+        return static_cast<char>(std::tolower(static_cast<unsigned char>(character)));
+    });
+}
+
+auto parseLineCount(const OutputFilterSpec& spec) -> std::expected<size_t, std::string> {
+    if (spec.args.empty()) {
+        return DefaultFilterLineCount;
+    }
+
+    size_t count = 0;
+    const auto& countArg = spec.args.front();
+    const auto* const argEnd = countArg.data() + countArg.size(); //NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    const auto [ptr, errorCode] = std::from_chars(countArg.data(), argEnd, count);
+    if (spec.args.size() != 1 or errorCode != std::errc{} or ptr != argEnd) {
+        return std::unexpected{std::format("@{}: expected a single, non negative, number of lines", spec.name)};
+    }
+    return count;
+}
+
+auto makeGrepFilter(const OutputFilterSpec& spec) -> std::expected<OutputFilter, std::string> {
+    bool invert = false;
+    bool ignoreCase = false;
+    std::vector<std::string> patterns;
+    for (const auto& arg : spec.args) {
+        if (arg == "-v") {
+            invert = true;
+        } else if (arg == "-i") {
+            ignoreCase = true;
+        } else {
+            patterns.push_back(arg);
+        }
+    }
+
+    if (patterns.size() != 1 or patterns.front().empty()) {
+        return std::unexpected{std::string{"@grep: expected a single, non empty, text to look for"}};
+    }
+    std::string pattern = patterns.front();
+    if (ignoreCase) {
+        // folded once here, lines are folded as they are matched
+        foldCase(patterns.front(), pattern);
+    }
+    return GrepFilter{std::move(pattern), invert, ignoreCase};
+}
+
+template<typename Filter>
+auto makeOptionlessFilter(const OutputFilterSpec& spec) -> std::expected<OutputFilter, std::string> {
+    if (not spec.args.empty()) {
+        return std::unexpected{std::format("@{}: takes no arguments", spec.name)};
+    }
+    return Filter{};
+}
+
+} // namespace
+
+GrepFilter::GrepFilter(std::string text, bool invertMatch, bool foldCaseOnMatch)
+    : pattern{std::make_shared<const std::string>(std::move(text))},
+      searcher{this->pattern->begin(), this->pattern->end()},
+      invert{invertMatch},
+      ignoreCase{foldCaseOnMatch} {
+}
+
+auto GrepFilter::Matches(std::string_view line) -> bool {
+    if (line.size() < this->pattern->size()) {
+        return false;
+    }
+    if (this->ignoreCase) {
+        foldCase(line, this->foldedLine);
+        line = this->foldedLine;
+    }
+    return std::search(line.begin(), line.end(), this->searcher) != line.end();
+}
+
+auto makeOutputFilter(const OutputFilterSpec& spec) -> std::expected<OutputFilter, std::string> {
+    if (spec.name == "grep") {
+        return makeGrepFilter(spec);
+    }
+    if (spec.name == "head" or spec.name == "tail") {
+        const auto lineCount = parseLineCount(spec);
+        if (not lineCount.has_value()) {
+            return std::unexpected{lineCount.error()};
+        }
+        if (spec.name == "head") {
+            return HeadFilter{lineCount.value()};
+        }
+        return TailFilter{lineCount.value()};
+    }
+    if (spec.name == "uniq") {
+        return makeOptionlessFilter<UniqFilter>(spec);
+    }
+    if (spec.name == "count") {
+        return makeOptionlessFilter<CountFilter>(spec);
+    }
+    return std::unexpected{std::format("Unknown output filter '@{}', expected one of @grep, @head, @tail, @uniq or @count", spec.name)};
+}
+
+OutputFilterChain::OutputFilterChain(std::vector<OutputFilter> lineFilters, const CommandOutputCallbacks& callbacks)
+    : filters{std::move(lineFilters)}, downstream{callbacks} {
+}
+
+auto OutputFilterChain::EmitFrom(size_t filterIndex, std::string_view line) -> void {
+    if (filterIndex == this->filters.size()) {
+        this->filteredOutput.append(line);
+        this->filteredOutput.push_back('\n');
+        return;
+    }
+
+    std::visit([this, filterIndex, line](auto& filter) {
+        filter.OnLine(line, [this, filterIndex](std::string_view keptLine) {
+            this->EmitFrom(filterIndex + 1, keptLine);
+        });
+    }, this->filters.at(filterIndex));
+}
+
+auto OutputFilterChain::Flush() -> void {
+    if (not this->filteredOutput.empty()) {
+        this->downstream.onStdOut(this->filteredOutput);
+        this->filteredOutput.clear();
+    }
+}
+
+auto OutputFilterChain::IsSaturated() const -> bool {
+    // lines only reach an exhausted filter through filters that pass them on right away
+    for (const auto& filter : this->filters) {
+        const auto [exhausted, streaming] = std::visit([](const auto& current) {
+            return std::pair{current.IsExhausted(), current.IsStreaming()};
+        }, filter);
+        if (exhausted) {
+            return true;
+        }
+        if (not streaming) {
+            return false;
+        }
+    }
+    return false;
+}
+
+auto OutputFilterChain::Feed(std::string_view chunk) -> void {
+    if (this->IsSaturated()) {
+        return;
+    }
+
+    // memchr is the vectorized newline scan of the C library, no need for a hand written one
+    size_t lineStart = 0;
+    while (lineStart < chunk.size()) {
+        const void* newline = std::memchr(chunk.data() + lineStart, '\n', chunk.size() - lineStart); //NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+        if (newline == nullptr) {
+            break;
+        }
+        const auto lineEnd = static_cast<size_t>(static_cast<const char*>(newline) - chunk.data());
+        const auto line = chunk.substr(lineStart, lineEnd - lineStart);
+
+        if (this->partialLine.empty()) {
+            this->EmitFrom(0, line);
+        } else {
+            this->partialLine.append(line);
+            this->EmitFrom(0, this->partialLine);
+            this->partialLine.clear();
+        }
+        lineStart = lineEnd + 1;
+    }
+
+    this->partialLine.append(chunk.substr(lineStart));
+    this->Flush();
+}
+
+auto OutputFilterChain::Finish() -> void {
+    if (not this->partialLine.empty() and not this->IsSaturated()) {
+        this->EmitFrom(0, this->partialLine);
+    }
+    this->partialLine.clear();
+
+    // each filter emits what it kept into the next ones before those finish
+    for (size_t index = 0; index < this->filters.size(); index++) {
+        std::visit([this, index](auto& filter) {
+            filter.OnEnd([this, index](std::string_view keptLine) {
+                this->EmitFrom(index + 1, keptLine);
+            });
+        }, this->filters.at(index));
+    }
+    this->Flush();
+}
+
+auto OutputFilterChain::Callbacks() -> CommandOutputCallbacks {
+    return CommandOutputCallbacks{
+        .onStdOut = [this](std::string_view chunk) {
+            this->Feed(chunk);
+        },
+        .onStdErr = this->downstream.onStdErr,
+        // stdout has to reach the chain, only stderr can still skip the REPL
+        .stdOutFd = -1,
+        .stdErrFd = this->downstream.stdErrFd
+    };
+}
+
+} // namespace replmk
@@ -0,0 +1,204 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <expected>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+#include "ProcessExecutor.h"
+
+namespace replmk {
+
+// pipeline words starting with it name an output filter instead of a catalog command
+constexpr char OutputFilterPrefix = '@';
+
+constexpr std::array<std::string_view, 5> OutputFilterNames = {"grep", "head", "tail", "uniq", "count"};
+
+[[nodiscard]] inline auto isOutputFilterName(std::string_view word) -> bool {
+    return word.size() > 1 and word.front() == OutputFilterPrefix;
+}
+
+struct OutputFilterSpec {
+    // without the '@' prefix
+    std::string name{};
+    std::vector<std::string> args{};
+};
+
+// '@grep [-v] [-i] text', keeps the lines containing the text, or not containing it with -v
+class GrepFilter final {
+public:
+    // with foldCaseOnMatch the text is expected in lower case already
+    GrepFilter(std::string text, bool invertMatch, bool foldCaseOnMatch);
+
+    template<typename Emit>
+    auto OnLine(std::string_view line, Emit&& emit) -> void {
+        if (this->Matches(line) != this->invert) {
+            std::forward<Emit>(emit)(line);
+        }
+    }
+
+    template<typename Emit>
+    auto OnEnd([[maybe_unused]] Emit&& emit) -> void {}
+
+    [[nodiscard]] auto IsExhausted() const -> bool { return false; }
+    [[nodiscard]] auto IsStreaming() const -> bool { return true; }
+
+private:
+    [[nodiscard]] auto Matches(std::string_view line) -> bool;
+
+    // on the heap, so the searcher iterators stay valid when the filter is moved
+    std::shared_ptr<const std::string> pattern;
+    std::boyer_moore_horspool_searcher<std::string::const_iterator> searcher;
+    bool invert;
+    bool ignoreCase;
+    std::string foldedLine;
+};
+
+// '@head [N]', keeps the first N lines
+class HeadFilter final {
+public:
+    explicit HeadFilter(size_t maxLines) : remaining{maxLines} {}
+
+    template<typename Emit>
+    auto OnLine(std::string_view line, Emit&& emit) -> void {
+        if (this->remaining > 0) {
+            this->remaining--;
+            std::forward<Emit>(emit)(line);
+        }
+    }
+
+    template<typename Emit>
+    auto OnEnd([[maybe_unused]] Emit&& emit) -> void {}
+
+    [[nodiscard]] auto IsExhausted() const -> bool { return this->remaining == 0; }
+    [[nodiscard]] auto IsStreaming() const -> bool { return true; }
+
+private:
+    size_t remaining;
+};
+
+// '@tail [N]', keeps the last N lines, emitted once the command ends
+class TailFilter final {
+public:
+    explicit TailFilter(size_t maxLines) : lines(maxLines) {}
+
+    template<typename Emit>
+    auto OnLine(std::string_view line, [[maybe_unused]] Emit&& emit) -> void {
+        if (this->lines.empty()) {
+            return;
+        }
+        // the ring slots are reused, so only lines longer than any seen before allocate
+        this->lines.at(this->next).assign(line);
+        this->next = (this->next + 1) % this->lines.size();
+        this->stored = std::min(this->stored + 1, this->lines.size());
+    }
+
+    template<typename Emit>
+    auto OnEnd(Emit&& emit) -> void {
+        const auto first = (this->next + this->lines.size() - this->stored) % std::max<size_t>(this->lines.size(), 1);
+        for (size_t index = 0; index < this->stored; index++) {
+            emit(this->lines.at((first + index) % this->lines.size()));
+        }
+    }
+
+    [[nodiscard]] auto IsExhausted() const -> bool { return false; }
+    [[nodiscard]] auto IsStreaming() const -> bool { return false; }
+
+private:
+    std::vector<std::string> lines;
+    size_t next{0};
+    size_t stored{0};
+};
+
+// '@uniq', drops lines equal to the one right before them
+class UniqFilter final {
+public:
+    template<typename Emit>
+    auto OnLine(std::string_view line, Emit&& emit) -> void {
+        if (this->hasPrevious and line == this->previous) {
+            return;
+        }
+        this->previous.assign(line);
+        this->hasPrevious = true;
+        std::forward<Emit>(emit)(line);
+    }
+
+    template<typename Emit>
+    auto OnEnd([[maybe_unused]] Emit&& emit) -> void {}
+
+    [[nodiscard]] auto IsExhausted() const -> bool { return false; }
+    [[nodiscard]] auto IsStreaming() const -> bool { return true; }
+
+private:
+    std::string previous;
+    bool hasPrevious{false};
+};
+
+// '@count', replaces the output with its number of lines
+class CountFilter final {
+public:
+    template<typename Emit>
+    auto OnLine([[maybe_unused]] std::string_view line, [[maybe_unused]] Emit&& emit) -> void {
+        this->count++;
+    }
+
+    template<typename Emit>
+    auto OnEnd(Emit&& emit) -> void {
+        std::forward<Emit>(emit)(std::to_string(this->count));
+    }
+
+    [[nodiscard]] auto IsExhausted() const -> bool { return false; }
+    [[nodiscard]] auto IsStreaming() const -> bool { return false; }
+
+private:
+    size_t count{0};
+};
+
+using OutputFilter = std::variant<GrepFilter, HeadFilter, TailFilter, UniqFilter, CountFilter>;
+
+[[nodiscard]]
+auto makeOutputFilter(const OutputFilterSpec& spec) -> std::expected<OutputFilter, std::string>;
+
+/**
+ * Runs the stdout chunks of a command through a list of line filters before they are stored.
+ * Lines are split as chunks arrive, carrying partial lines over to the next chunk,
+ * and the lines kept from each chunk are passed downstream in a single call
+ */
+class OutputFilterChain final {
+public:
+    OutputFilterChain(std::vector<OutputFilter> lineFilters, const CommandOutputCallbacks& callbacks);
+
+    OutputFilterChain(const OutputFilterChain&) = delete;
+    OutputFilterChain(OutputFilterChain&&) = delete;
+    auto operator=(const OutputFilterChain&) -> OutputFilterChain& = delete;
+    auto operator=(OutputFilterChain&&) -> OutputFilterChain& = delete;
+    ~OutputFilterChain() = default;
+
+    auto Feed(std::string_view chunk) -> void;
+
+    // passes on the last line, even without a newline, and whatever filters kept until the end
+    auto Finish() -> void;
+
+    // callbacks for the command, stdout goes through the chain and stderr straight downstream
+    [[nodiscard]] auto Callbacks() -> CommandOutputCallbacks;
+
+private:
+    auto EmitFrom(size_t filterIndex, std::string_view line) -> void;
+    auto Flush() -> void;
+
+    // true once no line fed from now on can reach the output, for instance after '@head' got all its lines
+    [[nodiscard]] auto IsSaturated() const -> bool;
+
+    std::vector<OutputFilter> filters;
+    CommandOutputCallbacks downstream;
+    std::string partialLine;
+    std::string filteredOutput;
+};
+
+} // namespace replmk
@@ -1,5 +1,7 @@
 #include <filesystem>
+#include <format>
 #include <fstream>
+#include <sstream>
 #include <string_view>
 
 #include "OutputHistory.h"
@@ -19,11 +21,125 @@ auto ReadField(std::ifstream& inFile, const std::string_view expectedPrefix) ->
     return ReadHistoryFieldWithLengthAndLineBreak(inFile).value_or("");
 }
 
+// whether the next field has the prefix, without reading it. Optional fields can share their first letter
+auto NextFieldIs(std::ifstream& inFile, const std::string_view prefix) -> bool {
+    const auto position = inFile.tellg();
+    std::string next(prefix.size(), '\0');
+    const bool matches = static_cast<bool>(inFile.read(next.data(), static_cast<std::streamsize>(next.size()))) and next == prefix and inFile.peek() == ':';
+    inFile.clear();
+    inFile.seekg(position);
+    return matches;
+}
+
 // Helper function to write a field with prefix:length:content format
 auto WriteField(std::ofstream& outFile, const std::string_view prefix, const std::string& content) -> void {
     outFile << prefix << ':' << content.size() << ':' << content << '\n';
 }
 
+constexpr std::string_view ElidedStdOutName = "stdout";
+constexpr std::string_view ElidedStdErrName = "stderr";
+
+// the stream, offset, bytes and lines, then the path of the full output, which can contain spaces
+auto SerializeElided(std::string_view streamName, const ElidedOutput& elided) -> std::string {
+    return std::format("{} {} {} {} {}", streamName, elided.offset, elided.bytes, elided.lines, elided.fullOutputPath);
+}
+
+// false when the field is not one SerializeElided wrote
+auto ParseElided(const std::string& text, OutputBufferEntry& entry) -> bool {
+    std::istringstream fields{text};
+    std::string streamName;
+    ElidedOutput elided;
+    if (not (fields >> streamName >> elided.offset >> elided.bytes >> elided.lines)) {
+        return false;
+    }
+    // the single space before the path, which is empty without a full output
+    fields.ignore(1);
+    std::getline(fields, elided.fullOutputPath);
+
+    if (streamName == ElidedStdOutName and elided.offset <= entry.stdOutEntry.size()) {
+        entry.stdOutElided = std::move(elided);
+        return true;
+    }
+    if (streamName == ElidedStdErrName and elided.offset <= entry.stdErrEntry.size()) {
+        entry.stdErrElided = std::move(elided);
+        return true;
+    }
+    return false;
+}
+
+constexpr char ChunkStdOutTag = 'o';
+constexpr char ChunkStdErrTag = 'e';
+
+// one word per chunk, its stream tag, milliseconds, '+' and length, like o120+4096
+auto SerializeChunks(const OutputChunkLog& chunkLog) -> std::string {
+    std::string serialized;
+    for (const auto& chunk : chunkLog.Chunks()) {
+        serialized.append(serialized.empty() ? "" : " ");
+        serialized.append(std::format("{}{}+{}", chunk.stream == OutputStream::StdOut ? ChunkStdOutTag : ChunkStdErrTag,
+                                      chunk.elapsedMilliseconds, chunk.length));
+    }
+    return serialized;
+}
+
+auto ParseChunks(const std::string& text) -> std::optional<std::vector<OutputChunk>> {
+    std::vector<OutputChunk> chunks;
+    std::istringstream words{text};
+    char tag = '\0';
+    char separator = '\0';
+    OutputChunk chunk;
+    while (words >> tag >> chunk.elapsedMilliseconds >> separator >> chunk.length) {
+        if ((tag != ChunkStdOutTag and tag != ChunkStdErrTag) or separator != '+') {
+            return std::nullopt;
+        }
+        chunk.stream = tag == ChunkStdOutTag ? OutputStream::StdOut : OutputStream::StdErr;
+        chunks.push_back(chunk);
+    }
+    if (not words.eof()) {
+        return std::nullopt;
+    }
+    return chunks;
+}
+
+// one word per span, the stream tag, offset, ':' and the SGR parameters of its style, like o12:0;1;31
+auto SerializeStyles(const OutputBufferEntry& entry) -> std::string {
+    std::string serialized;
+    const auto append = [&serialized](char tag, const std::vector<StyleSpan>& spans) {
+        for (const auto& span : spans) {
+            serialized.append(serialized.empty() ? "" : " ");
+            serialized.append(std::format("{}{}:{}", tag, span.offset, formatSgr(span.style)));
+        }
+    };
+    append(ChunkStdOutTag, entry.stdOutStyles);
+    append(ChunkStdErrTag, entry.stdErrStyles);
+    return serialized;
+}
+
+// false when the field is not one SerializeStyles wrote for the outputs of the entry
+auto ParseStyles(const std::string& text, OutputBufferEntry& entry) -> bool {
+    std::istringstream words{text};
+    std::string word;
+    while (words >> word) {
+        std::istringstream fields{word};
+        char tag = '\0';
+        size_t offset = 0;
+        char separator = '\0';
+        if (not (fields >> tag >> offset >> separator) or separator != ':' or (tag != ChunkStdOutTag and tag != ChunkStdErrTag)) {
+            return false;
+        }
+        auto& spans = tag == ChunkStdOutTag ? entry.stdOutStyles : entry.stdErrStyles;
+        const auto& output = tag == ChunkStdOutTag ? entry.stdOutEntry : entry.stdErrEntry;
+        if (offset > output.size() or (not spans.empty() and offset < spans.back().offset)) {
+            return false;
+        }
+        StyleSpan span{.offset = offset, .style = {}};
+        std::string parameters;
+        std::getline(fields, parameters);
+        applySgr(parameters, span.style);
+        spans.push_back(span);
+    }
+    return true;
+}
+
 // Helper function to read a complete entry (PROMPT, STDOUT, STDERR) from file
 auto ReadCompleteEntry(std::ifstream& inFile) -> std::optional<replmk::OutputBufferEntry> {
     replmk::OutputBufferEntry entry;
@@ -49,6 +165,41 @@ auto ReadCompleteEntry(std::ifstream& inFile) -> std::optional<replmk::OutputBuf
     }
     entry.stdErrEntry = stderr.value();
 
+    // Read STATS. Only entries written by a command have it, the next entry starts with PROMPT otherwise
+    if (NextFieldIs(inFile, OutputHistoryStatsPrefix)) {
+        const auto stats = ReadField(inFile, OutputHistoryStatsPrefix);
+        if (not stats.has_value()) {
+            return std::nullopt;
+        }
+        entry.stats = parseExecutionStats(stats.value());
+    }
+
+    // Read ELIDED, for the streams that had their middle left out
+    while (NextFieldIs(inFile, OutputHistoryElidedPrefix)) {
+        const auto elided = ReadField(inFile, OutputHistoryElidedPrefix);
+        if (not elided.has_value() or not ParseElided(elided.value(), entry)) {
+            return std::nullopt;
+        }
+    }
+
+    // Read CHUNKS. Without it, or when it doesn't match the outputs, they show one after the other
+    if (NextFieldIs(inFile, OutputHistoryChunksPrefix)) {
+        const auto chunks = ReadField(inFile, OutputHistoryChunksPrefix);
+        const auto parsedChunks = chunks.has_value() ? ParseChunks(chunks.value()) : std::nullopt;
+        if (not parsedChunks.has_value()) {
+            return std::nullopt;
+        }
+        entry.chunkLog.Restore(parsedChunks.value());
+    }
+
+    // Read STYLES. Without it the outputs show in the default style
+    if (NextFieldIs(inFile, OutputHistoryStylesPrefix)) {
+        const auto styles = ReadField(inFile, OutputHistoryStylesPrefix);
+        if (not styles.has_value() or not ParseStyles(styles.value(), entry)) {
+            return std::nullopt;
+        }
+    }
+
     return entry;
 }
 
@@ -57,6 +208,21 @@ auto WriteCompleteEntry(std::ofstream& outFile, const OutputBufferEntry& entry)
     WriteField(outFile, OutputHistoryPromptPrefix, entry.prompt);
     WriteField(outFile, OutputHistoryStdOutPrefix, entry.stdOutEntry);
     WriteField(outFile, OutputHistoryStdErrPrefix, entry.stdErrEntry);
+    if (entry.stats.has_value()) {
+        WriteField(outFile, OutputHistoryStatsPrefix, serializeExecutionStats(entry.stats.value()));
+    }
+    if (entry.stdOutElided.has_value()) {
+        WriteField(outFile, OutputHistoryElidedPrefix, SerializeElided(ElidedStdOutName, entry.stdOutElided.value()));
+    }
+    if (entry.stdErrElided.has_value()) {
+        WriteField(outFile, OutputHistoryElidedPrefix, SerializeElided(ElidedStdErrName, entry.stdErrElided.value()));
+    }
+    if (not entry.chunkLog.Chunks().empty()) {
+        WriteField(outFile, OutputHistoryChunksPrefix, SerializeChunks(entry.chunkLog));
+    }
+    if (not entry.stdOutStyles.empty() or not entry.stdErrStyles.empty()) {
+        WriteField(outFile, OutputHistoryStylesPrefix, SerializeStyles(entry));
+    }
     outFile.flush();
 }
 
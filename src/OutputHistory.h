@@ -10,6 +10,14 @@ namespace replmk {
 constexpr std::string_view OutputHistoryPromptPrefix = "PROMPT";
 constexpr std::string_view OutputHistoryStdOutPrefix = "STDOUT";
 constexpr std::string_view OutputHistoryStdErrPrefix = "STDERR";
+// optional, after STDERR. Older histories don't have it
+constexpr std::string_view OutputHistoryStatsPrefix = "STATS";
+// optional, after STATS, once for each stream of the entry that had its middle left out
+constexpr std::string_view OutputHistoryElidedPrefix = "ELIDED";
+// optional, after ELIDED. The order and time stdout and stderr arrived in
+constexpr std::string_view OutputHistoryChunksPrefix = "CHUNKS";
+// optional, last. The colors and styles of the outputs, which are kept without their escape sequences
+constexpr std::string_view OutputHistoryStylesPrefix = "STYLES";
 
 
 using OutputBufferEntry = replmk::OutputBufferEntry;
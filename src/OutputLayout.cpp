@@ -0,0 +1,325 @@
+#include <algorithm>
+#include <limits>
+#include <optional>
+
+#include "OutputLayout.h"
+
+namespace replmk {
+
+namespace {
+
+// the text of one stream of an entry, and how its rows are shown
+struct StreamRows {
+    std::string_view text;
+    const LineIndex& index;
+    const std::optional<ElidedOutput>& elided;
+    OutputRowKind textKind;
+    OutputRowKind elidedKind;
+};
+
+auto isCharacterStart(char byte) -> bool {
+    constexpr unsigned ContinuationMask = 0xC0U;
+    constexpr unsigned ContinuationBits = 0x80U;
+    return (static_cast<unsigned char>(byte) & ContinuationMask) != ContinuationBits;
+}
+
+auto makeRow(size_t offset, size_t length, OutputRowKind kind) -> OutputRow {
+    return OutputRow{.offset = offset, .length = static_cast<uint32_t>(std::min<size_t>(length, std::numeric_limits<uint32_t>::max())), .kind = kind};
+}
+
+// an empty line still takes a row
+auto appendWrappedLine(std::vector<OutputRow>& rows, std::string_view text, size_t start, size_t end, size_t width, OutputRowKind kind) -> void {
+    auto rowStart = start;
+    size_t characters = 0;
+    for (auto position = start; position < end; position++) {
+        if (not isCharacterStart(text[position])) {
+            continue;
+        }
+        if (characters == width) {
+            rows.push_back(makeRow(rowStart, position - rowStart, kind));
+            rowStart = position;
+            characters = 0;
+        }
+        characters++;
+    }
+    rows.push_back(makeRow(rowStart, end - rowStart, kind));
+}
+
+// the rows of the text from start to end, which can start or end inside a line
+auto appendWrappedText(std::vector<OutputRow>& rows, std::string_view text, const LineIndex& index, size_t start, size_t end, size_t width,
+                       OutputRowKind kind) -> void {
+    for (size_t line = index.LineAt(start), position = start; position < end; line++) {
+        const auto lineEnd = std::min(index.LineStart(line) + index.LineLength(line), end);
+        appendWrappedLine(rows, text, position, lineEnd, width, kind);
+        // past the newline
+        position = lineEnd + 1;
+    }
+}
+
+// entries outside of the buffers can have outputs their index doesn't cover
+auto upToDateIndex(std::string_view text, const LineIndex& index, LineIndex& rebuilt) -> const LineIndex& {
+    if (index.IndexedLength() == text.size()) {
+        return index;
+    }
+    rebuilt.Clear();
+    rebuilt.Extend(text);
+    return rebuilt;
+}
+
+// true when the marker of the stream was shown at its very end
+auto appendRun(std::vector<OutputRow>& rows, const OutputRun& run, const StreamRows& stream, size_t width) -> bool {
+    if (run.gapBefore > ShownOutputPause) {
+        rows.push_back(makeRow(0, static_cast<size_t>(run.gapBefore.count()), OutputRowKind::Pause));
+    }
+    const bool isStdErr = stream.textKind == OutputRowKind::StdErr;
+    if (isStdErr) {
+        rows.push_back(makeRow(0, 0, OutputRowKind::StdErrBorder));
+    }
+
+    const auto runEnd = run.offset + run.length;
+    std::optional<size_t> markerOffset;
+    if (stream.elided.has_value()) {
+        const auto offset = std::min(stream.elided->offset, stream.text.size());
+        if ((offset >= run.offset and offset < runEnd) or (offset == runEnd and runEnd == stream.text.size())) {
+            markerOffset = offset;
+        }
+    }
+    if (markerOffset.has_value()) {
+        if (markerOffset.value() > run.offset) {
+            appendWrappedText(rows, stream.text, stream.index, run.offset, markerOffset.value(), width, stream.textKind);
+        }
+        rows.push_back(makeRow(0, 0, stream.elidedKind));
+        appendWrappedText(rows, stream.text, stream.index, markerOffset.value(), runEnd, width, stream.textKind);
+    } else {
+        appendWrappedText(rows, stream.text, stream.index, run.offset, runEnd, width, stream.textKind);
+    }
+
+    if (isStdErr) {
+        rows.push_back(makeRow(0, 0, OutputRowKind::StdErrBorder));
+    }
+    return markerOffset.has_value() and markerOffset.value() == stream.text.size();
+}
+
+auto hasChunkLog(const OutputBufferEntry& entry) -> bool {
+    return entry.chunkLog.Length(OutputStream::StdOut) == entry.stdOutEntry.size() and
+           entry.chunkLog.Length(OutputStream::StdErr) == entry.stdErrEntry.size();
+}
+
+// lays out the runs from firstRun on, returning whether a marker was shown at the end of its stream
+auto appendRuns(std::vector<OutputRow>& rows, const OutputBufferEntry& entry, const std::vector<OutputRun>& runs, size_t firstRun, size_t width,
+                size_t& lastRunFirstRow) -> bool {
+    LineIndex rebuiltStdOut;
+    LineIndex rebuiltStdErr;
+    const StreamRows stdOut{.text = entry.stdOutEntry, .index = upToDateIndex(entry.stdOutEntry, entry.stdOutLines, rebuiltStdOut),
+                            .elided = entry.stdOutElided, .textKind = OutputRowKind::StdOut, .elidedKind = OutputRowKind::StdOutElided};
+    const StreamRows stdErr{.text = entry.stdErrEntry, .index = upToDateIndex(entry.stdErrEntry, entry.stdErrLines, rebuiltStdErr),
+                            .elided = entry.stdErrElided, .textKind = OutputRowKind::StdErr, .elidedKind = OutputRowKind::StdErrElided};
+
+    bool markerAtEnd = false;
+    lastRunFirstRow = rows.size();
+    for (auto run = runs.begin() + static_cast<std::ptrdiff_t>(firstRun); run != runs.end(); ++run) {
+        lastRunFirstRow = rows.size();
+        markerAtEnd = appendRun(rows, *run, run->stream == OutputStream::StdOut ? stdOut : stdErr, width) or markerAtEnd;
+    }
+    // with nothing kept of a stream, there is no run to show its marker in
+    for (const auto* stream : {&stdOut, &stdErr}) {
+        if (stream->elided.has_value() and stream->text.empty()) {
+            rows.push_back(makeRow(0, 0, stream->elidedKind));
+            markerAtEnd = true;
+        }
+    }
+    return markerAtEnd;
+}
+
+auto appendEntry(std::vector<OutputRow>& rows, const OutputBufferEntry& entry, const std::vector<OutputRun>& runs, size_t width,
+                 size_t& lastRunFirstRow) -> bool {
+    LineIndex promptLines;
+    promptLines.Extend(entry.prompt);
+    appendWrappedText(rows, entry.prompt, promptLines, 0, entry.prompt.size(), width, OutputRowKind::Prompt);
+    return appendRuns(rows, entry, runs, 0, width, lastRunFirstRow);
+}
+
+} // namespace
+
+auto layoutEntry(const OutputBufferEntry& entry, size_t width) -> std::vector<OutputRow> {
+    std::vector<OutputRow> rows;
+    size_t lastRunFirstRow = 0;
+    appendEntry(rows, entry, interleaveOutput(entry, ShownOutputPause), std::max<size_t>(width, 1), lastRunFirstRow);
+    return rows;
+}
+
+auto rowText(const OutputBufferEntry& entry, const OutputRow& row) -> std::string_view {
+    switch (row.kind) {
+        case OutputRowKind::Prompt:
+            return std::string_view{entry.prompt}.substr(row.offset, row.length);
+        case OutputRowKind::StdOut:
+            return std::string_view{entry.stdOutEntry}.substr(row.offset, row.length);
+        case OutputRowKind::StdErr:
+            return std::string_view{entry.stdErrEntry}.substr(row.offset, row.length);
+        case OutputRowKind::StdErrBorder:
+        case OutputRowKind::Pause:
+        case OutputRowKind::StdOutElided:
+        case OutputRowKind::StdErrElided:
+            return {};
+    }
+    return {};
+}
+
+auto OutputLayout::Shape(const OutputBufferEntry& entry) -> EntryShape {
+    return EntryShape{
+        .promptSize = entry.prompt.size(),
+        .stdOutSize = entry.stdOutEntry.size(),
+        .stdErrSize = entry.stdErrEntry.size(),
+        .chunkCount = entry.chunkLog.Chunks().size(),
+        .generation = entry.generation,
+        .stdOutElided = entry.stdOutElided.has_value(),
+        .stdErrElided = entry.stdErrElided.has_value()
+    };
+}
+
+auto OutputLayout::CanExtend(const EntryShape& previous, const EntryShape& current) -> bool {
+    // replaced outputs share nothing with the rows laid out before, whatever their size
+    return previous.generation == current.generation and previous.promptSize == current.promptSize and
+           previous.stdOutElided == current.stdOutElided and previous.stdErrElided == current.stdErrElided and
+           current.stdOutSize >= previous.stdOutSize and current.stdErrSize >= previous.stdErrSize and
+           current.chunkCount >= previous.chunkCount;
+}
+
+auto OutputLayout::LayOut(const OutputBufferEntry& entry, LaidOutEntry& laidOut, bool extend) const -> void {
+    // runs only change at the end of a log that grew, the ones before the last stay as they were laid out
+    const auto runs = interleaveOutput(entry, ShownOutputPause);
+    const bool fromChunkLog = hasChunkLog(entry);
+    if (extend and laidOut.fromChunkLog and fromChunkLog and laidOut.runCount > 0 and runs.size() >= laidOut.runCount) {
+        laidOut.rows.resize(laidOut.lastRunFirstRow);
+        laidOut.markerAtEnd = appendRuns(laidOut.rows, entry, runs, laidOut.runCount - 1, this->width, laidOut.lastRunFirstRow);
+    } else {
+        laidOut.rows.clear();
+        laidOut.markerAtEnd = appendEntry(laidOut.rows, entry, runs, this->width, laidOut.lastRunFirstRow);
+    }
+    laidOut.runCount = runs.size();
+    laidOut.fromChunkLog = fromChunkLog;
+}
+
+auto OutputLayout::Update(const std::vector<OutputBufferEntry>& bufferEntries, size_t frameWidth) -> void {
+    frameWidth = std::max<size_t>(frameWidth, 1);
+    if (frameWidth != this->width or bufferEntries.size() < this->entries.size()) {
+        this->width = frameWidth;
+        this->entries.clear();
+        this->entryFirstRows.assign(1, 0);
+    }
+
+    std::optional<size_t> firstChanged;
+    for (size_t index = 0; index < bufferEntries.size(); index++) {
+        const auto shape = Shape(bufferEntries[index]);
+        if (index == this->entries.size()) {
+            this->entries.emplace_back();
+            this->LayOut(bufferEntries[index], this->entries.back(), false);
+        } else if (this->entries[index].shape != shape) {
+            auto& laidOut = this->entries[index];
+            this->LayOut(bufferEntries[index], laidOut, not laidOut.markerAtEnd and CanExtend(laidOut.shape, shape));
+        } else {
+            continue;
+        }
+        this->entries[index].shape = shape;
+        if (not firstChanged.has_value()) {
+            firstChanged = index;
+        }
+    }
+
+    if (not firstChanged.has_value()) {
+        return;
+    }
+    this->entryFirstRows.resize(this->entries.size() + 1);
+    for (auto index = firstChanged.value(); index < this->entries.size(); index++) {
+        this->entryFirstRows[index + 1] = this->entryFirstRows[index] + this->entries[index].rows.size();
+    }
+}
+
+auto OutputLayout::EntryFirstRow(size_t entry) const -> size_t {
+    return this->entryFirstRows.at(entry);
+}
+
+auto OutputLayout::EntryAt(size_t row) const -> size_t {
+    if (this->entries.empty()) {
+        return 0;
+    }
+    // empty entries start where the next one does, the last of them is the one with rows
+    const auto after = std::ranges::upper_bound(this->entryFirstRows, row) - this->entryFirstRows.begin();
+    return std::min(static_cast<size_t>(std::max<std::ptrdiff_t>(after - 1, 0)), this->entries.size() - 1);
+}
+
+auto OutputLayout::Rows(size_t entry) const -> const std::vector<OutputRow>& {
+    return this->entries.at(entry).rows;
+}
+
+auto OutputScroll::LastFirstRow() const -> size_t {
+    return this->rowCount > this->pageRows ? this->rowCount - this->pageRows : 0;
+}
+
+auto OutputScroll::Resize(size_t contentRows, size_t visibleRows) -> void {
+    this->rowCount = contentRows;
+    this->pageRows = visibleRows;
+    this->firstRow = this->followTail ? this->LastFirstRow() : std::min(this->firstRow, this->LastFirstRow());
+}
+
+auto OutputScroll::ScrollBy(std::ptrdiff_t rows) -> void {
+    if (rows < 0) {
+        this->ScrollTo(this->firstRow - std::min(this->firstRow, static_cast<size_t>(-rows)));
+    } else {
+        this->ScrollTo(this->firstRow + std::min(static_cast<size_t>(rows), this->rowCount));
+    }
+}
+
+auto OutputScroll::ScrollTo(size_t row) -> void {
+    this->firstRow = std::min(row, this->LastFirstRow());
+    this->followTail = this->firstRow == this->LastFirstRow();
+}
+
+auto OutputScroll::PageUp() -> void {
+    this->ScrollBy(-static_cast<std::ptrdiff_t>(std::max<size_t>(this->pageRows, 1)));
+}
+
+auto OutputScroll::PageDown() -> void {
+    this->ScrollBy(static_cast<std::ptrdiff_t>(std::max<size_t>(this->pageRows, 1)));
+}
+
+auto OutputScroll::ToTop() -> void {
+    this->ScrollTo(0);
+}
+
+auto OutputScroll::ToBottom() -> void {
+    this->ScrollTo(this->rowCount);
+}
+
+auto OutputScroll::Thumb() const -> std::pair<size_t, size_t> {
+    if (this->pageRows == 0 or this->rowCount <= this->pageRows) {
+        return {0, 0};
+    }
+    const auto length = std::max<size_t>(this->pageRows * this->pageRows / this->rowCount, 1);
+    const auto lastStart = this->pageRows - length;
+    // at the bottom the thumb is too, whatever the rounding
+    if (this->firstRow == this->LastFirstRow()) {
+        return {lastStart, length};
+    }
+    return {std::min(this->firstRow * this->pageRows / this->rowCount, lastStart), length};
+}
+
+auto previousEntryRow(const OutputLayout& layout, size_t row) -> size_t {
+    for (auto entry = layout.EntryAt(row) + 1; entry > 0; entry--) {
+        if (const auto firstRow = layout.EntryFirstRow(entry - 1); firstRow < row) {
+            return firstRow;
+        }
+    }
+    return 0;
+}
+
+auto nextEntryRow(const OutputLayout& layout, size_t row) -> size_t {
+    for (auto entry = layout.EntryAt(row) + 1; entry < layout.EntryCount(); entry++) {
+        if (const auto firstRow = layout.EntryFirstRow(entry); firstRow > row) {
+            return firstRow;
+        }
+    }
+    return layout.RowCount();
+}
+
+} // namespace replmk
@@ -0,0 +1,147 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "OutputBuffers.h"
+
+namespace replmk {
+
+// pauses in the output longer than this are shown
+constexpr std::chrono::milliseconds ShownOutputPause{1000};
+
+enum class OutputRowKind: uint8_t {
+    Prompt,
+    StdOut,
+    StdErr,
+    // the lines stderr is shown between
+    StdErrBorder,
+    Pause,
+    StdOutElided,
+    StdErrElided
+};
+
+// one row of the output frame, at most as many characters as the frame is wide
+struct OutputRow {
+    // where the text of the row starts, in the prompt or the stream of its kind
+    size_t offset{0};
+    // of the text, in bytes, or for a pause how long it was, in milliseconds
+    uint32_t length{0};
+    OutputRowKind kind{OutputRowKind::StdOut};
+};
+
+/**
+ * The rows the entry takes in a frame width characters wide: its prompt, then its stdout and stderr in the order
+ * they arrived. Lines longer than the frame are cut into several rows, characters being counted as UTF-8 code points
+ */
+[[nodiscard]] auto layoutEntry(const OutputBufferEntry& entry, size_t width) -> std::vector<OutputRow>;
+
+// empty for the rows that have no text of their own
+[[nodiscard]] auto rowText(const OutputBufferEntry& entry, const OutputRow& row) -> std::string_view;
+
+/**
+ * The rows of all the entries, numbered from the first row of the first entry. Entries are only ever added, and only
+ * the last one changes, so an update lays out the new entries and the ones that changed. An entry that only grew is
+ * laid out again from the start of its last run
+ */
+class OutputLayout final {
+  private:
+    // what decides the rows of an entry
+    struct EntryShape {
+        size_t promptSize{0};
+        size_t stdOutSize{0};
+        size_t stdErrSize{0};
+        size_t chunkCount{0};
+        uint64_t generation{0};
+        bool stdOutElided{false};
+        bool stdErrElided{false};
+
+        auto operator==(const EntryShape&) const -> bool = default;
+    };
+
+    struct LaidOutEntry {
+        EntryShape shape;
+        std::vector<OutputRow> rows;
+        // where the rows of the last run start, and how many runs there were
+        size_t lastRunFirstRow{0};
+        size_t runCount{0};
+        // the runs came from the chunk log rather than one stream after the other
+        bool fromChunkLog{false};
+        // a marker shown at the very end of its stream ends up inside it once the stream grows, all is laid out again then
+        bool markerAtEnd{false};
+    };
+
+    size_t width{0};
+    std::vector<LaidOutEntry> entries;
+    // one more than the entries, the last is the number of rows
+    std::vector<size_t> entryFirstRows{0};
+
+    static auto Shape(const OutputBufferEntry& entry) -> EntryShape;
+    static auto CanExtend(const EntryShape& previous, const EntryShape& current) -> bool;
+    auto LayOut(const OutputBufferEntry& entry, LaidOutEntry& laidOut, bool extend) const -> void;
+
+  public:
+    auto Update(const std::vector<OutputBufferEntry>& bufferEntries, size_t frameWidth) -> void;
+
+    [[nodiscard]] auto RowCount() const -> size_t {
+        return this->entryFirstRows.back();
+    }
+
+    [[nodiscard]] auto EntryCount() const -> size_t {
+        return this->entries.size();
+    }
+
+    [[nodiscard]] auto EntryFirstRow(size_t entry) const -> size_t;
+    // the entry the row is part of, the last one for rows past the end
+    [[nodiscard]] auto EntryAt(size_t row) const -> size_t;
+    [[nodiscard]] auto Rows(size_t entry) const -> const std::vector<OutputRow>&;
+};
+
+/**
+ * Which rows of the layout the frame shows, as the first of them. Following the tail, the frame stays at the bottom as
+ * rows are added. Scrolling up stops following it, and scrolling back to the bottom follows it again
+ */
+class OutputScroll final {
+  private:
+    size_t firstRow{0};
+    size_t rowCount{0};
+    size_t pageRows{0};
+    bool followTail{true};
+
+    [[nodiscard]] auto LastFirstRow() const -> size_t;
+
+  public:
+    auto Resize(size_t contentRows, size_t visibleRows) -> void;
+    auto ScrollBy(std::ptrdiff_t rows) -> void;
+    auto ScrollTo(size_t row) -> void;
+    auto PageUp() -> void;
+    auto PageDown() -> void;
+    auto ToTop() -> void;
+    auto ToBottom() -> void;
+
+    [[nodiscard]] auto FirstRow() const -> size_t {
+        return this->firstRow;
+    }
+
+    [[nodiscard]] auto PageRows() const -> size_t {
+        return this->pageRows;
+    }
+
+    [[nodiscard]] auto IsFollowingTail() const -> bool {
+        return this->followTail;
+    }
+
+    // the first visible row and the number of rows of the scroll bar thumb, none when everything fits
+    [[nodiscard]] auto Thumb() const -> std::pair<size_t, size_t>;
+};
+
+// the first row of the entry shown at row, or of the one before when the row already is its first
+[[nodiscard]] auto previousEntryRow(const OutputLayout& layout, size_t row) -> size_t;
+// the first row of the entry after the one shown at row, the last row when there is none
+[[nodiscard]] auto nextEntryRow(const OutputLayout& layout, size_t row) -> size_t;
+
+} // namespace replmk
@@ -0,0 +1,69 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <format>
+#include <string>
+#include <string_view>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "OutputRedirection.h"
+
+namespace replmk {
+
+namespace {
+
+constexpr mode_t RedirectionFileMode = 0644;
+
+auto regularFileSize(int fileDescriptor) -> std::optional<uint64_t> {
+    struct stat fileStat {};
+    if (fstat(fileDescriptor, &fileStat) != 0 or not S_ISREG(fileStat.st_mode)) {
+        return std::nullopt;
+    }
+    return static_cast<uint64_t>(fileStat.st_size);
+}
+
+} // namespace
+
+auto OutputRedirectionFile::Open(const std::filesystem::path& targetPath, bool append) -> std::expected<void, std::string> {
+    // close-on-exec, children only keep the copy made when it becomes their stdout or stderr
+    const int flags = O_WRONLY | O_CREAT | O_CLOEXEC | (append ? O_APPEND : O_TRUNC);
+    this->fileDescriptor = open(targetPath.c_str(), flags, RedirectionFileMode); //NOLINT(cppcoreguidelines-pro-type-vararg)
+    if (this->fileDescriptor < 0) {
+        return std::unexpected{std::format("Could not open '{}' for writing: {}", targetPath.string(), std::strerror(errno))}; //NOLINT(concurrency-mt-unsafe)
+    }
+
+    this->filePath = targetPath;
+    this->initialSize = regularFileSize(this->fileDescriptor);
+    return {};
+}
+
+auto OutputRedirectionFile::Writer() const -> OnCommandOutput {
+    return makeFileDescriptorCallbacks(this->fileDescriptor, this->fileDescriptor).onStdOut;
+}
+
+auto OutputRedirectionFile::BytesWritten() const -> std::optional<uint64_t> {
+    const auto currentSize = regularFileSize(this->fileDescriptor);
+    if (not currentSize.has_value() or not this->initialSize.has_value()) {
+        return std::nullopt;
+    }
+    return currentSize.value() - std::min(currentSize.value(), this->initialSize.value());
+}
+
+OutputRedirectionFile::~OutputRedirectionFile() {
+    if (this->fileDescriptor >= 0) {
+        close(this->fileDescriptor);
+    }
+}
+
+auto formatRedirectionSummary(std::string_view streamName, const OutputRedirectionFile& file, std::chrono::duration<double> elapsed) -> std::string {
+    const auto bytesWritten = file.BytesWritten();
+    if (not bytesWritten.has_value()) {
+        return std::format("{} sent to '{}' in {:.3f}s\n", streamName, file.Path().string(), elapsed.count());
+    }
+    return std::format("{} written to '{}': {} bytes in {:.3f}s\n", streamName, file.Path().string(), bytesWritten.value(), elapsed.count());
+}
+
+} // namespace replmk
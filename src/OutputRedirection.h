@@ -0,0 +1,57 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <expected>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "ProcessExecutor.h"
+
+namespace replmk {
+
+/**
+ * File receiving the stdout or stderr of a command, opened by the REPL before the command starts.
+ * Child processes get its descriptor as their own output, so the data goes from the command to the file
+ * through the kernel without ever being read by the REPL. Commands running inside the REPL write to it instead
+ */
+class OutputRedirectionFile final {
+  private:
+    int fileDescriptor{-1};
+    std::filesystem::path filePath;
+    std::optional<uint64_t> initialSize;
+
+  public:
+    OutputRedirectionFile() = default;
+    OutputRedirectionFile(const OutputRedirectionFile&) = delete;
+    OutputRedirectionFile(OutputRedirectionFile&&) = delete;
+
+    auto operator=(const OutputRedirectionFile&) -> OutputRedirectionFile& = delete;
+    auto operator=(OutputRedirectionFile&&) -> OutputRedirectionFile& = delete;
+
+    // truncates the file unless append is set. The error is a message for the user
+    [[nodiscard]] auto Open(const std::filesystem::path& targetPath, bool append) -> std::expected<void, std::string>;
+
+    [[nodiscard]] auto Descriptor() const -> int {
+        return this->fileDescriptor;
+    }
+
+    [[nodiscard]] auto Writer() const -> OnCommandOutput;
+
+    // how much the file grew since it was opened, unknown for anything but regular files
+    [[nodiscard]] auto BytesWritten() const -> std::optional<uint64_t>;
+
+    [[nodiscard]] auto Path() const -> const std::filesystem::path& {
+        return this->filePath;
+    }
+
+    ~OutputRedirectionFile();
+};
+
+// one line telling the user where the output of a stream went
+[[nodiscard]]
+auto formatRedirectionSummary(std::string_view streamName, const OutputRedirectionFile& file, std::chrono::duration<double> elapsed) -> std::string;
+
+} // namespace replmk
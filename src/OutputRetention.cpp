@@ -0,0 +1,170 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <format>
+#include <system_error>
+#include <utility>
+
+#include <unistd.h>
+
+#include "ExecutionStats.h"
+#include "OutputRetention.h"
+
+namespace replmk {
+
+namespace {
+
+auto countLines(std::string_view text) -> uint64_t {
+    return static_cast<uint64_t>(std::ranges::count(text, '\n'));
+}
+
+// the name of the command keeps the file easy to find, anything but letters, digits, '-' and '_' is replaced
+auto fileNamePart(std::string_view text) -> std::string {
+    std::string part{text};
+    std::ranges::replace_if(part, [](char character) {
+        const bool isAlphanumeric = (character >= 'a' and character <= 'z') or (character >= 'A' and character <= 'Z') or
+                                    (character >= '0' and character <= '9');
+        return not isAlphanumeric and character != '-' and character != '_';
+    }, '_');
+    return part;
+}
+
+} // namespace
+
+OutputRetention::OutputRetention(const OutputRetentionPolicy& retentionPolicy, OnCommandOutput output, OnOutputElided outputElided,
+                                 std::filesystem::path fullOutputFile)
+    : policy{retentionPolicy}, downstream{std::move(output)}, onElided{std::move(outputElided)}, ring(retentionPolicy.tailBytes),
+      fullOutputPath{std::move(fullOutputFile)} {
+    if (not this->policy.keepFullOutput or this->fullOutputPath.empty()) {
+        this->fullOutputPath.clear();
+        return;
+    }
+    std::error_code error;
+    std::filesystem::create_directories(this->fullOutputPath.parent_path(), error);
+    this->fullOutput.open(this->fullOutputPath, std::ios::binary | std::ios::trunc);
+    // the output is still kept within the policy, only the marker can't tell where the rest is
+    if (not this->fullOutput) {
+        this->fullOutputPath.clear();
+    }
+}
+
+auto OutputRetention::Feed(std::string_view chunk) -> void {
+    if (this->fullOutput.is_open()) {
+        this->fullOutput.write(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+    }
+
+    if (this->headForwarded < this->policy.headBytes) {
+        const auto headPart = chunk.substr(0, static_cast<size_t>(std::min<uint64_t>(this->policy.headBytes - this->headForwarded, chunk.size())));
+        this->headForwarded += headPart.size();
+        this->downstream(headPart);
+        chunk.remove_prefix(headPart.size());
+    }
+    if (not chunk.empty()) {
+        this->KeepInTail(chunk);
+    }
+}
+
+auto OutputRetention::Finish() -> void {
+    if (this->fullOutput.is_open()) {
+        this->fullOutput.close();
+    }
+    if (this->elidedBytes > 0 and this->onElided) {
+        this->onElided(ElidedOutput{.offset = 0, .bytes = this->elidedBytes, .lines = this->elidedLines, .fullOutputPath = this->fullOutputPath.string()});
+    }
+
+    // the ring holds the tail in two parts once it wrapped, the oldest bytes at ringNext
+    const std::string_view stored{this->ring.data(), this->ring.size()};
+    const auto oldest = (this->ringNext + this->ring.size() - this->ringStored) % std::max<size_t>(this->ring.size(), 1);
+    const auto firstPart = stored.substr(oldest, std::min(this->ringStored, this->ring.size() - oldest));
+    const auto secondPart = stored.substr(0, this->ringStored - firstPart.size());
+    if (not firstPart.empty()) {
+        this->downstream(firstPart);
+    }
+    if (not secondPart.empty()) {
+        this->downstream(secondPart);
+    }
+    this->ringStored = 0;
+    this->ringNext = 0;
+}
+
+auto OutputRetention::Callback() -> OnCommandOutput {
+    return [this](std::string_view chunk) {
+        this->Feed(chunk);
+    };
+}
+
+auto OutputRetention::Elide(std::string_view text) -> void {
+    this->elidedBytes += text.size();
+    this->elidedLines += countLines(text);
+}
+
+auto OutputRetention::KeepInTail(std::string_view text) -> void {
+    const auto capacity = this->ring.size();
+    const std::string_view stored{this->ring.data(), capacity};
+    const auto oldest = (this->ringNext + capacity - this->ringStored) % std::max<size_t>(capacity, 1);
+
+    // a text filling the ring on its own pushes out everything stored, and its own start
+    if (text.size() >= capacity) {
+        this->Elide(stored.substr(oldest, std::min(this->ringStored, capacity - oldest)));
+        this->Elide(stored.substr(0, this->ringStored - std::min(this->ringStored, capacity - oldest)));
+        this->Elide(text.substr(0, text.size() - capacity));
+        text.remove_prefix(text.size() - capacity);
+        this->ringStored = 0;
+        this->ringNext = 0;
+    } else if (this->ringStored + text.size() > capacity) {
+        const auto overflow = this->ringStored + text.size() - capacity;
+        const auto firstPart = std::min(overflow, capacity - oldest);
+        this->Elide(stored.substr(oldest, firstPart));
+        this->Elide(stored.substr(0, overflow - firstPart));
+        this->ringStored -= overflow;
+    }
+
+    const auto firstPart = std::min(text.size(), capacity - this->ringNext);
+    std::ranges::copy(text.substr(0, firstPart), this->ring.begin() + static_cast<std::ptrdiff_t>(this->ringNext));
+    std::ranges::copy(text.substr(firstPart), this->ring.begin());
+    this->ringNext = (this->ringNext + text.size()) % std::max<size_t>(capacity, 1);
+    this->ringStored += text.size();
+}
+
+auto combineOutputRetention(const std::vector<OutputRetentionPolicy>& policies) -> OutputRetentionPolicy {
+    OutputRetentionPolicy combined;
+    for (const auto& policy : policies) {
+        if (not policy.IsEnabled()) {
+            continue;
+        }
+        if (not combined.IsEnabled() or policy.headBytes + policy.tailBytes < combined.headBytes + combined.tailBytes) {
+            combined.headBytes = policy.headBytes;
+            combined.tailBytes = policy.tailBytes;
+        }
+        combined.keepFullOutput = combined.keepFullOutput or policy.keepFullOutput;
+    }
+    return combined;
+}
+
+auto defaultFullOutputDirectory() -> std::filesystem::path {
+    if (const auto* stateHome = std::getenv("XDG_STATE_HOME"); stateHome != nullptr and *stateHome != '\0') { //NOLINT(concurrency-mt-unsafe)
+        return std::filesystem::path{stateHome} / "replmk" / "output";
+    }
+    if (const auto* home = std::getenv("HOME"); home != nullptr and *home != '\0') { //NOLINT(concurrency-mt-unsafe)
+        return std::filesystem::path{home} / ".local" / "state" / "replmk" / "output";
+    }
+    return std::filesystem::temp_directory_path() / "replmk-output";
+}
+
+auto makeFullOutputPath(const std::filesystem::path& directory, std::string_view commandName, std::string_view streamName) -> std::filesystem::path {
+    // unique among the files of this process, the time and pid set it apart from the ones of other sessions
+    static std::atomic<uint64_t> sequence{0};
+    const auto now = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch());
+    return directory / std::format("{}-{}-{}-{}.{}", fileNamePart(commandName), now.count(), ::getpid(), sequence++, streamName);
+}
+
+auto formatElisionMarker(const ElidedOutput& elided) -> std::string {
+    auto marker = std::format("[... {} in {} {} left out", formatApproximateSize(elided.bytes), elided.lines, elided.lines == 1 ? "line" : "lines");
+    if (not elided.fullOutputPath.empty()) {
+        marker.append(std::format(", all of the output is in {}", elided.fullOutputPath));
+    }
+    return marker + " ...]";
+}
+
+} // namespace replmk
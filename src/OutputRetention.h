@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Command.h"
+#include "OutputBuffers.h"
+#include "ProcessExecutor.h"
+
+namespace replmk {
+
+using OnOutputElided = std::function<void(const ElidedOutput&)>;
+
+/**
+ * Keeps one stream of a command within its retention policy. The first headBytes are passed on as they arrive,
+ * the last tailBytes are held in a ring buffer and passed on by Finish, and whatever falls out of the ring in between
+ * is only counted. With keepFullOutput every byte is written to fullOutputPath as well
+ */
+class OutputRetention final {
+  private:
+    OutputRetentionPolicy policy;
+    OnCommandOutput downstream;
+    OnOutputElided onElided;
+
+    uint64_t headForwarded{0};
+    std::vector<char> ring;
+    size_t ringNext{0};
+    size_t ringStored{0};
+    uint64_t elidedBytes{0};
+    uint64_t elidedLines{0};
+
+    std::filesystem::path fullOutputPath;
+    std::ofstream fullOutput;
+
+    auto Elide(std::string_view text) -> void;
+    auto KeepInTail(std::string_view text) -> void;
+
+  public:
+    OutputRetention(const OutputRetentionPolicy& retentionPolicy, OnCommandOutput output, OnOutputElided outputElided,
+                    std::filesystem::path fullOutputFile = {});
+    OutputRetention(const OutputRetention&) = delete;
+    OutputRetention(OutputRetention&&) = delete;
+
+    auto operator=(const OutputRetention&) -> OutputRetention& = delete;
+    auto operator=(OutputRetention&&) -> OutputRetention& = delete;
+
+    auto Feed(std::string_view chunk) -> void;
+
+    // onElided runs first, only if something was left out, then the tail is passed on
+    auto Finish() -> void;
+
+    [[nodiscard]] auto Callback() -> OnCommandOutput;
+
+    ~OutputRetention() = default;
+};
+
+// the strictest policy of the commands, with a full copy if any of them asks for one
+[[nodiscard]] auto combineOutputRetention(const std::vector<OutputRetentionPolicy>& policies) -> OutputRetentionPolicy;
+
+// under XDG_STATE_HOME, ~/.local/state otherwise, or the temporary directory without a home
+[[nodiscard]] auto defaultFullOutputDirectory() -> std::filesystem::path;
+
+// a new file name in directory for the full output of a stream of the command
+[[nodiscard]] auto makeFullOutputPath(const std::filesystem::path& directory, std::string_view commandName, std::string_view streamName) -> std::filesystem::path;
+
+// the line shown where the middle of an output was left out
+[[nodiscard]] auto formatElisionMarker(const ElidedOutput& elided) -> std::string;
+
+} // namespace replmk
@@ -0,0 +1,151 @@
+#include <cstdlib>
+#include <expected>
+#include <format>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <dlfcn.h>
+#include <unistd.h>
+
+#include "PluginCommands.h"
+
+namespace replmk {
+
+namespace {
+
+struct PluginSinkContext {
+    const CommandOutputCallbacks* callbacks;
+    const ExecutionControl* control;
+};
+
+auto sinkWriteStdOut(void* context, const char* data, size_t size) -> void {
+    if (data != nullptr and size > 0) {
+        static_cast<PluginSinkContext*>(context)->callbacks->onStdOut(std::string_view(data, size));
+    }
+}
+
+auto sinkWriteStdErr(void* context, const char* data, size_t size) -> void {
+    if (data != nullptr and size > 0) {
+        static_cast<PluginSinkContext*>(context)->callbacks->onStdErr(std::string_view(data, size));
+    }
+}
+
+auto sinkIsCancelled(void* context) -> int {
+    const auto* control = static_cast<PluginSinkContext*>(context)->control;
+    // a plugin writing nothing only hands control back here, so the interface reads Ctrl+C while it polls
+    if (control != nullptr) {
+        control->RunOnIdle();
+    }
+    return (control != nullptr and control->IsCancelRequested()) ? 1 : 0;
+}
+
+auto makePluginArgv(std::string_view cmdName, const std::vector<std::string>& args, std::string& cmdNameStorage) -> std::vector<const char*> {
+    cmdNameStorage = std::string{cmdName};
+
+    std::vector<const char*> argv;
+    argv.reserve(args.size() + 2);
+    argv.push_back(cmdNameStorage.c_str());
+    for (const auto& arg : args) {
+        argv.push_back(arg.c_str());
+    }
+    argv.push_back(nullptr);
+    return argv;
+}
+
+} // namespace
+
+auto PluginLibrary::FindSymbol(const std::string& symbol) const -> void* {
+    return dlsym(this->handle, symbol.c_str());
+}
+
+PluginLibrary::~PluginLibrary() {
+    if (this->handle != nullptr) {
+        dlclose(this->handle);
+    }
+}
+
+auto PluginCache::LoadLibrary(const std::string& libraryPath) -> std::expected<const PluginLibrary*, std::string> {
+    if (const auto loaded = this->libraries.find(libraryPath); loaded != this->libraries.end()) {
+        return loaded->second.get();
+    }
+
+    void* handle = dlopen(libraryPath.c_str(), RTLD_NOW | RTLD_LOCAL);
+    if (handle == nullptr) {
+        const char* error = dlerror(); //NOLINT(concurrency-mt-unsafe)
+        return std::unexpected{std::format("Could not load plugin '{}': {}", libraryPath, error == nullptr ? "unknown error" : error)};
+    }
+
+    auto library = std::make_unique<PluginLibrary>(handle);
+
+    // the version symbol is optional, plugins that don't export it are assumed to be compatible
+    if (auto* versionSymbol = library->FindSymbol(REPLMK_PLUGIN_ABI_VERSION_SYMBOL); versionSymbol != nullptr) {
+        const auto versionFn = reinterpret_cast<replmk_plugin_abi_version_fn>(versionSymbol); //NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+        if (const auto pluginVersion = versionFn(); pluginVersion != REPLMK_PLUGIN_ABI_VERSION) {
+            return std::unexpected{std::format("Plugin '{}' was built for ABI version {}, expected {}", libraryPath, pluginVersion, REPLMK_PLUGIN_ABI_VERSION)};
+        }
+    }
+
+    const auto* libraryPtr = library.get();
+    this->libraries.emplace(libraryPath, std::move(library));
+    return libraryPtr;
+}
+
+auto PluginCache::Resolve(const std::string& libraryPath, const std::string& symbol) -> std::expected<replmk_command_fn, std::string> {
+    auto key = std::make_pair(libraryPath, symbol);
+    if (const auto resolved = this->commands.find(key); resolved != this->commands.end()) {
+        return resolved->second;
+    }
+
+    const auto library = this->LoadLibrary(libraryPath);
+    if (not library.has_value()) {
+        return std::unexpected{library.error()};
+    }
+
+    auto* commandSymbol = library.value()->FindSymbol(symbol);
+    if (commandSymbol == nullptr) {
+        return std::unexpected{std::format("Symbol '{}' not found in plugin '{}'", symbol, libraryPath)};
+    }
+
+    const auto commandFn = reinterpret_cast<replmk_command_fn>(commandSymbol); //NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+    this->commands.emplace(std::move(key), commandFn);
+    return commandFn;
+}
+
+auto PluginCache::LoadedLibrariesCount() const -> size_t {
+    return this->libraries.size();
+}
+
+auto runPluginCommand(replmk_command_fn commandFn, std::string_view cmdName, const std::vector<std::string>& args,
+                      const CommandOutputCallbacks& callbacks, const ExecutionControl& control) -> bool {
+    std::string cmdNameStorage;
+    const auto argv = makePluginArgv(cmdName, args, cmdNameStorage);
+
+    PluginSinkContext context{.callbacks = &callbacks, .control = &control};
+    const replmk_output_sink sink{
+        .abi_version = REPLMK_PLUGIN_ABI_VERSION,
+        .struct_size = sizeof(replmk_output_sink),
+        .context = &context,
+        .write_stdout = sinkWriteStdOut,
+        .write_stderr = sinkWriteStdErr,
+        .is_cancelled = sinkIsCancelled
+    };
+
+    return commandFn(static_cast<int>(argv.size() - 1), argv.data(), &sink) == 0;
+}
+
+auto makeForkedPluginMain(replmk_command_fn commandFn, std::string_view cmdName, const std::vector<std::string>& args) -> ForkedProcessMain {
+    return [commandFn, cmdName = std::string{cmdName}, args]() -> int {
+        // the forked child writes straight to its redirected descriptors and, having no UI, is never cancelled
+        const auto callbacks = makeFileDescriptorCallbacks(STDOUT_FILENO, STDERR_FILENO);
+        const ExecutionControl noControl;
+        return runPluginCommand(commandFn, cmdName, args, callbacks, noControl) ? EXIT_SUCCESS : EXIT_FAILURE;
+    };
+}
+
+auto runIsolatedPluginCommand(replmk_command_fn commandFn, std::string_view cmdName, const std::vector<std::string>& args,
+                              const CommandOutputCallbacks& callbacks, const ExecutionOptions& options) -> bool {
+    return executeForkedAndCaptureOutputs(makeForkedPluginMain(commandFn, cmdName, args), callbacks, options);
+}
+
+} // namespace replmk
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <expected>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "ExecutionControl.h"
+#include "ProcessExecutor.h"
+#include "ReplmkPlugin.h"
+
+namespace replmk {
+
+/**
+ * Owns a dlopen handle. The library is unloaded when the object is destroyed
+ */
+class PluginLibrary final {
+  private:
+    void* handle;
+
+  public:
+    explicit PluginLibrary(void* libraryHandle) : handle(libraryHandle) {}
+    PluginLibrary(const PluginLibrary&) = delete;
+    PluginLibrary(PluginLibrary&&) = delete;
+
+    auto operator=(const PluginLibrary&) -> PluginLibrary& = delete;
+    auto operator=(PluginLibrary&&) -> PluginLibrary& = delete;
+
+    [[nodiscard]] auto FindSymbol(const std::string& symbol) const -> void*;
+
+    ~PluginLibrary();
+};
+
+/**
+ * Plugin libraries and command symbols resolved so far. Each library is opened once per session,
+ * the first time one of its commands runs, and stays loaded until the session ends
+ */
+class PluginCache final {
+  private:
+    std::map<std::string, std::unique_ptr<PluginLibrary>, std::less<>> libraries;
+    std::map<std::pair<std::string, std::string>, replmk_command_fn> commands;
+
+    auto LoadLibrary(const std::string& libraryPath) -> std::expected<const PluginLibrary*, std::string>;
+
+  public:
+    PluginCache() = default;
+    PluginCache(const PluginCache&) = delete;
+    PluginCache(PluginCache&&) = delete;
+
+    auto operator=(const PluginCache&) -> PluginCache& = delete;
+    auto operator=(PluginCache&&) -> PluginCache& = delete;
+
+    [[nodiscard]] auto Resolve(const std::string& libraryPath, const std::string& symbol) -> std::expected<replmk_command_fn, std::string>;
+    [[nodiscard]] auto LoadedLibrariesCount() const -> size_t;
+
+    ~PluginCache() = default;
+};
+
+// calls the plugin function in the REPL process. Output is streamed through the callbacks while the function runs
+auto runPluginCommand(replmk_command_fn commandFn, std::string_view cmdName, const std::vector<std::string>& args,
+                      const CommandOutputCallbacks& callbacks, const ExecutionControl& control) -> bool;
+
+// child process entry point running the plugin, for isolated commands and pipeline stages
+[[nodiscard]] auto makeForkedPluginMain(replmk_command_fn commandFn, std::string_view cmdName, const std::vector<std::string>& args) -> ForkedProcessMain;
+
+// same as runPluginCommand but in a forked child, so a crashing plugin can't take the REPL down
+auto runIsolatedPluginCommand(replmk_command_fn commandFn, std::string_view cmdName, const std::vector<std::string>& args,
+                              const CommandOutputCallbacks& callbacks, const ExecutionOptions& options) -> bool;
+
+} // namespace replmk
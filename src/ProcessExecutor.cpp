@@ -3,113 +3,585 @@
 #include <unistd.h>
 #include <sys/types.h>
 #include <sys/wait.h>
+#include <sys/resource.h>
 #include <sys/select.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <sys/timerfd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pty.h>
+#include <termios.h>
+#include <csignal>
+#include <cerrno>
 #include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <format>
 #include <vector>
 #include <array>
 #include <cstdlib>
+#include <string>
+#include <optional>
 
 namespace replmk {
 
 namespace {
 
 struct ProcessExecutorStdPipes {
+    std::array<int, 2> stdinPipe;
     std::array<int, 2> stdoutPipe;
     std::array<int, 2> stderrPipe;
 };
 
-auto childProcess(ProcessExecutorStdPipes pipes, std::string cmd, const std::vector<std::string>& args) -> void {
-    // Child process
+// close-on-exec, commands running at the same time from other threads must not keep these open
+auto openStdPipes(ProcessExecutorStdPipes& pipes) -> bool {
+    pipes = ProcessExecutorStdPipes{{-1, -1}, {-1, -1}, {-1, -1}};
+    const bool opened = pipe2(pipes.stdinPipe.data(), O_CLOEXEC) == 0 and pipe2(pipes.stdoutPipe.data(), O_CLOEXEC) == 0 and
+                        pipe2(pipes.stderrPipe.data(), O_CLOEXEC) == 0;
+    if (not opened) {
+        for (const auto fileDescriptor : {pipes.stdinPipe[0], pipes.stdinPipe[1], pipes.stdoutPipe[0], pipes.stdoutPipe[1],
+                                          pipes.stderrPipe[0], pipes.stderrPipe[1]}) {
+            if (fileDescriptor >= 0) {
+                close(fileDescriptor);
+            }
+        }
+        return false;
+    }
+    // only the end written by the REPL, the command reads its stdin as usual
+    fcntl(pipes.stdinPipe[1], F_SETFL, fcntl(pipes.stdinPipe[1], F_GETFL) | O_NONBLOCK);
+    return true;
+}
+
+// Everything the child needs is prepared by the parent, so nothing is allocated between fork and exec
+struct ChildProcessImage {
+    std::string cmd;
+    std::vector<char*> argv;
+    std::vector<std::string> environmentEntries;
+    std::vector<char*> envp;
+    std::string workingDirectory;
+};
+
+// filled in place, argv and envp point into the image itself so it must not be moved afterwards
+auto fillChildProcessImage(ChildProcessImage& image, std::string_view cmd, const std::vector<std::string>& args, const ExecutionOptions& options) -> void {
+    image.cmd = std::string(cmd);
+    image.workingDirectory = options.workingDirectory.string();
+
+    image.argv.reserve(args.size() + 2);
+    image.argv.push_back(image.cmd.data());
+    for (const auto& arg : args) {
+        image.argv.push_back(const_cast<char*>(arg.c_str())); //NOLINT(cppcoreguidelines-pro-type-const-cast)
+    }
+    image.argv.push_back(nullptr);
+
+    if (options.environment.empty()) {
+        return;
+    }
+
+    for (char** envEntry = environ; *envEntry != nullptr; envEntry++) { //NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+        const std::string_view entry{*envEntry};
+        const auto name = entry.substr(0, entry.find('='));
+        if (not options.environment.contains(std::string{name})) {
+            image.environmentEntries.emplace_back(entry);
+        }
+    }
+    for (const auto& [name, value] : options.environment) {
+        image.environmentEntries.push_back(name + "=" + value);
+    }
+
+    image.envp.reserve(image.environmentEntries.size() + 1);
+    for (auto& entry : image.environmentEntries) {
+        image.envp.push_back(entry.data());
+    }
+    image.envp.push_back(nullptr);
+}
+
+// the capture pipes are still replaced, so the parent just sees them closed right away
+auto redirectToOutputDescriptors(const CommandOutputCallbacks& callbacks, bool includeStdOut) -> void {
+    if (includeStdOut and callbacks.stdOutFd >= 0) {
+        dup2(callbacks.stdOutFd, STDOUT_FILENO);
+    }
+    if (callbacks.stdErrFd >= 0) {
+        dup2(callbacks.stdErrFd, STDERR_FILENO);
+    }
+}
+
+auto redirectChildOutputs(ProcessExecutorStdPipes pipes, const CommandOutputCallbacks& callbacks) -> void {
+    dup2(pipes.stdinPipe[0], STDIN_FILENO);
     dup2(pipes.stdoutPipe[1], STDOUT_FILENO);
     dup2(pipes.stderrPipe[1], STDERR_FILENO);
+    redirectToOutputDescriptors(callbacks, true);
+    close(pipes.stdinPipe[0]);
+    close(pipes.stdinPipe[1]);
     close(pipes.stdoutPipe[0]);
     close(pipes.stdoutPipe[1]);
     close(pipes.stderrPipe[0]);
     close(pipes.stderrPipe[1]);
+}
 
-    // Build argv
-    std::vector<char*> argv;
-    std::string cmd_str(cmd);
-    argv.push_back(cmd_str.data());
-    std::vector<std::string> args_copy = args;
-    for (auto& arg : args_copy) {
-        argv.push_back(arg.data());
+[[noreturn]]
+auto execChildProcessImage(const ChildProcessImage& image) -> void {
+    if (not image.workingDirectory.empty() and chdir(image.workingDirectory.c_str()) != 0) {
+        _exit(EXIT_FAILURE);
     }
-    argv.push_back(nullptr);
 
-    execvp(argv[0], argv.data());
+    if (image.envp.empty()) {
+        execvp(image.argv[0], image.argv.data());
+    } else {
+        execvpe(image.argv[0], image.argv.data(), image.envp.data());
+    }
     // If execvp fails
     _exit(EXIT_FAILURE);
 }
 
+[[noreturn]]
+auto runForkedProcessMain(const ForkedProcessMain& childMain, const std::string& workingDirectory, const ExecutionOptions& options) -> void {
+    if (not workingDirectory.empty() and chdir(workingDirectory.c_str()) != 0) {
+        _exit(EXIT_FAILURE);
+    }
+    for (const auto& [name, value] : options.environment) {
+        setenv(name.c_str(), value.c_str(), 1); //NOLINT(concurrency-mt-unsafe)
+    }
+    _exit(childMain());
+}
+
 auto handleProcessOutput(int fileDescriptor, const OnCommandOutput& callback) {
     constexpr size_t BufferSize = 4096;
     std::array<char, BufferSize> buf{};
     ssize_t bytesRead = read(fileDescriptor, buf.data(), BufferSize);
     if (bytesRead > 0) {
         callback(std::string_view(buf.data(), static_cast<size_t>(bytesRead)));
+    } else if (bytesRead < 0 and (errno == EAGAIN or errno == EINTR)) {
+        // a pseudo-terminal master is non-blocking, for its input, and can have nothing to read after all
+        return true;
     } else {
-        close(fileDescriptor);
+        // closed by its owner, once the event loop is done with it
         return false;
     }
 
     return true;
 }
 
-auto parentProcessEventLoop(int stdout_fd, int stdoutFd, const CommandOutputCallbacks& callbacks) {
+// a command that closed its stdin fails the write with EPIPE, and the SIGPIPE coming with it must not end the REPL
+auto writeWithoutSigpipe(int fileDescriptor, std::string_view data) -> ssize_t {
+    sigset_t sigpipeSet;
+    sigemptyset(&sigpipeSet);
+    sigaddset(&sigpipeSet, SIGPIPE);
+    sigset_t previousMask;
+    pthread_sigmask(SIG_BLOCK, &sigpipeSet, &previousMask);
+
+    const auto written = write(fileDescriptor, data.data(), data.size());
+    const int writeError = errno;
+    if (written < 0 and writeError == EPIPE) {
+        // the signal is pending on this thread, taken here before it is unblocked
+        const timespec noWait{.tv_sec = 0, .tv_nsec = 0};
+        sigtimedwait(&sigpipeSet, nullptr, &noWait);
+    }
+
+    pthread_sigmask(SIG_SETMASK, &previousMask, nullptr);
+    errno = writeError;
+    return written;
+}
+
+/**
+ * Writes what the interface sends to the stdin of the command, as fast as the command reads it. The descriptor is
+ * non-blocking so a paste bigger than the pipe doesn't stall the interface, the rest waits here until it can be written.
+ * Commands that aren't interactive read end of file right away, instead of competing with the interface for its terminal.
+ * A pseudo-terminal can't be closed for input alone, those commands get /dev/null as their stdin instead, and nothing
+ * is forwarded to them
+ */
+struct StdinForwarder {
+    // a terminal ends input with its EOF character, Ctrl+D, that its line discipline turns into end of file
+    static constexpr char TerminalEndOfFile = '\x04';
+
+    int fd{-1};
+    ExecutionControl* control{nullptr};
+    // the master end of a pseudo-terminal, that also carries stdout and is closed by its owner
+    bool isTerminal{false};
+    std::string pending{};
+    bool closeRequested{false};
+
+    [[nodiscard]] auto IsInteractive() const -> bool {
+        return control != nullptr and control->IsInteractiveThread();
+    }
+
+    [[nodiscard]] auto HasPendingWrite() const -> bool {
+        return fd >= 0 and not pending.empty();
+    }
+
+    auto Close() -> void {
+        if (fd >= 0 and not isTerminal) {
+            close(fd);
+        }
+        fd = -1;
+        pending.clear();
+    }
+
+    auto Collect() -> void {
+        if (fd < 0) {
+            return;
+        }
+        if (not this->IsInteractive()) {
+            this->Close();
+            return;
+        }
+
+        auto input = control->TakeInput();
+        pending.append(input.text);
+        if (input.closed and isTerminal) {
+            pending.push_back(TerminalEndOfFile);
+        }
+        closeRequested = closeRequested or (input.closed and not isTerminal);
+        if (closeRequested and pending.empty()) {
+            this->Close();
+        }
+    }
+
+    auto Write() -> void {
+        const auto written = writeWithoutSigpipe(fd, pending);
+        if (written > 0) {
+            pending.erase(0, static_cast<size_t>(written));
+        } else if (written < 0 and errno != EAGAIN and errno != EINTR) {
+            // the command closed its stdin or exited, nothing more can be written to it
+            this->Close();
+            return;
+        }
+        if (closeRequested and pending.empty()) {
+            this->Close();
+        }
+    }
+
+    StdinForwarder(int fileDescriptor, ExecutionControl* executionControl, bool terminal)
+        : fd{fileDescriptor}, control{executionControl}, isTerminal{terminal} {}
+    StdinForwarder(const StdinForwarder&) = delete;
+    StdinForwarder(StdinForwarder&&) = delete;
+    auto operator=(const StdinForwarder&) -> StdinForwarder& = delete;
+    auto operator=(StdinForwarder&&) -> StdinForwarder& = delete;
+
+    ~StdinForwarder() {
+        this->Close();
+    }
+};
+
+constexpr auto TickInterval = std::chrono::milliseconds{100};
+
+enum class StopReason: uint8_t {
+    Cancelled,
+    TimedOut
+};
+
+/**
+ * Stops an execution cancelled through its control, or running past its timeout, by signalling its process group:
+ * SIGINT first, like Ctrl+C in a terminal, then SIGKILL if it still runs StopGracePeriod later.
+ * A timerfd fires at the timeout, and again at the end of the grace period
+ */
+struct ExecutionStopper {
+    ExecutionControl* control{nullptr};
+    std::chrono::milliseconds timeout{0};
+    pid_t processGroup{-1};
+    int timerFd{-1};
+    std::optional<StopReason> reason{};
+    bool killed{false};
+
+    auto Arm(std::chrono::milliseconds delay) const -> void {
+        const auto seconds = std::chrono::duration_cast<std::chrono::seconds>(delay);
+        const auto nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(delay - seconds);
+        const itimerspec expiration{
+            .it_interval = {.tv_sec = 0, .tv_nsec = 0},
+            .it_value = {.tv_sec = static_cast<time_t>(seconds.count()), .tv_nsec = static_cast<long>(nanoseconds.count())}
+        };
+        timerfd_settime(timerFd, 0, &expiration, nullptr);
+    }
+
+    auto Stop(StopReason stopReason) -> void {
+        reason = stopReason;
+        if (processGroup <= 0) {
+            return;
+        }
+        ::kill(-processGroup, SIGINT);
+        // a process stopped for reading the terminal only gets SIGINT once it continues
+        ::kill(-processGroup, SIGCONT);
+        this->Arm(StopGracePeriod);
+    }
+
+    auto CheckCancellation() -> void {
+        if (not reason.has_value() and control != nullptr and control->IsCancelRequested()) {
+            this->Stop(StopReason::Cancelled);
+        }
+    }
+
+    auto OnTimer() -> void {
+        uint64_t expirations = 0;
+        if (read(timerFd, &expirations, sizeof(expirations)) != sizeof(expirations)) {
+            return;
+        }
+        if (not reason.has_value()) {
+            this->Stop(StopReason::TimedOut);
+        } else if (not killed and processGroup > 0) {
+            ::kill(-processGroup, SIGKILL);
+            killed = true;
+        }
+    }
+
+    [[nodiscard]] auto Stopped() const -> bool {
+        return reason.has_value();
+    }
+
+    // ends the output of a stopped command, after whatever it wrote until then
+    [[nodiscard]] auto TerminationMarker() const -> std::string {
+        const auto stopReason = reason == StopReason::TimedOut
+            ? std::format("timed out after {:g}s", std::chrono::duration<double>{timeout}.count())
+            : std::string{"cancelled"};
+        const auto killedText = killed ? std::format(", killed {}s later", StopGracePeriod.count()) : std::string{};
+        return std::format("[{}, interrupted{}]\n", stopReason, killedText);
+    }
+
+    ExecutionStopper(ExecutionControl* executionControl, std::chrono::milliseconds executionTimeout, pid_t group)
+        : control{executionControl}, timeout{executionTimeout}, processGroup{group},
+          timerFd{timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK)} {
+        if (timeout.count() > 0) {
+            this->Arm(timeout);
+        }
+    }
+    ExecutionStopper(const ExecutionStopper&) = delete;
+    ExecutionStopper(ExecutionStopper&&) = delete;
+    auto operator=(const ExecutionStopper&) -> ExecutionStopper& = delete;
+    auto operator=(ExecutionStopper&&) -> ExecutionStopper& = delete;
+
+    ~ExecutionStopper() {
+        if (timerFd >= 0) {
+            close(timerFd);
+        }
+    }
+};
+
+/**
+ * Reads both outputs until they are closed, and forwards input to the command in between. Every TickInterval at least
+ * onTick, when set, runs while stdout is open, and the stopper checks for cancellation. Waiting for an interactive command
+ * with nothing to show lets the interface handle its events, so what is typed reaches the command even when it is silent.
+ * The descriptors stay open, their owner closes them once the loop ends, whichever way it does
+ */
+auto parentProcessEventLoop(int stdoutFd, int stderrFd, const CommandOutputCallbacks& callbacks, StdinForwarder& input,
+                            ExecutionStopper& stopper, const std::function<void()>& onTick = {}) {
     fd_set readfds;
-    int maxfd = std::max(stdout_fd, stdoutFd);
+    fd_set writefds;
     bool stdoutOpen = true;
     bool stderrOpen = true;
 
     while (stdoutOpen || stderrOpen) {
+        input.Collect();
+        stopper.CheckCancellation();
         FD_ZERO(&readfds);
+        FD_ZERO(&writefds);
         if (stdoutOpen) {
-            FD_SET(stdout_fd, &readfds);
+            FD_SET(stdoutFd, &readfds);
         }
         if (stderrOpen) {
-            FD_SET(stdoutFd, &readfds);
+            FD_SET(stderrFd, &readfds);
+        }
+        if (stopper.timerFd >= 0) {
+            FD_SET(stopper.timerFd, &readfds);
+        }
+        if (input.HasPendingWrite()) {
+            FD_SET(input.fd, &writefds);
         }
 
-        int ret = select(maxfd + 1, &readfds, nullptr, nullptr, nullptr);
+        const int maxfd = std::max({stdoutFd, stderrFd, input.fd, stopper.timerFd});
+        int ret = 0;
+        const auto waitStep = [&](std::chrono::milliseconds interval) {
+            timeval tickTimeout{.tv_sec = 0, .tv_usec = std::chrono::duration_cast<std::chrono::microseconds>(interval).count()};
+            ret = select(maxfd + 1, &readfds, &writefds, nullptr, &tickTimeout);
+            return ret != 0;
+        };
+        if (input.control != nullptr) {
+            input.control->WaitWithIdle(waitStep);
+        } else {
+            waitStep(TickInterval);
+        }
+        if (ret < 0 and errno == EINTR) {
+            continue;
+        }
         if (ret < 0) {
             break;
         }
+        if (onTick and stdoutOpen) {
+            onTick();
+        }
+        if (stopper.timerFd >= 0 and FD_ISSET(stopper.timerFd, &readfds)) {
+            stopper.OnTimer();
+        }
 
-        if (stdoutOpen && FD_ISSET(stdout_fd, &readfds)) {
-            stdoutOpen = handleProcessOutput(stdout_fd, callbacks.onStdOut);
+        if (input.HasPendingWrite() and FD_ISSET(input.fd, &writefds)) {
+            input.Write();
         }
-        if (stderrOpen && FD_ISSET(stdoutFd, &readfds)) {
-            stderrOpen = handleProcessOutput(stdoutFd, callbacks.onStdErr);
+
+        if (stdoutOpen && FD_ISSET(stdoutFd, &readfds)) {
+            stdoutOpen = handleProcessOutput(stdoutFd, callbacks.onStdOut);
+            // a pseudo-terminal carries both, nothing can be written to it once its output ended
+            if (not stdoutOpen and input.fd == stdoutFd) {
+                input.Close();
+            }
+        }
+        if (stderrOpen && FD_ISSET(stderrFd, &readfds)) {
+            stderrOpen = handleProcessOutput(stderrFd, callbacks.onStdErr);
+        }
+    }
+}
+
+/**
+ * Waits for the process through a pidfd, so the stopper keeps working while it runs with its outputs closed.
+ * Returns the wait status, the resources it used are added to the control of the stopper
+ */
+auto waitForProcess(pid_t pid, ExecutionStopper& stopper) -> int {
+    // through syscall, the wrapper of glibc 2.36 can't be called from C++
+    if (const auto pidFd = static_cast<int>(syscall(SYS_pidfd_open, pid, 0)); pidFd >= 0) {
+        std::array<pollfd, 2> waited{{
+            {.fd = pidFd, .events = POLLIN, .revents = 0},
+            {.fd = stopper.timerFd, .events = POLLIN, .revents = 0}
+        }};
+        while (true) {
+            stopper.CheckCancellation();
+            const int ready = poll(waited.data(), waited.size(), static_cast<int>(TickInterval.count()));
+            if (ready < 0 and errno != EINTR) {
+                break;
+            }
+            if (ready > 0 and (waited[1].revents & POLLIN) != 0) {
+                stopper.OnTimer();
+            }
+            if (ready > 0 and (waited[0].revents & POLLIN) != 0) {
+                break;
+            }
         }
+        close(pidFd);
     }
+
+    int status = 0;
+    rusage usage{};
+    if (wait4(pid, &status, 0, &usage) == pid and stopper.control != nullptr) {
+        stopper.control->AddProcessUsage(status, usage);
+    }
+    return status;
 }
 
-auto parentProcess(pid_t pid, ProcessExecutorStdPipes pipes, const CommandOutputCallbacks& callbacks) -> bool {
+// limits that won't be enforced are told before the command runs
+auto reportLimitNotes(const ResourceLimiter& limiter, const CommandOutputCallbacks& callbacks) -> void {
+    if (not limiter.Notes().empty()) {
+        callbacks.onStdErr(limiter.Notes());
+    }
+}
+
+// a stopped command fails, whatever it exited with, and says so after its output, like a limit that ended it
+auto finishExecution(int status, const ExecutionStopper& stopper, std::string_view limitsReport, const CommandOutputCallbacks& callbacks) -> bool {
+    if (not limitsReport.empty()) {
+        callbacks.onStdErr(limitsReport);
+    }
+    if (stopper.Stopped()) {
+        callbacks.onStdErr(stopper.TerminationMarker());
+        return false;
+    }
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+auto parentProcess(pid_t pid, ProcessExecutorStdPipes pipes, const CommandOutputCallbacks& callbacks, const ExecutionOptions& options,
+                   const ResourceLimiter& limiter) -> bool {
     // Parent process
+    close(pipes.stdinPipe[0]);
     close(pipes.stdoutPipe[1]);
     close(pipes.stderrPipe[1]);
 
-    parentProcessEventLoop(pipes.stdoutPipe[0], pipes.stderrPipe[0], callbacks);
+    StdinForwarder input{pipes.stdinPipe[1], options.control, false};
+    ExecutionStopper stopper{options.control, options.timeout, pid};
+    parentProcessEventLoop(pipes.stdoutPipe[0], pipes.stderrPipe[0], callbacks, input, stopper);
+    close(pipes.stdoutPipe[0]);
+    close(pipes.stderrPipe[0]);
 
-    int status = 0;
-    waitpid(pid, &status, 0);
-    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    const int status = waitForProcess(pid, stopper);
+    return finishExecution(status, stopper, limiter.Report(status), callbacks);
 }
 
-} // namespace
+/**
+ * Pipes of a pipeline. Stage i writes into stagePipes[i] and stage i+1 reads from it,
+ * so data flows between children without ever reaching the REPL. Only the first stage stdin, the last stage stdout,
+ * and the stderr shared by all stages, have an end in the parent
+ */
+struct PipelineDescriptors {
+    std::vector<std::array<int, 2>> stagePipes;
+    ProcessExecutorStdPipes outerPipes{{-1, -1}, {-1, -1}, {-1, -1}};
 
-auto executeAndCaptureOutputs(std::string_view cmd, const std::vector<std::string>& args,
-                              const CommandOutputCallbacks& callbacks) -> bool {
-    ProcessExecutorStdPipes pipes{};
+    auto CloseAllButParentEnds() const -> void {
+        for (const auto& stagePipe : this->stagePipes) {
+            close(stagePipe[0]);
+            close(stagePipe[1]);
+        }
+        close(this->outerPipes.stdinPipe[0]);
+        close(this->outerPipes.stdoutPipe[1]);
+        close(this->outerPipes.stderrPipe[1]);
+    }
+
+    auto CloseAll() const -> void {
+        this->CloseAllButParentEnds();
+        close(this->outerPipes.stdinPipe[1]);
+        close(this->outerPipes.stdoutPipe[0]);
+        close(this->outerPipes.stderrPipe[0]);
+    }
+};
+
+auto openPipelineDescriptors(size_t stagesCount) -> std::optional<PipelineDescriptors> {
+    PipelineDescriptors descriptors;
+    if (not openStdPipes(descriptors.outerPipes)) {
+        return std::nullopt;
+    }
 
-    if (pipe(pipes.stdoutPipe.data()) != 0 || pipe(pipes.stderrPipe.data()) != 0) {
+    descriptors.stagePipes.resize(stagesCount - 1, {-1, -1});
+    bool opened = true;
+    for (auto& stagePipe : descriptors.stagePipes) {
+        opened = opened and pipe2(stagePipe.data(), O_CLOEXEC) == 0;
+    }
+
+    if (not opened) {
+        descriptors.CloseAll();
+        return std::nullopt;
+    }
+    return descriptors;
+}
+
+auto redirectPipelineStage(const PipelineDescriptors& descriptors, size_t index, const CommandOutputCallbacks& callbacks) -> void {
+    const auto lastIndex = descriptors.stagePipes.size();
+    dup2(index == 0 ? descriptors.outerPipes.stdinPipe[0] : descriptors.stagePipes.at(index - 1)[0], STDIN_FILENO);
+    dup2(index == lastIndex ? descriptors.outerPipes.stdoutPipe[1] : descriptors.stagePipes.at(index)[1], STDOUT_FILENO);
+    dup2(descriptors.outerPipes.stderrPipe[1], STDERR_FILENO);
+    redirectToOutputDescriptors(callbacks, index == lastIndex);
+    // forked stages don't exec, so nothing can rely on close-on-exec
+    descriptors.CloseAll();
+}
+
+auto trackProcess(ExecutionControl* control, pid_t pid) -> void {
+    if (control != nullptr) {
+        control->AddProcess(pid);
+    }
+}
+
+auto untrackProcess(ExecutionControl* control, pid_t pid) -> void {
+    if (control != nullptr) {
+        control->RemoveProcess(pid);
+    }
+}
+
+template<typename ChildMain>
+auto forkAndCaptureOutputs(const CommandOutputCallbacks& callbacks, const ExecutionOptions& options, const ChildMain& childMain) -> bool {
+    ProcessExecutorStdPipes pipes{};
+    if (not openStdPipes(pipes)) {
         return false;
     }
 
+    const ResourceLimiter limiter{options.limits};
+    reportLimitNotes(limiter, callbacks);
     pid_t pid = fork();
     if (pid < 0) {
         // Fork failed
+        close(pipes.stdinPipe[0]);
+        close(pipes.stdinPipe[1]);
         close(pipes.stdoutPipe[0]);
         close(pipes.stdoutPipe[1]);
         close(pipes.stderrPipe[0]);
@@ -117,10 +589,250 @@ auto executeAndCaptureOutputs(std::string_view cmd, const std::vector<std::strin
         return false;
     }
 
+    // a process group of its own, set on both sides so it is in place whichever runs first
     if (pid == 0) {
-        childProcess(pipes, std::string(cmd), args);
+        setpgid(0, 0);
+        redirectChildOutputs(pipes, callbacks);
+        limiter.ApplyInChild();
+        childMain();
+        _exit(EXIT_FAILURE);
     }
+    setpgid(pid, pid);
+
+    trackProcess(options.control, pid);
+    const bool result = parentProcess(pid, pipes, callbacks, options, limiter);
+    untrackProcess(options.control, pid);
+    return result;
+}
+
+struct PseudoTerminal {
+    int master{-1};
+    int slave{-1};
+};
+
+auto toWindowSize(const ExecutionControl* control) -> winsize {
+    constexpr uint16_t DefaultColumns = 80;
+    constexpr uint16_t DefaultRows = 24;
+    const auto size = control != nullptr ? control->OutputSize() : TerminalSize{};
+    return winsize{
+        .ws_row = size.rows > 0 ? size.rows : DefaultRows,
+        .ws_col = size.columns > 0 ? size.columns : DefaultColumns,
+        .ws_xpixel = 0,
+        .ws_ypixel = 0
+    };
+}
 
-    return parentProcess(pid, pipes, callbacks);
+auto openPseudoTerminal(const ExecutionControl* control) -> std::optional<PseudoTerminal> {
+    PseudoTerminal terminal;
+    auto windowSize = toWindowSize(control);
+    if (openpty(&terminal.master, &terminal.slave, nullptr, nullptr, &windowSize) != 0) {
+        return std::nullopt;
+    }
+    // openpty can't open them close-on-exec, commands started from other threads must not keep them open
+    fcntl(terminal.master, F_SETFD, FD_CLOEXEC);
+    // input is forwarded through the master without blocking, like through a stdin pipe
+    fcntl(terminal.master, F_SETFL, fcntl(terminal.master, F_GETFL) | O_NONBLOCK);
+    fcntl(terminal.slave, F_SETFD, FD_CLOEXEC);
+
+    // lines end with '\n' like they do through a pipe, instead of "\r\n"
+    termios settings{};
+    if (tcgetattr(terminal.slave, &settings) == 0) {
+        settings.c_oflag &= ~static_cast<tcflag_t>(ONLCR);
+        tcsetattr(terminal.slave, TCSANOW, &settings);
+    }
+    return terminal;
+}
+
+[[noreturn]]
+auto pseudoTerminalChildProcess(const PseudoTerminal& terminal, const std::array<int, 2>& stderrPipe, const ChildProcessImage& image,
+                                const ResourceLimiter& limiter, bool interactive) -> void {
+    // a session of its own, with the pseudo-terminal as its controlling terminal
+    setsid();
+    ioctl(terminal.slave, TIOCSCTTY, 0);
+    // nothing is typed to a command that isn't interactive, it reads end of file like through a closed stdin pipe
+    if (const int nullInput = interactive ? -1 : open("/dev/null", O_RDONLY | O_CLOEXEC); nullInput >= 0) {
+        dup2(nullInput, STDIN_FILENO);
+    } else {
+        dup2(terminal.slave, STDIN_FILENO);
+    }
+    dup2(terminal.slave, STDOUT_FILENO);
+    dup2(stderrPipe[1], STDERR_FILENO);
+    close(terminal.master);
+    close(terminal.slave);
+    close(stderrPipe[0]);
+    close(stderrPipe[1]);
+    limiter.ApplyInChild();
+    execChildProcessImage(image);
+}
+
+// nothing when no pseudo-terminal could be opened, without running anything
+auto executeInPseudoTerminal(const ChildProcessImage& image, const CommandOutputCallbacks& callbacks, const ExecutionOptions& options)
+-> std::optional<bool> {
+    auto* const control = options.control;
+    const auto terminal = openPseudoTerminal(control);
+    if (not terminal.has_value()) {
+        return std::nullopt;
+    }
+    std::array<int, 2> stderrPipe{-1, -1};
+    if (pipe2(stderrPipe.data(), O_CLOEXEC) != 0) {
+        close(terminal->master);
+        close(terminal->slave);
+        return std::nullopt;
+    }
+
+    const ResourceLimiter limiter{options.limits};
+    reportLimitNotes(limiter, callbacks);
+    const bool interactive = control != nullptr and control->IsInteractiveThread();
+    const pid_t pid = fork();
+    if (pid == 0) {
+        pseudoTerminalChildProcess(terminal.value(), stderrPipe, image, limiter, interactive);
+    }
+    close(terminal->slave);
+    close(stderrPipe[1]);
+    if (pid < 0) {
+        close(terminal->master);
+        close(stderrPipe[0]);
+        return false;
+    }
+
+    // resizing the pseudo-terminal sends SIGWINCH to the program, so it can lay its output out again
+    trackProcess(control, pid);
+    auto windowSize = toWindowSize(control);
+    StdinForwarder input{interactive ? terminal->master : -1, control, true};
+    // the program reads keys as they are typed, the terminal echoes them and edits lines itself
+    if (interactive) {
+        control->SetKeystrokeInput(true);
+    }
+    // the session of the program is its process group too
+    ExecutionStopper stopper{control, options.timeout, pid};
+    parentProcessEventLoop(terminal->master, stderrPipe[0], callbacks, input, stopper, [&windowSize, &terminal, control]() {
+        auto currentSize = toWindowSize(control);
+        if (currentSize.ws_col != windowSize.ws_col or currentSize.ws_row != windowSize.ws_row) {
+            ioctl(terminal->master, TIOCSWINSZ, &currentSize);
+            windowSize = currentSize;
+        }
+    });
+
+    // the master end reads EIO, rather than end of file, once nothing has the terminal open
+    close(terminal->master);
+    close(stderrPipe[0]);
+    if (interactive) {
+        control->SetKeystrokeInput(false);
+    }
+    const int status = waitForProcess(pid, stopper);
+    untrackProcess(control, pid);
+    return finishExecution(status, stopper, limiter.Report(status), callbacks);
+}
+
+auto writeAll(int fileDescriptor, std::string_view data) -> void {
+    while (not data.empty()) {
+        const auto written = write(fileDescriptor, data.data(), data.size());
+        if (written <= 0) {
+            return;
+        }
+        data.remove_prefix(static_cast<size_t>(written));
+    }
+}
+
+} // namespace
+
+auto makeFileDescriptorCallbacks(int stdOutFd, int stdErrFd) -> CommandOutputCallbacks {
+    return CommandOutputCallbacks{
+        .onStdOut = [stdOutFd](std::string_view chunk) {
+            writeAll(stdOutFd, chunk);
+        },
+        .onStdErr = [stdErrFd](std::string_view chunk) {
+            writeAll(stdErrFd, chunk);
+        }
+    };
+}
+
+auto executeAndCaptureOutputs(std::string_view cmd, const std::vector<std::string>& args,
+                              const CommandOutputCallbacks& callbacks, const ExecutionOptions& options) -> bool {
+    ChildProcessImage image{};
+    fillChildProcessImage(image, cmd, args, options);
+
+    // a redirected stdout gets no pseudo-terminal, and neither does anything when one can't be opened
+    if (options.pty and callbacks.stdOutFd < 0) {
+        if (const auto result = executeInPseudoTerminal(image, callbacks, options); result.has_value()) {
+            return result.value();
+        }
+    }
+    return forkAndCaptureOutputs(callbacks, options, [&image]() {
+        execChildProcessImage(image);
+    });
+}
+
+auto executeForkedAndCaptureOutputs(const ForkedProcessMain& childMain, const CommandOutputCallbacks& callbacks,
+                                    const ExecutionOptions& options) -> bool {
+    const auto workingDirectory = options.workingDirectory.string();
+    return forkAndCaptureOutputs(callbacks, options, [&childMain, &workingDirectory, &options]() {
+        runForkedProcessMain(childMain, workingDirectory, options);
+    });
+}
+
+auto executePipelineAndCaptureOutputs(const std::vector<PipelineStage>& stages, const CommandOutputCallbacks& callbacks,
+                                      const ExecutionOptions& options) -> bool {
+    if (stages.empty()) {
+        return false;
+    }
+
+    std::vector<ChildProcessImage> images(stages.size());
+    for (size_t index = 0; index < stages.size(); index++) {
+        if (not stages.at(index).childMain) {
+            fillChildProcessImage(images.at(index), stages.at(index).cmd, stages.at(index).args, options);
+        }
+    }
+
+    auto descriptors = openPipelineDescriptors(stages.size());
+    if (not descriptors.has_value()) {
+        return false;
+    }
+
+    const auto workingDirectory = options.workingDirectory.string();
+    // limiters can't be moved, the cgroup of each stage is removed with it
+    std::deque<ResourceLimiter> limiters;
+    std::vector<pid_t> pids;
+    pids.reserve(stages.size());
+    for (size_t index = 0; index < stages.size(); index++) {
+        const auto& limiter = limiters.emplace_back(stages.at(index).limits);
+        reportLimitNotes(limiter, callbacks);
+        // every stage joins the process group of the first one, so they are all signalled at once
+        const pid_t processGroup = pids.empty() ? 0 : pids.front();
+        const pid_t pid = fork();
+        if (pid < 0) {
+            break;
+        }
+        if (pid == 0) {
+            setpgid(0, processGroup);
+            redirectPipelineStage(descriptors.value(), index, callbacks);
+            limiter.ApplyInChild();
+            if (stages.at(index).childMain) {
+                runForkedProcessMain(stages.at(index).childMain, workingDirectory, options);
+            }
+            execChildProcessImage(images.at(index));
+        }
+        setpgid(pid, processGroup == 0 ? pid : processGroup);
+        pids.push_back(pid);
+        trackProcess(options.control, pid);
+    }
+
+    // only the parent ends of the first stdin, the last stdout and the shared stderr stay open here
+    descriptors->CloseAllButParentEnds();
+    StdinForwarder input{descriptors->outerPipes.stdinPipe[1], options.control, false};
+    ExecutionStopper stopper{options.control, options.timeout, pids.empty() ? -1 : pids.front()};
+    parentProcessEventLoop(descriptors->outerPipes.stdoutPipe[0], descriptors->outerPipes.stderrPipe[0], callbacks, input, stopper);
+    close(descriptors->outerPipes.stdoutPipe[0]);
+    close(descriptors->outerPipes.stderrPipe[0]);
+
+    int lastStatus = EXIT_FAILURE;
+    std::string limitsReport;
+    for (size_t index = 0; index < pids.size(); index++) {
+        lastStatus = waitForProcess(pids.at(index), stopper);
+        untrackProcess(options.control, pids.at(index));
+        limitsReport.append(limiters.at(index).Report(lastStatus));
+    }
+    // like a shell without pipefail, the last stage decides
+    return finishExecution(lastStatus, stopper, limitsReport, callbacks) and pids.size() == stages.size();
 }
-} //namespace replmk
\ No newline at end of file
+} //namespace replmk
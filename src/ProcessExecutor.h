@@ -1,18 +1,84 @@
 #pragma once
 
+#include <chrono>
+#include <filesystem>
 #include <functional>
+#include <map>
 #include <string>
 #include <vector>
 #include <string_view>
 
+#include "ExecutionControl.h"
+#include "ResourceLimits.h"
+
 namespace replmk {
 using OnCommandOutput = std::function<void(std::string_view)>;
 
 struct CommandOutputCallbacks {
     OnCommandOutput onStdOut;
     OnCommandOutput onStdErr;
+    // when set, child processes get these descriptors as their stdout or stderr and write to them directly,
+    // the matching callback is then only used by commands running inside the REPL
+    int stdOutFd{-1};
+    int stdErrFd{-1};
+};
+
+struct ExecutionOptions {
+    // empty means the working directory of the REPL itself
+    std::filesystem::path workingDirectory{};
+    // added to, or replacing, the environment inherited from the REPL
+    std::map<std::string, std::string> environment{};
+    // when set, spawned processes are registered in it until they have been waited for. Commands executed on its
+    // interactive thread read the input sent through it from their stdin, the others read end of file right away
+    ExecutionControl* control{nullptr};
+    // single programs only. stdin and stdout are a pseudo-terminal, so the program sees a terminal and doesn't buffer
+    // its output. stderr stays a pipe of its own. The window size follows the output size of control
+    bool pty{false};
+    // the command is stopped once it runs for longer, zero for no limit
+    std::chrono::milliseconds timeout{0};
+    // applied to the child before it runs the command, see ResourceLimiter. Pipelines use the limits of each stage instead
+    ResourceLimits limits{};
 };
 
+// how long a stopped command has to exit after SIGINT, before it gets SIGKILL
+constexpr auto StopGracePeriod = std::chrono::seconds{2};
+
+// callbacks writing straight to file descriptors, for in-process code running in a forked child
+[[nodiscard]] auto makeFileDescriptorCallbacks(int stdOutFd, int stdErrFd) -> CommandOutputCallbacks;
+
+// runs in the forked child, with stdout and stderr already redirected. The result is the child exit status.
+// Other threads of the REPL are gone there, along with whatever they held, so it must not take REPL locks
+using ForkedProcessMain = std::function<int()>;
+
+/**
+ * Runs the program in a process group of its own and passes its outputs to the callbacks as they arrive.
+ * When options.control asks for cancellation, or options.timeout passes, the group gets SIGINT, and SIGKILL if it still
+ * runs StopGracePeriod later. The output until then is kept, followed on stderr by a line telling how it was stopped,
+ * and the result is a failure. A command ended by one of options.limits is reported the same way
+ */
 auto executeAndCaptureOutputs(std::string_view cmd, const std::vector<std::string>& args,
-                              const CommandOutputCallbacks& callbacks) -> bool;
+                              const CommandOutputCallbacks& callbacks, const ExecutionOptions& options = {}) -> bool;
+
+struct PipelineStage {
+    // program to exec, unless childMain is set
+    std::string cmd{};
+    std::vector<std::string> args{};
+    ForkedProcessMain childMain{};
+    ResourceLimits limits{};
+};
+
+/**
+ * Runs the stages connected stdout to stdin, all at once. Intermediate data goes from child to child through
+ * the kernel, only the last stage stdout and the stderr of every stage reach the callbacks.
+ * The result is the one of the last stage
+ */
+auto executePipelineAndCaptureOutputs(const std::vector<PipelineStage>& stages, const CommandOutputCallbacks& callbacks,
+                                      const ExecutionOptions& options = {}) -> bool;
+
+/**
+ * Same as executeAndCaptureOutputs but the child runs childMain instead of exec'ing a new program.
+ * Used to isolate in-process code, like plugins, from the REPL itself
+ */
+auto executeForkedAndCaptureOutputs(const ForkedProcessMain& childMain, const CommandOutputCallbacks& callbacks,
+                                    const ExecutionOptions& options = {}) -> bool;
 } //namespace replmk
\ No newline at end of file
@@ -0,0 +1,228 @@
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <format>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <set>
+#include <sstream>
+#include <system_error>
+#include <utility>
+
+#include <unistd.h>
+
+#include "ExecutionStats.h"
+#include "ProcessMonitor.h"
+
+namespace replmk {
+
+namespace {
+
+constexpr std::string_view IdleStatus = " Status: idle";
+
+auto parseField(std::string_view text, uint64_t& value) -> bool {
+    const auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+    return error == std::errc{} and end == text.data() + text.size();
+}
+
+auto readFile(const std::filesystem::path& path) -> std::optional<std::string> {
+    std::ifstream file{path};
+    if (not file) {
+        return std::nullopt;
+    }
+    return std::string{std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{}};
+}
+
+auto isProcessDirectory(const std::filesystem::directory_entry& entry) -> bool {
+    const auto name = entry.path().filename().string();
+    return not name.empty() and std::ranges::all_of(name, [](char character) {
+        return character >= '0' and character <= '9';
+    });
+}
+
+// where the rates of the next sample count from
+struct MonitorSample {
+    std::chrono::steady_clock::time_point commandStart{};
+    std::chrono::steady_clock::time_point time{};
+    uint64_t cpuTicks{0};
+    OutputProgress output{};
+};
+
+auto perSecond(uint64_t previous, uint64_t current, double seconds) -> double {
+    return current > previous and seconds > 0 ? static_cast<double>(current - previous) / seconds : 0;
+}
+
+} // namespace
+
+auto parseProcessStat(std::string_view text) -> std::optional<ProcessStat> {
+    // the command name, between parentheses, can contain spaces and parentheses itself
+    const auto nameStart = text.find('(');
+    const auto nameEnd = text.rfind(')');
+    if (nameStart == std::string_view::npos or nameEnd == std::string_view::npos or nameEnd < nameStart) {
+        return std::nullopt;
+    }
+
+    // from the state on, the third field of the file
+    constexpr size_t ParentPidField = 1;
+    constexpr size_t UserTimeField = 11;
+    constexpr size_t SystemTimeField = 12;
+    constexpr size_t ChildrenUserTimeField = 13;
+    constexpr size_t ChildrenSystemTimeField = 14;
+    constexpr size_t ResidentPagesField = 21;
+    std::vector<std::string> fields;
+    std::istringstream stream{std::string{text.substr(nameEnd + 1)}};
+    for (std::string field; stream >> field;) {
+        fields.push_back(std::move(field));
+    }
+    if (fields.size() <= ResidentPagesField) {
+        return std::nullopt;
+    }
+
+    uint64_t pid = 0;
+    uint64_t parentPid = 0;
+    std::array<uint64_t, 4> times{};
+    ProcessStat stat;
+    if (not parseField(text.substr(0, text.find(' ')), pid) or not parseField(fields.at(ParentPidField), parentPid) or
+        not parseField(fields.at(UserTimeField), times.at(0)) or not parseField(fields.at(SystemTimeField), times.at(1)) or
+        not parseField(fields.at(ChildrenUserTimeField), times.at(2)) or not parseField(fields.at(ChildrenSystemTimeField), times.at(3)) or
+        not parseField(fields.at(ResidentPagesField), stat.residentPages)) {
+        return std::nullopt;
+    }
+    stat.pid = static_cast<pid_t>(pid);
+    stat.parentPid = static_cast<pid_t>(parentPid);
+    // children it already waited for stay part of the tree, a shell running short commands one after the other is busy too
+    for (const auto time : times) {
+        stat.cpuTicks += time;
+    }
+    return stat;
+}
+
+auto sampleProcessTree(const std::vector<pid_t>& roots, const std::filesystem::path& procRoot) -> ProcessTreeSample {
+    ProcessTreeSample sample;
+    if (roots.empty()) {
+        return sample;
+    }
+
+    std::map<pid_t, ProcessStat> stats;
+    std::multimap<pid_t, pid_t> children;
+    std::error_code error;
+    for (const auto& entry : std::filesystem::directory_iterator{procRoot, error}) {
+        if (not isProcessDirectory(entry)) {
+            continue;
+        }
+        const auto content = readFile(entry.path() / "stat");
+        if (not content.has_value()) {
+            continue;
+        }
+        if (const auto stat = parseProcessStat(content.value()); stat.has_value()) {
+            stats.emplace(stat->pid, stat.value());
+            children.emplace(stat->parentPid, stat->pid);
+        }
+    }
+
+    static const auto PageSize = static_cast<uint64_t>(::sysconf(_SC_PAGESIZE));
+    std::set<pid_t> visited;
+    std::vector<pid_t> pending{roots};
+    while (not pending.empty()) {
+        const auto pid = pending.back();
+        pending.pop_back();
+        const auto stat = stats.find(pid);
+        if (stat == stats.end() or not visited.insert(pid).second) {
+            continue;
+        }
+        sample.cpuTicks += stat->second.cpuTicks;
+        sample.residentBytes += stat->second.residentPages * PageSize;
+        sample.processes++;
+        const auto [first, last] = children.equal_range(pid);
+        for (auto child = first; child != last; ++child) {
+            pending.push_back(child->second);
+        }
+    }
+    return sample;
+}
+
+auto formatCommandActivity(const CommandActivity& activity) -> std::string {
+    const std::chrono::duration<double> elapsed = activity.elapsed;
+    auto status = std::format(" Running {:.1f}s  output {}/s, {:.0f} lines/s", elapsed.count(),
+                              formatApproximateSize(static_cast<uint64_t>(activity.bytesPerSecond)), activity.linesPerSecond);
+    // builtins and plugins run inside the REPL, with no process of their own to show
+    if (activity.processes > 0) {
+        status.append(std::format("  cpu {:.0f}%  rss {}  {} {}", activity.cpuPercent, formatApproximateSize(activity.residentBytes),
+                                  activity.processes, activity.processes == 1 ? "process" : "processes"));
+    }
+    return status;
+}
+
+ProcessMonitor::ProcessMonitor(const ExecutionControl& executionControl, std::chrono::milliseconds sampleInterval, std::function<void()> onStatusChange)
+    : control{executionControl}, interval{sampleInterval}, onChange{std::move(onStatusChange)}, status{IdleStatus}, thread{[this] {
+        this->Run();
+    }} {
+}
+
+auto ProcessMonitor::Status() const -> std::string {
+    const std::scoped_lock lock{this->statusMutex};
+    return this->status;
+}
+
+auto ProcessMonitor::Run() -> void {
+    static const auto TicksPerSecond = static_cast<double>(::sysconf(_SC_CLK_TCK));
+    std::optional<MonitorSample> previous;
+    while (true) {
+        {
+            std::unique_lock lock{this->stopMutex};
+            if (this->stopCondition.wait_for(lock, this->interval, [this] {
+                    return this->stopRequested;
+                })) {
+                return;
+            }
+        }
+
+        std::string nextStatus{IdleStatus};
+        if (this->control.IsRunning()) {
+            const auto now = std::chrono::steady_clock::now();
+            const auto commandStart = this->control.StartTime();
+            const auto tree = sampleProcessTree(this->control.Processes());
+            const auto output = this->control.Output();
+            // the first sample of a command counts from its start
+            if (not previous.has_value() or previous->commandStart != commandStart) {
+                previous = MonitorSample{.commandStart = commandStart, .time = commandStart};
+            }
+            const double seconds = std::chrono::duration<double>(now - previous->time).count();
+            nextStatus = formatCommandActivity(CommandActivity{
+                .elapsed = now - commandStart,
+                .bytesPerSecond = perSecond(previous->output.bytes, output.bytes, seconds),
+                .linesPerSecond = perSecond(previous->output.lines, output.lines, seconds),
+                // processes that exit take their time with them, the tree can have used less than before
+                .cpuPercent = perSecond(previous->cpuTicks, tree.cpuTicks, seconds) / TicksPerSecond * 100,
+                .residentBytes = tree.residentBytes,
+                .processes = tree.processes
+            });
+            previous = MonitorSample{.commandStart = commandStart, .time = now, .cpuTicks = tree.cpuTicks, .output = output};
+        } else {
+            previous.reset();
+        }
+
+        {
+            const std::scoped_lock lock{this->statusMutex};
+            if (this->status == nextStatus) {
+                continue;
+            }
+            this->status = std::move(nextStatus);
+        }
+        if (this->onChange) {
+            this->onChange();
+        }
+    }
+}
+
+ProcessMonitor::~ProcessMonitor() {
+    {
+        const std::scoped_lock lock{this->stopMutex};
+        this->stopRequested = true;
+    }
+    this->stopCondition.notify_one();
+    this->thread.join();
+}
+
+} // namespace replmk
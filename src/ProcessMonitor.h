@@ -0,0 +1,93 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <sys/types.h>
+
+#include "ExecutionControl.h"
+
+namespace replmk {
+
+// the fields of /proc/<pid>/stat the monitor uses
+struct ProcessStat {
+    pid_t pid{0};
+    pid_t parentPid{0};
+    // user and system time, in clock ticks
+    uint64_t cpuTicks{0};
+    // resident set, in pages
+    uint64_t residentPages{0};
+};
+
+// empty when the text isn't the content of a stat file
+[[nodiscard]] auto parseProcessStat(std::string_view text) -> std::optional<ProcessStat>;
+
+// the processes given and every one they started that still runs, added up
+struct ProcessTreeSample {
+    uint64_t cpuTicks{0};
+    uint64_t residentBytes{0};
+    size_t processes{0};
+};
+
+// reads every process under procRoot, processes that exit while it reads are left out
+[[nodiscard]] auto sampleProcessTree(const std::vector<pid_t>& roots, const std::filesystem::path& procRoot = "/proc") -> ProcessTreeSample;
+
+// what the status bar shows about the running command
+struct CommandActivity {
+    std::chrono::steady_clock::duration elapsed{};
+    // since the previous sample
+    double bytesPerSecond{0};
+    double linesPerSecond{0};
+    // 100 for each processor kept busy
+    double cpuPercent{0};
+    uint64_t residentBytes{0};
+    size_t processes{0};
+};
+
+[[nodiscard]] auto formatCommandActivity(const CommandActivity& activity) -> std::string;
+
+/**
+ * Samples the command running under an execution control on a thread of its own, every interval, reading /proc for
+ * its process tree. The status line is kept ready for the interface to draw, and onChange runs, on the monitor thread,
+ * only when the line is different, so an idle REPL or a command that is done changing doesn't cause redraws
+ */
+class ProcessMonitor final {
+  private:
+    const ExecutionControl& control;
+    std::chrono::milliseconds interval;
+    std::function<void()> onChange;
+
+    mutable std::mutex statusMutex;
+    std::string status;
+
+    std::mutex stopMutex;
+    std::condition_variable stopCondition;
+    bool stopRequested{false};
+    // last, started once everything it uses is
+    std::thread thread;
+
+    auto Run() -> void;
+
+  public:
+    ProcessMonitor(const ExecutionControl& executionControl, std::chrono::milliseconds sampleInterval, std::function<void()> onStatusChange);
+    ProcessMonitor(const ProcessMonitor&) = delete;
+    ProcessMonitor(ProcessMonitor&&) = delete;
+
+    auto operator=(const ProcessMonitor&) -> ProcessMonitor& = delete;
+    auto operator=(ProcessMonitor&&) -> ProcessMonitor& = delete;
+
+    [[nodiscard]] auto Status() const -> std::string;
+
+    ~ProcessMonitor();
+};
+
+} // namespace replmk
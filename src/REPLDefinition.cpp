@@ -1,9 +1,20 @@
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
 #include <expected>
+#include <limits>
 #include <string>
 #include <string_view>
 #include <vector>
+#include <optional>
+#include <utility>
 
 #include "REPLDefinition.h"
+#include "BuiltinCommands.h"
+#include "CommandCache.h"
+#include "ResourceLimits.h"
 
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wsign-conversion"
@@ -35,6 +46,34 @@ auto getStringOrDefault(const YAML::Node& node, std::string_view key, std::strin
     return std::string{defaultValue};
 }
 
+[[nodiscard]]
+auto getBoolOrDefault(const YAML::Node& node, std::string_view key, bool defaultValue) -> std::expected<bool, DefinitionError> {
+    std::string keyStr{key};
+    if (not node[keyStr]) {
+        return defaultValue;
+    }
+
+    bool value = defaultValue;
+    if (not node[keyStr].IsScalar() or not YAML::convert<bool>::decode(node[keyStr], value)) {
+        return std::unexpected{DefinitionError::InvalidFieldType};
+    }
+    return value;
+}
+
+[[nodiscard]]
+auto getOptionalNumber(const YAML::Node& node, std::string_view key) -> std::expected<std::optional<double>, DefinitionError> {
+    std::string keyStr{key};
+    if (not node[keyStr]) {
+        return std::nullopt;
+    }
+
+    double value = 0;
+    if (not node[keyStr].IsScalar() or not YAML::convert<double>::decode(node[keyStr], value)) {
+        return std::unexpected{DefinitionError::InvalidFieldType};
+    }
+    return value;
+}
+
 [[nodiscard]]
 auto parseBasicFields(const YAML::Node& replDefNode) -> ReplDefinition {
     ReplDefinition replDef;
@@ -53,6 +92,268 @@ auto parseBasicFields(const YAML::Node& replDefNode) -> ReplDefinition {
     return replDef;
 }
 
+[[nodiscard]]
+auto parseArgumentSpec(const YAML::Node& argNode) -> std::expected<ArgumentSpec, DefinitionError> {
+    if (not argNode.IsMap()) {
+        return std::unexpected{DefinitionError::InvalidArgumentSchema};
+    }
+
+    ArgumentSpec spec;
+    auto nameResult = getRequiredString(argNode, definition::ArgumentNameLabel);
+    if (!nameResult) {
+        return std::unexpected{nameResult.error()};
+    }
+    spec.name = nameResult.value();
+    spec.description = getStringOrDefault(argNode, definition::ArgumentDescLabel, "");
+    spec.argType = toArgumentType(getStringOrDefault(argNode, definition::ArgumentTypeLabel, "string"));
+    spec.pattern = getStringOrDefault(argNode, definition::ArgumentPatternLabel, "");
+
+    auto requiredResult = getBoolOrDefault(argNode, definition::ArgumentRequiredLabel, true);
+    auto variadicResult = getBoolOrDefault(argNode, definition::ArgumentVariadicLabel, false);
+    auto minResult = getOptionalNumber(argNode, definition::ArgumentMinLabel);
+    auto maxResult = getOptionalNumber(argNode, definition::ArgumentMaxLabel);
+    if (!requiredResult or !variadicResult or !minResult or !maxResult) {
+        return std::unexpected{DefinitionError::InvalidFieldType};
+    }
+    spec.required = requiredResult.value();
+    spec.variadic = variadicResult.value();
+    spec.minValue = minResult.value();
+    spec.maxValue = maxResult.value();
+
+    if (const auto& valuesNode = argNode[definition::ArgumentValuesLabel]; valuesNode) {
+        if (not valuesNode.IsSequence()) {
+            return std::unexpected{DefinitionError::InvalidArgumentSchema};
+        }
+        for (const auto& valueNode : valuesNode) {
+            if (not valueNode.IsScalar()) {
+                return std::unexpected{DefinitionError::InvalidArgumentSchema};
+            }
+            spec.allowedValues.push_back(valueNode.as<std::string>());
+        }
+    }
+
+    // compile validators once, at load time, so that resolving a command line never has to
+    if (not compileArgumentSpec(spec)) {
+        return std::unexpected{DefinitionError::InvalidArgumentSchema};
+    }
+    return spec;
+}
+
+[[nodiscard]]
+auto parseArgumentSchema(const YAML::Node& commandNode) -> std::expected<ArgumentSchema, DefinitionError> {
+    ArgumentSchema schema;
+    const auto& argsNode = commandNode[definition::CommandArgsLabel];
+    if (not argsNode) {
+        return schema;
+    }
+    if (not argsNode.IsSequence()) {
+        return std::unexpected{DefinitionError::InvalidArgumentSchema};
+    }
+
+    for (const auto& argNode : argsNode) {
+        auto specResult = parseArgumentSpec(argNode);
+        if (!specResult) {
+            return std::unexpected{specResult.error()};
+        }
+        schema.arguments.push_back(std::move(specResult.value()));
+    }
+
+    if (not isArgumentSchemaConsistent(schema)) {
+        return std::unexpected{DefinitionError::InvalidArgumentSchema};
+    }
+    return schema;
+}
+
+[[nodiscard]]
+auto parseCachePolicy(const YAML::Node& commandNode, CommandType cmdType) -> std::expected<CommandCachePolicy, DefinitionError> {
+    CommandCachePolicy policy;
+    const auto& cacheNode = commandNode[definition::CommandCacheLabel];
+    if (not cacheNode) {
+        return policy;
+    }
+    // builtins change the session, replaying their output would skip that
+    const bool cacheable = cmdType == CommandType::Single or cmdType == CommandType::Shell or cmdType == CommandType::Plugin;
+    if (not cacheable or not cacheNode.IsMap()) {
+        return std::unexpected{DefinitionError::InvalidCachePolicy};
+    }
+
+    auto ttlResult = getRequiredString(cacheNode, definition::CacheTtlLabel);
+    if (!ttlResult) {
+        return std::unexpected{ttlResult.error()};
+    }
+    const auto ttl = parseCacheTtl(ttlResult.value());
+    if (not ttl.has_value()) {
+        return std::unexpected{DefinitionError::InvalidCachePolicy};
+    }
+    policy.ttl = ttl.value();
+
+    if (const auto& filesNode = cacheNode[std::string{definition::CacheDependsOnFilesLabel}]; filesNode) {
+        if (not filesNode.IsSequence()) {
+            return std::unexpected{DefinitionError::InvalidCachePolicy};
+        }
+        for (const auto& fileNode : filesNode) {
+            if (not fileNode.IsScalar()) {
+                return std::unexpected{DefinitionError::InvalidCachePolicy};
+            }
+            policy.dependsOnFiles.push_back(fileNode.as<std::string>());
+        }
+    }
+    return policy;
+}
+
+// written like the ttl of a cache, '30s' or '5m'
+[[nodiscard]]
+auto parseCommandTimeout(const YAML::Node& commandNode, CommandType cmdType) -> std::expected<std::chrono::seconds, DefinitionError> {
+    const auto& timeoutNode = commandNode[definition::CommandTimeoutLabel];
+    if (not timeoutNode) {
+        return std::chrono::seconds{0};
+    }
+    if ((cmdType != CommandType::Single and cmdType != CommandType::Shell) or not timeoutNode.IsScalar()) {
+        return std::unexpected{DefinitionError::InvalidTimeout};
+    }
+
+    const auto timeout = parseCacheTtl(timeoutNode.as<std::string>());
+    if (not timeout.has_value()) {
+        return std::unexpected{DefinitionError::InvalidTimeout};
+    }
+    return timeout.value();
+}
+
+// a whole number within the range, empty otherwise
+[[nodiscard]]
+auto parseLimitNumber(const YAML::Node& node, int64_t minimum, int64_t maximum) -> std::optional<int64_t> {
+    if (not node.IsScalar()) {
+        return std::nullopt;
+    }
+    const auto text = node.as<std::string>();
+    int64_t value = 0;
+    const auto* const textEnd = text.data() + text.size(); //NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    const auto [ptr, errorCode] = std::from_chars(text.data(), textEnd, value);
+    if (text.empty() or errorCode != std::errc{} or ptr != textEnd or value < minimum or value > maximum) {
+        return std::nullopt;
+    }
+    return value;
+}
+
+// sets the limit named by key, false when the key is unknown or its value invalid
+[[nodiscard]]
+auto parseLimit(std::string_view key, const YAML::Node& valueNode, ResourceLimits& limits) -> bool {
+    constexpr int64_t HighestNiceness = -20;
+    constexpr int64_t LowestNiceness = 19;
+    constexpr int64_t MaxCpuIndex = CPU_SETSIZE - 1;
+    constexpr int64_t MaxProcesses = std::numeric_limits<int32_t>::max();
+
+    if (key == definition::LimitMemoryLabel) {
+        limits.memoryBytes = valueNode.IsScalar() ? parseByteSize(valueNode.as<std::string>()) : std::nullopt;
+        return limits.memoryBytes.has_value();
+    }
+    if (key == definition::LimitCpuTimeLabel) {
+        // written like a timeout, '30s' or '5m'
+        const auto cpuTime = valueNode.IsScalar() ? parseCacheTtl(valueNode.as<std::string>()) : std::nullopt;
+        if (cpuTime.has_value()) {
+            limits.cpuSeconds = static_cast<uint64_t>(cpuTime->count());
+        }
+        return cpuTime.has_value();
+    }
+    if (key == definition::LimitNiceLabel) {
+        const auto niceness = parseLimitNumber(valueNode, HighestNiceness, LowestNiceness);
+        if (niceness.has_value()) {
+            limits.niceness = static_cast<int>(niceness.value());
+        }
+        return niceness.has_value();
+    }
+    if (key == definition::LimitIoNiceLabel) {
+        limits.ioPriority = valueNode.IsScalar() ? parseIoPriority(valueNode.as<std::string>()) : std::nullopt;
+        return limits.ioPriority.has_value();
+    }
+    if (key == definition::LimitCpusLabel) {
+        if (not valueNode.IsSequence() or valueNode.size() == 0) {
+            return false;
+        }
+        for (const auto& cpuNode : valueNode) {
+            const auto cpu = parseLimitNumber(cpuNode, 0, MaxCpuIndex);
+            if (not cpu.has_value()) {
+                return false;
+            }
+            limits.cpus.push_back(static_cast<unsigned>(cpu.value()));
+        }
+        return true;
+    }
+    if (key == definition::LimitMaxPidsLabel) {
+        const auto maxProcesses = parseLimitNumber(valueNode, 1, MaxProcesses);
+        if (maxProcesses.has_value()) {
+            limits.maxProcesses = static_cast<uint64_t>(maxProcesses.value());
+        }
+        return maxProcesses.has_value();
+    }
+    return false;
+}
+
+// a map of limits, a misspelled one is an error rather than no limit
+[[nodiscard]]
+auto parseResourceLimits(const YAML::Node& commandNode, CommandType cmdType) -> std::expected<ResourceLimits, DefinitionError> {
+    ResourceLimits limits;
+    const auto& limitsNode = commandNode[definition::CommandLimitsLabel];
+    if (not limitsNode) {
+        return limits;
+    }
+    if ((cmdType != CommandType::Single and cmdType != CommandType::Shell) or not limitsNode.IsMap()) {
+        return std::unexpected{DefinitionError::InvalidLimits};
+    }
+
+    for (const auto& entry : limitsNode) {
+        if (not entry.first.IsScalar() or not parseLimit(entry.first.as<std::string>(), entry.second, limits)) {
+            return std::unexpected{DefinitionError::InvalidLimits};
+        }
+    }
+    return limits;
+}
+
+// a size, kept half from the start and half from the end, or a map of head, tail and full_output
+[[nodiscard]]
+auto parseOutputRetention(const YAML::Node& parentNode) -> std::expected<OutputRetentionPolicy, DefinitionError> {
+    OutputRetentionPolicy policy;
+    const auto& retentionNode = parentNode[std::string{definition::MaxOutputBytesLabel}];
+    if (not retentionNode) {
+        return policy;
+    }
+    if (retentionNode.IsScalar()) {
+        const auto maxBytes = parseByteSize(retentionNode.as<std::string>());
+        if (not maxBytes.has_value()) {
+            return std::unexpected{DefinitionError::InvalidOutputRetention};
+        }
+        policy.headBytes = maxBytes.value() / 2;
+        policy.tailBytes = maxBytes.value() - policy.headBytes;
+        return policy;
+    }
+    if (not retentionNode.IsMap()) {
+        return std::unexpected{DefinitionError::InvalidOutputRetention};
+    }
+
+    for (const auto& entry : retentionNode) {
+        const auto key = entry.first.IsScalar() ? entry.first.as<std::string>() : std::string{};
+        if (key == definition::RetentionFullLabel) {
+            if (not entry.second.IsScalar() or not YAML::convert<bool>::decode(entry.second, policy.keepFullOutput)) {
+                return std::unexpected{DefinitionError::InvalidOutputRetention};
+            }
+            continue;
+        }
+        if (key != definition::RetentionHeadLabel and key != definition::RetentionTailLabel) {
+            return std::unexpected{DefinitionError::InvalidOutputRetention};
+        }
+        const auto bytes = entry.second.IsScalar() ? parseByteSize(entry.second.as<std::string>()) : std::nullopt;
+        if (not bytes.has_value()) {
+            return std::unexpected{DefinitionError::InvalidOutputRetention};
+        }
+        (key == definition::RetentionHeadLabel ? policy.headBytes : policy.tailBytes) = bytes.value();
+    }
+    // a full copy alone would still keep the whole output in memory
+    if (not policy.IsEnabled()) {
+        return std::unexpected{DefinitionError::InvalidOutputRetention};
+    }
+    return policy;
+}
+
 [[nodiscard]]
 auto parseCommand(const YAML::Node& commandNode) -> std::expected<Command, DefinitionError> {
     Command cmd;
@@ -85,6 +386,65 @@ auto parseCommand(const YAML::Node& commandNode) -> std::expected<Command, Defin
     }
     cmd.exec = execResult.value();
 
+    if (cmd.cmdType == CommandType::Builtin and not isBuiltinCommand(cmd.exec)) {
+        return std::unexpected{DefinitionError::UnknownBuiltinCommand};
+    }
+
+    if (cmd.cmdType == CommandType::Plugin) {
+        // the library itself is only loaded when the command first runs
+        auto symbolResult = getRequiredString(commandNode, definition::CommandSymbolLabel);
+        if (!symbolResult) {
+            return std::unexpected{symbolResult.error()};
+        }
+        cmd.symbol = symbolResult.value();
+
+        auto isolatedResult = getBoolOrDefault(commandNode, definition::CommandIsolatedLabel, false);
+        if (!isolatedResult) {
+            return std::unexpected{isolatedResult.error()};
+        }
+        cmd.isolated = isolatedResult.value();
+    }
+
+    auto ptyResult = getBoolOrDefault(commandNode, definition::CommandPtyLabel, false);
+    if (!ptyResult) {
+        return std::unexpected{ptyResult.error()};
+    }
+    // like a timeout, a pseudo-terminal only means something to commands running a process of their own
+    if (commandNode[definition::CommandPtyLabel] and cmd.cmdType != CommandType::Single and cmd.cmdType != CommandType::Shell) {
+        return std::unexpected{DefinitionError::InvalidPty};
+    }
+    cmd.pty = ptyResult.value();
+
+    auto timeoutResult = parseCommandTimeout(commandNode, cmd.cmdType);
+    if (!timeoutResult) {
+        return std::unexpected{timeoutResult.error()};
+    }
+    cmd.timeout = timeoutResult.value();
+
+    auto limitsResult = parseResourceLimits(commandNode, cmd.cmdType);
+    if (!limitsResult) {
+        return std::unexpected{limitsResult.error()};
+    }
+    cmd.limits = std::move(limitsResult.value());
+
+    auto argsSchemaResult = parseArgumentSchema(commandNode);
+    if (!argsSchemaResult) {
+        return std::unexpected{argsSchemaResult.error()};
+    }
+    cmd.argsSchema = std::move(argsSchemaResult.value());
+
+    auto cacheResult = parseCachePolicy(commandNode, cmd.cmdType);
+    if (!cacheResult) {
+        return std::unexpected{cacheResult.error()};
+    }
+    cmd.cache = std::move(cacheResult.value());
+
+    auto retentionResult = parseOutputRetention(commandNode);
+    if (!retentionResult) {
+        return std::unexpected{retentionResult.error()};
+    }
+    cmd.outputRetention = retentionResult.value();
+
     return cmd;
 }
 
@@ -109,6 +469,126 @@ auto parseCommands(const YAML::Node& replDefNode) -> std::expected<std::vector<C
     return commands;
 }
 
+[[nodiscard]]
+auto parseWorkflowStep(const YAML::Node& stepNode) -> std::expected<WorkflowStep, DefinitionError> {
+    if (not stepNode.IsMap()) {
+        return std::unexpected{DefinitionError::InvalidWorkflow};
+    }
+
+    auto nameResult = getRequiredString(stepNode, definition::WorkflowStepNameLabel);
+    if (!nameResult) {
+        return std::unexpected{nameResult.error()};
+    }
+    auto runResult = getRequiredString(stepNode, definition::WorkflowStepRunLabel);
+    if (!runResult) {
+        return std::unexpected{runResult.error()};
+    }
+    WorkflowStep step{.name = nameResult.value(), .commandLine = runResult.value(), .dependsOn = {}};
+
+    // a single step name, or a list of them
+    const auto& dependsOnNode = stepNode[definition::WorkflowStepDependsOnLabel];
+    if (dependsOnNode and dependsOnNode.IsScalar()) {
+        step.dependsOn.push_back(dependsOnNode.as<std::string>());
+    } else if (dependsOnNode) {
+        if (not dependsOnNode.IsSequence()) {
+            return std::unexpected{DefinitionError::InvalidWorkflow};
+        }
+        for (const auto& dependencyNode : dependsOnNode) {
+            if (not dependencyNode.IsScalar()) {
+                return std::unexpected{DefinitionError::InvalidWorkflow};
+            }
+            step.dependsOn.push_back(dependencyNode.as<std::string>());
+        }
+    }
+    return step;
+}
+
+[[nodiscard]]
+auto parseWorkflow(const YAML::Node& workflowNode) -> std::expected<Workflow, DefinitionError> {
+    if (not workflowNode.IsMap()) {
+        return std::unexpected{DefinitionError::InvalidWorkflow};
+    }
+
+    Workflow workflow;
+    auto nameResult = getRequiredString(workflowNode, definition::WorkflowNameLabel);
+    if (!nameResult) {
+        return std::unexpected{nameResult.error()};
+    }
+    workflow.name = nameResult.value();
+    workflow.description = getStringOrDefault(workflowNode, definition::WorkflowDescLabel, "");
+
+    const auto policy = toWorkflowPolicy(getStringOrDefault(workflowNode, definition::WorkflowPolicyLabel, workflowPolicyName(WorkflowPolicy::FailFast)));
+    if (not policy.has_value()) {
+        return std::unexpected{DefinitionError::InvalidWorkflow};
+    }
+    workflow.policy = policy.value();
+
+    const auto& stepsNode = workflowNode[definition::WorkflowStepsLabel];
+    if (not stepsNode or not stepsNode.IsSequence()) {
+        return std::unexpected{DefinitionError::InvalidWorkflow};
+    }
+    for (const auto& stepNode : stepsNode) {
+        auto stepResult = parseWorkflowStep(stepNode);
+        if (!stepResult) {
+            return std::unexpected{stepResult.error()};
+        }
+        workflow.steps.push_back(std::move(stepResult.value()));
+    }
+
+    // commands are only looked up when the workflow runs, the shape of the graph can be checked now
+    if (not resolveWorkflowDependencies(workflow).has_value()) {
+        return std::unexpected{DefinitionError::InvalidWorkflow};
+    }
+    return workflow;
+}
+
+[[nodiscard]]
+auto parseWorkflows(const YAML::Node& replDefNode) -> std::expected<std::vector<Workflow>, DefinitionError> {
+    std::vector<Workflow> workflows;
+    const auto& workflowsNode = replDefNode[definition::WorkflowListLabel];
+    if (not workflowsNode) {
+        return workflows;
+    }
+    if (not workflowsNode.IsSequence()) {
+        return std::unexpected{DefinitionError::InvalidWorkflow};
+    }
+
+    for (const auto& workflowNode : workflowsNode) {
+        auto workflowResult = parseWorkflow(workflowNode);
+        if (!workflowResult) {
+            return std::unexpected{workflowResult.error()};
+        }
+        const bool duplicated = std::ranges::any_of(workflows, [&workflowResult](const Workflow& workflow) {
+            return workflow.name == workflowResult.value().name;
+        });
+        if (duplicated) {
+            return std::unexpected{DefinitionError::InvalidWorkflow};
+        }
+        workflows.push_back(std::move(workflowResult.value()));
+    }
+    return workflows;
+}
+
+// a command named like an internal one would hide it, and two internal commands cannot share a name
+[[nodiscard]]
+auto hasCommandNameClash(const ReplDefinition& replDef) -> bool {
+    const std::array<std::string_view, 10> internalNames{
+        replDef.helpCommandName.empty() ? std::string_view{definition::DefaultHelpKeyword} : replDef.helpCommandName,
+        replDef.exitCommandName.empty() ? std::string_view{definition::DefaultExitKeyword} : replDef.exitCommandName,
+        definition::JobsKeyword, definition::ForegroundKeyword, definition::TailKeyword, definition::KillKeyword,
+        definition::RunKeyword, definition::RefreshKeyword, definition::WatchKeyword, definition::StatsKeyword
+    };
+
+    for (auto name = internalNames.begin(); name != internalNames.end(); name++) {
+        if (std::find(std::next(name), internalNames.end(), *name) != internalNames.end()) {
+            return true;
+        }
+    }
+    return std::ranges::any_of(replDef.commands, [&internalNames](const Command& command) {
+        return std::ranges::find(internalNames, command.name) != internalNames.end();
+    });
+}
+
 [[nodiscard]]
 auto loadDefinitionWithException(std::string_view filePath) -> std::expected<ReplDefinition, DefinitionError> {
     auto yamlRoot = YAML::LoadFile(std::string{filePath});
@@ -125,6 +605,26 @@ auto loadDefinitionWithException(std::string_view filePath) -> std::expected<Rep
     }
 
     replDef.commands = commandsResult.value();
+    if (hasCommandNameClash(replDef)) {
+        return std::unexpected{DefinitionError::CommandNameClash};
+    }
+
+    auto retentionResult = parseOutputRetention(yamlRoot);
+    if (!retentionResult) {
+        return std::unexpected{retentionResult.error()};
+    }
+    replDef.outputRetention = retentionResult.value();
+    for (auto& command : replDef.commands) {
+        if (not command.outputRetention.IsEnabled()) {
+            command.outputRetention = replDef.outputRetention;
+        }
+    }
+
+    auto workflowsResult = parseWorkflows(yamlRoot);
+    if (!workflowsResult) {
+        return std::unexpected{workflowsResult.error()};
+    }
+    replDef.workflows = std::move(workflowsResult.value());
     return replDef;
 }
 
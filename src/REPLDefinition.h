@@ -8,6 +8,7 @@
 #include <string_view>
 
 #include "Command.h"
+#include "Workflow.h"
 
 namespace replmk {
 
@@ -18,6 +19,17 @@ constexpr std::string InitialMessageIcon = "👋";
 constexpr std::string DefaultInputNote = "Enter a command";
 constexpr std::string ConsoleIcon = "\U0001F4BB"; // 🖥️
 constexpr std::string DefaultHelpKeyword = "help";
+constexpr std::string DefaultExitKeyword = "exit";
+// internal commands that cannot be renamed, a command of the definition cannot take their names
+constexpr std::string JobsKeyword = "jobs";
+constexpr std::string ForegroundKeyword = "fg";
+constexpr std::string TailKeyword = "tail";
+constexpr std::string KillKeyword = "kill";
+constexpr std::string RunKeyword = "run";
+constexpr std::string RefreshKeyword = "refresh";
+constexpr std::string WatchKeyword = "watch";
+constexpr std::string StatsKeyword = "stats";
+constexpr std::string PlanStepPromptPrefix = "↳ ";
 
 
 // yaml fields labels
@@ -37,6 +49,54 @@ constexpr std::string CommandDescLabel = "description";
 constexpr std::string CommandTypeLabel = "type";
 constexpr std::string CommandExecLabel = "exec";
 constexpr std::string CommandListLabel = "commands";
+constexpr std::string CommandArgsLabel = "args";
+constexpr std::string CommandSymbolLabel = "symbol";
+constexpr std::string CommandIsolatedLabel = "isolated";
+constexpr std::string CommandCacheLabel = "cache";
+constexpr std::string CommandPtyLabel = "pty";
+constexpr std::string CommandTimeoutLabel = "timeout";
+constexpr std::string CommandLimitsLabel = "limits";
+// top level or per command, longer than a constexpr std::string can hold
+constexpr std::string_view MaxOutputBytesLabel = "max_output_bytes";
+
+// cache labels
+constexpr std::string CacheTtlLabel = "ttl";
+// longer than a constexpr std::string can hold
+constexpr std::string_view CacheDependsOnFilesLabel = "depends_on_files";
+
+// limits labels
+constexpr std::string LimitMemoryLabel = "memory";
+constexpr std::string LimitCpuTimeLabel = "cpu_time";
+constexpr std::string LimitNiceLabel = "nice";
+constexpr std::string LimitIoNiceLabel = "ionice";
+constexpr std::string LimitCpusLabel = "cpus";
+constexpr std::string LimitMaxPidsLabel = "max_pids";
+
+// output retention labels
+constexpr std::string RetentionHeadLabel = "head";
+constexpr std::string RetentionTailLabel = "tail";
+constexpr std::string RetentionFullLabel = "full_output";
+
+// argument schema labels
+constexpr std::string ArgumentNameLabel = "name";
+constexpr std::string ArgumentDescLabel = "description";
+constexpr std::string ArgumentTypeLabel = "type";
+constexpr std::string ArgumentRequiredLabel = "required";
+constexpr std::string ArgumentVariadicLabel = "variadic";
+constexpr std::string ArgumentValuesLabel = "values";
+constexpr std::string ArgumentMinLabel = "min";
+constexpr std::string ArgumentMaxLabel = "max";
+constexpr std::string ArgumentPatternLabel = "pattern";
+
+// workflow labels
+constexpr std::string WorkflowListLabel = "workflows";
+constexpr std::string WorkflowNameLabel = "name";
+constexpr std::string WorkflowDescLabel = "description";
+constexpr std::string WorkflowPolicyLabel = "policy";
+constexpr std::string WorkflowStepsLabel = "steps";
+constexpr std::string WorkflowStepNameLabel = "name";
+constexpr std::string WorkflowStepRunLabel = "run";
+constexpr std::string WorkflowStepDependsOnLabel = "depends_on";
 
 
 }// namespace definition
@@ -50,6 +110,15 @@ enum class DefinitionError: uint8_t {
     InvalidCommandType,
     MissingCommandsList,
     InvalidCommandsList,
+    InvalidArgumentSchema,
+    UnknownBuiltinCommand,
+    InvalidWorkflow,
+    InvalidCachePolicy,
+    InvalidTimeout,
+    InvalidLimits,
+    InvalidPty,
+    InvalidOutputRetention,
+    CommandNameClash,
     UnexpectedError
 };
 
@@ -62,6 +131,9 @@ struct ReplDefinition {
     std::string exitCommandDescription;
     std::string inputNote;
     std::vector<Command> commands;
+    std::vector<Workflow> workflows{};
+    // already given to the commands without one of their own
+    OutputRetentionPolicy outputRetention{};
 };
 
 
@@ -89,6 +161,24 @@ constexpr auto DefinitionErrorAsString(DefinitionError err) -> std::string_view
         return "MissingCommandsList";
     case DefinitionError::InvalidCommandsList:
         return "InvalidCommandsList";
+    case DefinitionError::InvalidArgumentSchema:
+        return "InvalidArgumentSchema";
+    case DefinitionError::UnknownBuiltinCommand:
+        return "UnknownBuiltinCommand";
+    case DefinitionError::InvalidWorkflow:
+        return "InvalidWorkflow";
+    case DefinitionError::InvalidCachePolicy:
+        return "InvalidCachePolicy";
+    case DefinitionError::InvalidTimeout:
+        return "InvalidTimeout";
+    case DefinitionError::InvalidLimits:
+        return "InvalidLimits";
+    case DefinitionError::InvalidPty:
+        return "InvalidPty";
+    case DefinitionError::InvalidOutputRetention:
+        return "InvalidOutputRetention";
+    case DefinitionError::CommandNameClash:
+        return "CommandNameClash";
     case DefinitionError::UnexpectedError:
         return "UnexpectedError";
     default:
@@ -15,6 +15,7 @@
 
 #include "REPLMaker.h"
 #include "Core.h"
+#include "OutputRetention.h"
 #include "TextUserInterface.h"
 
 auto makeExternalCommandCatalog(const replmk::ReplDefinition& definition) -> replmk::CommandCatalog {
@@ -56,9 +57,16 @@ auto runWithUserInterface(const replmk::ReplDefinition& definition, replmk::Comm
     if(not outputHistory.Load(outBuffers)) {
     }
 
-    const auto cmdProcAction = replmk::makeCommandProcessingAction(externalCatalog, modifiers, outBuffers, cmdHistory, outputHistory);
+    replmk::Session session;
+    session.cache.SetDirectory(replmk::defaultCommandCacheDirectory());
+    session.fullOutputDirectory = replmk::defaultFullOutputDirectory();
+    for(const auto& workflow: definition.workflows) {
+        session.workflows.emplace(workflow.name, workflow);
+    }
+    const auto cmdProcAction = replmk::makeCommandProcessingAction(externalCatalog, modifiers, outBuffers, session, cmdHistory, outputHistory);
+    const auto cmdCompletionAction = replmk::makeCommandCompletionAction(externalCatalog, modifiers);
 
-    runTextUserInterface(outBuffers, cmdProcAction, definition, cmdHistory);
+    runTextUserInterface(outBuffers, cmdProcAction, cmdCompletionAction, definition, cmdHistory, session.control);
 }
 
 auto runMain(int argc, char* argv[]) -> int { //NOLINT(cppcoreguidelines-avoid-c-arrays,modernize-avoid-c-arrays)
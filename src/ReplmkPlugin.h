@@ -0,0 +1,54 @@
+/*
+ * Public C interface for replmk plugin commands.
+ *
+ * A plugin is a shared object exporting one or more functions with the replmk_command_fn signature.
+ * The REPL loads the object once, the first time one of its commands runs, and keeps it loaded.
+ * This header is plain C so plugins can be built with any compiler, without linking against replmk.
+ */
+#ifndef REPLMK_PLUGIN_H
+#define REPLMK_PLUGIN_H
+
+#include <stddef.h> //NOLINT(modernize-deprecated-headers)
+#include <stdint.h> //NOLINT(modernize-deprecated-headers)
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//NOLINTBEGIN(modernize-use-using,cppcoreguidelines-macro-usage)
+
+/* Bumped on incompatible changes. Plugins may export replmk_plugin_abi_version to have it checked on load */
+#define REPLMK_PLUGIN_ABI_VERSION 1U
+#define REPLMK_PLUGIN_ABI_VERSION_SYMBOL "replmk_plugin_abi_version"
+
+/*
+ * Streaming output given to a command. Writes are appended to the command output as they happen.
+ * New members are only ever added at the end, check struct_size before using them.
+ */
+typedef struct replmk_output_sink {
+    uint32_t abi_version;
+    uint32_t struct_size;
+    void* context;
+
+    void (*write_stdout)(void* context, const char* data, size_t size);
+    void (*write_stderr)(void* context, const char* data, size_t size);
+    /* returns non zero once the user asked to cancel the command. Long running commands should poll it, the interface
+       only handles its events while in-process commands write output or poll */
+    int (*is_cancelled)(void* context);
+} replmk_output_sink;
+
+/*
+ * argv[0] is the command name as typed by the user, followed by argc - 1 arguments.
+ * Returning 0 means success. The sink and argv are only valid during the call
+ */
+typedef int (*replmk_command_fn)(int argc, const char* const* argv, const replmk_output_sink* sink);
+
+typedef uint32_t (*replmk_plugin_abi_version_fn)(void);
+
+//NOLINTEND(modernize-use-using,cppcoreguidelines-macro-usage)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* REPLMK_PLUGIN_H */
@@ -0,0 +1,299 @@
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <format>
+#include <fstream>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <utility>
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "ResourceLimits.h"
+
+namespace replmk {
+
+namespace {
+
+constexpr std::string_view DelegatedCgroupVariable = "REPLMK_CGROUP";
+constexpr int CgroupRemovalAttempts = 50;
+constexpr auto CgroupRemovalInterval = std::chrono::milliseconds{10};
+// ioprio_set has no wrapper in glibc, these come from linux/ioprio.h
+constexpr int IoPriorityWhoProcess = 1;
+constexpr unsigned IoPriorityClassShift = 13;
+constexpr uint8_t MaxIoPriorityLevel = 7;
+
+auto parseUnsigned(std::string_view text) -> std::optional<uint64_t> {
+    uint64_t value = 0;
+    const auto* const textEnd = text.data() + text.size(); //NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    const auto [ptr, errorCode] = std::from_chars(text.data(), textEnd, value);
+    if (text.empty() or errorCode != std::errc{} or ptr != textEnd) {
+        return std::nullopt;
+    }
+    return value;
+}
+
+auto writeControlFile(const std::filesystem::path& file, std::string_view value) -> bool {
+    const int fileDescriptor = ::open(file.c_str(), O_WRONLY | O_CLOEXEC);
+    if (fileDescriptor < 0) {
+        return false;
+    }
+    const bool written = ::write(fileDescriptor, value.data(), value.size()) == static_cast<ssize_t>(value.size());
+    ::close(fileDescriptor);
+    return written;
+}
+
+// the count of one event in a file like memory.events, 'oom_kill 1' on a line of its own
+auto readEventCount(const std::filesystem::path& file, std::string_view event) -> uint64_t {
+    std::ifstream events{file};
+    std::string name;
+    uint64_t count = 0;
+    while (events >> name >> count) {
+        if (name == event) {
+            return count;
+        }
+    }
+    return 0;
+}
+
+auto createTransientCgroup(const std::filesystem::path& delegated, const ResourceLimits& limits) -> std::optional<std::filesystem::path> {
+    static std::atomic<uint64_t> created{0};
+
+    // only possible while nothing runs in the delegated cgroup itself, otherwise whoever delegated it enabled them already
+    writeControlFile(delegated / "cgroup.subtree_control", "+memory");
+    writeControlFile(delegated / "cgroup.subtree_control", "+pids");
+
+    auto directory = delegated / std::format("replmk-{}-{}", ::getpid(), ++created);
+    if (::mkdir(directory.c_str(), S_IRWXU | S_IRGRP | S_IXGRP | S_IROTH | S_IXOTH) != 0) {
+        return std::nullopt;
+    }
+
+    bool configured = true;
+    if (limits.memoryBytes.has_value()) {
+        configured = writeControlFile(directory / "memory.max", std::to_string(limits.memoryBytes.value()));
+        // the command can't get around the limit by swapping, the file is missing when swap isn't accounted
+        writeControlFile(directory / "memory.swap.max", "0");
+    }
+    if (limits.maxProcesses.has_value()) {
+        configured = configured and writeControlFile(directory / "pids.max", std::to_string(limits.maxProcesses.value()));
+    }
+    if (not configured) {
+        ::rmdir(directory.c_str());
+        return std::nullopt;
+    }
+    return directory;
+}
+
+auto writeChildError(std::string_view message) noexcept -> void {
+    [[maybe_unused]] const auto written = ::write(STDERR_FILENO, message.data(), message.size());
+}
+
+auto signalName(int signalNumber) -> std::string {
+    const auto* abbreviation = ::sigabbrev_np(signalNumber);
+    return abbreviation != nullptr ? std::format("SIG{}", abbreviation) : std::format("signal {}", signalNumber);
+}
+
+} // namespace
+
+auto parseByteSize(std::string_view text) -> std::optional<uint64_t> {
+    constexpr uint64_t Kibibyte = 1024;
+    const auto unitStart = text.find_first_not_of("0123456789");
+    const auto amount = parseUnsigned(text.substr(0, unitStart));
+    const auto unit = unitStart == std::string_view::npos ? std::string_view{} : text.substr(unitStart);
+    if (not amount.has_value() or amount.value() == 0) {
+        return std::nullopt;
+    }
+
+    uint64_t multiplier = 0;
+    if (unit.empty()) {
+        multiplier = 1;
+    } else if (unit == "K") {
+        multiplier = Kibibyte;
+    } else if (unit == "M") {
+        multiplier = Kibibyte * Kibibyte;
+    } else if (unit == "G") {
+        multiplier = Kibibyte * Kibibyte * Kibibyte;
+    } else {
+        return std::nullopt;
+    }
+    if (amount.value() > std::numeric_limits<uint64_t>::max() / multiplier) {
+        return std::nullopt;
+    }
+    return amount.value() * multiplier;
+}
+
+auto formatByteSize(uint64_t bytes) -> std::string {
+    constexpr uint64_t Kibibyte = 1024;
+    constexpr std::array<std::pair<uint64_t, char>, 3> Units{{
+        {Kibibyte * Kibibyte * Kibibyte, 'G'},
+        {Kibibyte * Kibibyte, 'M'},
+        {Kibibyte, 'K'}
+    }};
+    for (const auto& [size, unit] : Units) {
+        if (bytes >= size and bytes % size == 0) {
+            return std::format("{}{}", bytes / size, unit);
+        }
+    }
+    return std::to_string(bytes);
+}
+
+auto parseIoPriority(std::string_view text) -> std::optional<IoPriority> {
+    const auto separator = text.find(':');
+    const auto className = text.substr(0, separator);
+
+    IoPriority priority;
+    if (className == "idle") {
+        // the idle class has no levels
+        return separator == std::string_view::npos ? std::optional{IoPriority{.ioClass = IoPriorityClass::Idle, .level = 0}} : std::nullopt;
+    }
+    if (className == "best-effort") {
+        priority.ioClass = IoPriorityClass::BestEffort;
+    } else if (className == "realtime") {
+        priority.ioClass = IoPriorityClass::Realtime;
+    } else {
+        return std::nullopt;
+    }
+
+    if (separator != std::string_view::npos) {
+        const auto level = parseUnsigned(text.substr(separator + 1));
+        if (not level.has_value() or level.value() > MaxIoPriorityLevel) {
+            return std::nullopt;
+        }
+        priority.level = static_cast<uint8_t>(level.value());
+    }
+    return priority;
+}
+
+auto delegatedCgroup() -> std::optional<std::filesystem::path> {
+    const auto* directory = std::getenv(DelegatedCgroupVariable.data()); //NOLINT(concurrency-mt-unsafe,bugprone-suspicious-stringview-data-usage)
+    if (directory == nullptr or *directory == '\0') {
+        return std::nullopt;
+    }
+
+    // a cgroup v2 directory the REPL can create cgroups in
+    std::filesystem::path cgroup{directory};
+    if (::access((cgroup / "cgroup.controllers").c_str(), R_OK) != 0 or ::access(cgroup.c_str(), W_OK) != 0) {
+        return std::nullopt;
+    }
+    return cgroup;
+}
+
+ResourceLimiter::ResourceLimiter(const ResourceLimits& resourceLimits) : limits{resourceLimits} {
+    CPU_ZERO(&this->cpuSet);
+    for (const auto cpu : this->limits.cpus) {
+        if (cpu < CPU_SETSIZE) {
+            CPU_SET(cpu, &this->cpuSet);
+        }
+    }
+
+    // only memory and processes need a cgroup
+    if (not this->limits.memoryBytes.has_value() and not this->limits.maxProcesses.has_value()) {
+        return;
+    }
+
+    if (const auto delegated = delegatedCgroup(); delegated.has_value()) {
+        this->cgroup = createTransientCgroup(delegated.value(), this->limits);
+        if (this->cgroup.has_value()) {
+            this->cgroupProcsFd = ::open((this->cgroup.value() / "cgroup.procs").c_str(), O_WRONLY | O_CLOEXEC);
+        } else {
+            this->notes.append(std::format("limits: no cgroup with memory and pids controllers could be created under '{}'\n",
+                                           delegated.value().string()));
+        }
+    }
+    if (not this->cgroup.has_value() and this->limits.maxProcesses.has_value()) {
+        this->notes.append(std::format("limits: max_pids needs a delegated cgroup, named by {}, it is not applied\n", DelegatedCgroupVariable));
+    }
+}
+
+auto ResourceLimiter::ApplyInChild() const noexcept -> void {
+    if (this->cgroupProcsFd >= 0 and ::write(this->cgroupProcsFd, "0", 1) != 1) {
+        writeChildError("limits: could not join the cgroup of the command\n");
+    }
+
+    if (this->limits.memoryBytes.has_value() and not this->cgroup.has_value()) {
+        const rlimit memoryLimit{.rlim_cur = this->limits.memoryBytes.value(), .rlim_max = this->limits.memoryBytes.value()};
+        if (::setrlimit(RLIMIT_AS, &memoryLimit) != 0) {
+            writeChildError("limits: could not limit the memory\n");
+        }
+    }
+    if (this->limits.cpuSeconds.has_value()) {
+        // SIGXCPU at the limit, SIGKILL a second later for programs that handle it
+        const rlimit cpuLimit{.rlim_cur = this->limits.cpuSeconds.value(), .rlim_max = this->limits.cpuSeconds.value() + 1};
+        if (::setrlimit(RLIMIT_CPU, &cpuLimit) != 0) {
+            writeChildError("limits: could not limit the cpu time\n");
+        }
+    }
+    if (this->limits.niceness.has_value() and ::setpriority(PRIO_PROCESS, 0, this->limits.niceness.value()) != 0) {
+        writeChildError("limits: could not set the niceness\n");
+    }
+    if (this->limits.ioPriority.has_value()) {
+        const auto& priority = this->limits.ioPriority.value();
+        const auto value = (static_cast<unsigned>(priority.ioClass) << IoPriorityClassShift) | priority.level;
+        if (::syscall(SYS_ioprio_set, IoPriorityWhoProcess, 0, value) != 0) {
+            writeChildError("limits: could not set the io priority\n");
+        }
+    }
+    if (not this->limits.cpus.empty() and ::sched_setaffinity(0, sizeof(this->cpuSet), &this->cpuSet) != 0) {
+        writeChildError("limits: could not restrict the processors\n");
+    }
+}
+
+auto ResourceLimiter::Report(int waitStatus) const -> std::string {
+    std::string report;
+    if (this->cgroup.has_value()) {
+        if (this->limits.memoryBytes.has_value() and readEventCount(this->cgroup.value() / "memory.events", "oom_kill") > 0) {
+            report.append(std::format("[killed: memory limit of {} reached]\n", formatByteSize(this->limits.memoryBytes.value())));
+        }
+        if (this->limits.maxProcesses.has_value() and readEventCount(this->cgroup.value() / "pids.events", "max") > 0) {
+            report.append(std::format("[process limit of {} reached, some could not be started]\n", this->limits.maxProcesses.value()));
+        }
+    }
+    if (not WIFSIGNALED(waitStatus)) {
+        return report;
+    }
+
+    const int signalNumber = WTERMSIG(waitStatus);
+    if (this->limits.cpuSeconds.has_value() and signalNumber == SIGXCPU) {
+        report.append(std::format("[killed: cpu time limit of {}s reached]\n", this->limits.cpuSeconds.value()));
+    }
+    // without a cgroup, going over the memory limit makes allocations fail and many programs crash on that
+    const bool crashed = signalNumber == SIGSEGV or signalNumber == SIGABRT or signalNumber == SIGBUS;
+    if (this->limits.memoryBytes.has_value() and not this->cgroup.has_value() and crashed) {
+        report.append(std::format("[killed by {}, possibly for going over the memory limit of {}]\n", signalName(signalNumber),
+                                  formatByteSize(this->limits.memoryBytes.value())));
+    }
+    return report;
+}
+
+ResourceLimiter::~ResourceLimiter() {
+    if (this->cgroupProcsFd >= 0) {
+        ::close(this->cgroupProcsFd);
+    }
+    if (not this->cgroup.has_value()) {
+        return;
+    }
+
+    // whatever the command left running goes with it, a cgroup can only be removed once empty
+    writeControlFile(this->cgroup.value() / "cgroup.kill", "1");
+    for (int attempt = 0; attempt < CgroupRemovalAttempts; attempt++) {
+        if (::rmdir(this->cgroup->c_str()) == 0 or errno != EBUSY) {
+            return;
+        }
+        std::this_thread::sleep_for(CgroupRemovalInterval);
+    }
+}
+
+} // namespace replmk
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <sched.h>
+
+namespace replmk {
+
+// the scheduling classes of ionice
+enum class IoPriorityClass: uint8_t {
+    Realtime = 1,
+    BestEffort = 2,
+    Idle = 3
+};
+
+struct IoPriority {
+    IoPriorityClass ioClass{IoPriorityClass::BestEffort};
+    // 0, the highest, to 7. Ignored by the idle class
+    uint8_t level{4};
+};
+
+// what a command may use, nothing set means no limit
+struct ResourceLimits {
+    std::optional<uint64_t> memoryBytes{};
+    std::optional<uint64_t> cpuSeconds{};
+    std::optional<int> niceness{};
+    std::optional<IoPriority> ioPriority{};
+    // processors the command may run on, by index
+    std::vector<unsigned> cpus{};
+    std::optional<uint64_t> maxProcesses{};
+
+    [[nodiscard]] auto IsEmpty() const -> bool {
+        return not memoryBytes.has_value() and not cpuSeconds.has_value() and not niceness.has_value() and
+               not ioPriority.has_value() and cpus.empty() and not maxProcesses.has_value();
+    }
+};
+
+// '1048576', '512K', '512M' or '2G', in powers of 1024. Empty when the text is none of those or zero
+[[nodiscard]] auto parseByteSize(std::string_view text) -> std::optional<uint64_t>;
+
+// '512M' for 512 MiB, the largest unit dividing the size
+[[nodiscard]] auto formatByteSize(uint64_t bytes) -> std::string;
+
+// 'idle', 'best-effort' or 'realtime', with an optional ':level' from 0 to 7 for the last two
+[[nodiscard]] auto parseIoPriority(std::string_view text) -> std::optional<IoPriority>;
+
+// the delegated cgroup v2 directory transient ones are created under, named by REPLMK_CGROUP. Empty when there is none
+[[nodiscard]] auto delegatedCgroup() -> std::optional<std::filesystem::path>;
+
+/**
+ * Limits of one execution, prepared by the parent before fork so the child only makes system calls before exec.
+ * Memory and process limits go to a transient cgroup created under the delegated one, when there is one, and are enforced
+ * for the command and everything it starts. Without one, memory is limited through RLIMIT_AS for each process and
+ * the number of processes is not limited. CPU time, niceness, io priority and processors are limits of the process,
+ * inherited by its children. The cgroup is removed, with anything still running in it, when the limiter goes away
+ */
+class ResourceLimiter final {
+  private:
+    ResourceLimits limits;
+    cpu_set_t cpuSet{};
+    std::optional<std::filesystem::path> cgroup{};
+    int cgroupProcsFd{-1};
+    std::string notes;
+
+  public:
+    explicit ResourceLimiter(const ResourceLimits& resourceLimits);
+    ResourceLimiter(const ResourceLimiter&) = delete;
+    ResourceLimiter(ResourceLimiter&&) = delete;
+
+    auto operator=(const ResourceLimiter&) -> ResourceLimiter& = delete;
+    auto operator=(ResourceLimiter&&) -> ResourceLimiter& = delete;
+
+    // in the child, between fork and exec. A limit that can't be applied is reported on stderr and the command runs anyway
+    auto ApplyInChild() const noexcept -> void;
+
+    // limits that won't be enforced, known before the command runs
+    [[nodiscard]] auto Notes() const -> const std::string& {
+        return this->notes;
+    }
+
+    // how the limits ended the command, from its wait status. Empty when they didn't
+    [[nodiscard]] auto Report(int waitStatus) const -> std::string;
+
+    ~ResourceLimiter();
+};
+
+} // namespace replmk
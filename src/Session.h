@@ -0,0 +1,36 @@
+#pragma once
+
+#include <filesystem>
+#include <map>
+#include <string>
+
+#include "CommandCache.h"
+#include "ExecutionControl.h"
+#include "JobTable.h"
+#include "PluginCommands.h"
+#include "Workflow.h"
+
+namespace replmk {
+
+/**
+ * State kept across the commands of a REPL session.
+ * Builtin commands change it and spawned processes inherit its working directory and variables
+ */
+struct Session {
+    std::filesystem::path workingDirectory{};
+    std::filesystem::path previousWorkingDirectory{};
+    std::map<std::string, std::string> variables{};
+    // from the definition, started with 'run'
+    WorkflowCatalog workflows{};
+
+    ExecutionControl control{};
+    PluginCache plugins{};
+    // output of commands declaring a cache, off until given a directory
+    CommandCache cache{};
+    // where outputs too large to keep are written in full when their command asks for it, the temporary directory when empty
+    std::filesystem::path fullOutputDirectory{};
+    // last, so jobs still using the rest of the REPL are stopped first
+    JobTable jobs{};
+};
+
+} // namespace replmk
@@ -1,4 +1,8 @@
 #include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <format>
 #include <ftxui/component/component.hpp>
 #include <ftxui/component/component_options.hpp>
 #include <ftxui/component/event.hpp>
@@ -7,15 +11,23 @@
 #include <ftxui/dom/node.hpp>
 #include <ftxui/screen/color.hpp>
 #include <ftxui/screen/screen.hpp>
+#include <ftxui/screen/terminal.hpp>
 #include <functional>
 #include <optional>
 #include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
 
 
 #include "TextUserInterface.h"
+#include "AnsiText.h"
 #include "CommandHistory.h"
 #include "OutputBuffers.h"
+#include "OutputLayout.h"
 #include "Command.h"
+#include "OutputRetention.h"
+#include "ProcessMonitor.h"
 
 namespace replmk {
 using OnCommandEnterEvent = std::function<void(const std::string&)>;
@@ -29,10 +41,18 @@ auto hasNavigateContent(const ftxui::Event& event, CommandHistory& cmdHistory)->
     }
     return std::nullopt;
 }
-auto makeCommandInput(std::string& inputBuffer, const std::string& inputNote, const OnCommandEnterEvent& onCommandEntered, CommandHistory& cmdHistory)  -> ftxui::Component {
+auto makeCommandInput(std::string& inputBuffer, const std::string& inputNote, const OnCommandEnterEvent& onCommandEntered, CommandHistory& cmdHistory,
+                      const CommandCompletionAction& cmdCompletionAction)  -> ftxui::Component {
     auto inputField = ftxui::Input(&inputBuffer, inputNote);
 
-    auto inputFieldWithEvents = ftxui::CatchEvent(inputField, [&inputBuffer, onCommandEntered, &cmdHistory](const ftxui::Event& event) {
+    auto inputFieldWithEvents = ftxui::CatchEvent(inputField, [&inputBuffer, onCommandEntered, &cmdHistory, cmdCompletionAction](const ftxui::Event& event) {
+
+        if(event == ftxui::Event::Tab) {
+            if(cmdCompletionAction) {
+                inputBuffer = cmdCompletionAction(inputBuffer);
+            }
+            return true;
+        }
 
         if(const auto navigateContent = hasNavigateContent(event, cmdHistory); navigateContent.has_value()) {
             const auto& historyContent = navigateContent.value();
@@ -56,32 +76,116 @@ auto makeCommandInput(std::string& inputBuffer, const std::string& inputNote, co
     return inputFieldWithEvents;
 }
 
-auto makeOutputFrame(const OutputBuffers& outBuffers, const float& scrollYPos, ftxui::Box& firstItemBox)  -> ftxui::Component {
-    auto outputRenderer = ftxui::Renderer([&outBuffers, &scrollYPos, &firstItemBox] {
-        ftxui::Elements lines;
+auto toFtxuiColor(const TextColor& textColor) -> ftxui::Color {
+    switch(textColor.kind) {
+        case ColorKind::Default:
+            return ftxui::Color::Default;
+        // the first 16 follow the colors of the terminal theme
+        case ColorKind::Palette:
+            return textColor.index < 16
+                ? ftxui::Color{static_cast<ftxui::Color::Palette16>(textColor.index)}
+                : ftxui::Color{static_cast<ftxui::Color::Palette256>(textColor.index)};
+        case ColorKind::Rgb:
+            return ftxui::Color::RGB(textColor.red, textColor.green, textColor.blue);
+    }
+    return ftxui::Color::Default;
+}
 
-        for (const auto& entry : outBuffers.GetBuffer()) {
+auto makeStyledText(std::string_view text, const TextStyle& style) -> ftxui::Element {
+    auto element = ftxui::text(std::string{text});
+    if(style.foreground.kind != ColorKind::Default) {
+        element |= ftxui::color(toFtxuiColor(style.foreground));
+    }
+    if(style.background.kind != ColorKind::Default) {
+        element |= ftxui::bgcolor(toFtxuiColor(style.background));
+    }
+    const std::array<std::pair<TextAttribute, ftxui::Decorator>, 7> decorators{{
+        {TextAttribute::Bold, ftxui::bold}, {TextAttribute::Dim, ftxui::dim}, {TextAttribute::Italic, ftxui::italic},
+        {TextAttribute::Underline, ftxui::underlined}, {TextAttribute::Blink, ftxui::blink},
+        {TextAttribute::Inverse, ftxui::inverted}, {TextAttribute::Strikethrough, ftxui::strikethrough}
+    }};
+    for(const auto& [attribute, decorator] : decorators) {
+        if(style.Has(attribute)) {
+            element |= decorator;
+        }
+    }
+    return element;
+}
 
-            if(not entry.prompt.empty()) {
-                lines.push_back(ftxui::bold(ftxui::paragraph(entry.prompt)));
-            }
+// the styles were read from the output as it arrived, drawing only cuts the row along them
+auto makeStyledRow(std::string_view text, const std::vector<StyleSpan>& spans, const OutputRow& row) -> ftxui::Element {
+    const auto pieces = styledPieces(spans, row.offset, text.size());
+    if(pieces.size() == 1 and pieces.front().style == TextStyle{}) {
+        return ftxui::text(std::string{text});
+    }
+    ftxui::Elements elements;
+    for(const auto& piece : pieces) {
+        elements.push_back(makeStyledText(text.substr(piece.offset - row.offset, piece.length), piece.style));
+    }
+    return ftxui::hbox(elements);
+}
 
-            auto pline = ftxui::paragraph(entry.stdOutEntry);
-            if(lines.empty()) {
-                pline = pline | ftxui::reflect(firstItemBox);
-            }
-            lines.push_back(pline);
+auto makeOutputRow(const OutputBufferEntry& entry, const OutputRow& row) -> ftxui::Element {
+    switch(row.kind) {
+        case OutputRowKind::Prompt:
+            return ftxui::bold(ftxui::text(std::string{rowText(entry, row)}));
+        case OutputRowKind::StdOut:
+            return makeStyledRow(rowText(entry, row), entry.stdOutStyles, row);
+        case OutputRowKind::StdErr:
+            return makeStyledRow(rowText(entry, row), entry.stdErrStyles, row);
+        case OutputRowKind::StdErrBorder:
+            return ftxui::separator()|ftxui::color(ftxui::Color::OrangeRed1);
+        case OutputRowKind::Pause:
+            return ftxui::text(std::format("+{:.1f}s", static_cast<double>(row.length) / 1000)) | ftxui::dim;
+        // the marker stands out from the output, between what was kept of its start and of its end
+        case OutputRowKind::StdOutElided:
+        case OutputRowKind::StdErrElided: {
+            const auto& elided = row.kind == OutputRowKind::StdOutElided ? entry.stdOutElided : entry.stdErrElided;
+            return ftxui::text(elided.has_value() ? formatElisionMarker(elided.value()) : "") | ftxui::dim | ftxui::inverted;
+        }
+    }
+    return ftxui::text("");
+}
 
-            if(not entry.stdErrEntry.empty()) {
-                lines.push_back(ftxui::separator()|ftxui::color(ftxui::Color::OrangeRed1));
-                lines.push_back(ftxui::hflow(ftxui::paragraph(entry.stdErrEntry)));
-                lines.push_back(ftxui::separator()|ftxui::color(ftxui::Color::OrangeRed1));
+auto makeScrollIndicator(const OutputScroll& scroll) -> ftxui::Element {
+    const auto [thumbStart, thumbLength] = scroll.Thumb();
+    ftxui::Elements cells;
+    for(size_t row = 0; row < scroll.PageRows(); row++) {
+        cells.push_back(ftxui::text(row >= thumbStart and row < thumbStart + thumbLength ? "┃" : " "));
+    }
+    return ftxui::vbox(cells);
+}
+
+auto outputTextSize(const OutputView& view) -> TerminalSize {
+    const auto screenSize = ftxui::Terminal::Size();
+    return TerminalSize{
+        .columns = static_cast<uint16_t>(std::max(1, screenSize.dimx - view.reservedColumns)),
+        .rows = static_cast<uint16_t>(std::max(1, screenSize.dimy - view.reservedRows))
+    };
+}
+
+// only the rows in view are drawn, laid out for the size the terminal has now
+auto makeOutputFrame(const OutputBuffers& outBuffers, OutputView& view)  -> ftxui::Component {
+    auto outputRenderer = ftxui::Renderer([&outBuffers, &view] {
+        const auto textSize = outputTextSize(view);
+        view.layout.Update(outBuffers.GetBuffer(), textSize.columns);
+        view.scroll.Resize(view.layout.RowCount(), textSize.rows);
+
+        ftxui::Elements rows;
+        const auto firstRow = view.scroll.FirstRow();
+        const auto shownRows = std::min(view.scroll.PageRows(), view.layout.RowCount() - firstRow);
+        for(auto entry = view.layout.EntryAt(firstRow); entry < view.layout.EntryCount() and rows.size() < shownRows; entry++) {
+            const auto& entryRows = view.layout.Rows(entry);
+            const auto entryFirstRow = view.layout.EntryFirstRow(entry);
+            for(auto row = firstRow > entryFirstRow ? firstRow - entryFirstRow : 0; row < entryRows.size() and rows.size() < shownRows; row++) {
+                rows.push_back(makeOutputRow(outBuffers.GetBuffer()[entry], entryRows[row]));
             }
         }
 
-        const auto linesVbox = ftxui::vbox(lines);
-
-        return linesVbox | ftxui::focusPositionRelative(0, scrollYPos)| ftxui::vscroll_indicator  |ftxui::yframe;
+        return ftxui::hbox({
+            ftxui::vbox(rows) | ftxui::flex,
+            makeScrollIndicator(view.scroll)
+        });
     });
 
     return outputRenderer;
@@ -96,50 +200,63 @@ auto makeTopBarRenderer(const std::string& initialMessage) {
 }
 
 
-auto makeStatusBarRenderer() {
-    return ftxui::Renderer([] ->ftxui::Element{
+// the monitor samples on its own thread, drawing only reads the line it left
+auto makeStatusBarRenderer(const ProcessMonitor& monitor) {
+    return ftxui::Renderer([&monitor] ->ftxui::Element{
         return ftxui::hbox({
-            ftxui::text(" Status: idle")
+            ftxui::text(monitor.Status())
         }) | ftxui::color(ftxui::Color::White) | ftxui::bgcolor(ftxui::Color::DarkGreen);
     });
 
 }
 
-auto calculateScrollPosition ( int minFirstItemYValue, const ftxui::Box& outputFrameRenderedBox, float scrollYPos, const ftxui::Event& event) {
-
-    // hack to calculate position. For some reason, y_max has the correct value when the page goes off screen
-    const int totalHeight = outputFrameRenderedBox.y_max - minFirstItemYValue;
-    const int pageHeight = outputFrameRenderedBox.y_max - outputFrameRenderedBox.y_min;
-
+auto isForwardedKey(const ftxui::Event& event) -> bool {
+    return not event.is_mouse() and not event.is_cursor_position() and event != ftxui::Event::Custom and
+           event != ftxui::Event::PageUp and event != ftxui::Event::PageDown and not event.input().empty();
+}
 
-    float pageStep = 0;
-    if(totalHeight > 0) {
-        pageStep = static_cast<float>(pageHeight)/static_cast<float>(totalHeight);
+// by pages, wheel steps or commands. The keys reach the input field too, where Home and End move the cursor
+auto scrollOutput(OutputView& view, ftxui::Event event) -> bool {
+    constexpr std::ptrdiff_t WheelRows = 3;
+    if(event.is_mouse()) {
+        if(event.mouse().button == ftxui::Mouse::WheelUp) {
+            view.scroll.ScrollBy(-WheelRows);
+            return true;
+        }
+        if(event.mouse().button == ftxui::Mouse::WheelDown) {
+            view.scroll.ScrollBy(WheelRows);
+            return true;
+        }
+        return false;
     }
 
     if(event == ftxui::Event::PageUp) {
-        scrollYPos = scrollYPos-pageStep;
+        view.scroll.PageUp();
     }
     if(event == ftxui::Event::PageDown) {
-        scrollYPos = scrollYPos+pageStep;
+        view.scroll.PageDown();
+    }
+    if(event == ftxui::Event::ArrowUpCtrl) {
+        view.scroll.ScrollTo(previousEntryRow(view.layout, view.scroll.FirstRow()));
+    }
+    if(event == ftxui::Event::ArrowDownCtrl) {
+        view.scroll.ScrollTo(nextEntryRow(view.layout, view.scroll.FirstRow()));
     }
-
-    scrollYPos = std::min<float>(scrollYPos, 1);
-    scrollYPos = std::max<float>(scrollYPos, 0);
-
     if(event == ftxui::Event::Home) {
-        scrollYPos = 0;
+        view.scroll.ToTop();
     }
     if(event == ftxui::Event::End) {
-        scrollYPos = 1;
+        view.scroll.ToBottom();
     }
-
-    return scrollYPos;
+    return false;
 }
 
 auto createAndRunTextUserInterface(const std::string& inputNote, OutputBuffers& outBuffers, const std::string& prompt,
-                                   const CommandProcessingAction& cmdProcAction, const std::string& initialMessage, CommandHistory& cmdHistory) {
+                                   const CommandProcessingAction& cmdProcAction, const CommandCompletionAction& cmdCompletionAction,
+                                   const std::string& initialMessage, CommandHistory& cmdHistory, ExecutionControl& execControl) {
     auto screen = ftxui::ScreenInteractive::FullscreenAlternateScreen();
+    // Ctrl+C cancels the running command instead of always leaving the REPL
+    screen.ForceHandleCtrlC(false);
 
     std::string inputBuffer;
     const auto onInternalSpecialCmd = [&screen](CommandType command) {
@@ -148,7 +265,14 @@ auto createAndRunTextUserInterface(const std::string& inputNote, OutputBuffers&
         }
     };
 
-    const auto onCommandEntered = [&outBuffers, &prompt, cmdProcAction, onInternalSpecialCmd](const std::string& fullCommandLine) {
+    const auto onCommandEntered = [&outBuffers, &prompt, &execControl, cmdProcAction, onInternalSpecialCmd](const std::string& fullCommandLine) {
+
+        // typed while a command runs, the line is input for it rather than a new command, and stays out of the history
+        if(execControl.IsRunning()) {
+            outBuffers.AppendToLastStdOutEntry(fullCommandLine+"\n");
+            execControl.SendInput(fullCommandLine+"\n");
+            return;
+        }
 
         const auto trimmedFullCmdLine = trimString(fullCommandLine);
         if (trimmedFullCmdLine.empty()) {
@@ -164,19 +288,28 @@ auto createAndRunTextUserInterface(const std::string& inputNote, OutputBuffers&
         cmdProcAction(trimmedFullCmdLine, onInternalSpecialCmd);
     };
 
-    float scrollYPos = 1;
-    ftxui::Box firstItemBox;
-
-    const auto inputField = makeCommandInput(inputBuffer, inputNote, onCommandEntered, cmdHistory);
-    const auto outputFrame = makeOutputFrame(outBuffers, scrollYPos, firstItemBox);
-    const auto topBarRenderer = makeTopBarRenderer(initialMessage);
-    const auto statusBarRenderer= makeStatusBarRenderer();
-
     constexpr int MaxInputFieldHeight = 6;
     constexpr int StartInputFieldHeight = 4;
+    constexpr int BarHeight = 1;
+    constexpr int FrameBorderWidth = 2;
+    constexpr int ScrollIndicatorWidth = 1;
+    // the output text gets what the bars, the input field, the frame border and the scroll indicator leave of the screen
+    OutputView outputView{
+        .reservedColumns = FrameBorderWidth + ScrollIndicatorWidth,
+        .reservedRows = 2 * BarHeight + StartInputFieldHeight + FrameBorderWidth
+    };
+
+    const auto inputField = makeCommandInput(inputBuffer, inputNote, onCommandEntered, cmdHistory, cmdCompletionAction);
+    const auto outputFrame = makeOutputFrame(outBuffers, outputView);
+    const auto topBarRenderer = makeTopBarRenderer(initialMessage);
+    // a redraw is asked for only when the status line changes, once per sample at most
+    constexpr std::chrono::milliseconds StatusSampleInterval{1000};
+    const ProcessMonitor monitor{execControl, StatusSampleInterval, [&screen] {
+        screen.PostEvent(ftxui::Event::Custom);
+    }};
+    const auto statusBarRenderer= makeStatusBarRenderer(monitor);
 
-    ftxui::Box outputFrameRenderedBox;
-    const auto outputFrameFlexBox = outputFrame | ftxui::border |  ftxui::flex |ftxui::reflect(outputFrameRenderedBox);
+    const auto outputFrameFlexBox = outputFrame | ftxui::border |  ftxui::flex;
 
 
     auto mainContainer = ftxui::Container::Vertical({
@@ -190,13 +323,30 @@ auto createAndRunTextUserInterface(const std::string& inputNote, OutputBuffers&
 
     mainContainer->SetActiveChild(mainContainer->ChildAt(2));
 
-    int minFirstItemYValue = 0;
-    auto mainContainerEventCather = ftxui::CatchEvent(mainContainer, [&scrollYPos, &outputFrameRenderedBox, &firstItemBox, &minFirstItemYValue]([[maybe_unused]] const ftxui::Event& event) {
-        minFirstItemYValue = std::min(minFirstItemYValue, firstItemBox.y_max);
+    auto mainContainerEventCather = ftxui::CatchEvent(mainContainer, [&screen, &execControl, &outputView]([[maybe_unused]] const ftxui::Event& event) {
+        if(event == ftxui::Event::CtrlC) {
+            if(execControl.IsRunning()) {
+                execControl.RequestCancel();
+            } else {
+                screen.Exit();
+            }
+            return true;
+        }
+        if(event == ftxui::Event::CtrlD and execControl.IsRunning() and not execControl.IsKeystrokeInput()) {
+            execControl.CloseInput();
+            return true;
+        }
 
-        scrollYPos = calculateScrollPosition(minFirstItemYValue, outputFrameRenderedBox, scrollYPos, event);
+        // the text area of the output frame is the terminal of commands running in a pseudo-terminal
+        execControl.SetOutputSize(outputTextSize(outputView));
 
-        return false;
+        // a command in a pseudo-terminal gets the keys as they are typed, Ctrl+D included. Pages and the wheel still scroll the output
+        if(execControl.IsKeystrokeInput() and isForwardedKey(event)) {
+            execControl.SendInput(event.input());
+            return true;
+        }
+
+        return scrollOutput(outputView, event);
 
     });
 
@@ -206,15 +356,21 @@ auto createAndRunTextUserInterface(const std::string& inputNote, OutputBuffers&
         screen.PostEvent(ftxui::Event::Custom);
         looper.RunOnceBlocking();
     });
+    // while a command waits, keys keep being handled, so what is typed reaches it and Ctrl+C can stop it
+    execControl.SetOnIdle([&looper]() {
+        looper.RunOnce();
+    });
 
     looper.Run();
+    execControl.SetOnIdle({});
 }
 
 auto runTextUserInterface(OutputBuffers& outBuffers, const CommandProcessingAction& cmdProcessingAction,
-                          const ReplDefinition& definition, CommandHistory& cmdHistory) -> void {
+                          const CommandCompletionAction& cmdCompletionAction,
+                          const ReplDefinition& definition, CommandHistory& cmdHistory, ExecutionControl& execControl) -> void {
 
     createAndRunTextUserInterface(definition.inputNote, outBuffers, definition.prompt, cmdProcessingAction,
-                                  definition.initialMessage, cmdHistory);
+                                  cmdCompletionAction, definition.initialMessage, cmdHistory, execControl);
 }
 
 } // namespace replmk
\ No newline at end of file
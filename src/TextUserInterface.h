@@ -12,18 +12,34 @@
 
 #include "Core.h"
 #include "OutputBuffers.h"
+#include "OutputLayout.h"
 #include "CommandHistory.h"
+#include "ExecutionControl.h"
 
 namespace replmk {
 
 using OnCommandEnterEvent = std::function<void(const std::string&)>;
 
+// what the output frame shows, kept from one frame to the next
+struct OutputView {
+    OutputLayout layout{};
+    OutputScroll scroll{};
+    // of the screen, taken by everything around the output text
+    int reservedColumns{0};
+    int reservedRows{0};
+};
+
 auto runTextUserInterface(OutputBuffers& outBuffers, const CommandProcessingAction& cmdProcessingAction,
-                         const ReplDefinition& definition, CommandHistory& cmdHistory) -> void;
+                         const CommandCompletionAction& cmdCompletionAction,
+                         const ReplDefinition& definition, CommandHistory& cmdHistory, ExecutionControl& execControl) -> void;
+
+auto makeCommandInput(std::string& inputBuffer, const std::string& inputNote, const OnCommandEnterEvent& onCommandEntered, CommandHistory& cmdHistory,
+                      const CommandCompletionAction& cmdCompletionAction = nullptr) -> ftxui::Component;
 
-auto makeCommandInput(std::string& inputBuffer, const std::string& inputNote, const OnCommandEnterEvent& onCommandEntered, CommandHistory& cmdHistory) -> ftxui::Component;
+auto makeOutputFrame(const OutputBuffers& outBuffers, OutputView& view) -> ftxui::Component;
 
-auto makeOutputFrame(const OutputBuffers& outBuffers, const float& scrollYPos, ftxui::Box& firstItemBox) -> ftxui::Component;
+// the columns and rows of the screen the output text gets
+auto outputTextSize(const OutputView& view) -> TerminalSize;
 
 auto hasNavigateContent(const ftxui::Event& event, CommandHistory& cmdHistory) -> std::optional<std::string>;
 
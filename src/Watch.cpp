@@ -0,0 +1,166 @@
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+#include <format>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+#include <poll.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include "Watch.h"
+
+namespace replmk {
+
+namespace {
+
+// changed lines listed by number in the header, past these only their count is given
+constexpr size_t MaxListedChangedLines = 10;
+
+// a trailing newline ends the last line instead of starting an empty one
+auto splitLines(std::string_view text) -> std::vector<std::string_view> {
+    std::vector<std::string_view> lines;
+    while (not text.empty()) {
+        const auto lineEnd = text.find('\n');
+        lines.push_back(text.substr(0, lineEnd));
+        text.remove_prefix(lineEnd == std::string_view::npos ? text.size() : lineEnd + 1);
+    }
+    return lines;
+}
+
+auto toTimespec(std::chrono::duration<double> duration) -> timespec {
+    const auto nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(duration);
+    const auto seconds = std::chrono::duration_cast<std::chrono::seconds>(nanoseconds);
+    return timespec{.tv_sec = static_cast<time_t>(seconds.count()), .tv_nsec = static_cast<long>((nanoseconds - seconds).count())};
+}
+
+// true once the timer fired, false when cancelled while waiting for it
+auto waitForTick(int timerFd, const ExecutionControl& control) -> bool {
+    pollfd timerPoll{.fd = timerFd, .events = POLLIN, .revents = 0};
+    while (not control.IsCancelRequested()) {
+        // between runs, the interface takes its turn and reads Ctrl+C
+        int ready = 0;
+        control.WaitWithIdle([&timerPoll, &ready](std::chrono::milliseconds interval) {
+            ready = ::poll(&timerPoll, 1, static_cast<int>(interval.count()));
+            return ready != 0;
+        });
+        if (ready <= 0) {
+            continue;
+        }
+        // the count of expirations is read, and dropped, so missed ticks don't pile up
+        uint64_t expirations = 0;
+        if (::read(timerFd, &expirations, sizeof(expirations)) == sizeof(expirations)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+auto formatTimeOfDay(std::chrono::system_clock::time_point timePoint) -> std::string {
+    const auto timeValue = std::chrono::system_clock::to_time_t(timePoint);
+    std::tm localTime{};
+    localtime_r(&timeValue, &localTime);
+    return std::format("{:02}:{:02}:{:02}", localTime.tm_hour, localTime.tm_min, localTime.tm_sec);
+}
+
+} // namespace
+
+auto parseWatchArguments(const std::vector<std::string>& args) -> std::expected<WatchArguments, std::string> {
+    WatchArguments watch;
+    auto commandStart = args.begin();
+    if (commandStart != args.end() and *commandStart == "-n") {
+        const auto& intervalArg = std::next(commandStart) == args.end() ? std::string{} : *std::next(commandStart);
+        double seconds = 0;
+        const auto* const argEnd = intervalArg.data() + intervalArg.size(); //NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+        const auto [ptr, errorCode] = std::from_chars(intervalArg.data(), argEnd, seconds);
+        if (intervalArg.empty() or errorCode != std::errc{} or ptr != argEnd or seconds < MinimumWatchInterval.count()) {
+            return std::unexpected{std::format("-n expects a number of seconds, at least {}", MinimumWatchInterval.count())};
+        }
+        watch.interval = std::chrono::duration<double>{seconds};
+        commandStart = std::next(commandStart, 2);
+    }
+
+    if (commandStart == args.end()) {
+        return std::unexpected{"missing the command to watch"};
+    }
+    watch.commandWords.assign(commandStart, args.end());
+    return watch;
+}
+
+auto diffLines(std::string_view previous, std::string_view current) -> LineChanges {
+    const auto previousLines = splitLines(previous);
+    const auto currentLines = splitLines(current);
+
+    LineChanges changes;
+    for (size_t index = 0; index < currentLines.size(); index++) {
+        if (index >= previousLines.size() or previousLines[index] != currentLines[index]) {
+            changes.changedLines.push_back(index);
+        }
+    }
+    changes.removedLines = previousLines.size() > currentLines.size() ? previousLines.size() - currentLines.size() : 0;
+    return changes;
+}
+
+auto runWatch(std::chrono::duration<double> interval, const ExecutionControl& control, const WatchTask& task) -> std::expected<size_t, std::string> {
+    const int timerFd = ::timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+    if (timerFd < 0) {
+        return std::unexpected{std::format("could not create a timer: {}", std::generic_category().message(errno))};
+    }
+
+    // a periodic timer keeps the schedule steady however long each run takes
+    const itimerspec schedule{.it_interval = toTimespec(interval), .it_value = toTimespec(interval)};
+    if (::timerfd_settime(timerFd, 0, &schedule, nullptr) != 0) {
+        const auto error = std::generic_category().message(errno);
+        ::close(timerFd);
+        return std::unexpected{std::format("could not set the timer: {}", error)};
+    }
+
+    size_t runs = 0;
+    while (true) {
+        task(++runs);
+        if (control.IsCancelRequested() or not waitForTick(timerFd, control)) {
+            break;
+        }
+    }
+
+    ::close(timerFd);
+    return runs;
+}
+
+auto formatWatchHeader(const WatchArguments& watch, size_t run, const LineChanges& changes,
+                       std::chrono::system_clock::time_point runTime) -> std::string {
+    std::string commandLine;
+    for (const auto& word : watch.commandWords) {
+        commandLine.append(commandLine.empty() ? "" : " ").append(word);
+    }
+    auto header = std::format("Every {:.1f}s: {}  run {} at {}", watch.interval.count(), commandLine, run, formatTimeOfDay(runTime));
+    if (run == 1) {
+        return header + "\n";
+    }
+    if (changes.IsEmpty()) {
+        return header + ", no changes\n";
+    }
+
+    if (not changes.changedLines.empty()) {
+        header.append(std::format(", {} changed line{}", changes.changedLines.size(), changes.changedLines.size() == 1 ? "" : "s"));
+        if (changes.changedLines.size() <= MaxListedChangedLines) {
+            std::string lineNumbers;
+            for (const auto index : changes.changedLines) {
+                lineNumbers.append(lineNumbers.empty() ? "" : ", ").append(std::to_string(index + 1));
+            }
+            header.append(std::format(" ({})", lineNumbers));
+        }
+    }
+    if (changes.removedLines > 0) {
+        header.append(std::format(", {} line{} fewer", changes.removedLines, changes.removedLines == 1 ? "" : "s"));
+    }
+    return header + "\n";
+}
+
+} // namespace replmk
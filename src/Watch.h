@@ -0,0 +1,54 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <expected>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "ExecutionControl.h"
+
+namespace replmk {
+
+constexpr auto DefaultWatchInterval = std::chrono::duration<double>{2};
+constexpr auto MinimumWatchInterval = std::chrono::duration<double>{0.1};
+
+// what follows 'watch' in a command line: [-n seconds] command [args...]
+struct WatchArguments {
+    std::chrono::duration<double> interval{DefaultWatchInterval};
+    std::vector<std::string> commandWords{};
+};
+
+[[nodiscard]] auto parseWatchArguments(const std::vector<std::string>& args) -> std::expected<WatchArguments, std::string>;
+
+// lines of the current output that are not the same line of the previous one, compared line by line like 'watch -d'
+struct LineChanges {
+    // zero based, in the current output
+    std::vector<size_t> changedLines{};
+    // lines the previous output had past the end of the current one
+    size_t removedLines{0};
+
+    [[nodiscard]] auto IsEmpty() const -> bool {
+        return changedLines.empty() and removedLines == 0;
+    }
+};
+
+[[nodiscard]] auto diffLines(std::string_view previous, std::string_view current) -> LineChanges;
+
+// runs on the calling thread, once per tick
+using WatchTask = std::function<void(size_t run)>;
+
+/**
+ * Runs task right away and then on every tick of a timer firing every interval, until control asks for cancellation.
+ * Ticks missed while task runs are dropped, a slow command runs again as soon as it finishes instead of catching up.
+ * Returns how many times task ran, or why the timer could not be set
+ */
+auto runWatch(std::chrono::duration<double> interval, const ExecutionControl& control, const WatchTask& task) -> std::expected<size_t, std::string>;
+
+// first line of the output entry of a watched command, with what changed since the previous run
+[[nodiscard]] auto formatWatchHeader(const WatchArguments& watch, size_t run, const LineChanges& changes,
+                                     std::chrono::system_clock::time_point runTime) -> std::string;
+
+} // namespace replmk
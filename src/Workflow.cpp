@@ -0,0 +1,262 @@
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <format>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "Workflow.h"
+
+namespace replmk {
+
+namespace {
+
+enum class StepProgress: uint8_t {
+    NotStarted,
+    Running,
+    Succeeded,
+    Failed
+};
+
+// why a step never ran, the first dependency that didn't succeed or else why the workflow stopped
+auto skipReason(const Workflow& workflow, const std::vector<size_t>& stepDependencies, const std::vector<StepProgress>& progress,
+                bool cancelled) -> std::string {
+    for (const auto dependency : stepDependencies) {
+        if (progress.at(dependency) == StepProgress::Failed) {
+            return std::format("not run, '{}' failed\n", workflow.steps.at(dependency).name);
+        }
+    }
+    for (const auto dependency : stepDependencies) {
+        if (progress.at(dependency) == StepProgress::NotStarted) {
+            return std::format("not run, '{}' did not run\n", workflow.steps.at(dependency).name);
+        }
+    }
+    return cancelled ? "not run, the workflow was cancelled\n" : "not run, the workflow stopped after a failure\n";
+}
+
+} // namespace
+
+auto toWorkflowPolicy(std::string_view policyName) -> std::optional<WorkflowPolicy> {
+    if (policyName == "fail_fast") {
+        return WorkflowPolicy::FailFast;
+    }
+    if (policyName == "keep_going") {
+        return WorkflowPolicy::KeepGoing;
+    }
+    return std::nullopt;
+}
+
+auto workflowPolicyName(WorkflowPolicy policy) -> std::string_view {
+    switch (policy) {
+    case WorkflowPolicy::KeepGoing:
+        return "keep_going";
+    case WorkflowPolicy::FailFast:
+    default:
+        return "fail_fast";
+    }
+}
+
+auto resolveWorkflowDependencies(const Workflow& workflow) -> std::expected<std::vector<std::vector<size_t>>, std::string> {
+    const auto& steps = workflow.steps;
+    if (steps.empty()) {
+        return std::unexpected{std::format("workflow '{}' has no steps", workflow.name)};
+    }
+
+    std::map<std::string_view, size_t> indices;
+    for (size_t index = 0; index < steps.size(); index++) {
+        if (not indices.emplace(steps[index].name, index).second) {
+            return std::unexpected{std::format("workflow '{}' has more than one step named '{}'", workflow.name, steps[index].name)};
+        }
+    }
+
+    std::vector<std::vector<size_t>> dependencies(steps.size());
+    for (size_t index = 0; index < steps.size(); index++) {
+        for (const auto& dependencyName : steps[index].dependsOn) {
+            const auto found = indices.find(dependencyName);
+            if (found == indices.end()) {
+                return std::unexpected{std::format("step '{}' of workflow '{}' depends on '{}', which is not one of its steps",
+                                                   steps[index].name, workflow.name, dependencyName)};
+            }
+            if (std::ranges::find(dependencies[index], found->second) == dependencies[index].end()) {
+                dependencies[index].push_back(found->second);
+            }
+        }
+    }
+
+    // steps left once every step that can run in some order is taken out are in, or after, a cycle
+    std::vector<size_t> pending(steps.size());
+    std::vector<std::vector<size_t>> dependents(steps.size());
+    for (size_t index = 0; index < steps.size(); index++) {
+        pending[index] = dependencies[index].size();
+        for (const auto dependency : dependencies[index]) {
+            dependents[dependency].push_back(index);
+        }
+    }
+
+    std::vector<size_t> ready;
+    for (size_t index = 0; index < steps.size(); index++) {
+        if (pending[index] == 0) {
+            ready.push_back(index);
+        }
+    }
+    size_t ordered = 0;
+    while (not ready.empty()) {
+        const auto index = ready.back();
+        ready.pop_back();
+        ordered++;
+        for (const auto dependent : dependents[index]) {
+            if (--pending[dependent] == 0) {
+                ready.push_back(dependent);
+            }
+        }
+    }
+
+    if (ordered != steps.size()) {
+        std::string cycleSteps;
+        for (size_t index = 0; index < steps.size(); index++) {
+            if (pending[index] > 0) {
+                cycleSteps.append(cycleSteps.empty() ? "" : ", ").append(steps[index].name);
+            }
+        }
+        return std::unexpected{std::format("the steps of workflow '{}' depend on each other in a cycle: {}", workflow.name, cycleSteps)};
+    }
+    return dependencies;
+}
+
+auto runWorkflow(const Workflow& workflow, const std::vector<std::vector<size_t>>& dependencies, const WorkflowStepTask& task,
+                 const ExecutionControl& control, const OnWorkflowStepDone& onStepDone) -> WorkflowSummary {
+    const auto startTime = std::chrono::steady_clock::now();
+    const auto stepCount = workflow.steps.size();
+    WorkflowSummary summary{.succeeded = 0, .failed = 0, .skipped = 0, .maxParallel = 0, .elapsed = {}};
+
+    std::vector<StepProgress> progress(stepCount, StepProgress::NotStarted);
+    std::vector<size_t> pending(stepCount);
+    std::vector<std::vector<size_t>> dependents(stepCount);
+    std::deque<size_t> ready;
+    for (size_t index = 0; index < stepCount; index++) {
+        pending[index] = dependencies.at(index).size();
+        for (const auto dependency : dependencies.at(index)) {
+            dependents[dependency].push_back(index);
+        }
+        if (pending[index] == 0) {
+            ready.push_back(index);
+        }
+    }
+
+    std::mutex resultsMutex;
+    std::condition_variable resultsCondition;
+    std::vector<WorkflowStepResult> finished;
+
+    const auto runStep = [&](size_t index) {
+        WorkflowStepResult result{.index = index, .status = WorkflowStepStatus::Failed, .stdOut = {}, .stdErr = {}, .elapsed = {}};
+        const auto stepStartTime = std::chrono::steady_clock::now();
+        const bool succeeded = task(index, CommandOutputCallbacks{
+            .onStdOut = [&result](std::string_view chunk) {
+                result.stdOut.append(chunk);
+            },
+            .onStdErr = [&result](std::string_view chunk) {
+                result.stdErr.append(chunk);
+            }
+        });
+        result.status = succeeded ? WorkflowStepStatus::Succeeded : WorkflowStepStatus::Failed;
+        result.elapsed = std::chrono::steady_clock::now() - stepStartTime;
+
+        const std::scoped_lock lock{resultsMutex};
+        finished.push_back(std::move(result));
+        resultsCondition.notify_one();
+    };
+
+    // the scheduling happens here, on the calling thread, steps only run their command and report back
+    std::vector<std::jthread> threads;
+    size_t running = 0;
+    bool stopStarting = false;
+    while (true) {
+        stopStarting = stopStarting or control.IsCancelRequested();
+        while (not stopStarting and not ready.empty()) {
+            const auto index = ready.front();
+            ready.pop_front();
+            progress[index] = StepProgress::Running;
+            threads.emplace_back(runStep, index);
+            running++;
+        }
+        summary.maxParallel = std::max(summary.maxParallel, running);
+        if (running == 0) {
+            break;
+        }
+
+        // while no step finishes, the interface handles its events, Ctrl+C included
+        std::vector<WorkflowStepResult> done;
+        control.WaitWithIdle([&](std::chrono::milliseconds interval) {
+            std::unique_lock lock{resultsMutex};
+            const bool handedOver = resultsCondition.wait_for(lock, interval, [&finished]() {
+                return not finished.empty();
+            });
+            done = std::exchange(finished, {});
+            return handedOver;
+        });
+
+        for (const auto& result : done) {
+            running--;
+            if (result.status == WorkflowStepStatus::Succeeded) {
+                summary.succeeded++;
+                progress[result.index] = StepProgress::Succeeded;
+                for (const auto dependent : dependents[result.index]) {
+                    if (--pending[dependent] == 0) {
+                        ready.push_back(dependent);
+                    }
+                }
+            } else {
+                summary.failed++;
+                progress[result.index] = StepProgress::Failed;
+                stopStarting = stopStarting or workflow.policy == WorkflowPolicy::FailFast;
+            }
+            onStepDone(result);
+        }
+    }
+    threads.clear();
+
+    for (size_t index = 0; index < stepCount; index++) {
+        if (progress[index] != StepProgress::NotStarted) {
+            continue;
+        }
+        summary.skipped++;
+        onStepDone(WorkflowStepResult{
+            .index = index,
+            .status = WorkflowStepStatus::Skipped,
+            .stdOut = {},
+            .stdErr = skipReason(workflow, dependencies.at(index), progress, control.IsCancelRequested()),
+            .elapsed = {}
+        });
+    }
+
+    summary.elapsed = std::chrono::steady_clock::now() - startTime;
+    return summary;
+}
+
+auto formatWorkflowStepHeader(const WorkflowStep& step, const WorkflowStepResult& result) -> std::string {
+    switch (result.status) {
+    case WorkflowStepStatus::Succeeded:
+        return std::format("[ok {:.3f}s] {}: {}\n", result.elapsed.count(), step.name, step.commandLine);
+    case WorkflowStepStatus::Failed:
+        return std::format("[failed {:.3f}s] {}: {}\n", result.elapsed.count(), step.name, step.commandLine);
+    case WorkflowStepStatus::Skipped:
+    default:
+        return std::format("[skipped] {}: {}\n", step.name, step.commandLine);
+    }
+}
+
+auto formatWorkflowSummary(const Workflow& workflow, const WorkflowSummary& summary) -> std::string {
+    auto text = std::format("{}: {} succeeded, {} failed", workflow.name, summary.succeeded, summary.failed);
+    if (summary.skipped > 0) {
+        text.append(std::format(", {} skipped", summary.skipped));
+    }
+    text.append(std::format(" in {:.3f}s, up to {} at a time\n", summary.elapsed.count(), summary.maxParallel));
+    return text;
+}
+
+} // namespace replmk
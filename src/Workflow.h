@@ -0,0 +1,92 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <functional>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "ExecutionControl.h"
+#include "ProcessExecutor.h"
+
+namespace replmk {
+
+// what happens to the rest of a workflow once a step fails
+enum class WorkflowPolicy: uint8_t {
+    FailFast, // no other step starts, the ones running finish
+    KeepGoing // only the steps depending on the failed one are skipped
+};
+
+[[nodiscard]] auto toWorkflowPolicy(std::string_view policyName) -> std::optional<WorkflowPolicy>;
+
+[[nodiscard]] auto workflowPolicyName(WorkflowPolicy policy) -> std::string_view;
+
+struct WorkflowStep {
+    std::string name;
+    // a catalog command, or a pipeline of them, as it would be typed
+    std::string commandLine{};
+    std::vector<std::string> dependsOn{};
+};
+
+struct Workflow {
+    std::string name;
+    std::string description{};
+    WorkflowPolicy policy{WorkflowPolicy::FailFast};
+    std::vector<WorkflowStep> steps{};
+};
+
+using WorkflowCatalog = std::map<std::string, Workflow, std::less<>>;
+
+/**
+ * For every step, the indices of the steps it depends on.
+ * Fails when step names repeat, a dependency names no step or the dependencies go round in a cycle
+ */
+[[nodiscard]] auto resolveWorkflowDependencies(const Workflow& workflow) -> std::expected<std::vector<std::vector<size_t>>, std::string>;
+
+enum class WorkflowStepStatus: uint8_t {
+    Succeeded,
+    Failed,
+    Skipped
+};
+
+struct WorkflowStepResult {
+    size_t index{0};
+    WorkflowStepStatus status{WorkflowStepStatus::Skipped};
+    std::string stdOut{};
+    std::string stdErr{};
+    std::chrono::duration<double> elapsed{};
+};
+
+struct WorkflowSummary {
+    size_t succeeded{0};
+    size_t failed{0};
+    size_t skipped{0};
+    // most steps that were running at the same time
+    size_t maxParallel{0};
+    std::chrono::duration<double> elapsed{};
+};
+
+// runs on a thread of its own, with callbacks collecting the output of that step only
+using WorkflowStepTask = std::function<bool(size_t index, const CommandOutputCallbacks& callbacks)>;
+using OnWorkflowStepDone = std::function<void(const WorkflowStepResult& result)>;
+
+/**
+ * Runs the steps of a workflow, each one as soon as every step it depends on succeeded, so independent steps run in parallel.
+ * Results are handed to onStepDone on the calling thread as steps finish. Steps that never ran follow at the end, as
+ * skipped, with the reason in their stderr. Once control asks for cancellation no new step starts, and the executions still
+ * running stop themselves as they share it
+ */
+auto runWorkflow(const Workflow& workflow, const std::vector<std::vector<size_t>>& dependencies, const WorkflowStepTask& task,
+                 const ExecutionControl& control, const OnWorkflowStepDone& onStepDone) -> WorkflowSummary;
+
+// status and command line of a step, the prompt of its output entry
+[[nodiscard]] auto formatWorkflowStepHeader(const WorkflowStep& step, const WorkflowStepResult& result) -> std::string;
+
+[[nodiscard]] auto formatWorkflowSummary(const Workflow& workflow, const WorkflowSummary& summary) -> std::string;
+
+} // namespace replmk
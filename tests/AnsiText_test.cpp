@@ -0,0 +1,148 @@
+#include <doctest/doctest.h>
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../src/AnsiText.h"
+
+using namespace replmk;
+
+//NOLINTBEGIN(readability-function-cognitive-complexity,cppcoreguidelines-avoid-do-while)
+TEST_SUITE_BEGIN("AnsiText");
+
+namespace {
+auto Red() -> TextColor {
+    return TextColor{.kind = ColorKind::Palette, .index = 1};
+}
+
+auto Bold() -> uint8_t {
+    return static_cast<uint8_t>(TextAttribute::Bold);
+}
+}
+
+TEST_CASE("SGR parameters change the style") {
+    TextStyle style;
+    applySgr("1;31", style);
+    REQUIRE(style.Has(TextAttribute::Bold));
+    REQUIRE(style.foreground == Red());
+
+    applySgr("22;44", style);
+    REQUIRE_FALSE(style.Has(TextAttribute::Bold));
+    REQUIRE_EQ(style.background.index, 4);
+
+    applySgr("38;5;208;48;2;10;20;30", style);
+    REQUIRE(style.foreground.kind == ColorKind::Palette);
+    REQUIRE_EQ(style.foreground.index, 208);
+    const TextColor background{.kind = ColorKind::Rgb, .red = 10, .green = 20, .blue = 30};
+    REQUIRE(style.background == background);
+
+    // the colon forms, with and without the color space
+    applySgr("38:2::1:2:3;4:3", style);
+    const TextColor foreground{.kind = ColorKind::Rgb, .red = 1, .green = 2, .blue = 3};
+    REQUIRE(style.foreground == foreground);
+    REQUIRE(style.Has(TextAttribute::Underline));
+    applySgr("4:0;91", style);
+    REQUIRE_FALSE(style.Has(TextAttribute::Underline));
+    REQUIRE_EQ(style.foreground.index, 9);
+
+    // an empty parameter resets, like 0
+    applySgr("", style);
+    REQUIRE(style == TextStyle{});
+}
+
+TEST_CASE("Styles written as SGR parameters read back the same") {
+    TextStyle style;
+    applySgr("1;3;9;93;48;5;200", style);
+    TextStyle readBack;
+    applySgr(formatSgr(style), readBack);
+    REQUIRE(readBack == style);
+    REQUIRE_EQ(formatSgr(TextStyle{}), "0");
+}
+
+TEST_CASE("Escape sequences are taken out of the text, keeping its styles") {
+    AnsiTextParser parser;
+    std::string text;
+    std::vector<StyleSpan> spans;
+    parser.Feed("ok \x1b[1;31merror\x1b[0m done", text, spans);
+    REQUIRE_EQ(text, "ok error done");
+    REQUIRE_EQ(spans.size(), 2);
+    REQUIRE_EQ(spans[0].offset, 3);
+    REQUIRE(spans[0].style.foreground == Red());
+    REQUIRE_EQ(spans[0].style.attributes, Bold());
+    REQUIRE_EQ(spans[1].offset, 8);
+    REQUIRE(spans[1].style == TextStyle{});
+
+    // styles changed back before any text leave no span
+    parser.Feed("\x1b[32m\x1b[0m!", text, spans);
+    REQUIRE_EQ(text, "ok error done!");
+    REQUIRE_EQ(spans.size(), 2);
+}
+
+TEST_CASE("A sequence cut between chunks is finished by the next one") {
+    const std::string_view output = "plain \x1b[38;5;12mblue\x1b[0m \x1b]0;title\x07""end";
+    std::string whole;
+    std::vector<StyleSpan> wholeSpans;
+    AnsiTextParser{}.Feed(output, whole, wholeSpans);
+    REQUIRE_EQ(whole, "plain blue end");
+
+    for (size_t cut = 0; cut <= output.size(); cut++) {
+        AnsiTextParser parser;
+        std::string text;
+        std::vector<StyleSpan> spans;
+        parser.Feed(output.substr(0, cut), text, spans);
+        parser.Feed(output.substr(cut), text, spans);
+        REQUIRE_EQ(text, whole);
+        REQUIRE_EQ(spans.size(), wholeSpans.size());
+        REQUIRE_EQ(spans.front().offset, wholeSpans.front().offset);
+        REQUIRE(spans.front().style == wholeSpans.front().style);
+    }
+}
+
+TEST_CASE("Other sequences are dropped") {
+    AnsiTextParser parser;
+    std::string text;
+    std::vector<StyleSpan> spans;
+    // cursor movement, erasing, private modes, saving the cursor, a hyperlink and a character set
+    parser.Feed("a\x1b[2J\x1b[10;5Hb\x1b[?25l\x1b""7c\x1b]8;;https://example.com\x1b\\d\x1b]8;;\x1b\\\x1b(Be", text, spans);
+    REQUIRE_EQ(text, "abcde");
+    REQUIRE(spans.empty());
+
+    // a private sequence ending in m is not SGR
+    parser.Feed("\x1b[>4;2mf", text, spans);
+    REQUIRE(spans.empty());
+
+    // a sequence that never ends is given up on
+    parser.Feed("\x1b]" + std::string(5000, 'x') + "g", text, spans);
+    REQUIRE(text.ends_with("g"));
+    REQUIRE(text.size() < 5000);
+
+    // interrupted, the rest of the sequence is text, the style stays
+    parser.Feed("\x1b[1mh\x1b[3", text, spans);
+    parser.Interrupt();
+    parser.Feed("1mi", text, spans);
+    REQUIRE(text.ends_with("h1mi"));
+    REQUIRE_EQ(spans.back().style.attributes, Bold());
+}
+
+TEST_CASE("The pieces of a part of the text have the styles of the spans over it") {
+    const std::vector<StyleSpan> spans{
+        {.offset = 2, .style = TextStyle{.foreground = Red(), .background = {}, .attributes = 0}},
+        {.offset = 5, .style = TextStyle{}}
+    };
+    const auto pieces = styledPieces(spans, 0, 8);
+    REQUIRE_EQ(pieces.size(), 3);
+    REQUIRE_EQ(pieces[0].length, 2);
+    REQUIRE(pieces[1].style.foreground == Red());
+    REQUIRE_EQ(pieces[1].offset, 2);
+    REQUIRE_EQ(pieces[1].length, 3);
+    REQUIRE_EQ(pieces[2].offset, 5);
+
+    const auto inside = styledPieces(spans, 3, 1);
+    REQUIRE_EQ(inside.size(), 1);
+    REQUIRE(inside.front().style.foreground == Red());
+    REQUIRE_EQ(styledPieces({}, 4, 2).size(), 1);
+}
+
+TEST_SUITE_END();
+//NOLINTEND(readability-function-cognitive-complexity,cppcoreguidelines-avoid-do-while)
@@ -0,0 +1,171 @@
+#include <doctest/doctest.h>
+
+#include <string>
+#include <vector>
+
+#include "../src/ArgumentSchema.h"
+
+using namespace replmk;
+
+//NOLINTBEGIN(readability-function-cognitive-complexity,cppcoreguidelines-avoid-do-while,cppcoreguidelines-avoid-magic-numbers,readability-magic-numbers)
+TEST_SUITE_BEGIN("ArgumentSchema");
+
+namespace {
+auto MakeSpec(std::string name, ArgumentType argType, bool required = true) -> ArgumentSpec {
+    ArgumentSpec spec;
+    spec.name = std::move(name);
+    spec.argType = argType;
+    spec.required = required;
+    return spec;
+}
+
+auto MakeDeploySchema() -> ArgumentSchema {
+    auto envSpec = MakeSpec("env", ArgumentType::Enum);
+    envSpec.allowedValues = {"dev", "prod"};
+
+    auto replicasSpec = MakeSpec("replicas", ArgumentType::Integer, false);
+    replicasSpec.minValue = 1;
+    replicasSpec.maxValue = 10;
+
+    auto tagSpec = MakeSpec("tag", ArgumentType::String, false);
+    tagSpec.pattern = "v[0-9]+";
+
+    ArgumentSchema schema;
+    schema.arguments = {envSpec, replicasSpec, tagSpec};
+    for (auto& spec : schema.arguments) {
+        REQUIRE(compileArgumentSpec(spec));
+    }
+    return schema;
+}
+}
+
+TEST_CASE("toArgumentType converts valid strings") {
+    REQUIRE_EQ(toArgumentType("string"), ArgumentType::String);
+    REQUIRE_EQ(toArgumentType("int"), ArgumentType::Integer);
+    REQUIRE_EQ(toArgumentType("float"), ArgumentType::Float);
+    REQUIRE_EQ(toArgumentType("bool"), ArgumentType::Boolean);
+    REQUIRE_EQ(toArgumentType("enum"), ArgumentType::Enum);
+    REQUIRE_EQ(toArgumentType("nope"), ArgumentType::Unknown);
+}
+
+TEST_CASE("Empty schema accepts any arguments") {
+    const ArgumentSchema schema;
+    REQUIRE(validateArguments(schema, {}).has_value());
+    REQUIRE(validateArguments(schema, {"a", "b", "c"}).has_value());
+}
+
+TEST_CASE("Valid arguments pass validation") {
+    const auto schema = MakeDeploySchema();
+    REQUIRE(validateArguments(schema, {"dev"}).has_value());
+    REQUIRE(validateArguments(schema, {"prod", "3"}).has_value());
+    REQUIRE(validateArguments(schema, {"prod", "10", "v12"}).has_value());
+}
+
+TEST_CASE("Invalid arguments are rejected with a message") {
+    const auto schema = MakeDeploySchema();
+
+    const auto missing = validateArguments(schema, {});
+    REQUIRE_FALSE(missing.has_value());
+    REQUIRE_NE(missing.error().find("env"), std::string::npos);
+
+    const auto badEnum = validateArguments(schema, {"staging"});
+    REQUIRE_FALSE(badEnum.has_value());
+    REQUIRE_NE(badEnum.error().find("dev, prod"), std::string::npos);
+
+    REQUIRE_FALSE(validateArguments(schema, {"dev", "three"}).has_value());
+    REQUIRE_FALSE(validateArguments(schema, {"dev", "2.5"}).has_value());
+    REQUIRE_FALSE(validateArguments(schema, {"dev", "0"}).has_value());
+    REQUIRE_FALSE(validateArguments(schema, {"dev", "11"}).has_value());
+    REQUIRE_FALSE(validateArguments(schema, {"dev", "1", "latest"}).has_value());
+    REQUIRE_FALSE(validateArguments(schema, {"dev", "1", "v1", "extra"}).has_value());
+}
+
+TEST_CASE("Float arguments must be finite numbers within their range") {
+    auto ratioSpec = MakeSpec("ratio", ArgumentType::Float);
+    ratioSpec.minValue = 0;
+    ratioSpec.maxValue = 1;
+    ArgumentSchema schema;
+    schema.arguments = {ratioSpec};
+
+    REQUIRE(validateArguments(schema, {"0.5"}).has_value());
+    REQUIRE_FALSE(validateArguments(schema, {"1.5"}).has_value());
+    for (const auto* notFinite : {"nan", "NaN", "-nan", "inf", "-inf", "infinity"}) {
+        const auto rejected = validateArguments(schema, {notFinite});
+        REQUIRE_FALSE(rejected.has_value());
+        REQUIRE_NE(rejected.error().find("expects a value of type float"), std::string::npos);
+    }
+
+    // without bounds too
+    schema.arguments.front().minValue.reset();
+    schema.arguments.front().maxValue.reset();
+    REQUIRE(validateArguments(schema, {"-1e300"}).has_value());
+    REQUIRE_FALSE(validateArguments(schema, {"inf"}).has_value());
+}
+
+TEST_CASE("Variadic last argument consumes the remaining arguments") {
+    auto filesSpec = MakeSpec("files", ArgumentType::String);
+    filesSpec.variadic = true;
+    ArgumentSchema schema;
+    schema.arguments = {MakeSpec("verbose", ArgumentType::Boolean), filesSpec};
+
+    REQUIRE(isArgumentSchemaConsistent(schema));
+    REQUIRE(validateArguments(schema, {"yes", "a", "b", "c"}).has_value());
+    REQUIRE_FALSE(validateArguments(schema, {"yes"}).has_value());
+    REQUIRE_FALSE(validateArguments(schema, {"maybe", "a"}).has_value());
+}
+
+TEST_CASE("Inconsistent schemas are detected") {
+    ArgumentSchema requiredAfterOptional;
+    requiredAfterOptional.arguments = {MakeSpec("first", ArgumentType::String, false), MakeSpec("second", ArgumentType::String)};
+    REQUIRE_FALSE(isArgumentSchemaConsistent(requiredAfterOptional));
+
+    auto variadicSpec = MakeSpec("files", ArgumentType::String);
+    variadicSpec.variadic = true;
+    ArgumentSchema variadicNotLast;
+    variadicNotLast.arguments = {variadicSpec, MakeSpec("other", ArgumentType::String)};
+    REQUIRE_FALSE(isArgumentSchemaConsistent(variadicNotLast));
+}
+
+TEST_CASE("compileArgumentSpec rejects invalid specs") {
+    auto badPattern = MakeSpec("tag", ArgumentType::String);
+    badPattern.pattern = "([unclosed";
+    REQUIRE_FALSE(compileArgumentSpec(badPattern));
+
+    auto emptyEnum = MakeSpec("env", ArgumentType::Enum);
+    REQUIRE_FALSE(compileArgumentSpec(emptyEnum));
+
+    auto unknownType = MakeSpec("what", ArgumentType::Unknown);
+    REQUIRE_FALSE(compileArgumentSpec(unknownType));
+
+    auto patternedInteger = MakeSpec("replicas", ArgumentType::Integer);
+    patternedInteger.pattern = "[0-9]";
+    REQUIRE_FALSE(compileArgumentSpec(patternedInteger));
+}
+
+TEST_CASE("Usage and help are derived from the schema") {
+    const auto schema = MakeDeploySchema();
+    REQUIRE_EQ(formatArgumentsUsage(schema), "<env:dev|prod> [replicas:int] [tag]");
+
+    const auto help = formatArgumentsHelp(schema);
+    REQUIRE_NE(help.find("one of dev, prod"), std::string::npos);
+    REQUIRE_NE(help.find("between 1 and 10"), std::string::npos);
+    REQUIRE_NE(help.find("matching 'v[0-9]+'"), std::string::npos);
+}
+
+TEST_CASE("completeArgument proposes enum and boolean values") {
+    const auto schema = MakeDeploySchema();
+    const std::vector<std::string> allEnvironments{"dev", "prod"};
+    const std::vector<std::string> prodEnvironment{"prod"};
+    REQUIRE_EQ(completeArgument(schema, 0, ""), allEnvironments);
+    REQUIRE_EQ(completeArgument(schema, 0, "p"), prodEnvironment);
+    REQUIRE(completeArgument(schema, 1, "").empty());
+    REQUIRE(completeArgument(schema, 5, "").empty());
+
+    ArgumentSchema boolSchema;
+    boolSchema.arguments = {MakeSpec("force", ArgumentType::Boolean)};
+    const std::vector<std::string> trueValue{"true"};
+    REQUIRE_EQ(completeArgument(boolSchema, 0, "t"), trueValue);
+}
+
+TEST_SUITE_END();
+//NOLINTEND(readability-function-cognitive-complexity,cppcoreguidelines-avoid-do-while,cppcoreguidelines-avoid-magic-numbers,readability-magic-numbers)
@@ -0,0 +1,156 @@
+#include <doctest/doctest.h>
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "../src/BuiltinCommands.h"
+
+using namespace replmk;
+
+//NOLINTBEGIN(readability-function-cognitive-complexity,cppcoreguidelines-avoid-do-while)
+TEST_SUITE_BEGIN("BuiltinCommands");
+
+namespace {
+struct CapturedOutput {
+    std::string stdOut;
+    std::string stdErr;
+
+    auto callbacks() -> CommandOutputCallbacks {
+        return {
+            .onStdOut = [this](std::string_view chunk) {
+                stdOut.append(chunk);
+            },
+            .onStdErr = [this](std::string_view chunk) {
+                stdErr.append(chunk);
+            }
+        };
+    }
+};
+
+auto RunBuiltin(std::string_view name, const std::vector<std::string>& args, Session& session, CapturedOutput& output,
+                const BuiltinCommandRunner& runner = nullptr) -> bool {
+    return executeBuiltin(name, args, session, output.callbacks(), runner);
+}
+}
+
+TEST_CASE("Registry contains the native implementations") {
+    for (const auto* name : {"cd", "pwd", "set", "unset", "echo", "cat", "sleep", "time"}) {
+        REQUIRE(isBuiltinCommand(name));
+    }
+    REQUIRE_FALSE(isBuiltinCommand("rm"));
+
+    Session session;
+    CapturedOutput output;
+    REQUIRE_FALSE(RunBuiltin("rm", {}, session, output));
+    REQUIRE_FALSE(output.stdErr.empty());
+}
+
+TEST_CASE("echo writes arguments and expands session variables") {
+    Session session;
+    session.variables["NAME"] = "world";
+
+    CapturedOutput output;
+    REQUIRE(RunBuiltin("echo", {"hello", "$NAME", "${NAME}!", "$", "$1"}, session, output));
+    REQUIRE_EQ(output.stdOut, "hello world world! $ $1\n");
+}
+
+TEST_CASE("echo leaves literal arguments as they are") {
+    Session session;
+    session.variables["NAME"] = "world";
+
+    CapturedOutput output;
+    REQUIRE(executeBuiltin("echo", {"$NAME", "$NAME", "${NAME}"}, session, output.callbacks(), nullptr, {true, false, true}));
+    REQUIRE_EQ(output.stdOut, "$NAME world ${NAME}\n");
+}
+
+TEST_CASE("set and unset keep session variables") {
+    Session session;
+    CapturedOutput output;
+
+    REQUIRE(RunBuiltin("set", {"FIRST", "a", "b"}, session, output));
+    REQUIRE(RunBuiltin("set", {"SECOND=c"}, session, output));
+    REQUIRE_EQ(session.variables.at("FIRST"), "a b");
+    REQUIRE_EQ(session.variables.at("SECOND"), "c");
+
+    REQUIRE(RunBuiltin("set", {}, session, output));
+    REQUIRE_EQ(output.stdOut, "FIRST=a b\nSECOND=c\n");
+
+    REQUIRE(RunBuiltin("unset", {"FIRST"}, session, output));
+    REQUIRE_FALSE(session.variables.contains("FIRST"));
+
+    REQUIRE_FALSE(RunBuiltin("set", {"1BAD", "x"}, session, output));
+    REQUIRE_FALSE(RunBuiltin("unset", {}, session, output));
+}
+
+TEST_CASE("cd changes the session working directory") {
+    Session session;
+    CapturedOutput output;
+    const auto tempDir = std::filesystem::canonical(std::filesystem::temp_directory_path());
+
+    REQUIRE(RunBuiltin("cd", {tempDir.string()}, session, output));
+    REQUIRE_EQ(session.workingDirectory, tempDir);
+
+    REQUIRE(RunBuiltin("pwd", {}, session, output));
+    REQUIRE_EQ(output.stdOut, tempDir.string() + "\n");
+
+    REQUIRE(RunBuiltin("cd", {".."}, session, output));
+    REQUIRE_EQ(session.workingDirectory, tempDir.parent_path());
+
+    REQUIRE(RunBuiltin("cd", {"-"}, session, output));
+    REQUIRE_EQ(session.workingDirectory, tempDir);
+
+    REQUIRE_FALSE(RunBuiltin("cd", {"/does/not/exist"}, session, output));
+    REQUIRE_EQ(session.workingDirectory, tempDir);
+    REQUIRE_FALSE(output.stdErr.empty());
+}
+
+TEST_CASE("cat reads files relative to the session working directory") {
+    const auto tempDir = std::filesystem::temp_directory_path();
+    const auto filePath = tempDir / "replmk_builtin_cat_test.txt";
+    {
+        std::ofstream outFile(filePath);
+        outFile << "line one\nline two\n";
+    }
+
+    Session session;
+    session.workingDirectory = tempDir;
+    CapturedOutput output;
+
+    REQUIRE(RunBuiltin("cat", {"replmk_builtin_cat_test.txt"}, session, output));
+    REQUIRE_EQ(output.stdOut, "line one\nline two\n");
+
+    REQUIRE_FALSE(RunBuiltin("cat", {"replmk_builtin_cat_missing.txt"}, session, output));
+    REQUIRE_FALSE(output.stdErr.empty());
+
+    std::filesystem::remove(filePath);
+}
+
+TEST_CASE("sleep validates its argument") {
+    Session session;
+    CapturedOutput output;
+    REQUIRE(RunBuiltin("sleep", {"0.01"}, session, output));
+    REQUIRE_FALSE(RunBuiltin("sleep", {"soon"}, session, output));
+    REQUIRE_FALSE(RunBuiltin("sleep", {}, session, output));
+}
+
+TEST_CASE("time runs the nested command and reports the elapsed time") {
+    Session session;
+    CapturedOutput output;
+    std::vector<std::string> ranCommand;
+    const BuiltinCommandRunner runner = [&ranCommand](const std::vector<std::string>& cmdAndArgs) {
+        ranCommand = cmdAndArgs;
+        return true;
+    };
+
+    REQUIRE(RunBuiltin("time", {"list", "-l"}, session, output, runner));
+    REQUIRE_EQ(ranCommand.size(), 2);
+    REQUIRE_EQ(ranCommand.at(0), "list");
+    REQUIRE_NE(output.stdOut.find("real "), std::string::npos);
+
+    REQUIRE_FALSE(RunBuiltin("time", {}, session, output, runner));
+}
+
+TEST_SUITE_END();
+//NOLINTEND(readability-function-cognitive-complexity,cppcoreguidelines-avoid-do-while)
@@ -0,0 +1,131 @@
+#include <doctest/doctest.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "../src/Command.h"
+#include "../src/CommandCache.h"
+
+using namespace replmk;
+
+//NOLINTBEGIN(readability-function-cognitive-complexity,cppcoreguidelines-avoid-do-while)
+TEST_SUITE_BEGIN("CommandCache");
+
+namespace {
+auto MakeCachedCommand(std::string name, std::vector<std::string> dependsOnFiles) -> Command {
+    Command command{.cmdType = CommandType::Single, .name = std::move(name), .description = "cached", .exec = "ls"};
+    command.cache = CommandCachePolicy{.ttl = std::chrono::seconds{30}, .dependsOnFiles = std::move(dependsOnFiles)};
+    return command;
+}
+
+auto MakeCacheDirectory(const std::string& name) -> std::filesystem::path {
+    auto directory = std::filesystem::temp_directory_path() / (name + "_" + std::to_string(getpid()));
+    std::filesystem::remove_all(directory);
+    return directory;
+}
+}
+
+TEST_CASE("Cache ttls take an optional unit") {
+    REQUIRE_EQ(parseCacheTtl("30"), std::chrono::seconds{30});
+    REQUIRE_EQ(parseCacheTtl("30s"), std::chrono::seconds{30});
+    REQUIRE_EQ(parseCacheTtl("5m"), std::chrono::minutes{5});
+    REQUIRE_EQ(parseCacheTtl("2h"), std::chrono::hours{2});
+    REQUIRE_EQ(parseCacheTtl("1d"), std::chrono::hours{24});
+    for (const auto* wrong : {"", "0", "0s", "s", "-5", "5 m", "5w", "1.5h"}) {
+        REQUIRE_FALSE(parseCacheTtl(wrong).has_value());
+    }
+}
+
+TEST_CASE("Keys change with anything the output depends on") {
+    const auto directory = MakeCacheDirectory("replmk_cache_keys");
+    std::filesystem::create_directories(directory);
+    const auto dependency = directory / "kubeconfig";
+    std::ofstream{dependency} << "cluster: one\n";
+
+    const auto command = MakeCachedCommand("pods", {"kubeconfig"});
+    const std::vector<std::string> args{"-n", "prod"};
+    const std::map<std::string, std::string> variables{{"CONTEXT", "a"}};
+    const auto key = makeCommandCacheKey(command, args, directory, variables);
+    const auto sameKey = makeCommandCacheKey(command, args, directory, variables);
+    REQUIRE_EQ(key.text, sameKey.text);
+    REQUIRE_EQ(key.FileName(), sameKey.FileName());
+
+    const std::vector<std::string> otherArgs{"-n", "dev"};
+    const std::vector<std::string> joinedArgs{"-nprod"};
+    const std::map<std::string, std::string> otherVariables{{"CONTEXT", "b"}};
+    REQUIRE_NE(key.text, makeCommandCacheKey(command, otherArgs, directory, variables).text);
+    REQUIRE_NE(key.text, makeCommandCacheKey(command, joinedArgs, directory, variables).text);
+    REQUIRE_NE(key.text, makeCommandCacheKey(command, args, directory, otherVariables).text);
+    REQUIRE_NE(key.text, makeCommandCacheKey(command, args, "/", variables).text);
+    REQUIRE_NE(key.text, makeCommandCacheKey(command, args, directory, variables, {false, true}).text);
+
+    std::ofstream{dependency} << "cluster: two\n";
+    REQUIRE_NE(key.text, makeCommandCacheKey(command, args, directory, variables).text);
+
+    // and with the environment the REPL inherited
+    const auto beforeEnvironment = makeCommandCacheKey(command, args, directory, variables);
+    REQUIRE_EQ(setenv("REPLMK_CACHE_TEST_PROFILE", "one", 1), 0); //NOLINT(concurrency-mt-unsafe)
+    const auto profileOne = makeCommandCacheKey(command, args, directory, variables);
+    REQUIRE_EQ(setenv("REPLMK_CACHE_TEST_PROFILE", "two", 1), 0); //NOLINT(concurrency-mt-unsafe)
+    const auto profileTwo = makeCommandCacheKey(command, args, directory, variables);
+    REQUIRE_EQ(unsetenv("REPLMK_CACHE_TEST_PROFILE"), 0); //NOLINT(concurrency-mt-unsafe)
+    REQUIRE_NE(beforeEnvironment.text, profileOne.text);
+    REQUIRE_NE(profileOne.text, profileTwo.text);
+    REQUIRE_EQ(beforeEnvironment.text, makeCommandCacheKey(command, args, directory, variables).text);
+
+    // entries of a command share a prefix
+    const auto otherKey = makeCommandCacheKey(command, {}, directory, {});
+    REQUIRE_EQ(key.FileName().substr(0, 17), otherKey.FileName().substr(0, 17));
+    std::filesystem::remove_all(directory);
+}
+
+TEST_CASE("Stored output is found until it expires or is forgotten") {
+    const auto directory = MakeCacheDirectory("replmk_cache_entries");
+    CommandCache cache;
+    const auto pods = makeCommandCacheKey(MakeCachedCommand("pods", {}), {"prod"}, "/", {});
+    const auto nodes = makeCommandCacheKey(MakeCachedCommand("nodes", {}), {}, "/", {});
+
+    // off without a directory
+    REQUIRE_FALSE(cache.Store(pods, "out", "err"));
+    REQUIRE_FALSE(cache.Find(pods, std::chrono::seconds{30}).has_value());
+
+    cache.SetDirectory(directory);
+    REQUIRE_FALSE(cache.Find(pods, std::chrono::seconds{30}).has_value());
+    const std::string binaryOutput{"line\n\0with nul\n", 16};
+    REQUIRE(cache.Store(pods, binaryOutput, "warning\n"));
+    REQUIRE(cache.Store(nodes, "node-1\n", ""));
+
+    const auto found = cache.Find(pods, std::chrono::seconds{30});
+    REQUIRE(found.has_value());
+    REQUIRE_EQ(found->stdOut, binaryOutput);
+    REQUIRE_EQ(found->stdErr, "warning\n");
+    REQUIRE_LT(found->age, std::chrono::seconds{30});
+    REQUIRE_NE(formatCacheHit(MakeCachedCommand("pods", {}), found.value()).find("'refresh pods'"), std::string::npos);
+
+    // expired entries are removed
+    REQUIRE_FALSE(cache.Find(pods, std::chrono::seconds{0}).has_value());
+    REQUIRE_FALSE(std::filesystem::exists(directory / pods.FileName()));
+
+    REQUIRE(cache.Store(pods, "again\n", ""));
+    REQUIRE_EQ(cache.Forget("pods"), 1);
+    REQUIRE_FALSE(cache.Find(pods, std::chrono::seconds{30}).has_value());
+    REQUIRE(cache.Find(nodes, std::chrono::seconds{30}).has_value());
+    REQUIRE_EQ(cache.Forget(std::nullopt), 1);
+    REQUIRE(std::filesystem::is_empty(directory));
+
+    // a damaged entry is a miss
+    REQUIRE(cache.Store(nodes, "node-1\n", ""));
+    std::ofstream{directory / nodes.FileName(), std::ios::trunc} << "replmk-cache 1\n99\nshort";
+    REQUIRE_FALSE(cache.Find(nodes, std::chrono::seconds{30}).has_value());
+    std::filesystem::remove_all(directory);
+}
+
+TEST_SUITE_END();
+//NOLINTEND(readability-function-cognitive-complexity,cppcoreguidelines-avoid-do-while)
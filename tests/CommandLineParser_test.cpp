@@ -2,6 +2,12 @@
 
 #include <doctest/doctest.h>
 
+#include <cctype>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
 #include "../src/CommandLineParser.h"
 
 using namespace replmk;
@@ -92,6 +98,279 @@ TEST_CASE("invalid input (invalid escape)") {
     REQUIRE_FALSE(result.has_value());
 }
 
+TEST_CASE("all whitespace characters separate words") {
+    auto result = ParseCommandLine("cmd\targ1\narg2\varg3\farg4\rarg5  arg6");
+    REQUIRE(result.has_value());
+    REQUIRE_EQ(result.value().size(), 7);
+    REQUIRE_EQ(result.value().back(), "arg6");
+}
+
+TEST_CASE("empty quoted words are dropped") {
+    auto result = ParseCommandLine(R"(cmd "" '' a""b)");
+    REQUIRE(result.has_value());
+    const auto& args = result.value();
+    REQUIRE_EQ(args.size(), 2);
+    REQUIRE_EQ(args[1], "ab");
+}
+
+TEST_CASE("tokens are NUL terminated and reusable") {
+    CommandLineTokens tokens;
+    REQUIRE(tokens.Tokenize(R"(run "first arg" second)"));
+    REQUIRE_EQ(tokens.Tokens().size(), 3);
+    REQUIRE_EQ(tokens.Segments().size(), 1);
+    const auto words = tokens.SegmentWords(tokens.Segments().front());
+    REQUIRE_EQ(words.size(), 3);
+    REQUIRE_EQ(words[1], "first arg");
+    REQUIRE_EQ(std::strlen(words[1].data()), words[1].size());
+
+    REQUIRE_FALSE(tokens.Tokenize("broken 'line"));
+    REQUIRE(tokens.Tokens().empty());
+    REQUIRE(tokens.Segments().empty());
+
+    REQUIRE(tokens.Tokenize("again"));
+    REQUIRE_EQ(tokens.Tokens().size(), 1);
+    REQUIRE_EQ(tokens.Tokens().front(), "again");
+}
+
+TEST_CASE("words with a single quoted or escaped '$' are literal") {
+    CommandLineTokens tokens;
+    REQUIRE(tokens.Tokenize(R"(echo '$HOME' \$USER "$PATH" $SHELL 'a'$b "'$c'" ''; x '$y')"));
+    const auto words = tokens.Tokens();
+    REQUIRE_EQ(words.size(), 10);
+    REQUIRE_EQ(words[1], "$HOME");
+    REQUIRE(tokens.IsLiteralWord(1));
+    REQUIRE_EQ(words[2], "$USER");
+    REQUIRE(tokens.IsLiteralWord(2));
+    REQUIRE_FALSE(tokens.IsLiteralWord(3));
+    REQUIRE_FALSE(tokens.IsLiteralWord(4));
+    REQUIRE_EQ(words[5], "a$b");
+    REQUIRE_FALSE(tokens.IsLiteralWord(5));
+    REQUIRE_EQ(words[6], "'$c'");
+    REQUIRE_FALSE(tokens.IsLiteralWord(6));
+    REQUIRE_EQ(words[7], ";");
+    REQUIRE_FALSE(tokens.IsLiteralWord(8));
+    REQUIRE(tokens.IsLiteralWord(9));
+
+    REQUIRE(tokens.Tokenize("echo $HOME"));
+    REQUIRE_FALSE(tokens.IsLiteralWord(1));
+}
+
+TEST_CASE("operators split the line into segments") {
+    CommandLineTokens tokens;
+    REQUIRE(tokens.Tokenize(R"(build --fast&&deploy 'a && b' ; check || echo "x;y" a\;b c&d e\|f)"));
+
+    const auto segments = tokens.Segments();
+    REQUIRE_EQ(segments.size(), 4);
+
+    REQUIRE_EQ(segments[0].source, "build --fast");
+    REQUIRE_EQ(segments[0].followedBy, CommandOperator::AndThen);
+    REQUIRE_EQ(segments[1].source, "deploy 'a && b'");
+    REQUIRE_EQ(segments[1].followedBy, CommandOperator::Sequence);
+    REQUIRE_EQ(segments[2].source, "check");
+    REQUIRE_EQ(segments[2].followedBy, CommandOperator::OrElse);
+    REQUIRE_EQ(segments[3].followedBy, CommandOperator::None);
+
+    const auto deployWords = tokens.SegmentWords(segments[1]);
+    REQUIRE_EQ(deployWords.size(), 2);
+    REQUIRE_EQ(deployWords[1], "a && b");
+
+    // quoted, escaped and single '&' characters are not operators
+    const auto echoWords = tokens.SegmentWords(segments[3]);
+    REQUIRE_EQ(echoWords.size(), 5);
+    REQUIRE_EQ(echoWords[1], "x;y");
+    REQUIRE_EQ(echoWords[2], "a;b");
+    REQUIRE_EQ(echoWords[3], "c&d");
+    REQUIRE_EQ(echoWords[4], "e|f");
+
+    // operators are kept as words of their own
+    auto result = ParseCommandLine("a && b");
+    REQUIRE(result.has_value());
+    REQUIRE_EQ(result.value().size(), 3);
+    REQUIRE_EQ(result.value()[1], "&&");
+}
+
+TEST_CASE("single pipes join commands into pipelines") {
+    CommandLineTokens tokens;
+    REQUIRE(tokens.Tokenize("list -a|filter x | count || echo none"));
+
+    const auto segments = tokens.Segments();
+    REQUIRE_EQ(segments.size(), 4);
+    REQUIRE_EQ(segments[0].source, "list -a");
+    REQUIRE_EQ(segments[0].followedBy, CommandOperator::Pipe);
+    REQUIRE_EQ(segments[1].source, "filter x");
+    REQUIRE_EQ(segments[1].followedBy, CommandOperator::Pipe);
+    REQUIRE_EQ(segments[2].followedBy, CommandOperator::OrElse);
+
+    REQUIRE_FALSE(tokens.Tokenize("list |"));
+    REQUIRE_FALSE(tokens.Tokenize("| list"));
+}
+
+TEST_CASE("operators need a command on both sides") {
+    CommandLineTokens tokens;
+    REQUIRE(tokens.Tokenize("a;"));
+    REQUIRE_EQ(tokens.Segments().size(), 1);
+
+    REQUIRE_FALSE(tokens.Tokenize(";"));
+    REQUIRE_FALSE(tokens.Tokenize("&& a"));
+    REQUIRE_FALSE(tokens.Tokenize("a &&"));
+    REQUIRE_FALSE(tokens.Tokenize("a || ; b"));
+    REQUIRE_FALSE(tokens.Tokenize("a ;; b"));
+}
+
+TEST_CASE("redirections end the words of a command") {
+    CommandLineTokens tokens;
+    REQUIRE(tokens.Tokenize(R"(dump --all > out.txt 2>>"err log" | x ; a2>b && c '>' d\>e)"));
+    // the pipe after a redirection is still parsed, rejecting it is up to the caller
+    const auto segments = tokens.Segments();
+    REQUIRE_EQ(segments.size(), 4);
+
+    REQUIRE_EQ(segments[0].source, R"(dump --all > out.txt 2>>"err log")");
+    REQUIRE_EQ(tokens.SegmentWords(segments[0]).size(), 2);
+    REQUIRE_EQ(segments[0].stdOutRedirection.target, "out.txt");
+    REQUIRE_FALSE(segments[0].stdOutRedirection.append);
+    REQUIRE_EQ(segments[0].stdErrRedirection.target, "err log");
+    REQUIRE(segments[0].stdErrRedirection.append);
+
+    REQUIRE_FALSE(segments[1].stdOutRedirection.IsSet());
+
+    // 'a2' is a word of its own, only a lone 2 names stderr
+    const auto aWords = tokens.SegmentWords(segments[2]);
+    REQUIRE_EQ(aWords.size(), 1);
+    REQUIRE_EQ(aWords[0], "a2");
+    REQUIRE_EQ(segments[2].stdOutRedirection.target, "b");
+
+    // quoted and escaped '>' are regular characters
+    const auto cWords = tokens.SegmentWords(segments[3]);
+    REQUIRE_EQ(cWords.size(), 3);
+    REQUIRE_EQ(cWords[1], ">");
+    REQUIRE_EQ(cWords[2], "d>e");
+    REQUIRE_FALSE(segments[3].stdOutRedirection.IsSet());
+
+    // redirections are kept as words of their own
+    auto result = ParseCommandLine("a 2> b");
+    REQUIRE(result.has_value());
+    REQUIRE_EQ(result.value().size(), 3);
+    REQUIRE_EQ(result.value()[1], "2>");
+}
+
+TEST_CASE("redirections need a single target at the end of the command") {
+    CommandLineTokens tokens;
+    REQUIRE_FALSE(tokens.Tokenize("a >"));
+    REQUIRE_FALSE(tokens.Tokenize("a > ; b"));
+    REQUIRE_FALSE(tokens.Tokenize("> out"));
+    REQUIRE_FALSE(tokens.Tokenize("a > out more"));
+    REQUIRE_FALSE(tokens.Tokenize("a > one > two"));
+    REQUIRE_FALSE(tokens.Tokenize("a >>> out"));
+    REQUIRE(tokens.Tokenize("a > out 2> err"));
+    REQUIRE(tokens.Tokenize("a >out"));
+    REQUIRE_EQ(tokens.Segments().front().stdOutRedirection.target, "out");
+}
+
+TEST_CASE("a trailing '&' runs the line in the background") {
+    CommandLineTokens tokens;
+    REQUIRE(tokens.Tokenize("build --all && test > log &  "));
+    REQUIRE(tokens.IsBackground());
+    const auto segments = tokens.Segments();
+    REQUIRE_EQ(segments.size(), 2);
+    REQUIRE_EQ(segments[1].source, "test > log");
+    REQUIRE_EQ(segments[1].stdOutRedirection.target, "log");
+    REQUIRE_EQ(tokens.Tokens().back(), "&");
+
+    REQUIRE(tokens.Tokenize("sleep 1&"));
+    REQUIRE(tokens.IsBackground());
+    REQUIRE_EQ(tokens.SegmentWords(tokens.Segments().front()).back(), "1");
+
+    // anywhere else it is a regular character
+    REQUIRE(tokens.Tokenize("echo a&b '&' \\&"));
+    REQUIRE_FALSE(tokens.IsBackground());
+    REQUIRE_EQ(tokens.Tokens().size(), 4);
+
+    REQUIRE_FALSE(tokens.Tokenize("&"));
+    REQUIRE_FALSE(tokens.Tokenize("a; &"));
+    REQUIRE_FALSE(tokens.Tokenize("a > &"));
+    REQUIRE(tokens.Tokenize("a & b"));
+    REQUIRE_FALSE(tokens.IsBackground());
+}
+
+TEST_CASE("long lines with quotes around block boundaries") {
+    // a pasted JSON payload, longer than the inline arena and crossing many SIMD blocks
+    std::string payload = "{";
+    for (int i = 0; i < 200; i++) {
+        payload.append("\"key" + std::to_string(i) + "\": \"value with spaces\", ");
+    }
+    payload.append("\"end\": true}");
+
+    const std::string line = "post '" + payload + "' --verbose";
+    auto result = ParseCommandLine(line);
+    REQUIRE(result.has_value());
+    const auto& args = result.value();
+    REQUIRE_EQ(args.size(), 3);
+    REQUIRE_EQ(args[1], payload);
+    REQUIRE_EQ(args[2], "--verbose");
+}
+
+namespace {
+// the original char by char parser, kept as the reference for the tokenizer
+auto ReferenceParseCommandLine(const std::string& input) -> std::optional<std::vector<std::string>> {
+    std::vector<std::string> cmdAndArgs;
+    std::string current;
+    bool inSingle = false;
+    bool inDouble = false;
+    bool escape = false;
+
+    for (char inChar : input) {
+        if (escape) {
+            current += inChar;
+            escape = false;
+        } else if (inChar == '\\') {
+            escape = true;
+        } else if (inChar == '\'' && !inDouble) {
+            inSingle = !inSingle;
+        } else if (inChar == '"' && !inSingle) {
+            inDouble = !inDouble;
+        } else if ((isspace(inChar) != 0) && !inSingle && !inDouble) {
+            if (!current.empty()) {
+                cmdAndArgs.push_back(current);
+                current.clear();
+            }
+        } else {
+            current += inChar;
+        }
+    }
+    if (escape || inSingle || inDouble) {
+        return std::nullopt;
+    }
+    if (!current.empty()) {
+        cmdAndArgs.push_back(current);
+    }
+    return cmdAndArgs;
+}
+}
+
+TEST_CASE("tokenizer matches the reference parser on random lines") {
+    constexpr std::string_view Alphabet = "ab \t\n'\"\\{}:,x";
+    constexpr int LinesCount = 2000;
+    constexpr size_t MaxLineLength = 80;
+
+    std::mt19937 generator(42); //NOLINT(cert-msc51-cpp)
+    std::uniform_int_distribution<size_t> lengthDist(0, MaxLineLength);
+    std::uniform_int_distribution<size_t> charDist(0, Alphabet.size() - 1);
+
+    for (int lineIndex = 0; lineIndex < LinesCount; lineIndex++) {
+        std::string line(lengthDist(generator), ' ');
+        for (auto& character : line) {
+            character = Alphabet.at(charDist(generator));
+        }
+
+        const auto expected = ReferenceParseCommandLine(line);
+        const auto actual = ParseCommandLine(line);
+        REQUIRE_EQ(expected.has_value(), actual.has_value());
+        if (expected.has_value()) {
+            REQUIRE(expected.value() == actual.value());
+        }
+    }
+}
+
 TEST_SUITE_END();
 
 //NOLINTEND(readability-function-cognitive-complexity,cppcoreguidelines-avoid-do-while,bugprone-unchecked-optional-access)
@@ -8,6 +8,7 @@ using namespace replmk;
 TEST_CASE("CommandType: toCommandType converts valid strings") {
     REQUIRE(toCommandType("shell") == CommandType::Shell);
     REQUIRE(toCommandType("script") == CommandType::Script);
+    REQUIRE(toCommandType("follow") == CommandType::Follow);
     REQUIRE(toCommandType("not a type") == CommandType::Unknown);
 }
 
@@ -1,9 +1,17 @@
 #include <doctest/doctest.h>
 
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
 #include <string>
+#include <thread>
 #include <unordered_map>
 #include <vector>
 
+#include <unistd.h>
+
 #include "../src/Core.h"
 #include "../src/OutputBuffers.h"
 #include "../src/Command.h"
@@ -119,7 +127,8 @@ TEST_CASE("executeCommandLine handles script command type") {
     bool eventHandlerCalled = false;
     const OnInternalCommandEvent eventHandler = [&](CommandType /*type*/) -> void { eventHandlerCalled = true; };
 
-    const bool result = executeCommandLine(external, internal, outputBuffers, "test hello", eventHandler);
+    Session session;
+    const bool result = executeCommandLine(external, internal, outputBuffers, session, "test hello", eventHandler);
 
     // Script type is not yet implemented, should return false
     REQUIRE_EQ(result, false);
@@ -204,8 +213,9 @@ TEST_CASE("Help command lists commands and internal help/exit") {
     OutputBuffers outputBuffers;
     CommandHistory commandHistory("");
     OutputHistory outputHistory("");
+    Session session;
 
-    auto processCommand = makeCommandProcessingAction(externalCommands, modifiers, outputBuffers, commandHistory, outputHistory);
+    auto processCommand = makeCommandProcessingAction(externalCommands, modifiers, outputBuffers, session, commandHistory, outputHistory);
 
     bool wasEventHandlerCalled = false;
     CommandType receivedCommandType = CommandType::Unknown;
@@ -237,8 +247,9 @@ TEST_CASE("Unknown command appends error to last stderr with help hint") {
 
     CommandHistory commandHistory("");
     OutputHistory outputHistory("");
+    Session session;
 
-    auto processCommand = makeCommandProcessingAction(externalCommands, modifiers, outputBuffers, commandHistory, outputHistory);
+    auto processCommand = makeCommandProcessingAction(externalCommands, modifiers, outputBuffers, session, commandHistory, outputHistory);
 
     bool wasEventHandlerCalled = false;
     const auto eventHandler = [&](CommandType) {
@@ -267,8 +278,9 @@ TEST_CASE("Execute external single command appends to stdout of last entry") {
 
     CommandHistory commandHistory("");
     OutputHistory outputHistory("");
+    Session session;
 
-    auto processCommand = makeCommandProcessingAction(externalCommands, modifiers, outputBuffers, commandHistory, outputHistory);
+    auto processCommand = makeCommandProcessingAction(externalCommands, modifiers, outputBuffers, session, commandHistory, outputHistory);
 
     const bool commandSucceeded = processCommand("echo hello", [](CommandType) {});
     REQUIRE_EQ(commandSucceeded, true);
@@ -286,8 +298,9 @@ TEST_CASE("Internal exit triggers event and returns true without modifying buffe
 
     CommandHistory commandHistory("");
     OutputHistory outputHistory("");
+    Session session;
 
-    auto processCommand = makeCommandProcessingAction(externalCommands, modifiers, outputBuffers, commandHistory, outputHistory);
+    auto processCommand = makeCommandProcessingAction(externalCommands, modifiers, outputBuffers, session, commandHistory, outputHistory);
 
     bool wasEventHandlerCalled = false;
     CommandType receivedCommandType = CommandType::Unknown;
@@ -301,5 +314,832 @@ TEST_CASE("Internal exit triggers event and returns true without modifying buffe
     REQUIRE_EQ(outputBuffers.GetBuffer().size(), initialBufferSize);
 }
 
+namespace {
+auto CreateSchemaCommand() -> Command {
+    auto cmd = CreateTestCommand(CommandType::Single, "deploy", "deploy command", "echo");
+    ArgumentSpec envSpec;
+    envSpec.name = "env";
+    envSpec.argType = ArgumentType::Enum;
+    envSpec.allowedValues = {"dev", "prod"};
+    REQUIRE(compileArgumentSpec(envSpec));
+    cmd.argsSchema.arguments.push_back(envSpec);
+    return cmd;
+}
+}
+
+TEST_CASE("executeCommandLine rejects arguments that do not match the schema") {
+    CommandCatalog external{{"deploy", CreateSchemaCommand()}};
+    CommandCatalog internal{};
+    OutputBuffers outputBuffers;
+    outputBuffers.AddNewEntry(OutputBufferEntry{"", "", ""});
+
+    Session session;
+    const bool result = executeCommandLine(external, internal, outputBuffers, session, "deploy staging", [](CommandType) {});
+
+    REQUIRE_EQ(result, false);
+    const auto& lastOutput = outputBuffers.GetBuffer().back();
+    REQUIRE(lastOutput.stdOutEntry.empty());
+    REQUIRE_NE(lastOutput.stdErrEntry.find("must be one of"), std::string::npos);
+    REQUIRE_NE(lastOutput.stdErrEntry.find("Usage: deploy <env:dev|prod>"), std::string::npos);
+}
+
+TEST_CASE("executeCommandLine runs commands with valid arguments") {
+    CommandCatalog external{{"deploy", CreateSchemaCommand()}};
+    CommandCatalog internal{};
+    OutputBuffers outputBuffers;
+    outputBuffers.AddNewEntry(OutputBufferEntry{"", "", ""});
+
+    Session session;
+    const bool result = executeCommandLine(external, internal, outputBuffers, session, "deploy prod", [](CommandType) {});
+
+    REQUIRE_EQ(result, true);
+    REQUIRE_EQ(outputBuffers.GetBuffer().back().stdOutEntry, "prod\n");
+}
+
+TEST_CASE("handleHelpDisplay shows the argument usage of a command") {
+    CommandCatalog external{{"deploy", CreateSchemaCommand()}};
+    CommandCatalog internal{};
+
+    OutputBuffers outputBuffers;
+    handleHelpDisplay({"deploy"}, external, internal, outputBuffers);
+
+    const auto& lastOutput = outputBuffers.GetBuffer().back();
+    REQUIRE_NE(lastOutput.stdOutEntry.find("Usage: deploy <env:dev|prod>"), std::string::npos);
+    REQUIRE_NE(lastOutput.stdOutEntry.find("one of dev, prod"), std::string::npos);
+}
+
+TEST_CASE("completeCommandLine completes command names and schema values") {
+    CommandCatalog external{
+        {"deploy", CreateSchemaCommand()},
+        {"describe", CreateTestCommand(CommandType::Single, "describe", "describe command", "echo")}
+    };
+    CommandCatalog internal{
+        {"help", CreateTestCommand(CommandType::InternalHelp, "help", "help command")}
+    };
+
+    REQUIRE_EQ(completeCommandLine(external, internal, "de"), "de");
+    REQUIRE_EQ(completeCommandLine(external, internal, "dep"), "deploy ");
+    REQUIRE_EQ(completeCommandLine(external, internal, "he"), "help ");
+    REQUIRE_EQ(completeCommandLine(external, internal, "deploy p"), "deploy prod ");
+    REQUIRE_EQ(completeCommandLine(external, internal, "deploy "), "deploy ");
+    REQUIRE_EQ(completeCommandLine(external, internal, "describe x"), "describe x");
+    REQUIRE_EQ(completeCommandLine(external, internal, "unknown p"), "unknown p");
+    REQUIRE_EQ(completeCommandLine(external, internal, "deploy prod && dep"), "deploy prod && deploy ");
+    REQUIRE_EQ(completeCommandLine(external, internal, "help; deploy p"), "help; deploy prod ");
+    REQUIRE_EQ(completeCommandLine(external, internal, "deploy prod | @gr"), "deploy prod | @grep ");
+    REQUIRE_EQ(completeCommandLine(external, internal, "deploy prod | @"), "deploy prod | @");
+}
+
+TEST_CASE("Builtin commands keep session state across command lines") {
+    CommandCatalog externalCommands{
+        {"set", CreateTestCommand(CommandType::Builtin, "set", "set a variable", "set")},
+        {"say", CreateTestCommand(CommandType::Builtin, "say", "echo builtin", "echo")},
+        {"env", CreateTestCommand(CommandType::Single, "env", "print environment", "env")},
+        {"time", CreateTestCommand(CommandType::Builtin, "time", "time a command", "time")}
+    };
+    CommandCatalog internal{};
+    OutputBuffers outputBuffers;
+    Session session;
+
+    outputBuffers.AddNewEntry(OutputBufferEntry{"", "", ""});
+    REQUIRE(executeCommandLine(externalCommands, internal, outputBuffers, session, "set GREETING hi", [](CommandType) {}));
+
+    outputBuffers.AddNewEntry(OutputBufferEntry{"", "", ""});
+    REQUIRE(executeCommandLine(externalCommands, internal, outputBuffers, session, "say $GREETING there", [](CommandType) {}));
+    REQUIRE_EQ(outputBuffers.GetBuffer().back().stdOutEntry, "hi there\n");
+
+    // like a shell, single quotes and escapes keep the '$', double quotes don't
+    outputBuffers.AddNewEntry(OutputBufferEntry{"", "", ""});
+    REQUIRE(executeCommandLine(externalCommands, internal, outputBuffers, session, R"(say '$GREETING' \$GREETING "$GREETING")", [](CommandType) {}));
+    REQUIRE_EQ(outputBuffers.GetBuffer().back().stdOutEntry, "$GREETING $GREETING hi\n");
+
+    outputBuffers.AddNewEntry(OutputBufferEntry{"", "", ""});
+    REQUIRE(executeCommandLine(externalCommands, internal, outputBuffers, session, "time say '$GREETING' $GREETING", [](CommandType) {}));
+    REQUIRE(outputBuffers.GetBuffer().back().stdOutEntry.starts_with("$GREETING hi\n"));
+
+    // spawned processes inherit session variables
+    outputBuffers.AddNewEntry(OutputBufferEntry{"", "", ""});
+    REQUIRE(executeCommandLine(externalCommands, internal, outputBuffers, session, "env", [](CommandType) {}));
+    REQUIRE_NE(outputBuffers.GetBuffer().back().stdOutEntry.find("GREETING=hi"), std::string::npos);
+
+    outputBuffers.AddNewEntry(OutputBufferEntry{"", "", ""});
+    REQUIRE(executeCommandLine(externalCommands, internal, outputBuffers, session, "time say done", [](CommandType) {}));
+    REQUIRE(outputBuffers.GetBuffer().back().stdOutEntry.starts_with("done\n"));
+
+    outputBuffers.AddNewEntry(OutputBufferEntry{"", "", ""});
+    REQUIRE_FALSE(executeCommandLine(externalCommands, internal, outputBuffers, session, "time missing", [](CommandType) {}));
+    REQUIRE_NE(outputBuffers.GetBuffer().back().stdErrEntry.find("Could not find the command 'missing'"), std::string::npos);
+}
+
+TEST_CASE("Foreground sleep leaves the interface its events and can be cancelled") {
+    CommandCatalog externalCommands{
+        {"sleep", CreateTestCommand(CommandType::Builtin, "sleep", "sleep builtin", "sleep")},
+        {"time", CreateTestCommand(CommandType::Builtin, "time", "time a command", "time")}
+    };
+    CommandCatalog internal{};
+    OutputBuffers outputBuffers;
+    Session session;
+    session.control.SetOnIdle([&session]() {
+        session.control.RequestCancel();
+    });
+    const auto run = [&](const std::string& line) {
+        session.control.BeginCommand();
+        outputBuffers.AddNewEntry(OutputBufferEntry{"", "", ""});
+        return executeCommandLine(externalCommands, internal, outputBuffers, session, line, [](CommandType) {});
+    };
+
+    const auto start = std::chrono::steady_clock::now();
+    REQUIRE_FALSE(run("sleep 30"));
+    REQUIRE_FALSE(run("time sleep 30"));
+    session.control.SetOnIdle({});
+    REQUIRE_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds{10});
+}
+
+TEST_CASE("Plugin commands run through the session plugin cache") {
+    auto echoPlugin = CreateTestCommand(CommandType::Plugin, "pecho", "plugin echo", REPLMK_TEST_PLUGIN_PATH);
+    echoPlugin.symbol = "replmk_test_echo";
+    auto isolatedPlugin = echoPlugin;
+    isolatedPlugin.name = "iecho";
+    isolatedPlugin.isolated = true;
+    auto missingPlugin = CreateTestCommand(CommandType::Plugin, "missing", "missing plugin", "/does/not/exist.so");
+    missingPlugin.symbol = "replmk_test_echo";
+
+    CommandCatalog externalCommands{
+        {echoPlugin.name, echoPlugin},
+        {isolatedPlugin.name, isolatedPlugin},
+        {missingPlugin.name, missingPlugin}
+    };
+    CommandCatalog internal{};
+    OutputBuffers outputBuffers;
+    Session session;
+
+    outputBuffers.AddNewEntry(OutputBufferEntry{"", "", ""});
+    REQUIRE(executeCommandLine(externalCommands, internal, outputBuffers, session, "pecho hello", [](CommandType) {}));
+    REQUIRE_EQ(outputBuffers.GetBuffer().back().stdOutEntry, "pecho\nhello\n");
+
+    outputBuffers.AddNewEntry(OutputBufferEntry{"", "", ""});
+    REQUIRE(executeCommandLine(externalCommands, internal, outputBuffers, session, "iecho hello", [](CommandType) {}));
+    REQUIRE_EQ(outputBuffers.GetBuffer().back().stdOutEntry, "iecho\nhello\n");
+    REQUIRE_EQ(session.plugins.LoadedLibrariesCount(), 1);
+
+    outputBuffers.AddNewEntry(OutputBufferEntry{"", "", ""});
+    REQUIRE_FALSE(executeCommandLine(externalCommands, internal, outputBuffers, session, "missing", [](CommandType) {}));
+    REQUIRE_NE(outputBuffers.GetBuffer().back().stdErrEntry.find("Could not load plugin"), std::string::npos);
+}
+
+TEST_CASE("Silent plugin commands leave the interface its events and can be cancelled") {
+    auto silentPlugin = CreateTestCommand(CommandType::Plugin, "silent", "silent plugin", REPLMK_TEST_PLUGIN_PATH);
+    silentPlugin.symbol = "replmk_test_silent";
+
+    CommandCatalog externalCommands{{silentPlugin.name, silentPlugin}};
+    CommandCatalog internal{};
+    OutputBuffers outputBuffers;
+    Session session;
+    session.control.BeginCommand();
+    session.control.SetOnIdle([&session]() {
+        session.control.RequestCancel();
+    });
+
+    const auto start = std::chrono::steady_clock::now();
+    outputBuffers.AddNewEntry(OutputBufferEntry{"", "", ""});
+    REQUIRE_FALSE(executeCommandLine(externalCommands, internal, outputBuffers, session, "silent", [](CommandType) {}));
+    session.control.SetOnIdle({});
+    REQUIRE_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds{5});
+    REQUIRE_EQ(outputBuffers.GetBuffer().back().stdOutEntry, "");
+}
+
+TEST_CASE("Command lines with operators run as a plan") {
+    CommandCatalog externalCommands{
+        {"echo", CreateTestCommand(CommandType::Single, "echo", "echo command", "echo")},
+        {"fail", CreateTestCommand(CommandType::Single, "fail", "always fails", "false")}
+    };
+    CommandCatalog internal{};
+    OutputBuffers outputBuffers;
+    Session session;
+
+    outputBuffers.AddNewEntry(OutputBufferEntry{"> echo a && fail || echo c; echo d", "", ""});
+    REQUIRE(executeCommandLine(externalCommands, internal, outputBuffers, session, "echo a && fail || echo 'c c'; echo d", [](CommandType) {}));
+
+    // the line entry stays as a header, followed by one entry per step that ran
+    const auto& buffer = outputBuffers.GetBuffer();
+    REQUIRE_EQ(buffer.size(), 5);
+    REQUIRE_EQ(buffer[1].prompt, definition::PlanStepPromptPrefix + "echo a\n");
+    REQUIRE_EQ(buffer[1].stdOutEntry, "a\n");
+    REQUIRE_EQ(buffer[2].prompt, definition::PlanStepPromptPrefix + "fail\n");
+    REQUIRE_EQ(buffer[3].prompt, definition::PlanStepPromptPrefix + "echo 'c c'\n");
+    REQUIRE_EQ(buffer[3].stdOutEntry, "c c\n");
+    REQUIRE_EQ(buffer[4].stdOutEntry, "d\n");
+}
+
+TEST_CASE("Plan steps are skipped based on the last result") {
+    CommandCatalog externalCommands{
+        {"echo", CreateTestCommand(CommandType::Single, "echo", "echo command", "echo")},
+        {"fail", CreateTestCommand(CommandType::Single, "fail", "always fails", "false")}
+    };
+    CommandCatalog internal{};
+    OutputBuffers outputBuffers;
+    Session session;
+
+    outputBuffers.AddNewEntry(OutputBufferEntry{"", "", ""});
+    REQUIRE_FALSE(executeCommandLine(externalCommands, internal, outputBuffers, session, "fail && echo skipped", [](CommandType) {}));
+    REQUIRE_EQ(outputBuffers.GetBuffer().size(), 2);
+
+    outputBuffers.AddNewEntry(OutputBufferEntry{"", "", ""});
+    REQUIRE(executeCommandLine(externalCommands, internal, outputBuffers, session, "echo ok || echo skipped && echo after", [](CommandType) {}));
+    REQUIRE_EQ(outputBuffers.GetBuffer().size(), 5);
+    REQUIRE_EQ(outputBuffers.GetBuffer().back().stdOutEntry, "after\n");
+}
+
+TEST_CASE("Plans with unknown commands run nothing") {
+    CommandCatalog externalCommands{
+        {"echo", CreateTestCommand(CommandType::Single, "echo", "echo command", "echo")}
+    };
+    CommandCatalog internal{};
+    OutputBuffers outputBuffers;
+    Session session;
+
+    outputBuffers.AddNewEntry(OutputBufferEntry{"", "", ""});
+    REQUIRE_FALSE(executeCommandLine(externalCommands, internal, outputBuffers, session, "echo first; nope --now", [](CommandType) {}));
+    REQUIRE_EQ(outputBuffers.GetBuffer().size(), 1);
+    REQUIRE_EQ(outputBuffers.GetBuffer().back().stdOutEntry, "");
+    REQUIRE_NE(outputBuffers.GetBuffer().back().stdErrEntry.find("Could not find the command 'nope --now'"), std::string::npos);
+
+    REQUIRE_FALSE(executeCommandLine(externalCommands, internal, outputBuffers, session, "echo first &&", [](CommandType) {}));
+}
+
+TEST_CASE("Pipelines mix command types") {
+    auto pluginEcho = CreateTestCommand(CommandType::Plugin, "pecho", "plugin echo", REPLMK_TEST_PLUGIN_PATH);
+    pluginEcho.symbol = "replmk_test_echo";
+
+    CommandCatalog externalCommands{
+        {"seq", CreateTestCommand(CommandType::Single, "seq", "sequence", "seq")},
+        {"upper", CreateTestCommand(CommandType::Shell, "upper", "to upper case", "tr a-z A-Z")},
+        {"say", CreateTestCommand(CommandType::Builtin, "say", "echo builtin", "echo")},
+        {"count", CreateTestCommand(CommandType::Single, "count", "count lines", "wc")},
+        {"sleep", CreateTestCommand(CommandType::Builtin, "sleep", "sleep builtin", "sleep")},
+        {pluginEcho.name, pluginEcho}
+    };
+    CommandCatalog internal{
+        {"help", CreateTestCommand(CommandType::InternalHelp, "help", "help command")}
+    };
+    OutputBuffers outputBuffers;
+    Session session;
+
+    outputBuffers.AddNewEntry(OutputBufferEntry{"", "", ""});
+    REQUIRE(executeCommandLine(externalCommands, internal, outputBuffers, session, "say hello | upper", [](CommandType) {}));
+    REQUIRE_EQ(outputBuffers.GetBuffer().back().stdOutEntry, "HELLO\n");
+
+    outputBuffers.AddNewEntry(OutputBufferEntry{"", "", ""});
+    REQUIRE(executeCommandLine(externalCommands, internal, outputBuffers, session, "pecho a b | upper", [](CommandType) {}));
+    REQUIRE_EQ(outputBuffers.GetBuffer().back().stdOutEntry, "PECHO\nA\nB\n");
+
+    // pipelines are steps of a plan like any other command
+    outputBuffers.AddNewEntry(OutputBufferEntry{"", "", ""});
+    REQUIRE(executeCommandLine(externalCommands, internal, outputBuffers, session, "seq 1 100 | count -l && say done", [](CommandType) {}));
+    const auto& buffer = outputBuffers.GetBuffer();
+    REQUIRE_EQ(buffer.at(buffer.size() - 2).prompt, definition::PlanStepPromptPrefix + "seq 1 100 | count -l\n");
+    REQUIRE_NE(buffer.at(buffer.size() - 2).stdOutEntry.find("100"), std::string::npos);
+    REQUIRE_EQ(buffer.back().stdOutEntry, "done\n");
+
+    outputBuffers.AddNewEntry(OutputBufferEntry{"", "", ""});
+    REQUIRE_FALSE(executeCommandLine(externalCommands, internal, outputBuffers, session, "help | upper", [](CommandType) {}));
+    REQUIRE_NE(outputBuffers.GetBuffer().back().stdErrEntry.find("'help' can't be used in a pipeline"), std::string::npos);
+
+    // forked builtins never run the interface, even when forked from its thread
+    const auto replPid = getpid();
+    session.control.SetOnIdle([replPid]() {
+        if(getpid() != replPid) {
+            _exit(EXIT_FAILURE);
+        }
+    });
+    outputBuffers.AddNewEntry(OutputBufferEntry{"", "", ""});
+    REQUIRE(executeCommandLine(externalCommands, internal, outputBuffers, session, "say hello | sleep 0.2", [](CommandType) {}));
+    session.control.SetOnIdle({});
+}
+
+TEST_CASE("Output filters apply to the command before them") {
+    CommandCatalog externalCommands{
+        {"seq", CreateTestCommand(CommandType::Single, "seq", "sequence", "seq")},
+        {"upper", CreateTestCommand(CommandType::Shell, "upper", "to upper case", "tr a-z A-Z")},
+        {"say", CreateTestCommand(CommandType::Builtin, "say", "echo builtin", "echo")}
+    };
+    CommandCatalog internal{
+        {"help", CreateTestCommand(CommandType::InternalHelp, "help", "help command")}
+    };
+    OutputBuffers outputBuffers;
+    Session session;
+
+    outputBuffers.AddNewEntry(OutputBufferEntry{"", "", ""});
+    REQUIRE(executeCommandLine(externalCommands, internal, outputBuffers, session, "seq 1 1000 | @grep 7 | @head 3", [](CommandType) {}));
+    REQUIRE_EQ(outputBuffers.GetBuffer().back().stdOutEntry, "7\n17\n27\n");
+
+    outputBuffers.AddNewEntry(OutputBufferEntry{"", "", ""});
+    REQUIRE(executeCommandLine(externalCommands, internal, outputBuffers, session, "say a b | upper | @count", [](CommandType) {}));
+    REQUIRE_EQ(outputBuffers.GetBuffer().back().stdOutEntry, "1\n");
+
+    // filters belong to their own step of a plan
+    outputBuffers.AddNewEntry(OutputBufferEntry{"", "", ""});
+    REQUIRE(executeCommandLine(externalCommands, internal, outputBuffers, session, "seq 1 5 | @tail 1 && seq 1 2", [](CommandType) {}));
+    const auto& buffer = outputBuffers.GetBuffer();
+    REQUIRE_EQ(buffer.at(buffer.size() - 2).prompt, definition::PlanStepPromptPrefix + "seq 1 5 | @tail 1\n");
+    REQUIRE_EQ(buffer.at(buffer.size() - 2).stdOutEntry, "5\n");
+    REQUIRE_EQ(buffer.back().stdOutEntry, "1\n2\n");
+}
+
+TEST_CASE("Misplaced or malformed output filters run nothing") {
+    CommandCatalog externalCommands{
+        {"say", CreateTestCommand(CommandType::Builtin, "say", "echo builtin", "echo")}
+    };
+    CommandCatalog internal{
+        {"help", CreateTestCommand(CommandType::InternalHelp, "help", "help command")}
+    };
+    OutputBuffers outputBuffers;
+    Session session;
+
+    for(const auto* line: {"@count", "say a && @count", "say a | @head x", "say a | @sort", "say a | @uniq | say b"}) {
+        outputBuffers.AddNewEntry(OutputBufferEntry{"", "", ""});
+        REQUIRE_FALSE(executeCommandLine(externalCommands, internal, outputBuffers, session, line, [](CommandType) {}));
+        REQUIRE_EQ(outputBuffers.GetBuffer().back().stdOutEntry, "");
+        REQUIRE_FALSE(outputBuffers.GetBuffer().back().stdErrEntry.empty());
+    }
+    REQUIRE_NE(outputBuffers.GetBuffer().back().stdErrEntry.find("must come after the last command"), std::string::npos);
+}
+
+TEST_CASE("Redirected output goes to files, with a summary in the buffers") {
+    CommandCatalog externalCommands{
+        {"seq", CreateTestCommand(CommandType::Single, "seq", "sequence", "seq")},
+        {"fail", CreateTestCommand(CommandType::Shell, "fail", "writes errors", "echo broken >&2; exit 1")},
+        {"upper", CreateTestCommand(CommandType::Shell, "upper", "to upper case", "tr a-z A-Z")},
+        {"say", CreateTestCommand(CommandType::Builtin, "say", "echo builtin", "echo")},
+        {"cd", CreateTestCommand(CommandType::Builtin, "cd", "change directory", "cd")}
+    };
+    CommandCatalog internal{
+        {"help", CreateTestCommand(CommandType::InternalHelp, "help", "help command")}
+    };
+    OutputBuffers outputBuffers;
+    Session session;
+
+    const auto tempDir = std::filesystem::temp_directory_path() / ("replmk_core_redirect_" + std::to_string(getpid()));
+    std::filesystem::create_directories(tempDir);
+    const auto readFile = [&tempDir](const std::string& name) {
+        std::ifstream file{tempDir / name};
+        return std::string{std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{}};
+    };
+    REQUIRE(executeCommandLine(externalCommands, internal, outputBuffers, session, "cd " + tempDir.string(), [](CommandType) {}));
+
+    outputBuffers.AddNewEntry(OutputBufferEntry{"", "", ""});
+    REQUIRE(executeCommandLine(externalCommands, internal, outputBuffers, session, "seq 1 1000 > numbers", [](CommandType) {}));
+    REQUIRE_EQ(readFile("numbers").size(), 3893);
+    REQUIRE_NE(outputBuffers.GetBuffer().back().stdOutEntry.find("stdout written to '" + (tempDir / "numbers").string() + "': 3893 bytes in"), std::string::npos);
+
+    // builtins, pipelines and filters write to the same kind of file
+    REQUIRE(executeCommandLine(externalCommands, internal, outputBuffers, session, "say a b >> numbers", [](CommandType) {}));
+    REQUIRE(readFile("numbers").ends_with("1000\na b\n"));
+    REQUIRE(executeCommandLine(externalCommands, internal, outputBuffers, session, "say x | upper > piped", [](CommandType) {}));
+    REQUIRE_EQ(readFile("piped"), "X\n");
+    REQUIRE(executeCommandLine(externalCommands, internal, outputBuffers, session, "seq 1 20 | @grep 1 | @tail 2 > filtered", [](CommandType) {}));
+    REQUIRE_EQ(readFile("filtered"), "18\n19\n");
+
+    outputBuffers.AddNewEntry(OutputBufferEntry{"", "", ""});
+    REQUIRE_FALSE(executeCommandLine(externalCommands, internal, outputBuffers, session, "fail 2> errors", [](CommandType) {}));
+    REQUIRE_EQ(readFile("errors"), "broken\n");
+    REQUIRE_EQ(outputBuffers.GetBuffer().back().stdErrEntry, "");
+    REQUIRE_NE(outputBuffers.GetBuffer().back().stdOutEntry.find("stderr written to"), std::string::npos);
+
+    // files that can't be opened stop the step before it runs
+    outputBuffers.AddNewEntry(OutputBufferEntry{"", "", ""});
+    REQUIRE_FALSE(executeCommandLine(externalCommands, internal, outputBuffers, session, "say hi > missing/dir/file", [](CommandType) {}));
+    REQUIRE_EQ(outputBuffers.GetBuffer().back().stdOutEntry, "");
+    REQUIRE_NE(outputBuffers.GetBuffer().back().stdErrEntry.find("Could not open"), std::string::npos);
+
+    for(const auto* line: {"say a > out | upper", "help > out", "say a > out 2>&1"}) {
+        outputBuffers.AddNewEntry(OutputBufferEntry{"", "", ""});
+        REQUIRE_FALSE(executeCommandLine(externalCommands, internal, outputBuffers, session, line, [](CommandType) {}));
+        REQUIRE_FALSE(outputBuffers.GetBuffer().back().stdErrEntry.empty());
+    }
+    REQUIRE_FALSE(std::filesystem::exists(tempDir / "out"));
+
+    std::filesystem::remove_all(tempDir);
+}
+
+TEST_CASE("@each runs a command once per item") {
+    CommandCatalog externalCommands{
+        {"seq", CreateTestCommand(CommandType::Single, "seq", "sequence", "seq")},
+        {"check", CreateTestCommand(CommandType::Shell, "check", "fails on 2", "echo \"checked $1\"; [ \"$1\" != 2 ] || { echo bad >&2; exit 1; }")},
+        {"say", CreateTestCommand(CommandType::Builtin, "say", "echo builtin", "echo")},
+        {"upper", CreateTestCommand(CommandType::Shell, "upper", "to upper case", "tr a-z A-Z")}
+    };
+    const auto internal = buildInternalCommandCatalog({});
+    OutputBuffers outputBuffers;
+    Session session;
+    const auto run = [&](const std::string& line) {
+        outputBuffers.AddNewEntry(OutputBufferEntry{"", "", ""});
+        return executeCommandLine(externalCommands, internal, outputBuffers, session, line, [](CommandType) {});
+    };
+
+    REQUIRE(run("@each -j2 say item-{} ::: a b c"));
+    const auto& output = outputBuffers.GetBuffer().back().stdOutEntry;
+    for(const auto* expected: {"] a\nitem-a\n", "] b\nitem-b\n", "] c\nitem-c\n", "@each: 3 succeeded, 0 failed in "}) {
+        REQUIRE_NE(output.find(expected), std::string::npos);
+    }
+
+    // items piped in, picked by filters, and failures reported per item
+    REQUIRE_FALSE(run("seq 1 4 | @grep -v 4 | @each -j3 check"));
+    const auto& checked = outputBuffers.GetBuffer().back();
+    REQUIRE_NE(checked.stdOutEntry.find("[failed "), std::string::npos);
+    REQUIRE_NE(checked.stdOutEntry.find("checked 3\n"), std::string::npos);
+    REQUIRE_EQ(checked.stdOutEntry.find("checked 4"), std::string::npos);
+    REQUIRE_NE(checked.stdOutEntry.find("2 succeeded, 1 failed"), std::string::npos);
+    REQUIRE_EQ(checked.stdErrEntry, "2: bad\n");
+
+    // the grouped output goes through filters like any other
+    REQUIRE(run("@each say ::: x y | @grep -v @each | @count"));
+    REQUIRE_EQ(outputBuffers.GetBuffer().back().stdOutEntry, "4\n");
+
+    for(const auto* line: {"@each say", "@each -j0 say ::: a", "@each missing ::: a", "@each help ::: a",
+                           "seq 1 2 | @each say ::: a", "@each say ::: a | upper", "@each say ::: a | @each say"}) {
+        REQUIRE_FALSE(run(line));
+        REQUIRE_EQ(outputBuffers.GetBuffer().back().stdOutEntry, "");
+        REQUIRE_FALSE(outputBuffers.GetBuffer().back().stdErrEntry.empty());
+    }
+
+    REQUIRE_EQ(completeCommandLine(externalCommands, internal, "@ea"), "@each ");
+}
+
+TEST_CASE("Lines ending with '&' run as background jobs") {
+    CommandCatalog externalCommands{
+        {"seq", CreateTestCommand(CommandType::Single, "seq", "sequence", "seq")},
+        {"say", CreateTestCommand(CommandType::Builtin, "say", "echo builtin", "echo")},
+        {"sleep", CreateTestCommand(CommandType::Builtin, "sleep", "sleep builtin", "sleep")},
+        {"wait", CreateTestCommand(CommandType::Single, "wait", "sleep process", "sleep")}
+    };
+    const auto internal = buildInternalCommandCatalog({});
+    OutputBuffers outputBuffers;
+    Session session;
+    const auto run = [&](const std::string& line) {
+        outputBuffers.AddNewEntry(OutputBufferEntry{"", "", ""});
+        return executeCommandLine(externalCommands, internal, outputBuffers, session, line, [](CommandType) {});
+    };
+
+    REQUIRE(run("seq 1 5 && say done &"));
+    REQUIRE_EQ(outputBuffers.GetBuffer().back().stdOutEntry, "[1] 'seq 1 5 && say done' running in the background\n");
+
+    // fg waits for the job and shows everything it wrote
+    REQUIRE(run("fg"));
+    const auto& foreground = outputBuffers.GetBuffer().back();
+    REQUIRE_EQ(foreground.stdOutEntry, definition::PlanStepPromptPrefix + "seq 1 5\n1\n2\n3\n4\n5\n" +
+                                       definition::PlanStepPromptPrefix + "say done\ndone\n");
+    REQUIRE(session.jobs.Jobs().empty());
+
+    REQUIRE(run("seq 1 100 &"));
+    REQUIRE(run("wait 30 &"));
+    REQUIRE(run("jobs"));
+    const auto& listing = outputBuffers.GetBuffer().back().stdOutEntry;
+    REQUIRE_NE(listing.find("[2] "), std::string::npos);
+    REQUIRE_NE(listing.find("[3] Running"), std::string::npos);
+    REQUIRE_NE(listing.find("wait 30\n"), std::string::npos);
+
+    while(session.jobs.Find(2)->IsRunning()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds{5});
+    }
+    REQUIRE(run("tail 2 3"));
+    REQUIRE_EQ(outputBuffers.GetBuffer().back().stdOutEntry, "98\n99\n100\n");
+
+    REQUIRE(run("kill 3"));
+    REQUIRE_FALSE(run("fg 3"));
+    REQUIRE_EQ(outputBuffers.GetBuffer().back().stdOutEntry, "");
+    REQUIRE_EQ(session.jobs.Jobs().size(), 1);
+    REQUIRE(run("kill"));
+    REQUIRE(session.jobs.Jobs().empty());
+
+    // builtins are cancelled too, and fg reports how the job ended
+    REQUIRE(run("sleep 30 &"));
+    REQUIRE(run("kill 4"));
+    REQUIRE_FALSE(run("fg"));
+
+    REQUIRE_FALSE(run("fg 9"));
+    REQUIRE_NE(outputBuffers.GetBuffer().back().stdErrEntry.find("fg: no job 9"), std::string::npos);
+    REQUIRE_FALSE(run("tail 0"));
+    REQUIRE_FALSE(run("help &"));
+    REQUIRE_NE(outputBuffers.GetBuffer().back().stdErrEntry.find("'help' can't run in the background"), std::string::npos);
+    REQUIRE(session.jobs.Jobs().empty());
+
+    // a silent job in the foreground leaves the interface its events, and Ctrl+C kills it
+    REQUIRE(run("wait 30 &"));
+    session.control.SetOnIdle([&session]() {
+        session.control.RequestCancel();
+    });
+    const auto start = std::chrono::steady_clock::now();
+    REQUIRE_FALSE(run("fg"));
+    session.control.SetOnIdle({});
+    REQUIRE_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds{10});
+    REQUIRE(session.jobs.Jobs().empty());
+}
+
+TEST_CASE("run executes the steps of a workflow once their dependencies succeed") {
+    CommandCatalog externalCommands{
+        {"seq", CreateTestCommand(CommandType::Single, "seq", "sequence", "seq")},
+        {"check", CreateTestCommand(CommandType::Shell, "check", "fails on 2", "echo \"checked $1\"; [ \"$1\" != 2 ] || { echo bad >&2; exit 1; }")},
+        {"say", CreateTestCommand(CommandType::Builtin, "say", "echo builtin", "echo")}
+    };
+    const auto internal = buildInternalCommandCatalog({});
+    OutputBuffers outputBuffers;
+    Session session;
+    const auto addWorkflow = [&session](std::string name, WorkflowPolicy policy, std::vector<WorkflowStep> steps) {
+        session.workflows.emplace(name, Workflow{.name = name, .description = "test workflow", .policy = policy, .steps = std::move(steps)});
+    };
+    const auto run = [&](const std::string& line) {
+        outputBuffers.AddNewEntry(OutputBufferEntry{"", "", ""});
+        return executeCommandLine(externalCommands, internal, outputBuffers, session, line, [](CommandType) {});
+    };
+    const auto findEntry = [&outputBuffers](const std::string& prompt) -> const OutputBufferEntry* {
+        for(const auto& entry: outputBuffers.GetBuffer()) {
+            if(entry.prompt.find(prompt) != std::string::npos) {
+                return &entry;
+            }
+        }
+        return nullptr;
+    };
+
+    REQUIRE(run("run"));
+    REQUIRE_EQ(outputBuffers.GetBuffer().back().stdOutEntry, "There are no workflows\n");
+
+    addWorkflow("build", WorkflowPolicy::FailFast, {
+        {.name = "first", .commandLine = "say first", .dependsOn = {}},
+        {.name = "count", .commandLine = "seq 1 3 | @count", .dependsOn = {"first"}},
+        {.name = "check", .commandLine = "check 1", .dependsOn = {"first"}}
+    });
+    addWorkflow("release", WorkflowPolicy::FailFast, {
+        {.name = "lint", .commandLine = "say linted", .dependsOn = {}},
+        {.name = "test", .commandLine = "check 2", .dependsOn = {}},
+        {.name = "package", .commandLine = "say packaged", .dependsOn = {"lint", "test"}}
+    });
+
+    REQUIRE(run("run"));
+    REQUIRE_EQ(outputBuffers.GetBuffer().back().stdOutEntry, "- build:  test workflow (3 steps, fail_fast)\n- release:  test workflow (3 steps, fail_fast)\n");
+
+    REQUIRE(run("run build"));
+    REQUIRE_NE(findEntry("] count: seq 1 3 | @count\n"), nullptr);
+    REQUIRE_EQ(findEntry("] count: seq 1 3 | @count\n")->stdOutEntry, "3\n");
+    REQUIRE_EQ(findEntry("] first: say first\n")->stdOutEntry, "first\n");
+    REQUIRE_NE(outputBuffers.GetBuffer().back().stdOutEntry.find("build: 3 succeeded, 0 failed in "), std::string::npos);
+
+    // the failed step stops the ones depending on it
+    REQUIRE_FALSE(run("run release"));
+    REQUIRE_NE(findEntry("[failed "), nullptr);
+    REQUIRE_EQ(findEntry("[failed ")->stdErrEntry, "bad\n");
+    REQUIRE_NE(findEntry("[skipped] package: say packaged\n"), nullptr);
+    REQUIRE_EQ(findEntry("[skipped] package")->stdErrEntry, "not run, 'test' failed\n");
+    REQUIRE_NE(outputBuffers.GetBuffer().back().stdOutEntry.find("1 failed, 1 skipped"), std::string::npos);
+
+    // nothing runs when a step can't be planned
+    addWorkflow("unknown", WorkflowPolicy::KeepGoing, {{.name = "only", .commandLine = "missing", .dependsOn = {}}});
+    addWorkflow("internal", WorkflowPolicy::KeepGoing, {{.name = "only", .commandLine = "help", .dependsOn = {}}});
+    addWorkflow("sequence", WorkflowPolicy::KeepGoing, {{.name = "only", .commandLine = "say a; say b", .dependsOn = {}}});
+    addWorkflow("cycle", WorkflowPolicy::KeepGoing, {{.name = "only", .commandLine = "say a", .dependsOn = {"only"}}});
+    for(const auto* line: {"run nope", "run unknown", "run internal", "run sequence", "run cycle"}) {
+        const auto entries = outputBuffers.GetBuffer().size();
+        REQUIRE_FALSE(run(line));
+        REQUIRE_EQ(outputBuffers.GetBuffer().size(), entries + 1);
+        REQUIRE_FALSE(outputBuffers.GetBuffer().back().stdErrEntry.empty());
+    }
+}
+
+TEST_CASE("@each items and workflow steps stop at the timeout of their command") {
+    auto slow = CreateTestCommand(CommandType::Single, "slow", "sleeps", "sleep");
+    slow.timeout = std::chrono::seconds{1};
+    CommandCatalog externalCommands{
+        {"slow", slow},
+        {"say", CreateTestCommand(CommandType::Builtin, "say", "echo builtin", "echo")}
+    };
+    const auto internal = buildInternalCommandCatalog({});
+    OutputBuffers outputBuffers;
+    Session session;
+    session.workflows.emplace("nightly", Workflow{.name = "nightly", .description = "", .policy = WorkflowPolicy::KeepGoing, .steps = {
+        {.name = "wait", .commandLine = "slow 30", .dependsOn = {}},
+        {.name = "report", .commandLine = "say done", .dependsOn = {}}
+    }});
+    const auto run = [&](const std::string& line) {
+        outputBuffers.AddNewEntry(OutputBufferEntry{"", "", ""});
+        return executeCommandLine(externalCommands, internal, outputBuffers, session, line, [](CommandType) {});
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    REQUIRE_FALSE(run("@each -j2 slow ::: 30 30"));
+    REQUIRE_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds{10});
+    REQUIRE_NE(outputBuffers.GetBuffer().back().stdOutEntry.find("0 succeeded, 2 failed"), std::string::npos);
+    REQUIRE_NE(outputBuffers.GetBuffer().back().stdErrEntry.find("timed out after 1s"), std::string::npos);
+
+    start = std::chrono::steady_clock::now();
+    REQUIRE_FALSE(run("run nightly"));
+    REQUIRE_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds{10});
+    bool timedOut = false;
+    for(const auto& entry: outputBuffers.GetBuffer()) {
+        timedOut = timedOut or (entry.prompt.find("wait: slow 30") != std::string::npos and entry.stdErrEntry.find("timed out after 1s") != std::string::npos);
+    }
+    REQUIRE(timedOut);
+    REQUIRE_NE(outputBuffers.GetBuffer().back().stdOutEntry.find("1 succeeded, 1 failed"), std::string::npos);
+}
+
+TEST_CASE("Commands declaring a cache replay identical runs until refreshed") {
+    const auto cacheDirectory = std::filesystem::temp_directory_path() / ("replmk_core_cache_" + std::to_string(getpid()));
+    std::filesystem::remove_all(cacheDirectory);
+
+    // every run appends to the counter file, so replays can be told apart from runs
+    const auto counterFile = cacheDirectory.parent_path() / ("replmk_core_cache_runs_" + std::to_string(getpid()));
+    auto counted = CreateTestCommand(CommandType::Shell, "counted", "counts runs", "echo run >> " + counterFile.string() + "; echo \"value $1\"; echo note >&2");
+    counted.cache = CommandCachePolicy{.ttl = std::chrono::seconds{60}, .dependsOnFiles = {}};
+    auto failing = CreateTestCommand(CommandType::Shell, "failing", "never cached", "echo run >> " + counterFile.string() + "; exit 1");
+    failing.cache = CommandCachePolicy{.ttl = std::chrono::seconds{60}, .dependsOnFiles = {}};
+    CommandCatalog externalCommands{{"counted", counted}, {"failing", failing}};
+
+    const auto internal = buildInternalCommandCatalog({});
+    OutputBuffers outputBuffers;
+    Session session;
+    session.cache.SetDirectory(cacheDirectory);
+    const auto run = [&](const std::string& line) {
+        outputBuffers.AddNewEntry(OutputBufferEntry{"", "", ""});
+        return executeCommandLine(externalCommands, internal, outputBuffers, session, line, [](CommandType) {});
+    };
+    const auto runCount = [&counterFile]() {
+        std::ifstream file{counterFile};
+        return std::distance(std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{}) / 4;
+    };
+
+    REQUIRE(run("counted a"));
+    REQUIRE_EQ(outputBuffers.GetBuffer().back().stdOutEntry, "value a\n");
+    REQUIRE(run("counted a"));
+    const auto& replayed = outputBuffers.GetBuffer().back();
+    REQUIRE(replayed.stdOutEntry.starts_with("value a\n(cached output from "));
+    REQUIRE_EQ(replayed.stdErrEntry, "note\n");
+    REQUIRE_EQ(runCount(), 1);
+
+    // other arguments or variables are other entries, and filters apply to replays
+    REQUIRE(run("counted b | @count"));
+    REQUIRE_EQ(outputBuffers.GetBuffer().back().stdOutEntry, "1\n");
+    REQUIRE(run("counted b | @count"));
+    REQUIRE(outputBuffers.GetBuffer().back().stdOutEntry.starts_with("1\n(cached"));
+    session.variables["MODE"] = "other";
+    REQUIRE(run("counted a"));
+    REQUIRE_EQ(runCount(), 3);
+
+    REQUIRE_FALSE(run("failing"));
+    REQUIRE_FALSE(run("failing"));
+    REQUIRE_EQ(runCount(), 5);
+
+    REQUIRE(run("refresh counted"));
+    REQUIRE_EQ(outputBuffers.GetBuffer().back().stdOutEntry, "Forgot 3 cached results of 'counted'\n");
+    REQUIRE(run("counted a"));
+    REQUIRE_EQ(outputBuffers.GetBuffer().back().stdOutEntry, "value a\n");
+    REQUIRE_EQ(runCount(), 6);
+    REQUIRE(run("refresh"));
+    REQUIRE_EQ(outputBuffers.GetBuffer().back().stdOutEntry, "Forgot 1 cached results\n");
+
+    std::filesystem::remove_all(cacheDirectory);
+    std::filesystem::remove(counterFile);
+}
+
+TEST_CASE("watch runs a command again, replacing its output in place") {
+    const auto counterFile = std::filesystem::temp_directory_path() / ("replmk_core_watch_runs_" + std::to_string(getpid()));
+    std::filesystem::remove(counterFile);
+    const auto ticking = CreateTestCommand(CommandType::Shell, "ticking", "counts runs", "echo static; echo run >> " + counterFile.string() + "; wc -l < " + counterFile.string() + " | tr -d ' '");
+    CommandCatalog externalCommands{{"ticking", ticking}};
+
+    const auto internal = buildInternalCommandCatalog({});
+    OutputBuffers outputBuffers;
+    Session session;
+    session.control.BeginCommand();
+    const auto run = [&](const std::string& line) {
+        outputBuffers.AddNewEntry(OutputBufferEntry{"", "", ""});
+        return executeCommandLine(externalCommands, internal, outputBuffers, session, line, [](CommandType) {});
+    };
+
+    REQUIRE_FALSE(run("watch"));
+    REQUIRE_NE(outputBuffers.GetBuffer().back().stdErrEntry.find("missing the command"), std::string::npos);
+    REQUIRE_FALSE(run("watch -n 0 ticking"));
+    REQUIRE_FALSE(run("watch jobs"));
+    REQUIRE_EQ(outputBuffers.GetBuffer().back().stdErrEntry, "watch: 'jobs' can't be watched\n");
+
+    // Ctrl+C, once the third run is shown
+    outputBuffers.SetOnOutputChangedEvent([&session](const OutputBuffers& buffers) {
+        if(buffers.GetBuffer().back().stdOutEntry.find("  run 3 at ") != std::string::npos) {
+            session.control.RequestCancel();
+        }
+    });
+    const auto entriesBefore = outputBuffers.GetBuffer().size();
+    REQUIRE(run("watch -n 0.1 ticking"));
+    REQUIRE_EQ(outputBuffers.GetBuffer().size(), entriesBefore + 1);
+
+    const auto& watched = outputBuffers.GetBuffer().back().stdOutEntry;
+    REQUIRE(watched.starts_with("Every 0.1s: ticking  run 3 at "));
+    REQUIRE(watched.ends_with(", 1 changed line (2)\nstatic\n3\n"));
+
+    std::filesystem::remove(counterFile);
+}
+
+TEST_CASE("Commands record what they cost, ranked by stats") {
+    const auto writer = CreateTestCommand(CommandType::Shell, "writer", "writes and fails", "printf 'twelve bytes' ; printf err >&2; exit 3");
+    const auto sleeper = CreateTestCommand(CommandType::Shell, "sleeper", "sleeps", "sleep 0.2");
+    CommandCatalog externalCommands{{"writer", writer}, {"sleeper", sleeper}};
+
+    const auto internal = buildInternalCommandCatalog({});
+    OutputBuffers outputBuffers;
+    Session session;
+    session.control.BeginCommand();
+    const auto run = [&](const std::string& line) {
+        outputBuffers.AddNewEntry(OutputBufferEntry{"", "", ""});
+        return executeCommandLine(externalCommands, internal, outputBuffers, session, line, [](CommandType) {});
+    };
+
+    REQUIRE_FALSE(run("writer"));
+    const auto& written = outputBuffers.GetBuffer().back().stats;
+    REQUIRE(written.has_value());
+    REQUIRE_EQ(written->command, "writer");
+    REQUIRE_EQ(written->stdOutBytes, 12);
+    REQUIRE_EQ(written->stdErrBytes, 3);
+    REQUIRE_EQ(written->exitCode, 3);
+    REQUIRE_GT(written->maxRssKiB, 0);
+
+    REQUIRE(run("sleeper"));
+    REQUIRE_GE(outputBuffers.GetBuffer().back().stats->wallTime.count(), 200);
+    REQUIRE_FALSE(run("writer | writer"));
+    REQUIRE_EQ(outputBuffers.GetBuffer().back().stats->command, "writer | writer");
+
+    // the REPL's own commands aren't measured
+    REQUIRE(run("stats 1"));
+    const auto& ranking = outputBuffers.GetBuffer().back();
+    REQUIRE_FALSE(ranking.stats.has_value());
+    REQUIRE(ranking.stdOutEntry.starts_with("Slowest commands, by average wall time:\n  sleeper"));
+    REQUIRE_NE(ranking.stdOutEntry.find("Heaviest commands, by peak memory:\n"), std::string::npos);
+}
+
+TEST_CASE("Commands run inside the REPL record no stats") {
+    auto echoPlugin = CreateTestCommand(CommandType::Plugin, "pecho", "plugin echo", REPLMK_TEST_PLUGIN_PATH);
+    echoPlugin.symbol = "replmk_test_echo";
+    auto isolatedPlugin = echoPlugin;
+    isolatedPlugin.name = "iecho";
+    isolatedPlugin.isolated = true;
+    CommandCatalog externalCommands{
+        {"say", CreateTestCommand(CommandType::Builtin, "say", "echo builtin", "echo")},
+        {"pecho", echoPlugin},
+        {"iecho", isolatedPlugin}
+    };
+
+    const auto internal = buildInternalCommandCatalog({});
+    OutputBuffers outputBuffers;
+    Session session;
+    session.control.BeginCommand();
+    const auto run = [&](const std::string& line) {
+        outputBuffers.AddNewEntry(OutputBufferEntry{"", "", ""});
+        return executeCommandLine(externalCommands, internal, outputBuffers, session, line, [](CommandType) {});
+    };
+
+    REQUIRE(run("say hello"));
+    REQUIRE_EQ(outputBuffers.GetBuffer().back().stdOutEntry, "hello\n");
+    REQUIRE_FALSE(outputBuffers.GetBuffer().back().stats.has_value());
+    REQUIRE(run("pecho hello"));
+    REQUIRE_FALSE(outputBuffers.GetBuffer().back().stats.has_value());
+    REQUIRE(run("jobs"));
+    REQUIRE_FALSE(outputBuffers.GetBuffer().back().stats.has_value());
+
+    // in a process of their own, they are measured
+    REQUIRE(run("iecho hello"));
+    REQUIRE(outputBuffers.GetBuffer().back().stats.has_value());
+    REQUIRE(run("say hello | pecho"));
+    const auto& piped = outputBuffers.GetBuffer().back().stats;
+    REQUIRE(piped.has_value());
+    REQUIRE_EQ(piped->command, "say | pecho");
+    REQUIRE_GT(piped->maxRssKiB, 0);
+}
+
+TEST_CASE("Outputs larger than the command allows keep their start and end") {
+    auto counter = CreateTestCommand(CommandType::Shell, "counter", "counts far", "seq 1 100000; seq 1 5 >&2");
+    counter.outputRetention = OutputRetentionPolicy{.headBytes = 4, .tailBytes = 13, .keepFullOutput = true};
+    CommandCatalog externalCommands{{"counter", counter}};
+
+    const auto internal = buildInternalCommandCatalog({});
+    OutputBuffers outputBuffers;
+    Session session;
+    session.fullOutputDirectory = std::filesystem::temp_directory_path() / ("replmk_full_output_" + std::to_string(getpid()));
+    session.control.BeginCommand();
+    outputBuffers.AddNewEntry(OutputBufferEntry{"", "", ""});
+    REQUIRE(executeCommandLine(externalCommands, internal, outputBuffers, session, "counter", [](CommandType) {}));
+
+    const auto& entry = outputBuffers.GetBuffer().back();
+    REQUIRE_EQ(entry.stdOutEntry, "1\n2\n99999\n100000\n");
+    REQUIRE(entry.stdOutElided.has_value());
+    REQUIRE_EQ(entry.stdOutElided->offset, 4);
+    REQUIRE_EQ(entry.stdOutElided->lines, 99996);
+    REQUIRE(std::filesystem::exists(entry.stdOutElided->fullOutputPath));
+    REQUIRE_EQ(std::filesystem::file_size(entry.stdOutElided->fullOutputPath), entry.stdOutElided->bytes + entry.stdOutEntry.size());
+    // small enough to be kept whole
+    REQUIRE_EQ(entry.stdErrEntry, "1\n2\n3\n4\n5\n");
+    REQUIRE_FALSE(entry.stdErrElided.has_value());
+    // what the command wrote is still counted in full
+    REQUIRE_EQ(entry.stats->stdOutBytes, entry.stdOutElided->bytes + entry.stdOutEntry.size());
+
+    std::filesystem::remove_all(session.fullOutputDirectory);
+}
+
 TEST_SUITE_END();
 //NOLINTEND(readability-function-cognitive-complexity,cppcoreguidelines-avoid-do-while)
@@ -0,0 +1,96 @@
+#include <doctest/doctest.h>
+
+#include <chrono>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <sys/resource.h>
+
+#include "../src/ExecutionStats.h"
+
+using namespace replmk;
+
+//NOLINTBEGIN(readability-function-cognitive-complexity,cppcoreguidelines-avoid-do-while)
+TEST_SUITE_BEGIN("ExecutionStats");
+
+namespace {
+auto MakeRun(std::string command, int64_t wallMilliseconds, uint64_t maxRssKiB, std::optional<int> exitCode) -> ExecutionStats {
+    return ExecutionStats{
+        .command = std::move(command),
+        .wallTime = std::chrono::milliseconds{wallMilliseconds},
+        .userCpu = std::chrono::microseconds{wallMilliseconds * 1000},
+        .systemCpu = std::chrono::microseconds{0},
+        .maxRssKiB = maxRssKiB,
+        .majorFaults = 0,
+        .stdOutBytes = 100,
+        .stdErrBytes = 0,
+        .exitCode = exitCode,
+        .signal = std::nullopt
+    };
+}
+}
+
+TEST_CASE("Process usage adds up, the last process decides how the command ended") {
+    ExecutionStats stats;
+    rusage usage{};
+    usage.ru_utime = {.tv_sec = 1, .tv_usec = 500000};
+    usage.ru_maxrss = 4096;
+    usage.ru_majflt = 2;
+    addProcessUsage(stats, 0, usage);
+    usage.ru_maxrss = 1024;
+    // killed by SIGKILL
+    addProcessUsage(stats, 9, usage);
+
+    REQUIRE_EQ(stats.userCpu.count(), 3000000);
+    REQUIRE_EQ(stats.maxRssKiB, 4096);
+    REQUIRE_EQ(stats.majorFaults, 4);
+    REQUIRE_FALSE(stats.exitCode.has_value());
+    REQUIRE_EQ(stats.signal, 9);
+    REQUIRE(stats.Failed());
+}
+
+TEST_CASE("Stats are written on one line and read back") {
+    const auto run = MakeRun("seq 1 10 | wc -l", 1234, 2048, 0);
+    const auto serialized = serializeExecutionStats(run);
+    REQUIRE_EQ(serialized, "1234 1234000 0 2048 0 100 0 0 - seq 1 10 | wc -l");
+
+    const auto parsed = parseExecutionStats(serialized);
+    REQUIRE(parsed.has_value());
+    REQUIRE_EQ(parsed->command, run.command);
+    REQUIRE_EQ(parsed->wallTime, run.wallTime);
+    REQUIRE_EQ(parsed->userCpu, run.userCpu);
+    REQUIRE_EQ(parsed->maxRssKiB, run.maxRssKiB);
+    REQUIRE_EQ(parsed->exitCode, 0);
+    REQUIRE_FALSE(parsed->signal.has_value());
+
+    REQUIRE_FALSE(parseExecutionStats("").has_value());
+    REQUIRE_FALSE(parseExecutionStats("1 2 3 4 5 6 7 zero - build").has_value());
+}
+
+TEST_CASE("Runs of the same command are summarized and ranked") {
+    const std::vector<ExecutionStats> runs{
+        MakeRun("build", 3000, 1024, 0),
+        MakeRun("list", 10, 8192, 0),
+        MakeRun("build", 1000, 2048, 2)
+    };
+    const auto summaries = summarizeExecutionStats(runs);
+    REQUIRE_EQ(summaries.size(), 2);
+    REQUIRE_EQ(summaries.at(0).command, "build");
+    REQUIRE_EQ(summaries.at(0).runs, 2);
+    REQUIRE_EQ(summaries.at(0).failures, 1);
+    REQUIRE_EQ(summaries.at(0).AverageWallTime().count(), 2000);
+    REQUIRE_EQ(summaries.at(0).peakRssKiB, 2048);
+
+    const std::string expected =
+        "Slowest commands, by average wall time:\n"
+        "  build     2 runs  avg    2.00s  max    3.00s  cpu    4.00s  1 failed\n"
+        "Heaviest commands, by peak memory:\n"
+        "  list     1 runs  max rss    8.0M  0 major faults  output    100B\n";
+    REQUIRE_EQ(formatStatsRanking(summaries, 1), expected);
+    REQUIRE_EQ(formatStatsRanking({}, 1), "No command ran yet\n");
+}
+
+TEST_SUITE_END();
+//NOLINTEND(readability-function-cognitive-complexity,cppcoreguidelines-avoid-do-while)
@@ -0,0 +1,142 @@
+#include <doctest/doctest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "../src/ExecutionControl.h"
+#include "../src/FanOut.h"
+
+using namespace replmk;
+
+//NOLINTBEGIN(readability-function-cognitive-complexity,cppcoreguidelines-avoid-do-while)
+TEST_SUITE_BEGIN("FanOut");
+
+TEST_CASE("parseFanOutArguments splits options, command and items") {
+    const std::vector<std::string_view> words{"-j16", "ping", "-c", "1", "{}", ":::", "a", "b"};
+    const auto arguments = parseFanOutArguments(words);
+    REQUIRE(arguments.has_value());
+    REQUIRE_EQ(arguments->concurrency, 16);
+    const std::vector<std::string> expectedCommandWords{"ping", "-c", "1", "{}"};
+    const std::vector<std::string> expectedItems{"a", "b"};
+    REQUIRE_EQ(arguments->commandWords, expectedCommandWords);
+    REQUIRE_EQ(arguments->items, expectedItems);
+    REQUIRE(arguments->hasItemsSeparator);
+
+    const std::vector<std::string_view> separateOption{"-j", "2", "check"};
+    const auto piped = parseFanOutArguments(separateOption);
+    REQUIRE(piped.has_value());
+    REQUIRE_EQ(piped->concurrency, 2);
+    REQUIRE_FALSE(piped->hasItemsSeparator);
+
+    const std::vector<std::string_view> noConcurrency{"check", ":::", "x"};
+    REQUIRE_EQ(parseFanOutArguments(noConcurrency)->concurrency, 0);
+
+    for (const auto& wrong : std::vector<std::vector<std::string_view>>{{}, {"-j0", "a"}, {"-jx", "a"}, {"-j"}, {"-j4", ":::", "a"}, {"a", ":::"}}) {
+        REQUIRE_FALSE(parseFanOutArguments(wrong).has_value());
+    }
+}
+
+TEST_CASE("Items replace placeholders or go last") {
+    const std::vector<std::string> withPlaceholders{"-h", "{}", "--out={}.log"};
+    const std::vector<std::string> replaced{"-h", "db1", "--out=db1.log"};
+    REQUIRE_EQ(substituteFanOutItem(withPlaceholders, "db1"), replaced);
+
+    const std::vector<std::string> withoutPlaceholders{"-c", "1"};
+    const std::vector<std::string> appended{"-c", "1", "db1"};
+    REQUIRE_EQ(substituteFanOutItem(withoutPlaceholders, "db1"), appended);
+
+    const std::vector<std::string> onlyItem{"db1"};
+    REQUIRE_EQ(substituteFanOutItem({}, "db1"), onlyItem);
+}
+
+TEST_CASE("Piped items are the non empty lines") {
+    const std::vector<std::string> expectedItems{"a", "b c", "d"};
+    REQUIRE_EQ(splitFanOutItems("a\n\nb c\r\nd"), expectedItems);
+    REQUIRE(splitFanOutItems("").empty());
+}
+
+TEST_CASE("runFanOut runs every item, never more than asked at a time") {
+    ExecutionControl control;
+    std::atomic<size_t> running{0};
+    std::atomic<size_t> maxRunning{0};
+    std::vector<size_t> doneItems;
+
+    const auto summary = runFanOut(20, 4, [&](size_t index, const CommandOutputCallbacks& callbacks) {
+        const auto nowRunning = running.fetch_add(1) + 1;
+        auto seen = maxRunning.load();
+        while (seen < nowRunning and not maxRunning.compare_exchange_weak(seen, nowRunning)) {
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds{5});
+        callbacks.onStdOut(std::to_string(index));
+        running.fetch_sub(1);
+        return index % 5 != 0;
+    }, control, [&doneItems](const FanOutItemResult& result) {
+        REQUIRE_EQ(result.stdOut, std::to_string(result.index));
+        doneItems.push_back(result.index);
+    });
+
+    REQUIRE_EQ(summary.succeeded, 16);
+    REQUIRE_EQ(summary.failed, 4);
+    REQUIRE_EQ(summary.notRun, 0);
+    REQUIRE_EQ(summary.concurrency, 4);
+    REQUIRE_LE(maxRunning.load(), 4);
+    REQUIRE_GT(maxRunning.load(), 1);
+
+    std::ranges::sort(doneItems);
+    REQUIRE_EQ(doneItems.size(), 20);
+    REQUIRE(std::ranges::adjacent_find(doneItems) == doneItems.end());
+}
+
+TEST_CASE("runFanOut stops starting items once cancelled") {
+    ExecutionControl control;
+    control.BeginCommand();
+    const auto summary = runFanOut(100, 2, [&control](size_t index, const CommandOutputCallbacks&) {
+        if (index == 3) {
+            control.RequestCancel();
+        }
+        return true;
+    }, control, [](const FanOutItemResult&) {});
+
+    REQUIRE_GT(summary.notRun, 0);
+    REQUIRE_EQ(summary.succeeded + summary.notRun, 100);
+    REQUIRE_NE(formatFanOutSummary(summary).find(" not run"), std::string::npos);
+}
+
+TEST_CASE("runFanOut keeps the interface going while items run, so they can be cancelled") {
+    ExecutionControl control;
+    int idleCalls = 0;
+    control.SetOnIdle([&control, &idleCalls]() {
+        if (++idleCalls == 3) {
+            control.RequestCancel();
+        }
+    });
+    control.BeginCommand();
+    // items that never finish on their own, like a command that hangs
+    const auto summary = runFanOut(4, 2, [&control](size_t, const CommandOutputCallbacks&) {
+        while (not control.IsCancelRequested()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds{5});
+        }
+        return false;
+    }, control, [](const FanOutItemResult&) {});
+
+    REQUIRE_GE(idleCalls, 3);
+    REQUIRE_EQ(summary.failed, 2);
+    REQUIRE_EQ(summary.notRun, 2);
+}
+
+TEST_CASE("Item output is grouped under a status line") {
+    const FanOutItemResult failed{.index = 0, .succeeded = false, .stdOut = "partial", .stdErr = "no route\nretrying\n", .elapsed = std::chrono::milliseconds{250}};
+    REQUIRE_EQ(formatFanOutItemOutput("db1", failed), "[failed 0.250s] db1\npartial\n");
+    REQUIRE_EQ(formatFanOutItemErrors("db1", failed), "db1: no route\ndb1: retrying\n");
+
+    const FanOutSummary summary{.succeeded = 3, .failed = 1, .notRun = 0, .concurrency = 4, .elapsed = std::chrono::seconds{2}};
+    REQUIRE_EQ(formatFanOutSummary(summary), "@each: 3 succeeded, 1 failed in 2.000s, 4 at a time\n");
+}
+
+TEST_SUITE_END();
+//NOLINTEND(readability-function-cognitive-complexity,cppcoreguidelines-avoid-do-while)
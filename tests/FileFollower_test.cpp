@@ -0,0 +1,187 @@
+#include <doctest/doctest.h>
+
+#include <chrono>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <stop_token>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include "../src/ExecutionControl.h"
+#include "../src/FileFollower.h"
+
+using namespace replmk;
+
+//NOLINTBEGIN(readability-function-cognitive-complexity,cppcoreguidelines-avoid-do-while)
+TEST_SUITE_BEGIN("FileFollower");
+
+namespace {
+// output written by the following thread, read by the test as it arrives
+class FollowedOutput final {
+  private:
+    mutable std::mutex outputMutex;
+    std::string stdOut;
+    std::string stdErr;
+
+  public:
+    auto Callbacks() -> CommandOutputCallbacks {
+        return CommandOutputCallbacks{
+            .onStdOut = [this](std::string_view chunk) {
+                const std::scoped_lock lock{this->outputMutex};
+                this->stdOut.append(chunk);
+            },
+            .onStdErr = [this](std::string_view chunk) {
+                const std::scoped_lock lock{this->outputMutex};
+                this->stdErr.append(chunk);
+            }
+        };
+    }
+
+    [[nodiscard]] auto StdOut() const -> std::string {
+        const std::scoped_lock lock{this->outputMutex};
+        return this->stdOut;
+    }
+
+    [[nodiscard]] auto StdErr() const -> std::string {
+        const std::scoped_lock lock{this->outputMutex};
+        return this->stdErr;
+    }
+
+    // true once the output ends with text, false when it doesn't within a few seconds
+    [[nodiscard]] auto WaitFor(std::string_view text) const -> bool {
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds{5};
+        while (std::chrono::steady_clock::now() < deadline) {
+            if (this->StdOut().ends_with(text)) {
+                return true;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds{10});
+        }
+        return false;
+    }
+};
+
+auto MakeFollowDirectory(const std::string& name) -> std::filesystem::path {
+    auto directory = std::filesystem::temp_directory_path() / (name + "_" + std::to_string(getpid()));
+    std::filesystem::remove_all(directory);
+    std::filesystem::create_directories(directory);
+    return directory;
+}
+
+auto AppendToFile(const std::filesystem::path& filePath, std::string_view text) -> void {
+    std::ofstream file{filePath, std::ios::app};
+    file << text;
+}
+}
+
+TEST_CASE("Followed paths are separated by whitespace") {
+    const std::vector<std::string> paths{"/var/log/app.log", "logs/worker.log"};
+    REQUIRE_EQ(splitFollowedPaths("  /var/log/app.log\n\tlogs/worker.log\n"), paths);
+    REQUIRE(splitFollowedPaths(" \n").empty());
+}
+
+TEST_CASE("The last lines are shown, then what is appended, truncated or rotated") {
+    const auto directory = MakeFollowDirectory("replmk_follow_single");
+    const auto logFile = directory / "app.log";
+    AppendToFile(logFile, "one\ntwo\nthree\n");
+
+    ExecutionControl control;
+    control.BeginCommand();
+    FollowedOutput output;
+    bool followed = false;
+    // a failed check stops the follower too, instead of waiting for it forever
+    std::jthread follower{[&](const std::stop_token& stopToken) {
+        const std::stop_callback cancelOnStop{stopToken, [&control]() {
+            control.RequestCancel();
+        }};
+        followed = followFiles({logFile}, output.Callbacks(), control, 2);
+    }};
+
+    REQUIRE(output.WaitFor("two\nthree\n"));
+    REQUIRE_EQ(output.StdOut(), "two\nthree\n");
+
+    AppendToFile(logFile, "four\n");
+    REQUIRE(output.WaitFor("three\nfour\n"));
+
+    // copytruncate rotation
+    std::filesystem::resize_file(logFile, 0);
+    AppendToFile(logFile, "after truncation\n");
+    REQUIRE(output.WaitFor("four\nafter truncation\n"));
+
+    // create rotation, the old file is moved away and a new one takes its name
+    std::filesystem::rename(logFile, directory / "app.log.1");
+    AppendToFile(logFile, "new file\n");
+    REQUIRE(output.WaitFor("after truncation\nnew file\n"));
+
+    follower.request_stop();
+    follower.join();
+    REQUIRE(followed);
+    REQUIRE_NE(output.StdErr().find("was truncated"), std::string::npos);
+    std::filesystem::remove_all(directory);
+}
+
+TEST_CASE("Following a file nobody writes to keeps the interface going and can be cancelled") {
+    const auto directory = MakeFollowDirectory("replmk_follow_quiet");
+    const auto logFile = directory / "quiet.log";
+    AppendToFile(logFile, "only line\n");
+
+    ExecutionControl control;
+    int idleCalls = 0;
+    // the interface reads Ctrl+C while it is given its turn
+    control.SetOnIdle([&control, &idleCalls]() {
+        if (++idleCalls == 3) {
+            control.RequestCancel();
+        }
+    });
+    control.BeginCommand();
+    FollowedOutput output;
+    REQUIRE(followFiles({logFile}, output.Callbacks(), control));
+    REQUIRE_EQ(idleCalls, 3);
+    REQUIRE_EQ(output.StdOut(), "only line\n");
+    std::filesystem::remove_all(directory);
+}
+
+TEST_CASE("Several files are followed at once, even before they exist") {
+    const auto directory = MakeFollowDirectory("replmk_follow_several");
+    const auto apiLog = directory / "api.log";
+    const auto workerLog = directory / "worker.log";
+    AppendToFile(apiLog, "api started\n");
+
+    ExecutionControl control;
+    control.BeginCommand();
+    FollowedOutput output;
+    bool followed = false;
+    std::jthread follower{[&](const std::stop_token& stopToken) {
+        const std::stop_callback cancelOnStop{stopToken, [&control]() {
+            control.RequestCancel();
+        }};
+        followed = followFiles({apiLog, workerLog, apiLog}, output.Callbacks(), control);
+    }};
+
+    REQUIRE(output.WaitFor("api started\n"));
+    AppendToFile(workerLog, "worker started");
+    REQUIRE(output.WaitFor("worker started"));
+    AppendToFile(apiLog, "api ready\n");
+    REQUIRE(output.WaitFor("api ready\n"));
+
+    follower.request_stop();
+    follower.join();
+    REQUIRE(followed);
+    const auto expected = std::format("==> {} <==\napi started\n==> {} <==\nworker started\n==> {} <==\napi ready\n",
+                                      apiLog.string(), workerLog.string(), apiLog.string());
+    REQUIRE_EQ(output.StdOut(), expected);
+    REQUIRE_NE(output.StdErr().find("does not exist yet"), std::string::npos);
+
+    // nothing can be followed in a directory that doesn't exist
+    FollowedOutput missingOutput;
+    REQUIRE_FALSE(followFiles({directory / "missing" / "app.log"}, missingOutput.Callbacks(), control));
+    std::filesystem::remove_all(directory);
+}
+
+TEST_SUITE_END();
+//NOLINTEND(readability-function-cognitive-complexity,cppcoreguidelines-avoid-do-while)
@@ -0,0 +1,187 @@
+#include <doctest/doctest.h>
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+
+#include "../src/JobTable.h"
+#include "../src/ProcessExecutor.h"
+#include "../src/Session.h"
+
+using namespace replmk;
+
+//NOLINTBEGIN(readability-function-cognitive-complexity,cppcoreguidelines-avoid-do-while)
+TEST_SUITE_BEGIN("JobTable");
+
+namespace {
+auto WaitForJob(const Job& job) -> void {
+    while (job.IsRunning()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds{5});
+    }
+}
+
+auto CopyAll(const Job& job, JobOutputCursor& cursor) -> std::pair<std::string, std::string> {
+    std::pair<std::string, std::string> output;
+    job.CopyOutput(cursor, CommandOutputCallbacks{
+        .onStdOut = [&output](std::string_view chunk) {
+            output.first.append(chunk);
+        },
+        .onStdErr = [&output](std::string_view chunk) {
+            output.second.append(chunk);
+        }
+    });
+    return output;
+}
+}
+
+TEST_CASE("Jobs run with a copy of the session and their own output") {
+    Session session;
+    session.workingDirectory = "/tmp";
+    session.variables["NAME"] = "value";
+    session.fullOutputDirectory = "/tmp/full-outputs";
+
+    JobTable jobs;
+    std::filesystem::path jobFullOutputDirectory;
+    auto& job = jobs.Start("work", session, [&jobFullOutputDirectory](Session& jobSession, OutputBuffers& outBuffers) {
+        outBuffers.AddNewEntry({.prompt = "", .stdOutEntry = jobSession.variables.at("NAME") + "\n", .stdErrEntry = ""});
+        jobFullOutputDirectory = jobSession.fullOutputDirectory;
+        jobSession.workingDirectory = "/";
+        return true;
+    });
+    WaitForJob(job);
+    // outputs too large to keep go where the REPL was told to write them
+    REQUIRE_EQ(jobFullOutputDirectory, "/tmp/full-outputs");
+
+    REQUIRE_EQ(job.Id(), 1);
+    REQUIRE_EQ(job.CommandLine(), "work");
+    REQUIRE_EQ(job.State(), JobState::Succeeded);
+    REQUIRE_EQ(job.BytesProduced(), 6);
+    REQUIRE(job.Processes().empty());
+    REQUIRE_EQ(session.workingDirectory, "/tmp");
+
+    auto& failed = jobs.Start("fail", session, [](Session&, OutputBuffers&) {
+        return false;
+    });
+    WaitForJob(failed);
+    REQUIRE_EQ(failed.Id(), 2);
+    REQUIRE_EQ(failed.State(), JobState::Failed);
+
+    REQUIRE_EQ(jobs.Find(std::nullopt), &failed);
+    REQUIRE_EQ(jobs.Find(1), &job);
+    REQUIRE_EQ(jobs.Find(3), nullptr);
+    jobs.Remove(1);
+    REQUIRE_EQ(jobs.Find(1), nullptr);
+    REQUIRE_EQ(jobs.Jobs().size(), 1);
+}
+
+TEST_CASE("Job output is copied once, as it grows") {
+    Session session;
+    JobTable jobs;
+    std::atomic<int> step{0};
+    auto& job = jobs.Start("steps", session, [&step](Session&, OutputBuffers& outBuffers) {
+        outBuffers.AddNewEntry({.prompt = "", .stdOutEntry = "one\n", .stdErrEntry = "warning\n"});
+        step.store(1);
+        while (step.load() != 2) {
+            std::this_thread::sleep_for(std::chrono::milliseconds{1});
+        }
+        outBuffers.AppendToLastStdOutEntry("two\n");
+        outBuffers.AddNewEntry({.prompt = "> next\n", .stdOutEntry = "three\n", .stdErrEntry = ""});
+        return true;
+    });
+
+    while (step.load() != 1) {
+        std::this_thread::sleep_for(std::chrono::milliseconds{1});
+    }
+    JobOutputCursor cursor;
+    const auto firstCopy = CopyAll(job, cursor);
+    REQUIRE_EQ(firstCopy.first, "one\n");
+    REQUIRE_EQ(firstCopy.second, "warning\n");
+
+    step.store(2);
+    WaitForJob(job);
+    const auto secondCopy = CopyAll(job, cursor);
+    REQUIRE_EQ(secondCopy.first, "two\n> next\nthree\n");
+    REQUIRE_EQ(secondCopy.second, "");
+    REQUIRE_EQ(CopyAll(job, cursor).first, "");
+}
+
+TEST_CASE("Killed jobs stop their processes and in-process commands") {
+    Session session;
+    JobTable jobs;
+    auto& job = jobs.Start("sleep", session, [](Session& jobSession, OutputBuffers&) {
+        ExecutionOptions options{};
+        options.control = &jobSession.control;
+        const bool slept = executeAndCaptureOutputs("sleep", {"30"}, CommandOutputCallbacks{
+            .onStdOut = [](std::string_view) {},
+            .onStdErr = [](std::string_view) {}
+        }, options);
+        // a builtin would poll the cancellation flag
+        while (not jobSession.control.IsCancelRequested()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds{1});
+        }
+        return slept;
+    });
+
+    while (job.Processes().empty()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds{1});
+    }
+    REQUIRE_EQ(job.State(), JobState::Running);
+
+    const auto killTime = std::chrono::steady_clock::now();
+    job.Kill();
+    WaitForJob(job);
+    REQUIRE_LT(std::chrono::steady_clock::now() - killTime, std::chrono::seconds{10});
+    REQUIRE_EQ(job.State(), JobState::Killed);
+    REQUIRE(job.Processes().empty());
+    REQUIRE_EQ(jobStateName(job.State()), "Killed");
+}
+
+TEST_CASE("Destroying the table stops the jobs still running") {
+    const auto startTime = std::chrono::steady_clock::now();
+    {
+        Session session;
+        JobTable jobs;
+        jobs.Start("forever", session, [](Session& jobSession, OutputBuffers&) {
+            while (not jobSession.control.IsCancelRequested()) {
+                std::this_thread::sleep_for(std::chrono::milliseconds{1});
+            }
+            return true;
+        });
+    }
+    REQUIRE_LT(std::chrono::steady_clock::now() - startTime, std::chrono::seconds{10});
+}
+
+TEST_CASE("Jobs ignoring SIGINT share one grace period when the table goes away") {
+    Session session;
+    std::atomic<int> ready{0};
+    std::optional<JobTable> jobs{std::in_place};
+    for (const auto* name : {"first", "second"}) {
+        jobs->Start(name, session, [&ready](Session& jobSession, OutputBuffers&) {
+            ExecutionOptions options{};
+            options.control = &jobSession.control;
+            return executeAndCaptureOutputs("sh", {"-c", "trap '' INT; echo ready; sleep 30"}, CommandOutputCallbacks{
+                .onStdOut = [&ready](std::string_view) {
+                    ready++;
+                },
+                .onStdErr = [](std::string_view) {}
+            }, options);
+        });
+    }
+    while (ready.load() < 2) {
+        std::this_thread::sleep_for(std::chrono::milliseconds{1});
+    }
+
+    const auto startTime = std::chrono::steady_clock::now();
+    jobs.reset();
+    const auto destroyTime = std::chrono::steady_clock::now() - startTime;
+    REQUIRE_GE(destroyTime, StopGracePeriod);
+    REQUIRE_LT(destroyTime, 2 * StopGracePeriod);
+}
+
+TEST_SUITE_END();
+//NOLINTEND(readability-function-cognitive-complexity,cppcoreguidelines-avoid-do-while)
@@ -1,4 +1,8 @@
 #include <doctest/doctest.h>
+#include <chrono>
+#include <string>
+#include <string_view>
+#include <vector>
 #include "../src/OutputBuffers.h"
 
 using namespace replmk;
@@ -97,6 +101,165 @@ TEST_CASE("Callback is not called if not set") {
     REQUIRE(buf[0].stdErrEntry == "bd");
 }
 
+TEST_CASE("The output of the last entry is replaced in place") {
+    OutputBuffers buffers;
+    REQUIRE_FALSE(buffers.ReplaceLastEntryOutput("out", "err"));
+
+    int changes = 0;
+    buffers.SetOnOutputChangedEvent([&changes](const OutputBuffers&) {
+        changes++;
+    });
+    buffers.AddNewEntry({.prompt = "first", .stdOutEntry="a", .stdErrEntry="b"});
+    buffers.AddNewEntry({.prompt = "> watch", .stdOutEntry="run 1\n", .stdErrEntry="warning\n"});
+    REQUIRE(buffers.ReplaceLastEntryOutput("run 2\n", ""));
+
+    const auto& buf = buffers.GetBuffer();
+    REQUIRE(buf.size() == 2);
+    REQUIRE(buf[0].stdOutEntry == "a");
+    REQUIRE(buf[1].prompt == "> watch");
+    REQUIRE(buf[1].stdOutEntry == "run 2\n");
+    REQUIRE(buf[1].stdErrEntry.empty());
+    REQUIRE(changes == 3);
+}
+
+TEST_CASE("Stdout and stderr are shown in the order they arrived") {
+    OutputBuffers buffers;
+    buffers.AddNewEntry({.prompt = "> make", .stdOutEntry = "", .stdErrEntry = ""});
+    REQUIRE(buffers.AppendToLastStdOutEntry("compiling a\n"));
+    REQUIRE(buffers.AppendToLastStdErrEntry("warning in a\n"));
+    REQUIRE(buffers.AppendToLastStdOutEntry("compiling b\n"));
+    REQUIRE(buffers.AppendToLastStdOutEntry("linking\n"));
+
+    const auto& entry = buffers.GetBuffer().at(0);
+    const auto runs = interleaveOutput(entry, std::chrono::seconds{1});
+    REQUIRE_EQ(runs.size(), 3);
+    REQUIRE(runs[0].stream == OutputStream::StdOut);
+    REQUIRE_EQ(entry.stdOutEntry.substr(runs[0].offset, runs[0].length), "compiling a\n");
+    REQUIRE(runs[1].stream == OutputStream::StdErr);
+    REQUIRE_EQ(entry.stdErrEntry.substr(runs[1].offset, runs[1].length), "warning in a\n");
+    REQUIRE(runs[2].stream == OutputStream::StdOut);
+    REQUIRE_EQ(entry.stdOutEntry.substr(runs[2].offset, runs[2].length), "compiling b\nlinking\n");
+}
+
+TEST_CASE("Pauses in the output split its runs") {
+    OutputBufferEntry entry{.prompt = "> poll", .stdOutEntry = "onetwothree", .stdErrEntry = "!"};
+    entry.chunkLog.Restore({
+        {.elapsedMilliseconds = 0, .length = 3, .stream = OutputStream::StdOut},
+        {.elapsedMilliseconds = 400, .length = 3, .stream = OutputStream::StdOut},
+        {.elapsedMilliseconds = 2500, .length = 5, .stream = OutputStream::StdOut},
+        {.elapsedMilliseconds = 2600, .length = 1, .stream = OutputStream::StdErr}
+    });
+
+    const auto runs = interleaveOutput(entry, std::chrono::seconds{1});
+    REQUIRE_EQ(runs.size(), 3);
+    REQUIRE_EQ(runs[0].length, 6);
+    REQUIRE_EQ(runs[1].offset, 6);
+    REQUIRE_EQ(runs[1].length, 5);
+    REQUIRE_EQ(runs[1].gapBefore, std::chrono::milliseconds{2100});
+    REQUIRE(runs[2].stream == OutputStream::StdErr);
+    REQUIRE_EQ(runs[2].offset, 0);
+    REQUIRE_EQ(runs[2].gapBefore, std::chrono::milliseconds{100});
+
+    // a log that doesn't cover the outputs is not trusted
+    entry.stdOutEntry.append("four");
+    const auto fallback = interleaveOutput(entry, std::chrono::seconds{1});
+    REQUIRE_EQ(fallback.size(), 2);
+    REQUIRE(fallback[0].stream == OutputStream::StdOut);
+    REQUIRE_EQ(fallback[0].length, 15);
+    REQUIRE(fallback[1].stream == OutputStream::StdErr);
+}
+
+TEST_CASE("Replaced output starts a new log") {
+    OutputBuffers buffers;
+    buffers.AddNewEntry({.prompt = "> watch", .stdOutEntry = "run 1\n", .stdErrEntry = ""});
+    REQUIRE(buffers.AppendToLastStdErrEntry("warning\n"));
+    REQUIRE(buffers.AppendToLastStdOutEntry("done\n"));
+    REQUIRE(buffers.ReplaceLastEntryOutput("run 2\n", "failed\n"));
+
+    const auto& chunks = buffers.GetBuffer().at(0).chunkLog.Chunks();
+    REQUIRE_EQ(chunks.size(), 2);
+    REQUIRE(chunks[0].stream == OutputStream::StdOut);
+    REQUIRE_EQ(chunks[0].length, 6);
+    REQUIRE(chunks[1].stream == OutputStream::StdErr);
+    REQUIRE_EQ(chunks[1].length, 7);
+}
+
+TEST_CASE("Colored output is kept as its text and styles") {
+    OutputBuffers buffers;
+    buffers.AddNewEntry({.prompt = "> test", .stdOutEntry = "\x1b[32mok\x1b[0m\n", .stdErrEntry = ""});
+    REQUIRE(buffers.AppendToLastStdOutEntry("\x1b[1;3"));
+    REQUIRE(buffers.AppendToLastStdOutEntry("1mfailed\x1b[0m\n"));
+    REQUIRE(buffers.AppendToLastStdErrEntry("\x1b[2Kwarning\n"));
+
+    const auto& entry = buffers.GetBuffer().at(0);
+    REQUIRE_EQ(entry.stdOutEntry, "ok\nfailed\n");
+    REQUIRE_EQ(entry.stdErrEntry, "warning\n");
+    REQUIRE_EQ(entry.stdOutStyles.size(), 4);
+    REQUIRE_EQ(entry.stdOutStyles[2].offset, 3);
+    REQUIRE(entry.stdOutStyles[2].style.Has(TextAttribute::Bold));
+    REQUIRE(entry.stdErrStyles.empty());
+    // the log and the lines count the text that is left
+    const auto runs = interleaveOutput(entry, std::chrono::seconds{1});
+    REQUIRE_EQ(runs.front().length, 10);
+    REQUIRE_EQ(outputLines(entry, OutputStream::StdOut).LineCount(), 2);
+
+    REQUIRE(buffers.ReplaceLastEntryOutput("\x1b[31mred", ""));
+    REQUIRE_EQ(buffers.GetBuffer().at(0).stdOutEntry, "red");
+    REQUIRE_EQ(buffers.GetBuffer().at(0).stdOutStyles.size(), 1);
+    REQUIRE_EQ(buffers.GetBuffer().at(0).chunkLog.Chunks().front().length, 3);
+}
+
+TEST_CASE("Lines are indexed as the output grows") {
+    OutputBuffers buffers;
+    buffers.AddNewEntry({.prompt = "> ls", .stdOutEntry = "a.txt\nb", .stdErrEntry = ""});
+    REQUIRE_EQ(outputLines(buffers.GetBuffer().at(0), OutputStream::StdOut).LineCount(), 2);
+    REQUIRE_EQ(outputLines(buffers.GetBuffer().at(0), OutputStream::StdErr).LineCount(), 0);
+
+    // the unfinished line is completed by what comes next
+    REQUIRE(buffers.AppendToLastStdOutEntry(".txt\n\nc.txt\n"));
+    REQUIRE(buffers.AppendToLastStdErrEntry("no d.txt"));
+    const auto lines = outputLines(buffers.GetBuffer().at(0), OutputStream::StdOut);
+    REQUIRE_EQ(lines.LineCount(), 4);
+    REQUIRE_EQ(lines.Line(0), "a.txt");
+    REQUIRE_EQ(lines.Line(1), "b.txt");
+    REQUIRE(lines.Line(2).empty());
+    REQUIRE_EQ(lines.Line(3), "c.txt");
+    REQUIRE_EQ(outputLines(buffers.GetBuffer().at(0), OutputStream::StdErr).Line(0), "no d.txt");
+
+    REQUIRE(buffers.ReplaceLastEntryOutput("x\ny\n", ""));
+    const auto replaced = outputLines(buffers.GetBuffer().at(0), OutputStream::StdOut);
+    REQUIRE_EQ(replaced.LineCount(), 2);
+    REQUIRE_EQ(replaced.Line(1), "y");
+    REQUIRE_EQ(outputLines(buffers.GetBuffer().at(0), OutputStream::StdErr).LineCount(), 0);
+}
+
+TEST_CASE("An index extended piece by piece matches one built at once") {
+    std::string text;
+    for (int line = 0; line < 1000; line++) {
+        text.append(std::string(static_cast<size_t>(line % 7), 'x')).append("\n");
+    }
+    text.append("end");
+
+    LineIndex whole;
+    whole.Extend(text);
+    LineIndex pieces;
+    for (size_t length = 0; length <= text.size(); length += 13) {
+        pieces.Extend(std::string_view{text}.substr(0, length));
+    }
+    pieces.Extend(text);
+    REQUIRE_EQ(whole.LineCount(), 1001);
+    REQUIRE_EQ(pieces.LineCount(), whole.LineCount());
+    for (size_t line = 0; line < whole.LineCount(); line++) {
+        REQUIRE_EQ(pieces.LineStart(line), whole.LineStart(line));
+        REQUIRE_EQ(pieces.LineLength(line), whole.LineLength(line));
+    }
+    REQUIRE_EQ(OutputLines(text, whole).Line(1000), "end");
+
+    // a shorter text is not a continuation
+    pieces.Extend("one\ntwo");
+    REQUIRE_EQ(pieces.LineCount(), 2);
+}
+
 TEST_SUITE_END();
 
 //NOLINTEND(readability-function-cognitive-complexity,cppcoreguidelines-avoid-do-while)
\ No newline at end of file
@@ -0,0 +1,146 @@
+#include <doctest/doctest.h>
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../src/OutputFilters.h"
+
+using namespace replmk;
+
+//NOLINTBEGIN(readability-function-cognitive-complexity,cppcoreguidelines-avoid-do-while)
+TEST_SUITE_BEGIN("OutputFilters");
+
+namespace {
+struct FilteredOutput {
+    std::string stdOut;
+    std::string stdErr;
+    size_t stdOutCalls{0};
+};
+
+auto MakeFilters(const std::vector<OutputFilterSpec>& specs) -> std::vector<OutputFilter> {
+    std::vector<OutputFilter> filters;
+    for (const auto& spec : specs) {
+        auto filter = makeOutputFilter(spec);
+        REQUIRE(filter.has_value());
+        filters.push_back(std::move(filter.value()));
+    }
+    return filters;
+}
+
+auto RunFilters(const std::vector<OutputFilterSpec>& specs, const std::vector<std::string_view>& chunks) -> FilteredOutput {
+    FilteredOutput output;
+    OutputFilterChain chain{MakeFilters(specs), CommandOutputCallbacks{
+        .onStdOut = [&output](std::string_view chunk) {
+            output.stdOut.append(chunk);
+            output.stdOutCalls++;
+        },
+        .onStdErr = [&output](std::string_view chunk) {
+            output.stdErr.append(chunk);
+        }
+    }};
+
+    const auto callbacks = chain.Callbacks();
+    for (const auto chunk : chunks) {
+        callbacks.onStdOut(chunk);
+    }
+    chain.Finish();
+    return output;
+}
+}
+
+TEST_CASE("Filter names are recognized by their prefix") {
+    REQUIRE(isOutputFilterName("@grep"));
+    REQUIRE_FALSE(isOutputFilterName("@"));
+    REQUIRE_FALSE(isOutputFilterName("grep"));
+}
+
+TEST_CASE("makeOutputFilter validates names and arguments") {
+    REQUIRE(makeOutputFilter({.name = "grep", .args = {"-v", "text"}}).has_value());
+    REQUIRE(makeOutputFilter({.name = "head", .args = {}}).has_value());
+    REQUIRE(makeOutputFilter({.name = "tail", .args = {"5"}}).has_value());
+
+    REQUIRE_FALSE(makeOutputFilter({.name = "grep", .args = {}}).has_value());
+    REQUIRE_FALSE(makeOutputFilter({.name = "grep", .args = {"a", "b"}}).has_value());
+    REQUIRE_FALSE(makeOutputFilter({.name = "head", .args = {"-1"}}).has_value());
+    REQUIRE_FALSE(makeOutputFilter({.name = "tail", .args = {"ten"}}).has_value());
+    REQUIRE_FALSE(makeOutputFilter({.name = "uniq", .args = {"-c"}}).has_value());
+
+    const auto unknown = makeOutputFilter({.name = "sort", .args = {}});
+    REQUIRE_FALSE(unknown.has_value());
+    REQUIRE_NE(unknown.error().find("'@sort'"), std::string::npos);
+}
+
+TEST_CASE("Lines split across chunks are put back together") {
+    const auto output = RunFilters({{.name = "grep", .args = {"needle"}}}, {"hay\nhayne", "edle hay\nnee", "dle\nneedle without newline"});
+    REQUIRE_EQ(output.stdOut, "hayneedle hay\nneedle\nneedle without newline\n");
+}
+
+TEST_CASE("Each chunk is passed downstream at most once") {
+    const auto output = RunFilters({{.name = "grep", .args = {"-v", "skip"}}}, {"a\nskip\nb\nc\n", "skip\n", "d\n"});
+    REQUIRE_EQ(output.stdOut, "a\nb\nc\nd\n");
+    REQUIRE_EQ(output.stdOutCalls, 2);
+}
+
+TEST_CASE("grep ignores case on request") {
+    const auto output = RunFilters({{.name = "grep", .args = {"-i", "ERROR"}}}, {"an error\nfine\nError again\n"});
+    REQUIRE_EQ(output.stdOut, "an error\nError again\n");
+}
+
+TEST_CASE("head, tail, uniq and count") {
+    const std::string_view lines = "1\n1\n2\n3\n3\n3\n4\n";
+
+    REQUIRE_EQ(RunFilters({{.name = "head", .args = {"2"}}}, {lines}).stdOut, "1\n1\n");
+    REQUIRE_EQ(RunFilters({{.name = "tail", .args = {"2"}}}, {lines}).stdOut, "3\n4\n");
+    REQUIRE_EQ(RunFilters({{.name = "tail", .args = {"0"}}}, {lines}).stdOut, "");
+    REQUIRE_EQ(RunFilters({{.name = "tail", .args = {"100"}}}, {lines}).stdOut, lines);
+    REQUIRE_EQ(RunFilters({{.name = "uniq", .args = {}}}, {lines}).stdOut, "1\n2\n3\n4\n");
+    REQUIRE_EQ(RunFilters({{.name = "count", .args = {}}}, {lines}).stdOut, "7\n");
+    REQUIRE_EQ(RunFilters({{.name = "count", .args = {}}}, {}).stdOut, "0\n");
+}
+
+TEST_CASE("Filters are applied in order") {
+    const std::string_view lines = "a1\nb\na2\na2\na3\nb\na4\n";
+
+    REQUIRE_EQ(RunFilters({{.name = "grep", .args = {"a"}}, {.name = "uniq", .args = {}}, {.name = "count", .args = {}}}, {lines}).stdOut, "4\n");
+    REQUIRE_EQ(RunFilters({{.name = "tail", .args = {"3"}}, {.name = "head", .args = {"1"}}}, {lines}).stdOut, "a3\n");
+    REQUIRE_EQ(RunFilters({{.name = "head", .args = {"3"}}, {.name = "count", .args = {}}}, {lines}).stdOut, "3\n");
+}
+
+TEST_CASE("Output past a full head is not even split") {
+    FilteredOutput output;
+    OutputFilterChain chain{MakeFilters({{.name = "grep", .args = {"x"}}, {.name = "head", .args = {"1"}}}), CommandOutputCallbacks{
+        .onStdOut = [&output](std::string_view chunk) {
+            output.stdOut.append(chunk);
+        },
+        .onStdErr = [&output](std::string_view chunk) {
+            output.stdErr.append(chunk);
+        }
+    }};
+
+    chain.Feed("x1\nx2\n");
+    // the partial line left by this chunk is dropped, no line can get through anymore
+    chain.Feed("x3");
+    chain.Finish();
+    REQUIRE_EQ(output.stdOut, "x1\n");
+}
+
+TEST_CASE("stderr goes straight downstream") {
+    FilteredOutput output;
+    OutputFilterChain chain{MakeFilters({{.name = "count", .args = {}}}), CommandOutputCallbacks{
+        .onStdOut = [&output](std::string_view chunk) {
+            output.stdOut.append(chunk);
+        },
+        .onStdErr = [&output](std::string_view chunk) {
+            output.stdErr.append(chunk);
+        }
+    }};
+
+    chain.Callbacks().onStdErr("not\ncounted\n");
+    chain.Finish();
+    REQUIRE_EQ(output.stdErr, "not\ncounted\n");
+    REQUIRE_EQ(output.stdOut, "0\n");
+}
+
+TEST_SUITE_END();
+//NOLINTEND(readability-function-cognitive-complexity,cppcoreguidelines-avoid-do-while)
@@ -1,6 +1,7 @@
 #include <doctest/doctest.h>
 #include <filesystem>
 #include <fstream>
+#include <chrono>
 #include <vector>
 #include "OutputHistory.h"
 #include "OutputBuffers.h"
@@ -103,6 +104,129 @@ TEST_CASE("Load and save without stdout stderr") {
     verifyLoadAndSaveWithEntries(entries);
 }
 
+TEST_CASE("Execution stats are kept with their entry") {
+    const std::filesystem::path tempFilePath(std::filesystem::temp_directory_path() / "output_history_test.txt");
+    std::filesystem::remove(tempFilePath);
+
+    OutputBuffers buffers;
+    buffers.AddNewEntry({.prompt = "> build\n", .stdOutEntry = "built\n", .stdErrEntry = ""});
+    REQUIRE(buffers.SetLastEntryStats(ExecutionStats{
+        .command = "build | tee", .wallTime = std::chrono::milliseconds{1500}, .userCpu = std::chrono::microseconds{900000},
+        .systemCpu = std::chrono::microseconds{100000}, .maxRssKiB = 2048, .majorFaults = 1, .stdOutBytes = 6, .stdErrBytes = 0,
+        .exitCode = std::nullopt, .signal = 9
+    }));
+    // written by help, that isn't measured
+    buffers.AddNewEntry({.prompt = "> help\n", .stdOutEntry = "commands\n", .stdErrEntry = ""});
+    auto outHistory = OutputHistory(tempFilePath);
+    REQUIRE(outHistory.Save(buffers));
+
+    OutputBuffers loadedBuffers;
+    REQUIRE(outHistory.Load(loadedBuffers));
+    REQUIRE_EQ(loadedBuffers.GetBuffer().size(), 2);
+    const auto& stats = loadedBuffers.GetBuffer().at(0).stats;
+    REQUIRE(stats.has_value());
+    REQUIRE_EQ(stats->command, "build | tee");
+    REQUIRE_EQ(stats->wallTime.count(), 1500);
+    REQUIRE_EQ(stats->maxRssKiB, 2048);
+    REQUIRE_FALSE(stats->exitCode.has_value());
+    REQUIRE_EQ(stats->signal, 9);
+    REQUIRE_EQ(loadedBuffers.GetBuffer().at(1).stdOutEntry, "commands\n");
+    REQUIRE_FALSE(loadedBuffers.GetBuffer().at(1).stats.has_value());
+
+    REQUIRE(std::filesystem::remove(tempFilePath));
+}
+
+TEST_CASE("Elided outputs keep their marker") {
+    const std::filesystem::path tempFilePath(std::filesystem::temp_directory_path() / "output_history_elided_test.txt");
+    std::filesystem::remove(tempFilePath);
+
+    OutputBuffers buffers;
+    buffers.AddNewEntry({.prompt = "> build\n", .stdOutEntry = "first\n", .stdErrEntry = "warning\n"});
+    REQUIRE(buffers.MarkLastStdOutElided(ElidedOutput{.offset = 0, .bytes = 4096, .lines = 12, .fullOutputPath = "/tmp/build output.stdout"}));
+    REQUIRE(buffers.AppendToLastStdOutEntry("last\n"));
+    REQUIRE(buffers.MarkLastStdErrElided(ElidedOutput{.offset = 0, .bytes = 10, .lines = 1, .fullOutputPath = ""}));
+    buffers.AddNewEntry({.prompt = "> help\n", .stdOutEntry = "commands\n", .stdErrEntry = ""});
+    auto outHistory = OutputHistory(tempFilePath);
+    REQUIRE(outHistory.Save(buffers));
+
+    OutputBuffers loadedBuffers;
+    REQUIRE(outHistory.Load(loadedBuffers));
+    REQUIRE_EQ(loadedBuffers.GetBuffer().size(), 2);
+    const auto& entry = loadedBuffers.GetBuffer().at(0);
+    REQUIRE_EQ(entry.stdOutEntry, "first\nlast\n");
+    REQUIRE(entry.stdOutElided.has_value());
+    REQUIRE_EQ(entry.stdOutElided->offset, 6);
+    REQUIRE_EQ(entry.stdOutElided->bytes, 4096);
+    REQUIRE_EQ(entry.stdOutElided->lines, 12);
+    REQUIRE_EQ(entry.stdOutElided->fullOutputPath, "/tmp/build output.stdout");
+    REQUIRE(entry.stdErrElided.has_value());
+    REQUIRE_EQ(entry.stdErrElided->offset, 8);
+    REQUIRE(entry.stdErrElided->fullOutputPath.empty());
+    REQUIRE_FALSE(loadedBuffers.GetBuffer().at(1).stdOutElided.has_value());
+
+    REQUIRE(std::filesystem::remove(tempFilePath));
+}
+
+TEST_CASE("The order stdout and stderr arrived in is kept") {
+    const std::filesystem::path tempFilePath(std::filesystem::temp_directory_path() / "output_history_chunks_test.txt");
+    std::filesystem::remove(tempFilePath);
+
+    OutputBuffers buffers;
+    buffers.AddNewEntry({.prompt = "> make\n", .stdOutEntry = "", .stdErrEntry = ""});
+    REQUIRE(buffers.AppendToLastStdOutEntry("compiling\n"));
+    REQUIRE(buffers.AppendToLastStdErrEntry("warning\n"));
+    REQUIRE(buffers.AppendToLastStdOutEntry("linking\n"));
+    auto outHistory = OutputHistory(tempFilePath);
+    REQUIRE(outHistory.Save(buffers));
+
+    OutputBuffers loadedBuffers;
+    REQUIRE(outHistory.Load(loadedBuffers));
+    REQUIRE_EQ(loadedBuffers.GetBuffer().size(), 1);
+    const auto& saved = buffers.GetBuffer().at(0).chunkLog.Chunks();
+    const auto& loaded = loadedBuffers.GetBuffer().at(0).chunkLog.Chunks();
+    REQUIRE_EQ(loaded.size(), saved.size());
+    for (size_t index = 0; index < saved.size(); index++) {
+        REQUIRE(loaded[index].stream == saved[index].stream);
+        REQUIRE_EQ(loaded[index].length, saved[index].length);
+        REQUIRE_EQ(loaded[index].elapsedMilliseconds, saved[index].elapsedMilliseconds);
+    }
+    REQUIRE_EQ(interleaveOutput(loadedBuffers.GetBuffer().at(0), std::chrono::seconds{1}).size(), 3);
+
+    REQUIRE(std::filesystem::remove(tempFilePath));
+}
+
+TEST_CASE("The styles of the outputs are kept") {
+    const std::filesystem::path tempFilePath(std::filesystem::temp_directory_path() / "output_history_styles_test.txt");
+    std::filesystem::remove(tempFilePath);
+
+    OutputBuffers buffers;
+    buffers.AddNewEntry({.prompt = "> test\n", .stdOutEntry = "", .stdErrEntry = ""});
+    REQUIRE(buffers.AppendToLastStdOutEntry("\x1b[1;32mpassed\x1b[0m 3\n"));
+    REQUIRE(buffers.AppendToLastStdErrEntry("\x1b[38;2;255;128;0mslow\n"));
+    // without stats, STYLES follows STDERR
+    buffers.AddNewEntry({.prompt = "> log\n", .stdOutEntry = "\x1b[4mseen\x1b[24m\n", .stdErrEntry = ""});
+    auto outHistory = OutputHistory(tempFilePath);
+    REQUIRE(outHistory.Save(buffers));
+
+    OutputBuffers loadedBuffers;
+    REQUIRE(outHistory.Load(loadedBuffers));
+    REQUIRE_EQ(loadedBuffers.GetBuffer().size(), 2);
+    for (size_t index = 0; index < 2; index++) {
+        const auto& saved = buffers.GetBuffer().at(index);
+        const auto& loaded = loadedBuffers.GetBuffer().at(index);
+        REQUIRE_EQ(loaded.stdOutEntry, saved.stdOutEntry);
+        REQUIRE_EQ(loaded.stdOutStyles.size(), saved.stdOutStyles.size());
+        REQUIRE_EQ(loaded.stdErrStyles.size(), saved.stdErrStyles.size());
+        for (size_t span = 0; span < saved.stdOutStyles.size(); span++) {
+            REQUIRE_EQ(loaded.stdOutStyles[span].offset, saved.stdOutStyles[span].offset);
+            REQUIRE(loaded.stdOutStyles[span].style == saved.stdOutStyles[span].style);
+        }
+    }
+    REQUIRE_EQ(loadedBuffers.GetBuffer().at(0).stdErrStyles.front().style.foreground.red, 255);
+
+    REQUIRE(std::filesystem::remove(tempFilePath));
+}
+
 TEST_CASE("Load and save with invalid path") {
     OutputBuffers buffers;
     const std::filesystem::path tempFilePath(std::filesystem::temp_directory_path() / "/not/a/valid/path/output_history_test.txt");
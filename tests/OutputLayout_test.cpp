@@ -0,0 +1,204 @@
+#include <doctest/doctest.h>
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../src/OutputLayout.h"
+
+using namespace replmk;
+
+//NOLINTBEGIN(readability-function-cognitive-complexity,cppcoreguidelines-avoid-do-while)
+TEST_SUITE_BEGIN("OutputLayout");
+
+namespace {
+auto RowTexts(const OutputBufferEntry& entry, const std::vector<OutputRow>& rows) -> std::vector<std::string> {
+    std::vector<std::string> texts;
+    for (const auto& row : rows) {
+        texts.emplace_back(rowText(entry, row));
+    }
+    return texts;
+}
+
+auto RowKinds(const std::vector<OutputRow>& rows) -> std::vector<OutputRowKind> {
+    std::vector<OutputRowKind> kinds;
+    for (const auto& row : rows) {
+        kinds.push_back(row.kind);
+    }
+    return kinds;
+}
+
+auto SameRows(const std::vector<OutputRow>& first, const std::vector<OutputRow>& second) -> bool {
+    if (first.size() != second.size()) {
+        return false;
+    }
+    for (size_t index = 0; index < first.size(); index++) {
+        if (first[index].offset != second[index].offset or first[index].length != second[index].length or first[index].kind != second[index].kind) {
+            return false;
+        }
+    }
+    return true;
+}
+}
+
+TEST_CASE("Lines wider than the frame take several rows") {
+    OutputBuffers buffers;
+    buffers.AddNewEntry({.prompt = "> ls\n", .stdOutEntry = "abcdefghij\n\nxyz", .stdErrEntry = ""});
+    const auto& entry = buffers.GetBuffer().at(0);
+    const auto rows = layoutEntry(entry, 4);
+    const std::vector<std::string> expected{"> ls", "abcd", "efgh", "ij", "", "xyz"};
+    REQUIRE_EQ(RowTexts(entry, rows), expected);
+    REQUIRE(rows.front().kind == OutputRowKind::Prompt);
+    REQUIRE(rows.back().kind == OutputRowKind::StdOut);
+
+    // characters, not bytes, fill a row
+    buffers.AddNewEntry({.prompt = "", .stdOutEntry = "ééééé\n", .stdErrEntry = ""});
+    const auto& accented = buffers.GetBuffer().at(1);
+    const std::vector<std::string> expectedAccented{"éé", "éé", "é"};
+    REQUIRE_EQ(RowTexts(accented, layoutEntry(accented, 2)), expectedAccented);
+}
+
+TEST_CASE("Stderr, pauses and markers get rows of their own") {
+    OutputBufferEntry entry{.prompt = "> make\n", .stdOutEntry = "compiling\nlinking\n", .stdErrEntry = "warning\n"};
+    entry.chunkLog.Restore({
+        {.elapsedMilliseconds = 0, .length = 10, .stream = OutputStream::StdOut},
+        {.elapsedMilliseconds = 10, .length = 8, .stream = OutputStream::StdErr},
+        {.elapsedMilliseconds = 3010, .length = 8, .stream = OutputStream::StdOut}
+    });
+    const auto rows = layoutEntry(entry, 80);
+    const std::vector<OutputRowKind> expectedKinds{OutputRowKind::Prompt, OutputRowKind::StdOut, OutputRowKind::StdErrBorder, OutputRowKind::StdErr,
+                                                   OutputRowKind::StdErrBorder, OutputRowKind::Pause, OutputRowKind::StdOut};
+    REQUIRE_EQ(RowKinds(rows), expectedKinds);
+    REQUIRE_EQ(rowText(entry, rows.at(3)), "warning");
+    REQUIRE_EQ(rows.at(5).length, 3000);
+    REQUIRE_EQ(rowText(entry, rows.at(6)), "linking");
+
+    OutputBufferEntry elided{.prompt = "", .stdOutEntry = "head\ntail\n", .stdErrEntry = ""};
+    elided.stdOutElided = ElidedOutput{.offset = 5, .bytes = 100, .lines = 10, .fullOutputPath = ""};
+    elided.stdErrElided = ElidedOutput{.offset = 0, .bytes = 100, .lines = 10, .fullOutputPath = ""};
+    const auto elidedRows = layoutEntry(elided, 80);
+    const std::vector<OutputRowKind> expectedElided{OutputRowKind::StdOut, OutputRowKind::StdOutElided, OutputRowKind::StdOut, OutputRowKind::StdErrElided};
+    REQUIRE_EQ(RowKinds(elidedRows), expectedElided);
+    REQUIRE_EQ(rowText(elided, elidedRows.at(2)), "tail");
+}
+
+TEST_CASE("Updating the layout as output arrives gives the rows of laying it out again") {
+    OutputBuffers buffers;
+    OutputLayout layout;
+    const auto check = [&buffers, &layout](size_t width) {
+        layout.Update(buffers.GetBuffer(), width);
+        size_t rowCount = 0;
+        for (size_t index = 0; index < buffers.GetBuffer().size(); index++) {
+            REQUIRE(SameRows(layout.Rows(index), layoutEntry(buffers.GetBuffer().at(index), width)));
+            REQUIRE_EQ(layout.EntryFirstRow(index), rowCount);
+            rowCount += layout.Rows(index).size();
+        }
+        REQUIRE_EQ(layout.RowCount(), rowCount);
+    };
+
+    buffers.AddNewEntry({.prompt = "> help\n", .stdOutEntry = "commands\n", .stdErrEntry = ""});
+    buffers.AddNewEntry({.prompt = "> build\n", .stdOutEntry = "", .stdErrEntry = ""});
+    check(10);
+    for (const std::string_view piece : {"step ", "1 of 3\n", "step 2 ", "of 3\nstep 3"}) {
+        REQUIRE(buffers.AppendToLastStdOutEntry(piece));
+        check(10);
+        REQUIRE(buffers.AppendToLastStdErrEntry("warn\n"));
+        check(10);
+    }
+    REQUIRE(buffers.MarkLastStdOutElided(ElidedOutput{.offset = 0, .bytes = 4096, .lines = 100, .fullOutputPath = ""}));
+    check(10);
+    REQUIRE(buffers.AppendToLastStdOutEntry("last line\n"));
+    check(10);
+    // a narrower frame lays everything out again
+    check(4);
+    REQUIRE(buffers.ReplaceLastEntryOutput("done\n", ""));
+    check(4);
+}
+
+TEST_CASE("Output replaced by text of the same size is laid out again") {
+    OutputBuffers buffers;
+    OutputLayout layout;
+    buffers.AddNewEntry({.prompt = "> watch\n", .stdOutEntry = "ab\ncd\n", .stdErrEntry = ""});
+    layout.Update(buffers.GetBuffer(), 10);
+
+    REQUIRE(buffers.ReplaceLastEntryOutput("abc\nd\n", ""));
+    layout.Update(buffers.GetBuffer(), 10);
+    const auto& entry = buffers.GetBuffer().at(0);
+    REQUIRE(SameRows(layout.Rows(0), layoutEntry(entry, 10)));
+    const std::vector<std::string> expected{"> watch", "abc", "d"};
+    REQUIRE_EQ(RowTexts(entry, layout.Rows(0)), expected);
+
+    // a longer replacement doesn't keep the rows before it either
+    REQUIRE(buffers.ReplaceLastEntryOutput("a\nbcdef\n", ""));
+    layout.Update(buffers.GetBuffer(), 10);
+    REQUIRE(SameRows(layout.Rows(0), layoutEntry(buffers.GetBuffer().at(0), 10)));
+    REQUIRE(buffers.AppendToLastStdOutEntry("g\n"));
+    layout.Update(buffers.GetBuffer(), 10);
+    REQUIRE(SameRows(layout.Rows(0), layoutEntry(buffers.GetBuffer().at(0), 10)));
+}
+
+TEST_CASE("Rows lead to their entries and back") {
+    OutputBuffers buffers;
+    buffers.AddNewEntry({.prompt = "> one\n", .stdOutEntry = "1\n", .stdErrEntry = ""});
+    buffers.AddNewEntry({.prompt = "", .stdOutEntry = "", .stdErrEntry = ""});
+    buffers.AddNewEntry({.prompt = "> three\n", .stdOutEntry = "3\n3\n", .stdErrEntry = ""});
+    OutputLayout layout;
+    layout.Update(buffers.GetBuffer(), 80);
+    REQUIRE_EQ(layout.RowCount(), 5);
+    REQUIRE_EQ(layout.EntryFirstRow(2), 2);
+    REQUIRE_EQ(layout.EntryAt(1), 0);
+    // the entry without rows is never the one shown
+    REQUIRE_EQ(layout.EntryAt(2), 2);
+    REQUIRE_EQ(layout.EntryAt(100), 2);
+
+    REQUIRE_EQ(previousEntryRow(layout, 4), 2);
+    REQUIRE_EQ(previousEntryRow(layout, 2), 0);
+    REQUIRE_EQ(previousEntryRow(layout, 0), 0);
+    REQUIRE_EQ(nextEntryRow(layout, 0), 2);
+    REQUIRE_EQ(nextEntryRow(layout, 3), 5);
+}
+
+TEST_CASE("The scroll follows the tail until scrolled away from it") {
+    OutputScroll scroll;
+    scroll.Resize(100, 10);
+    REQUIRE(scroll.IsFollowingTail());
+    REQUIRE_EQ(scroll.FirstRow(), 90);
+    scroll.Resize(120, 10);
+    REQUIRE_EQ(scroll.FirstRow(), 110);
+
+    scroll.PageUp();
+    REQUIRE_EQ(scroll.FirstRow(), 100);
+    REQUIRE_FALSE(scroll.IsFollowingTail());
+    // new rows don't move what is being read
+    scroll.Resize(200, 10);
+    REQUIRE_EQ(scroll.FirstRow(), 100);
+
+    scroll.ScrollBy(-3);
+    REQUIRE_EQ(scroll.FirstRow(), 97);
+    scroll.ToTop();
+    REQUIRE_EQ(scroll.FirstRow(), 0);
+    scroll.ScrollBy(-3);
+    REQUIRE_EQ(scroll.FirstRow(), 0);
+    const auto top = scroll.Thumb();
+    REQUIRE_EQ(top.first, 0);
+    REQUIRE_EQ(top.second, 1);
+
+    scroll.ScrollTo(185);
+    REQUIRE_EQ(scroll.FirstRow(), 185);
+    scroll.PageDown();
+    REQUIRE_EQ(scroll.FirstRow(), 190);
+    REQUIRE(scroll.IsFollowingTail());
+    REQUIRE_EQ(scroll.Thumb().first, 9);
+    scroll.Resize(300, 20);
+    REQUIRE_EQ(scroll.FirstRow(), 280);
+
+    // everything fits, there is nowhere to scroll to
+    scroll.Resize(5, 20);
+    scroll.PageUp();
+    REQUIRE_EQ(scroll.FirstRow(), 0);
+    REQUIRE(scroll.IsFollowingTail());
+    REQUIRE_EQ(scroll.Thumb().second, 0);
+}
+
+TEST_SUITE_END();
+//NOLINTEND(readability-function-cognitive-complexity,cppcoreguidelines-avoid-do-while)
@@ -0,0 +1,68 @@
+#include <doctest/doctest.h>
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+#include <unistd.h>
+
+#include "../src/OutputRedirection.h"
+
+using namespace replmk;
+
+//NOLINTBEGIN(readability-function-cognitive-complexity,cppcoreguidelines-avoid-do-while)
+TEST_SUITE_BEGIN("OutputRedirection");
+
+namespace {
+auto ReadFile(const std::filesystem::path& filePath) -> std::string {
+    std::ifstream file{filePath};
+    return {std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{}};
+}
+}
+
+TEST_CASE("Files are truncated or appended to") {
+    const auto filePath = std::filesystem::temp_directory_path() / ("replmk_redirection_test_" + std::to_string(getpid()));
+    std::ofstream{filePath} << "previous\n";
+
+    {
+        OutputRedirectionFile file;
+        REQUIRE(file.Open(filePath, true).has_value());
+        file.Writer()("appended\n");
+        REQUIRE_EQ(file.BytesWritten(), 9);
+    }
+    REQUIRE_EQ(ReadFile(filePath), "previous\nappended\n");
+
+    {
+        OutputRedirectionFile file;
+        REQUIRE(file.Open(filePath, false).has_value());
+        REQUIRE_EQ(file.BytesWritten(), 0);
+        file.Writer()("new\n");
+        REQUIRE_EQ(file.BytesWritten(), 4);
+        REQUIRE_EQ(formatRedirectionSummary("stdout", file, std::chrono::milliseconds{1500}),
+                   "stdout written to '" + filePath.string() + "': 4 bytes in 1.500s\n");
+    }
+    REQUIRE_EQ(ReadFile(filePath), "new\n");
+
+    std::filesystem::remove(filePath);
+}
+
+TEST_CASE("Sizes are only reported for regular files") {
+    OutputRedirectionFile file;
+    REQUIRE(file.Open("/dev/null", false).has_value());
+    file.Writer()("discarded");
+    REQUIRE_FALSE(file.BytesWritten().has_value());
+    REQUIRE_EQ(formatRedirectionSummary("stderr", file, std::chrono::seconds{0}), "stderr sent to '/dev/null' in 0.000s\n");
+}
+
+TEST_CASE("Open reports why a file can't be written") {
+    OutputRedirectionFile file;
+    const auto opened = file.Open("/nonexistent-replmk-dir/out.txt", false);
+    REQUIRE_FALSE(opened.has_value());
+    REQUIRE_NE(opened.error().find("Could not open '/nonexistent-replmk-dir/out.txt' for writing"), std::string::npos);
+    REQUIRE_LT(file.Descriptor(), 0);
+}
+
+TEST_SUITE_END();
+//NOLINTEND(readability-function-cognitive-complexity,cppcoreguidelines-avoid-do-while)
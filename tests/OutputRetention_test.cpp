@@ -0,0 +1,120 @@
+#include <doctest/doctest.h>
+
+#include <filesystem>
+#include <fstream>
+#include <initializer_list>
+#include <iterator>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "../src/ExecutionStats.h"
+#include "../src/OutputRetention.h"
+
+using namespace replmk;
+
+//NOLINTBEGIN(readability-function-cognitive-complexity,cppcoreguidelines-avoid-do-while)
+TEST_SUITE_BEGIN("OutputRetention");
+
+namespace {
+struct RetainedResult {
+    std::string kept;
+    std::optional<ElidedOutput> elided;
+};
+
+// feeds the output in chunks of chunkSize bytes
+auto Retain(const OutputRetentionPolicy& policy, const std::string& output, size_t chunkSize,
+            const std::filesystem::path& fullOutputPath = {}) -> RetainedResult {
+    RetainedResult result;
+    OutputRetention retention{policy, [&result](std::string_view chunk) {
+        result.kept.append(chunk);
+    }, [&result](const ElidedOutput& elided) {
+        result.elided = elided;
+    }, fullOutputPath};
+    for (size_t offset = 0; offset < output.size(); offset += chunkSize) {
+        retention.Feed(std::string_view{output}.substr(offset, chunkSize));
+    }
+    retention.Finish();
+    return result;
+}
+
+auto MakeLines(size_t count) -> std::string {
+    std::string lines;
+    for (size_t index = 0; index < count; index++) {
+        lines.append("line " + std::to_string(index) + "\n");
+    }
+    return lines;
+}
+}
+
+TEST_CASE("Outputs within the policy are kept whole") {
+    const OutputRetentionPolicy policy{.headBytes = 8, .tailBytes = 8, .keepFullOutput = false};
+    for (const size_t chunkSize : std::initializer_list<size_t>{1, 3, 100}) {
+        const auto result = Retain(policy, "0123456789abcdef", chunkSize);
+        REQUIRE_EQ(result.kept, "0123456789abcdef");
+        REQUIRE_FALSE(result.elided.has_value());
+    }
+}
+
+TEST_CASE("Larger outputs keep their start and end, the middle is counted") {
+    const OutputRetentionPolicy policy{.headBytes = 14, .tailBytes = 16, .keepFullOutput = false};
+    const auto output = MakeLines(100);
+    // however the output arrives, the same bytes are kept
+    for (const size_t chunkSize : std::initializer_list<size_t>{1, 7, 15, 16, 17, 64, 4096}) {
+        const auto result = Retain(policy, output, chunkSize);
+        REQUIRE_EQ(result.kept, "line 0\nline 1\nline 98\nline 99\n");
+        REQUIRE(result.elided.has_value());
+        REQUIRE_EQ(result.elided->bytes, output.size() - 30);
+        REQUIRE_EQ(result.elided->lines, 96);
+        REQUIRE(result.elided->fullOutputPath.empty());
+    }
+
+    const OutputRetentionPolicy tailOnly{.headBytes = 0, .tailBytes = 8, .keepFullOutput = false};
+    REQUIRE_EQ(Retain(tailOnly, output, 5).kept, "line 99\n");
+    const OutputRetentionPolicy headOnly{.headBytes = 7, .tailBytes = 0, .keepFullOutput = false};
+    REQUIRE_EQ(Retain(headOnly, output, 5).kept, "line 0\n");
+}
+
+TEST_CASE("The whole output can be written to a file of its own") {
+    const auto fullOutputPath = std::filesystem::temp_directory_path() / ("replmk_retention_" + std::to_string(getpid())) / "list.stdout";
+    const OutputRetentionPolicy policy{.headBytes = 7, .tailBytes = 9, .keepFullOutput = true};
+    const auto output = MakeLines(1000);
+    const auto result = Retain(policy, output, 100, fullOutputPath);
+    REQUIRE_EQ(result.kept, "line 0\nline 999\n");
+    REQUIRE(result.elided.has_value());
+    REQUIRE_EQ(result.elided->fullOutputPath, fullOutputPath.string());
+
+    std::ifstream file{fullOutputPath};
+    const std::string written{std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{}};
+    REQUIRE_EQ(written, output);
+    std::filesystem::remove_all(fullOutputPath.parent_path());
+
+    REQUIRE_EQ(formatElisionMarker(result.elided.value()),
+               "[... " + formatApproximateSize(output.size() - 16) + " in 998 lines left out, all of the output is in " + fullOutputPath.string() + " ...]");
+    REQUIRE_EQ(formatElisionMarker(ElidedOutput{.offset = 0, .bytes = 3 * 1024 * 1024, .lines = 1, .fullOutputPath = ""}),
+               "[... 3.0M in 1 line left out ...]");
+}
+
+TEST_CASE("The strictest policy of a pipeline applies") {
+    const std::vector<OutputRetentionPolicy> policies{
+        {.headBytes = 0, .tailBytes = 0, .keepFullOutput = false},
+        {.headBytes = 512, .tailBytes = 512, .keepFullOutput = true},
+        {.headBytes = 100, .tailBytes = 200, .keepFullOutput = false}
+    };
+    const auto combined = combineOutputRetention(policies);
+    REQUIRE_EQ(combined.headBytes, 100);
+    REQUIRE_EQ(combined.tailBytes, 200);
+    REQUIRE(combined.keepFullOutput);
+    REQUIRE_FALSE(combineOutputRetention({}).IsEnabled());
+
+    const auto path = makeFullOutputPath("/var/out", "my build", "stdout");
+    REQUIRE_EQ(path.parent_path(), "/var/out");
+    REQUIRE(path.filename().string().starts_with("my_build-"));
+    REQUIRE_EQ(path.extension(), ".stdout");
+    REQUIRE_NE(makeFullOutputPath("/var/out", "my build", "stdout"), path);
+}
+
+TEST_SUITE_END();
+//NOLINTEND(readability-function-cognitive-complexity,cppcoreguidelines-avoid-do-while)
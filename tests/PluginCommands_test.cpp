@@ -0,0 +1,116 @@
+#include <doctest/doctest.h>
+
+#include <string>
+#include <vector>
+
+#include "../src/PluginCommands.h"
+
+using namespace replmk;
+
+//NOLINTBEGIN(readability-function-cognitive-complexity,cppcoreguidelines-avoid-do-while)
+TEST_SUITE_BEGIN("PluginCommands");
+
+namespace {
+const std::string TestPluginPath{REPLMK_TEST_PLUGIN_PATH};
+
+struct CapturedOutput {
+    std::string stdOut;
+    std::string stdErr;
+
+    auto callbacks() -> CommandOutputCallbacks {
+        return {
+            .onStdOut = [this](std::string_view chunk) {
+                stdOut.append(chunk);
+            },
+            .onStdErr = [this](std::string_view chunk) {
+                stdErr.append(chunk);
+            }
+        };
+    }
+};
+}
+
+TEST_CASE("Plugin libraries are loaded once and symbols cached") {
+    PluginCache cache;
+    REQUIRE_EQ(cache.LoadedLibrariesCount(), 0);
+
+    const auto echoFn = cache.Resolve(TestPluginPath, "replmk_test_echo");
+    REQUIRE(echoFn.has_value());
+    const auto cancellableFn = cache.Resolve(TestPluginPath, "replmk_test_cancellable");
+    REQUIRE(cancellableFn.has_value());
+    REQUIRE_EQ(cache.LoadedLibrariesCount(), 1);
+
+    const auto echoAgainFn = cache.Resolve(TestPluginPath, "replmk_test_echo");
+    REQUIRE(echoAgainFn.has_value());
+    REQUIRE_EQ(echoFn.value(), echoAgainFn.value());
+}
+
+TEST_CASE("Missing plugins and symbols are reported") {
+    PluginCache cache;
+
+    const auto missingLibrary = cache.Resolve("/does/not/exist/plugin.so", "replmk_test_echo");
+    REQUIRE_FALSE(missingLibrary.has_value());
+    REQUIRE_NE(missingLibrary.error().find("Could not load plugin"), std::string::npos);
+
+    const auto missingSymbol = cache.Resolve(TestPluginPath, "replmk_test_nothing");
+    REQUIRE_FALSE(missingSymbol.has_value());
+    REQUIRE_NE(missingSymbol.error().find("replmk_test_nothing"), std::string::npos);
+}
+
+TEST_CASE("Plugin commands stream output through the callbacks") {
+    PluginCache cache;
+    ExecutionControl control;
+    const auto echoFn = cache.Resolve(TestPluginPath, "replmk_test_echo");
+    REQUIRE(echoFn.has_value());
+
+    CapturedOutput output;
+    const std::vector<std::string> args{"one", "two"};
+    REQUIRE(runPluginCommand(echoFn.value(), "echo", args, output.callbacks(), control));
+    REQUIRE_EQ(output.stdOut, "echo\none\ntwo\n");
+
+    CapturedOutput failedOutput;
+    const std::vector<std::string> failArgs{"fail"};
+    REQUIRE_FALSE(runPluginCommand(echoFn.value(), "echo", failArgs, failedOutput.callbacks(), control));
+    REQUIRE_EQ(failedOutput.stdErr, "failed on purpose\n");
+}
+
+TEST_CASE("Plugin commands see cancellation requests") {
+    PluginCache cache;
+    ExecutionControl control;
+    const auto cancellableFn = cache.Resolve(TestPluginPath, "replmk_test_cancellable");
+    REQUIRE(cancellableFn.has_value());
+
+    CapturedOutput output;
+    control.BeginCommand();
+    REQUIRE(runPluginCommand(cancellableFn.value(), "wait", {}, output.callbacks(), control));
+    REQUIRE_EQ(output.stdOut, "completed\n");
+
+    control.RequestCancel();
+    REQUIRE_FALSE(runPluginCommand(cancellableFn.value(), "wait", {}, output.callbacks(), control));
+    REQUIRE_EQ(output.stdOut, "completed\ncancelled\n");
+
+    control.EndCommand();
+    control.BeginCommand();
+    REQUIRE_FALSE(control.IsCancelRequested());
+}
+
+TEST_CASE("Isolated plugin commands run in a child process") {
+    PluginCache cache;
+    const auto echoFn = cache.Resolve(TestPluginPath, "replmk_test_echo");
+    const auto crashFn = cache.Resolve(TestPluginPath, "replmk_test_crash");
+    REQUIRE(echoFn.has_value());
+    REQUIRE(crashFn.has_value());
+
+    CapturedOutput output;
+    const std::vector<std::string> args{"isolated"};
+    REQUIRE(runIsolatedPluginCommand(echoFn.value(), "echo", args, output.callbacks(), {}));
+    REQUIRE_EQ(output.stdOut, "echo\nisolated\n");
+
+    // a crashing plugin only takes its own process down
+    CapturedOutput crashOutput;
+    REQUIRE_FALSE(runIsolatedPluginCommand(crashFn.value(), "crash", {}, crashOutput.callbacks(), {}));
+    REQUIRE_EQ(crashOutput.stdOut, "about to crash\n");
+}
+
+TEST_SUITE_END();
+//NOLINTEND(readability-function-cognitive-complexity,cppcoreguidelines-avoid-do-while)
@@ -1,8 +1,18 @@
 #include <doctest/doctest.h>
 
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <iterator>
 #include <string>
+#include <thread>
 #include <vector>
 
+#include <sched.h>
+#include <unistd.h>
+
 #include "ProcessExecutor.h"
 //NOLINTBEGIN(readability-function-cognitive-complexity,cppcoreguidelines-avoid-do-while)
 
@@ -75,5 +85,320 @@ TEST_CASE("Handle command that exits with non-zero status") {
     REQUIRE_FALSE(executionSucceeded);
 }
 
+TEST_CASE("Execution options set the working directory and environment") {
+    std::string capturedStdout;
+    const auto tempDir = std::filesystem::canonical(std::filesystem::temp_directory_path());
+    bool executionSucceeded = replmk::executeAndCaptureOutputs(
+    "sh", {"-c", "pwd; echo $REPLMK_TEST_VAR"}, {
+        .onStdOut = [&capturedStdout](std::string_view data) {
+            capturedStdout.append(data);
+        },
+        .onStdErr = [](std::string_view) {}
+    }, {
+        .workingDirectory = tempDir,
+        .environment = {{"REPLMK_TEST_VAR", "from session"}}
+    });
+
+    REQUIRE(executionSucceeded);
+    REQUIRE_EQ(capturedStdout, tempDir.string() + "\nfrom session\n");
+}
+
+TEST_CASE("Programs can run in a pseudo-terminal, the size of the output") {
+    std::string capturedStdout;
+    std::string capturedStderr;
+    replmk::ExecutionControl control;
+    control.SetOutputSize({.columns = 100, .rows = 30});
+    // run as if from the interface, the only commands whose stdin is the terminal
+    control.SetOnIdle([]() {});
+    const replmk::CommandOutputCallbacks callbacks{
+        .onStdOut = [&capturedStdout](std::string_view data) {
+            capturedStdout.append(data);
+        },
+        .onStdErr = [&capturedStderr](std::string_view data) {
+            capturedStderr.append(data);
+        }
+    };
+    const std::vector<std::string> script{"-c", "test -t 0 && test -t 1 && echo terminal; test -t 2 || echo 'errors apart' >&2; stty size"};
+
+    REQUIRE(replmk::executeAndCaptureOutputs("sh", script, callbacks, {.workingDirectory = {}, .environment = {}, .control = &control, .pty = true, .timeout = {}, .limits = {}}));
+    REQUIRE_EQ(capturedStdout, "terminal\n30 100\n");
+    REQUIRE_EQ(capturedStderr, "errors apart\n");
+    REQUIRE(control.Processes().empty());
+
+    capturedStdout.clear();
+    replmk::executeAndCaptureOutputs("sh", {"-c", "test -t 1 || echo pipe"}, callbacks, {.workingDirectory = {}, .environment = {}, .control = &control, .pty = false, .timeout = {}, .limits = {}});
+    REQUIRE_EQ(capturedStdout, "pipe\n");
+    // nobody types into the terminal of a command not run from the interface, it reads a closed input instead
+    control.SetOnIdle({});
+    capturedStdout.clear();
+    const auto start = std::chrono::steady_clock::now();
+    REQUIRE(replmk::executeAndCaptureOutputs("sh", {"-c", "test -t 0 || echo 'not a terminal'; test -t 1 && cat; read first || echo 'no input'"}, callbacks,
+                                             {.workingDirectory = {}, .environment = {}, .control = &control, .pty = true,
+                                              .timeout = std::chrono::seconds{10}, .limits = {}}));
+    REQUIRE_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds{5});
+    REQUIRE_EQ(capturedStdout, "not a terminal\nno input\n");
+}
+
+TEST_CASE("Input sent while a command runs is written to its stdin") {
+    std::string capturedStdout;
+    const replmk::CommandOutputCallbacks callbacks{
+        .onStdOut = [&capturedStdout](std::string_view data) {
+            capturedStdout.append(data);
+        },
+        .onStdErr = [](std::string_view) {}
+    };
+    replmk::ExecutionControl control;
+    const replmk::ExecutionOptions options{.workingDirectory = {}, .environment = {}, .control = &control, .pty = false, .timeout = {}, .limits = {}};
+
+    // without an interface waiting for them, commands read end of file instead of hanging
+    REQUIRE(replmk::executeAndCaptureOutputs("cat", {}, callbacks, options));
+    REQUIRE(capturedStdout.empty());
+
+    // the interface sends its input once the command waits for it, here more than a pipe holds at once
+    const std::string paste(1024 * 1024, 'x');
+    bool sent = false;
+    control.SetOnIdle([&control, &paste, &sent]() {
+        if (not sent) {
+            control.SendInput(paste);
+            control.CloseInput();
+            sent = true;
+        }
+    });
+    REQUIRE(replmk::executeAndCaptureOutputs("wc", {"-c"}, callbacks, options));
+    REQUIRE_EQ(capturedStdout.substr(capturedStdout.find_first_not_of(' ')), "1048576\n");
+
+    capturedStdout.clear();
+    sent = false;
+    control.SetOnIdle([&control, &sent]() {
+        if (not sent) {
+            control.SendInput("to the first stage\n");
+            control.CloseInput();
+            sent = true;
+        }
+    });
+    const std::vector<replmk::PipelineStage> stages{
+        {.cmd = "cat", .args = {}, .childMain = {}, .limits = {}},
+        {.cmd = "tr", .args = {"a-z", "A-Z"}, .childMain = {}, .limits = {}}
+    };
+    REQUIRE(replmk::executePipelineAndCaptureOutputs(stages, callbacks, options));
+    REQUIRE_EQ(capturedStdout, "TO THE FIRST STAGE\n");
+
+    // a pseudo-terminal gets every key, and echoes them itself
+    capturedStdout.clear();
+    sent = false;
+    bool keystrokes = false;
+    control.SetOnIdle([&control, &sent, &keystrokes]() {
+        if (not sent) {
+            keystrokes = control.IsKeystrokeInput();
+            control.SendInput("typed\n");
+            sent = true;
+        }
+    });
+    REQUIRE(replmk::executeAndCaptureOutputs("sh", {"-c", "read line; echo \"read $line\""}, callbacks,
+                                             {.workingDirectory = {}, .environment = {}, .control = &control, .pty = true, .timeout = {}, .limits = {}}));
+    REQUIRE(keystrokes);
+    REQUIRE_FALSE(control.IsKeystrokeInput());
+    REQUIRE_EQ(capturedStdout, "typed\nread typed\n");
+}
+
+TEST_CASE("Waits let the interface take its turn, without entering it again from its own events") {
+    replmk::ExecutionControl control;
+    int idleRuns = 0;
+    int nestedRuns = 0;
+    control.SetOnIdle([&control, &idleRuns, &nestedRuns]() {
+        idleRuns++;
+        // an event handled here that waits in turn doesn't run the interface again
+        control.WaitWithIdle([&nestedRuns](std::chrono::milliseconds) {
+            nestedRuns++;
+            return false;
+        });
+    });
+
+    REQUIRE(control.WaitWithIdle([](std::chrono::milliseconds interval) {
+        return interval == replmk::ExecutionControl::IdleInterval;
+    }));
+    REQUIRE_EQ(idleRuns, 0);
+
+    REQUIRE_FALSE(control.WaitWithIdle([](std::chrono::milliseconds) {
+        return false;
+    }));
+    REQUIRE_EQ(idleRuns, 1);
+    REQUIRE_EQ(nestedRuns, 1);
+
+    // and only runs on the thread that set it
+    std::thread{[&control]() {
+        control.RunOnIdle();
+    }}.join();
+    REQUIRE_EQ(idleRuns, 1);
+}
+
+TEST_CASE("Commands running past their timeout, or cancelled, are stopped with their process group") {
+    std::string capturedStdout;
+    std::string capturedStderr;
+    const replmk::CommandOutputCallbacks callbacks{
+        .onStdOut = [&capturedStdout](std::string_view data) {
+            capturedStdout.append(data);
+        },
+        .onStdErr = [&capturedStderr](std::string_view data) {
+            capturedStderr.append(data);
+        }
+    };
+    replmk::ExecutionControl control;
+
+    // the sleep started by the shell is in its group, it doesn't keep the output open for 30 seconds
+    const auto start = std::chrono::steady_clock::now();
+    REQUIRE_FALSE(replmk::executeAndCaptureOutputs("sh", {"-c", "echo partial; sleep 30; echo never"}, callbacks,
+                                                   {.workingDirectory = {}, .environment = {}, .control = &control, .pty = false,
+                                                    .timeout = std::chrono::milliseconds{200}, .limits = {}}));
+    REQUIRE_LT(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count(), 2000);
+    REQUIRE_EQ(capturedStdout, "partial\n");
+    REQUIRE_EQ(capturedStderr, "[timed out after 0.2s, interrupted]\n");
+    REQUIRE(control.Processes().empty());
+
+    // a command ignoring SIGINT is killed after the grace period, here cancelled once it said it ignores it
+    capturedStdout.clear();
+    capturedStderr.clear();
+    control.BeginCommand();
+    const replmk::CommandOutputCallbacks cancellingCallbacks{
+        .onStdOut = [&capturedStdout, &control](std::string_view data) {
+            capturedStdout.append(data);
+            control.RequestCancel();
+        },
+        .onStdErr = callbacks.onStdErr
+    };
+    const std::vector<replmk::PipelineStage> stages{
+        {.cmd = "sh", .args = {"-c", "trap '' INT; echo stubborn; sleep 30"}, .childMain = {}, .limits = {}},
+        {.cmd = "cat", .args = {}, .childMain = {}, .limits = {}}
+    };
+    REQUIRE_FALSE(replmk::executePipelineAndCaptureOutputs(stages, cancellingCallbacks, {.workingDirectory = {}, .environment = {},
+                                                                                         .control = &control, .pty = false, .timeout = {}, .limits = {}}));
+    REQUIRE_EQ(capturedStdout, "stubborn\n");
+    REQUIRE_EQ(capturedStderr, "[cancelled, interrupted, killed 2s later]\n");
+    control.EndCommand();
+}
+
+TEST_CASE("Resource limits are applied to the command, which is told when one ends it") {
+    std::string capturedStdout;
+    std::string capturedStderr;
+    const replmk::CommandOutputCallbacks callbacks{
+        .onStdOut = [&capturedStdout](std::string_view data) {
+            capturedStdout.append(data);
+        },
+        .onStdErr = [&capturedStderr](std::string_view data) {
+            capturedStderr.append(data);
+        }
+    };
+
+    // a processor the tests may run on, not every one is available everywhere
+    cpu_set_t available;
+    REQUIRE_EQ(sched_getaffinity(0, sizeof(available), &available), 0);
+    unsigned cpu = 0;
+    while (not CPU_ISSET(cpu, &available)) {
+        cpu++;
+    }
+
+    constexpr uint64_t MemoryLimit = 256ULL * 1024 * 1024;
+    const replmk::ExecutionOptions options{.workingDirectory = {}, .environment = {}, .control = nullptr, .pty = false, .timeout = {},
+                                           .limits = {.memoryBytes = MemoryLimit, .cpuSeconds = std::nullopt, .niceness = 5,
+                                                      .ioPriority = std::nullopt, .cpus = {cpu}, .maxProcesses = std::nullopt}};
+    REQUIRE(replmk::executeAndCaptureOutputs("sh", {"-c", "ulimit -v; nice; grep Cpus_allowed_list /proc/self/status | cut -f2"}, callbacks,
+                                             options));
+    REQUIRE_EQ(capturedStdout, std::format("262144\n5\n{}\n", cpu));
+    REQUIRE_EQ(capturedStderr, "");
+
+    capturedStdout.clear();
+    const replmk::ExecutionOptions cpuTimeOptions{.workingDirectory = {}, .environment = {}, .control = nullptr, .pty = false, .timeout = {},
+                                                  .limits = {.memoryBytes = std::nullopt, .cpuSeconds = 1, .niceness = std::nullopt,
+                                                             .ioPriority = std::nullopt, .cpus = {}, .maxProcesses = std::nullopt}};
+    REQUIRE_FALSE(replmk::executeAndCaptureOutputs("sh", {"-c", "while :; do :; done"}, callbacks, cpuTimeOptions));
+    REQUIRE_EQ(capturedStderr, "[killed: cpu time limit of 1s reached]\n");
+}
+
+TEST_CASE("Pipelines connect stages directly") {
+    std::string capturedStdout;
+    std::string capturedStderr;
+    const replmk::CommandOutputCallbacks callbacks{
+        .onStdOut = [&capturedStdout](std::string_view data) {
+            capturedStdout.append(data);
+        },
+        .onStdErr = [&capturedStderr](std::string_view data) {
+            capturedStderr.append(data);
+        }
+    };
+
+    const std::vector<replmk::PipelineStage> stages{
+        {.cmd = "sh", .args = {"-c", "seq 1 1000; echo first stage error >&2"}, .childMain = {}, .limits = {}},
+        {.cmd = "grep", .args = {"7"}, .childMain = {}, .limits = {}},
+        {.cmd = "wc", .args = {"-l"}, .childMain = {}, .limits = {}}
+    };
+    REQUIRE(replmk::executePipelineAndCaptureOutputs(stages, callbacks));
+    REQUIRE_EQ(capturedStdout.substr(capturedStdout.find_first_not_of(' ')), "271\n");
+    REQUIRE_EQ(capturedStderr, "first stage error\n");
+}
+
+TEST_CASE("Pipelines report the result of the last stage") {
+    std::string capturedStdout;
+    const replmk::CommandOutputCallbacks callbacks{
+        .onStdOut = [&capturedStdout](std::string_view data) {
+            capturedStdout.append(data);
+        },
+        .onStdErr = [](std::string_view) {}
+    };
+
+    const std::vector<replmk::PipelineStage> failingLast{
+        {.cmd = "echo", .args = {"hello"}, .childMain = {}, .limits = {}},
+        {.cmd = "false", .args = {}, .childMain = {}, .limits = {}}
+    };
+    REQUIRE_FALSE(replmk::executePipelineAndCaptureOutputs(failingLast, callbacks));
+
+    // forked stages read and write their standard descriptors like any program
+    const std::vector<replmk::PipelineStage> forkedFirst{
+        {.cmd = {}, .args = {}, .childMain = []() {
+            const auto stageCallbacks = replmk::makeFileDescriptorCallbacks(STDOUT_FILENO, STDERR_FILENO);
+            stageCallbacks.onStdOut("from a forked stage\n");
+            return 1;
+        }, .limits = {}},
+        {.cmd = "tr", .args = {"a-z", "A-Z"}, .childMain = {}, .limits = {}}
+    };
+    REQUIRE(replmk::executePipelineAndCaptureOutputs(forkedFirst, callbacks));
+    REQUIRE_EQ(capturedStdout, "FROM A FORKED STAGE\n");
+}
+
+TEST_CASE("Output descriptors are given to children as their own stdout and stderr") {
+    const auto outputPath = std::filesystem::temp_directory_path() / ("replmk_descriptors_test_" + std::to_string(getpid()));
+    std::FILE* outputFile = std::fopen(outputPath.c_str(), "w+");
+    REQUIRE_NE(outputFile, nullptr);
+
+    std::string capturedStdout;
+    std::string capturedStderr;
+    const replmk::CommandOutputCallbacks callbacks{
+        .onStdOut = [&capturedStdout](std::string_view data) {
+            capturedStdout.append(data);
+        },
+        .onStdErr = [&capturedStderr](std::string_view data) {
+            capturedStderr.append(data);
+        },
+        .stdOutFd = fileno(outputFile),
+        .stdErrFd = -1
+    };
+
+    REQUIRE(replmk::executeAndCaptureOutputs("sh", {"-c", "echo to file; echo to stderr >&2"}, callbacks));
+    const std::vector<replmk::PipelineStage> stages{
+        {.cmd = "seq", .args = {"1", "3"}, .childMain = {}, .limits = {}},
+        {.cmd = "tail", .args = {"-n", "1"}, .childMain = {}, .limits = {}}
+    };
+    REQUIRE(replmk::executePipelineAndCaptureOutputs(stages, callbacks));
+
+    // the callbacks never see what went to the descriptor
+    REQUIRE_EQ(capturedStdout, "");
+    REQUIRE_EQ(capturedStderr, "to stderr\n");
+
+    std::fclose(outputFile);
+    std::ifstream written{outputPath};
+    const std::string content{std::istreambuf_iterator<char>{written}, std::istreambuf_iterator<char>{}};
+    REQUIRE_EQ(content, "to file\n3\n");
+    std::filesystem::remove(outputPath);
+}
+
 TEST_SUITE_END();
 //NOLINTEND(readability-function-cognitive-complexity,cppcoreguidelines-avoid-do-while)
\ No newline at end of file
@@ -0,0 +1,115 @@
+#include <doctest/doctest.h>
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <string>
+#include <thread>
+
+#include <unistd.h>
+
+#include "../src/ExecutionControl.h"
+#include "../src/ProcessMonitor.h"
+
+using namespace replmk;
+
+//NOLINTBEGIN(readability-function-cognitive-complexity,cppcoreguidelines-avoid-do-while)
+TEST_SUITE_BEGIN("ProcessMonitor");
+
+namespace {
+auto MakeStat(pid_t pid, pid_t parentPid, uint64_t userTicks, uint64_t residentPages) -> std::string {
+    return std::format("{} (sh) S {} {} 0 0 -1 4194560 100 0 0 0 {} 0 0 0 20 0 1 0 12345 2506752 {} 18446744073709551615\n",
+                       pid, parentPid, pid, userTicks, residentPages);
+}
+
+auto WaitForStatus(const ProcessMonitor& monitor, std::string_view prefix) -> bool {
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds{5};
+    while (std::chrono::steady_clock::now() < deadline) {
+        if (monitor.Status().starts_with(prefix)) {
+            return true;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds{5});
+    }
+    return false;
+}
+}
+
+TEST_CASE("Stat files are read past command names with spaces and parentheses") {
+    const auto stat = parseProcessStat("4242 (my (odd) cmd) R 4200 4242 4242 0 -1 4194304 50 0 0 0 7 3 2 1 20 0 1 0 999 1000000 256 18446744073709551615");
+    REQUIRE(stat.has_value());
+    REQUIRE_EQ(stat->pid, 4242);
+    REQUIRE_EQ(stat->parentPid, 4200);
+    REQUIRE_EQ(stat->cpuTicks, 13);
+    REQUIRE_EQ(stat->residentPages, 256);
+
+    REQUIRE_FALSE(parseProcessStat("").has_value());
+    REQUIRE_FALSE(parseProcessStat("4242 (cut) R 4200 4242").has_value());
+}
+
+TEST_CASE("The process tree adds up the processes given and their descendants") {
+    const auto procRoot = std::filesystem::temp_directory_path() / ("replmk_proc_" + std::to_string(getpid()));
+    std::filesystem::create_directories(procRoot);
+    const auto writeStat = [&procRoot](pid_t pid, pid_t parentPid, uint64_t userTicks) {
+        std::filesystem::create_directories(procRoot / std::to_string(pid));
+        std::ofstream{procRoot / std::to_string(pid) / "stat"} << MakeStat(pid, parentPid, userTicks, 1);
+    };
+    writeStat(100, 1, 5);
+    writeStat(101, 100, 10);
+    writeStat(102, 101, 20);
+    // not started by the command
+    writeStat(200, 1, 1000);
+    std::filesystem::create_directories(procRoot / "self");
+
+    const auto sample = sampleProcessTree({100}, procRoot);
+    REQUIRE_EQ(sample.processes, 3);
+    REQUIRE_EQ(sample.cpuTicks, 35);
+    REQUIRE_EQ(sample.residentBytes, 3 * static_cast<uint64_t>(::sysconf(_SC_PAGESIZE)));
+
+    REQUIRE_EQ(sampleProcessTree({}, procRoot).processes, 0);
+    REQUIRE_EQ(sampleProcessTree({100, 102}, procRoot).processes, 3);
+    std::filesystem::remove_all(procRoot);
+
+    const auto self = sampleProcessTree({getpid()});
+    REQUIRE_GE(self.processes, 1);
+    REQUIRE_GT(self.residentBytes, 0);
+}
+
+TEST_CASE("Activity shows processes only when the command has some") {
+    const CommandActivity activity{
+        .elapsed = std::chrono::milliseconds{12345},
+        .bytesPerSecond = 2048,
+        .linesPerSecond = 40,
+        .cpuPercent = 99.6,
+        .residentBytes = 3ULL * 1024 * 1024,
+        .processes = 2
+    };
+    REQUIRE_EQ(formatCommandActivity(activity), " Running 12.3s  output 2.0K/s, 40 lines/s  cpu 100%  rss 3.0M  2 processes");
+
+    const CommandActivity inProcess{.elapsed = std::chrono::seconds{1}};
+    REQUIRE_EQ(formatCommandActivity(inProcess), " Running 1.0s  output 0B/s, 0 lines/s");
+}
+
+TEST_CASE("The monitor follows the command the control runs") {
+    ExecutionControl control;
+    std::atomic<int> changes{0};
+    const ProcessMonitor monitor{control, std::chrono::milliseconds{10}, [&changes] {
+        changes++;
+    }};
+    REQUIRE_EQ(monitor.Status(), " Status: idle");
+
+    control.BeginCommand();
+    control.AddProcess(getpid());
+    control.CountOutput("one\ntwo\n");
+    REQUIRE(WaitForStatus(monitor, " Running"));
+    REQUIRE_NE(monitor.Status().find(" process"), std::string::npos);
+
+    control.RemoveProcess(getpid());
+    control.EndCommand();
+    REQUIRE(WaitForStatus(monitor, " Status: idle"));
+    REQUIRE_GE(changes.load(), 2);
+}
+
+TEST_SUITE_END();
+//NOLINTEND(readability-function-cognitive-complexity,cppcoreguidelines-avoid-do-while)
@@ -7,6 +7,8 @@
 #include <fstream>                  // For creating temporary test files
 #include <string>                   // For std::string
 #include <filesystem>               // For path manipulation and file cleanup (C++17)
+#include <vector>
+#include <chrono>
 
 using namespace replmk;
 
@@ -78,7 +80,7 @@ commands:
       description: Says hello.
       type: script
       exec: "echo hello"
-    - name: run
+    - name: launch
       description: Run a program.
       type: shell
       exec: "{1} {args}"
@@ -103,7 +105,7 @@ commands:
   REQUIRE_EQ(greetCmd.exec, "echo hello");
 
   const auto& runCmd = definition.commands[1];
-  REQUIRE_EQ(runCmd.name, "run");
+  REQUIRE_EQ(runCmd.name, "launch");
   REQUIRE_EQ(runCmd.description, "Run a program.");
   REQUIRE_EQ(runCmd.cmdType, CommandType::Shell);
   REQUIRE_EQ(runCmd.exec, "{1} {args}");
@@ -226,6 +228,560 @@ commands:
   VerifyLoadDefinitionError(yamlContent, DefinitionError::InvalidCommandType);
 }
 
+TEST_CASE("Load command with argument schema") {
+  const std::string yamlContent = R"(
+prompt: ">"
+commands:
+  - name: deploy
+    description: Deploy the service
+    type: single
+    exec: "deploy.sh"
+    args:
+      - name: env
+        type: enum
+        values: [dev, prod]
+      - name: replicas
+        type: int
+        required: false
+        min: 1
+        max: 10
+      - name: tag
+        required: false
+        pattern: "v[0-9]+"
+)";
+
+  TempYamlFile tempFile(yamlContent);
+  const auto maybeDefinition = loadDefinition(tempFile.path());
+  REQUIRE(maybeDefinition.has_value());
+
+  const auto& schema = maybeDefinition.value().commands.at(0).argsSchema;
+  REQUIRE_EQ(schema.arguments.size(), 3);
+  REQUIRE_EQ(schema.arguments[0].argType, ArgumentType::Enum);
+  REQUIRE_EQ(schema.arguments[0].allowedValues.size(), 2);
+  REQUIRE(schema.arguments[0].required);
+  REQUIRE_EQ(schema.arguments[1].argType, ArgumentType::Integer);
+  REQUIRE_FALSE(schema.arguments[1].required);
+  REQUIRE(schema.arguments[1].maxValue.has_value());
+  REQUIRE_EQ(static_cast<int>(schema.arguments[1].maxValue.value_or(0)), 10);
+  REQUIRE_EQ(schema.arguments[2].argType, ArgumentType::String);
+  REQUIRE(schema.arguments[2].compiledPattern != nullptr);
+}
+
+TEST_CASE("Invalid argument schemas return InvalidArgumentSchema error") {
+  VerifyLoadDefinitionError(R"(
+commands:
+  - name: test
+    description: desc
+    type: single
+    exec: "echo"
+    args: not_a_list
+)", DefinitionError::InvalidArgumentSchema);
+
+  VerifyLoadDefinitionError(R"(
+commands:
+  - name: test
+    description: desc
+    type: single
+    exec: "echo"
+    args:
+      - name: tag
+        pattern: "([unclosed"
+)", DefinitionError::InvalidArgumentSchema);
+
+  VerifyLoadDefinitionError(R"(
+commands:
+  - name: test
+    description: desc
+    type: single
+    exec: "echo"
+    args:
+      - name: replicas
+        type: int
+        pattern: "[0-9]+"
+)", DefinitionError::InvalidArgumentSchema);
+
+  VerifyLoadDefinitionError(R"(
+commands:
+  - name: test
+    description: desc
+    type: single
+    exec: "echo"
+    args:
+      - name: first
+        required: false
+      - name: second
+)", DefinitionError::InvalidArgumentSchema);
+
+  VerifyLoadDefinitionError(R"(
+commands:
+  - name: test
+    description: desc
+    type: single
+    exec: "echo"
+    args:
+      - name: count
+        type: int
+        min: lots
+)", DefinitionError::InvalidFieldType);
+}
+TEST_CASE("Builtin commands must name a known builtin") {
+  const std::string validContent = R"(
+commands:
+  - name: goto
+    description: Change directory
+    type: builtin
+    exec: cd
+)";
+  TempYamlFile tempFile(validContent);
+  const auto maybeDefinition = loadDefinition(tempFile.path());
+  REQUIRE(maybeDefinition.has_value());
+  REQUIRE_EQ(maybeDefinition.value().commands.at(0).cmdType, CommandType::Builtin);
+
+  VerifyLoadDefinitionError(R"(
+commands:
+  - name: remove
+    description: Not a builtin
+    type: builtin
+    exec: rm
+)", DefinitionError::UnknownBuiltinCommand);
+}
+
+TEST_CASE("Plugin commands require a symbol") {
+  const std::string validContent = R"(
+commands:
+  - name: fast
+    description: Plugin command
+    type: plugin
+    exec: ./libfast.so
+    symbol: fast_command
+    isolated: true
+)";
+  TempYamlFile tempFile(validContent);
+  const auto maybeDefinition = loadDefinition(tempFile.path());
+  REQUIRE(maybeDefinition.has_value());
+  const auto& command = maybeDefinition.value().commands.at(0);
+  REQUIRE_EQ(command.cmdType, CommandType::Plugin);
+  REQUIRE_EQ(command.exec, "./libfast.so");
+  REQUIRE_EQ(command.symbol, "fast_command");
+  REQUIRE(command.isolated);
+
+  VerifyLoadDefinitionError(R"(
+commands:
+  - name: fast
+    description: Plugin command without symbol
+    type: plugin
+    exec: ./libfast.so
+)", DefinitionError::MissingRequiredField);
+}
+
+TEST_CASE("Workflows name their steps and dependencies") {
+  const std::string validContent = R"(
+commands:
+  - name: build
+    description: Build
+    type: single
+    exec: make
+workflows:
+  - name: release
+    description: Release checklist
+    policy: keep_going
+    steps:
+      - name: lint
+        run: build lint
+      - name: test
+        run: build test
+      - name: package
+        run: build package
+        depends_on: [lint, test]
+      - name: publish
+        run: build publish
+        depends_on: package
+  - name: quick
+    steps:
+      - name: only
+        run: build
+)";
+  TempYamlFile tempFile(validContent);
+  const auto maybeDefinition = loadDefinition(tempFile.path());
+  REQUIRE(maybeDefinition.has_value());
+  const auto& workflows = maybeDefinition.value().workflows;
+  REQUIRE_EQ(workflows.size(), 2);
+
+  const auto& release = workflows.at(0);
+  REQUIRE_EQ(release.name, "release");
+  REQUIRE_EQ(release.description, "Release checklist");
+  REQUIRE_EQ(release.policy, WorkflowPolicy::KeepGoing);
+  REQUIRE_EQ(release.steps.size(), 4);
+  REQUIRE_EQ(release.steps.at(2).commandLine, "build package");
+  const std::vector<std::string> packageDependencies{"lint", "test"};
+  REQUIRE_EQ(release.steps.at(2).dependsOn, packageDependencies);
+  REQUIRE_EQ(release.steps.at(3).dependsOn, std::vector<std::string>{"package"});
+  REQUIRE_EQ(workflows.at(1).policy, WorkflowPolicy::FailFast);
+}
+
+TEST_CASE("Workflows must be a DAG of well formed steps") {
+  VerifyLoadDefinitionError(R"(
+commands: []
+workflows:
+  - name: cycle
+    steps:
+      - name: a
+        run: x
+        depends_on: b
+      - name: b
+        run: x
+        depends_on: a
+)", DefinitionError::InvalidWorkflow);
+
+  VerifyLoadDefinitionError(R"(
+commands: []
+workflows:
+  - name: unknown
+    steps:
+      - name: a
+        run: x
+        depends_on: missing
+)", DefinitionError::InvalidWorkflow);
+
+  VerifyLoadDefinitionError(R"(
+commands: []
+workflows:
+  - name: policy
+    policy: sometimes
+    steps:
+      - name: a
+        run: x
+)", DefinitionError::InvalidWorkflow);
+
+  VerifyLoadDefinitionError(R"(
+commands: []
+workflows:
+  - name: nosteps
+)", DefinitionError::InvalidWorkflow);
+
+  VerifyLoadDefinitionError(R"(
+commands: []
+workflows:
+  - name: norun
+    steps:
+      - name: a
+)", DefinitionError::MissingRequiredField);
+}
+
+TEST_CASE("Commands can declare a cache") {
+  const std::string validContent = R"(
+commands:
+  - name: pods
+    description: List pods
+    type: single
+    exec: kubectl
+    cache:
+      ttl: 5m
+      depends_on_files: [~/.kube/config, values.yaml]
+  - name: nodes
+    description: List nodes
+    type: shell
+    exec: kubectl get nodes
+    cache:
+      ttl: 30
+)";
+  TempYamlFile tempFile(validContent);
+  const auto maybeDefinition = loadDefinition(tempFile.path());
+  REQUIRE(maybeDefinition.has_value());
+  const auto& pods = maybeDefinition.value().commands.at(0);
+  REQUIRE(pods.cache.IsEnabled());
+  REQUIRE_EQ(pods.cache.ttl, std::chrono::minutes{5});
+  const std::vector<std::string> podsFiles{"~/.kube/config", "values.yaml"};
+  REQUIRE_EQ(pods.cache.dependsOnFiles, podsFiles);
+  REQUIRE_EQ(maybeDefinition.value().commands.at(1).cache.ttl, std::chrono::seconds{30});
+
+  VerifyLoadDefinitionError(R"(
+commands:
+  - name: pods
+    description: List pods
+    type: single
+    exec: kubectl
+    cache:
+      ttl: soon
+)", DefinitionError::InvalidCachePolicy);
+
+  VerifyLoadDefinitionError(R"(
+commands:
+  - name: goto
+    description: Change directory
+    type: builtin
+    exec: cd
+    cache:
+      ttl: 30s
+)", DefinitionError::InvalidCachePolicy);
+
+  VerifyLoadDefinitionError(R"(
+commands:
+  - name: pods
+    description: List pods
+    type: single
+    exec: kubectl
+    cache:
+      depends_on_files: [a]
+)", DefinitionError::MissingRequiredField);
+}
+
+TEST_CASE("Single and shell commands can run in a pseudo-terminal") {
+  const std::string validContent = R"(
+commands:
+  - name: build
+    description: Build with colors
+    type: shell
+    exec: make -j8
+    pty: true
+  - name: list
+    description: List files
+    type: single
+    exec: ls
+)";
+  TempYamlFile tempFile(validContent);
+  const auto maybeDefinition = loadDefinition(tempFile.path());
+  REQUIRE(maybeDefinition.has_value());
+  REQUIRE(maybeDefinition.value().commands.at(0).pty);
+  REQUIRE_FALSE(maybeDefinition.value().commands.at(1).pty);
+
+  VerifyLoadDefinitionError(R"(
+commands:
+  - name: build
+    description: Build with colors
+    type: single
+    exec: make
+    pty: sometimes
+)", DefinitionError::InvalidFieldType);
+
+  // commands that don't run a process of their own have no terminal to give it
+  VerifyLoadDefinitionError(R"(
+commands:
+  - name: goto
+    description: Change directory
+    type: builtin
+    exec: cd
+    pty: true
+)", DefinitionError::InvalidPty);
+}
+
+TEST_CASE("Commands cannot take the name of an internal command") {
+  VerifyLoadDefinitionError(R"(
+commands:
+  - name: stats
+    description: Show disk usage
+    type: single
+    exec: df
+)", DefinitionError::CommandNameClash);
+
+  VerifyLoadDefinitionError(R"(
+commands:
+  - name: help
+    description: Show the manual
+    type: single
+    exec: man ls
+)", DefinitionError::CommandNameClash);
+
+  // renamed, help and exit free their names, and cannot take one of another internal command
+  const std::string renamedContent = R"(
+alt_help_cmd: commands
+alt_exit_cmd: quit
+commands:
+  - name: help
+    description: Show the manual
+    type: single
+    exec: man ls
+  - name: exit
+    description: Leave the directory
+    type: builtin
+    exec: cd
+)";
+  TempYamlFile tempFile(renamedContent);
+  REQUIRE(loadDefinition(tempFile.path()).has_value());
+
+  VerifyLoadDefinitionError(R"(
+alt_exit_cmd: quit
+commands:
+  - name: quit
+    description: Quit something else
+    type: single
+    exec: "true"
+)", DefinitionError::CommandNameClash);
+
+  VerifyLoadDefinitionError(R"(
+alt_help_cmd: jobs
+commands:
+  - name: list
+    description: List files
+    type: single
+    exec: ls
+)", DefinitionError::CommandNameClash);
+}
+
+TEST_CASE("Single and shell commands can have a timeout") {
+  const std::string validContent = R"(
+commands:
+  - name: deploy
+    description: Deploy, giving up after a while
+    type: shell
+    exec: ./deploy.sh
+    timeout: 5m
+  - name: list
+    description: List files
+    type: single
+    exec: ls
+)";
+  TempYamlFile tempFile(validContent);
+  const auto maybeDefinition = loadDefinition(tempFile.path());
+  REQUIRE(maybeDefinition.has_value());
+  REQUIRE_EQ(maybeDefinition.value().commands.at(0).timeout, std::chrono::minutes{5});
+  REQUIRE_EQ(maybeDefinition.value().commands.at(1).timeout, std::chrono::seconds{0});
+
+  VerifyLoadDefinitionError(R"(
+commands:
+  - name: deploy
+    description: Deploy
+    type: single
+    exec: ./deploy.sh
+    timeout: later
+)", DefinitionError::InvalidTimeout);
+
+  VerifyLoadDefinitionError(R"(
+commands:
+  - name: goto
+    description: Change directory
+    type: builtin
+    exec: cd
+    timeout: 10s
+)", DefinitionError::InvalidTimeout);
+}
+
+TEST_CASE("Single and shell commands can have resource limits") {
+  const std::string validContent = R"(
+commands:
+  - name: build
+    description: Build without taking over the machine
+    type: shell
+    exec: make -j8
+    limits:
+      memory: 2G
+      cpu_time: 10m
+      nice: 10
+      ionice: best-effort:7
+      cpus: [0, 1]
+      max_pids: 256
+  - name: list
+    description: List files
+    type: single
+    exec: ls
+)";
+  TempYamlFile tempFile(validContent);
+  const auto maybeDefinition = loadDefinition(tempFile.path());
+  REQUIRE(maybeDefinition.has_value());
+  const auto& limits = maybeDefinition.value().commands.at(0).limits;
+  REQUIRE_EQ(limits.memoryBytes, 2ULL * 1024 * 1024 * 1024);
+  REQUIRE_EQ(limits.cpuSeconds, 600);
+  REQUIRE_EQ(limits.niceness, 10);
+  REQUIRE(limits.ioPriority.has_value());
+  REQUIRE_EQ(limits.ioPriority->ioClass, IoPriorityClass::BestEffort);
+  REQUIRE_EQ(limits.ioPriority->level, 7);
+  const std::vector<unsigned> cpus{0, 1};
+  REQUIRE_EQ(limits.cpus, cpus);
+  REQUIRE_EQ(limits.maxProcesses, 256);
+  REQUIRE(maybeDefinition.value().commands.at(1).limits.IsEmpty());
+
+  // a misspelled limit would otherwise silently not apply
+  VerifyLoadDefinitionError(R"(
+commands:
+  - name: build
+    description: Build
+    type: shell
+    exec: make
+    limits:
+      memroy: 2G
+)", DefinitionError::InvalidLimits);
+
+  VerifyLoadDefinitionError(R"(
+commands:
+  - name: build
+    description: Build
+    type: shell
+    exec: make
+    limits:
+      nice: 40
+)", DefinitionError::InvalidLimits);
+
+  VerifyLoadDefinitionError(R"(
+commands:
+  - name: goto
+    description: Change directory
+    type: builtin
+    exec: cd
+    limits:
+      memory: 1G
+)", DefinitionError::InvalidLimits);
+}
+
+TEST_CASE("Outputs can be limited for every command, or for one") {
+  const std::string validContent = R"(
+max_output_bytes: 1M
+commands:
+  - name: build
+    description: Build everything
+    type: shell
+    exec: make
+    max_output_bytes:
+      head: 4K
+      tail: 64K
+      full_output: true
+  - name: list
+    description: List files
+    type: single
+    exec: ls
+)";
+  TempYamlFile tempFile(validContent);
+  const auto maybeDefinition = loadDefinition(tempFile.path());
+  REQUIRE(maybeDefinition.has_value());
+  const auto& build = maybeDefinition.value().commands.at(0).outputRetention;
+  REQUIRE_EQ(build.headBytes, 4ULL * 1024);
+  REQUIRE_EQ(build.tailBytes, 64ULL * 1024);
+  REQUIRE(build.keepFullOutput);
+  // half of the size from the start, half from the end
+  const auto& list = maybeDefinition.value().commands.at(1).outputRetention;
+  REQUIRE_EQ(list.headBytes, 512ULL * 1024);
+  REQUIRE_EQ(list.tailBytes, 512ULL * 1024);
+  REQUIRE_FALSE(list.keepFullOutput);
+
+  VerifyLoadDefinitionError(R"(
+max_output_bytes: lots
+commands:
+  - name: list
+    description: List files
+    type: single
+    exec: ls
+)", DefinitionError::InvalidOutputRetention);
+
+  // a full copy alone doesn't say what to keep
+  VerifyLoadDefinitionError(R"(
+commands:
+  - name: list
+    description: List files
+    type: single
+    exec: ls
+    max_output_bytes:
+      full_output: true
+)", DefinitionError::InvalidOutputRetention);
+
+  VerifyLoadDefinitionError(R"(
+commands:
+  - name: list
+    description: List files
+    type: single
+    exec: ls
+    max_output_bytes:
+      middle: 1M
+)", DefinitionError::InvalidOutputRetention);
+}
 
 TEST_SUITE_END();
 
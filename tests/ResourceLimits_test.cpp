@@ -0,0 +1,72 @@
+#include <doctest/doctest.h>
+
+#include <cstdint>
+#include <optional>
+
+#include "../src/ResourceLimits.h"
+
+using namespace replmk;
+
+//NOLINTBEGIN(readability-function-cognitive-complexity,cppcoreguidelines-avoid-do-while)
+TEST_SUITE_BEGIN("ResourceLimits");
+
+TEST_CASE("Byte sizes are written in powers of 1024") {
+    REQUIRE_EQ(parseByteSize("4096"), 4096);
+    REQUIRE_EQ(parseByteSize("512K"), 512ULL * 1024);
+    REQUIRE_EQ(parseByteSize("512M"), 512ULL * 1024 * 1024);
+    REQUIRE_EQ(parseByteSize("2G"), 2ULL * 1024 * 1024 * 1024);
+
+    REQUIRE_FALSE(parseByteSize("").has_value());
+    REQUIRE_FALSE(parseByteSize("0M").has_value());
+    REQUIRE_FALSE(parseByteSize("M").has_value());
+    REQUIRE_FALSE(parseByteSize("512MB").has_value());
+    REQUIRE_FALSE(parseByteSize("-1").has_value());
+    REQUIRE_FALSE(parseByteSize("99999999999999999999").has_value());
+    REQUIRE_FALSE(parseByteSize("99999999999G").has_value());
+
+    REQUIRE_EQ(formatByteSize(512ULL * 1024 * 1024), "512M");
+    REQUIRE_EQ(formatByteSize(1536ULL * 1024), "1536K");
+    REQUIRE_EQ(formatByteSize(1000), "1000");
+}
+
+TEST_CASE("Io priorities are a class, and a level for the ones that have levels") {
+    const auto idle = parseIoPriority("idle");
+    REQUIRE(idle.has_value());
+    REQUIRE_EQ(idle->ioClass, IoPriorityClass::Idle);
+
+    const auto bestEffort = parseIoPriority("best-effort");
+    REQUIRE(bestEffort.has_value());
+    REQUIRE_EQ(bestEffort->ioClass, IoPriorityClass::BestEffort);
+    REQUIRE_EQ(bestEffort->level, 4);
+
+    const auto realtime = parseIoPriority("realtime:0");
+    REQUIRE(realtime.has_value());
+    REQUIRE_EQ(realtime->ioClass, IoPriorityClass::Realtime);
+    REQUIRE_EQ(realtime->level, 0);
+
+    REQUIRE_FALSE(parseIoPriority("idle:3").has_value());
+    REQUIRE_FALSE(parseIoPriority("best-effort:8").has_value());
+    REQUIRE_FALSE(parseIoPriority("best-effort:").has_value());
+    REQUIRE_FALSE(parseIoPriority("low").has_value());
+}
+
+TEST_CASE("Limits only needing a cgroup say so when there is none") {
+    const ResourceLimits noLimits;
+    REQUIRE(noLimits.IsEmpty());
+    const ResourceLimiter unlimited{noLimits};
+    REQUIRE(unlimited.Notes().empty());
+
+    if (delegatedCgroup().has_value()) {
+        return;
+    }
+    ResourceLimits limits;
+    limits.maxProcesses = 10;
+    REQUIRE_FALSE(limits.IsEmpty());
+    const ResourceLimiter limiter{limits};
+    REQUIRE_NE(limiter.Notes().find("max_pids needs a delegated cgroup"), std::string::npos);
+    // nothing was enforced, so nothing can have ended the command
+    REQUIRE(limiter.Report(0).empty());
+}
+
+TEST_SUITE_END();
+//NOLINTEND(readability-function-cognitive-complexity,cppcoreguidelines-avoid-do-while)
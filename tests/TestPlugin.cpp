@@ -0,0 +1,64 @@
+// Plugin used by the plugin command tests. Built as a separate shared object
+#include <chrono>
+#include <cstdlib>
+#include <span>
+#include <string_view>
+#include <thread>
+
+#include "ReplmkPlugin.h"
+
+namespace {
+auto writeOut(const replmk_output_sink* sink, std::string_view text) -> void {
+    sink->write_stdout(sink->context, text.data(), text.size());
+}
+}
+
+extern "C" {
+
+auto replmk_plugin_abi_version() -> uint32_t {
+    return REPLMK_PLUGIN_ABI_VERSION;
+}
+
+// writes its arguments back, one per line. 'fail' as the first argument makes it write to stderr and fail
+auto replmk_test_echo(int argc, const char* const* argv, const replmk_output_sink* sink) -> int {
+    const std::span<const char* const> args(argv, static_cast<size_t>(argc));
+    if (args.size() > 1 and std::string_view{args[1]} == "fail") {
+        constexpr std::string_view ErrorMessage = "failed on purpose\n";
+        sink->write_stderr(sink->context, ErrorMessage.data(), ErrorMessage.size());
+        return 1;
+    }
+
+    for (const auto* arg : args) {
+        writeOut(sink, arg);
+        writeOut(sink, "\n");
+    }
+    return 0;
+}
+
+auto replmk_test_cancellable(int /*argc*/, const char* const* /*argv*/, const replmk_output_sink* sink) -> int {
+    if (sink->is_cancelled(sink->context) != 0) {
+        writeOut(sink, "cancelled\n");
+        return 1;
+    }
+    writeOut(sink, "completed\n");
+    return 0;
+}
+
+// writes nothing until it is cancelled, giving up after ten seconds
+auto replmk_test_silent(int /*argc*/, const char* const* /*argv*/, const replmk_output_sink* sink) -> int {
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds{10};
+    while (std::chrono::steady_clock::now() < deadline) {
+        if (sink->is_cancelled(sink->context) != 0) {
+            return 1;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds{10});
+    }
+    return 0;
+}
+
+auto replmk_test_crash(int /*argc*/, const char* const* /*argv*/, const replmk_output_sink* sink) -> int {
+    writeOut(sink, "about to crash\n");
+    std::abort();
+}
+
+}
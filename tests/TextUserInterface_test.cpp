@@ -73,12 +73,14 @@ TEST_CASE("Output buffer updates are reflected in UI") {
     }
 
     // Create output frame
-    float scrollYPos = 0;
-    ftxui::Box dummyBox;
-    auto outputFrame = makeOutputFrame(outputBuffers, scrollYPos, dummyBox);
+    OutputView outputView;
+    auto outputFrame = makeOutputFrame(outputBuffers, outputView);
 
     // Trigger render (should not crash)
     outputFrame->Render();
+    // a prompt and a line for the first entry, the second adds its stderr between two borders
+    REQUIRE(outputView.layout.RowCount() == 7);
+    REQUIRE(outputView.scroll.IsFollowingTail());
 
     // Verify buffer content
     const auto& buffer = outputBuffers.GetBuffer();
@@ -0,0 +1,107 @@
+#include <doctest/doctest.h>
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../src/ExecutionControl.h"
+#include "../src/Watch.h"
+
+using namespace replmk;
+
+//NOLINTBEGIN(readability-function-cognitive-complexity,cppcoreguidelines-avoid-do-while)
+TEST_SUITE_BEGIN("Watch");
+
+TEST_CASE("Arguments take an optional interval before the command") {
+    const auto defaults = parseWatchArguments({"pods", "-n", "prod"});
+    REQUIRE(defaults.has_value());
+    REQUIRE_EQ(std::chrono::duration_cast<std::chrono::milliseconds>(defaults->interval), std::chrono::milliseconds{2000});
+    const std::vector<std::string> podsCommand{"pods", "-n", "prod"};
+    REQUIRE_EQ(defaults->commandWords, podsCommand);
+
+    const auto everyHalfSecond = parseWatchArguments({"-n", "0.5", "pods"});
+    REQUIRE(everyHalfSecond.has_value());
+    REQUIRE_EQ(std::chrono::duration_cast<std::chrono::milliseconds>(everyHalfSecond->interval), std::chrono::milliseconds{500});
+    const std::vector<std::string> justPods{"pods"};
+    REQUIRE_EQ(everyHalfSecond->commandWords, justPods);
+
+    REQUIRE_FALSE(parseWatchArguments({}).has_value());
+    REQUIRE_FALSE(parseWatchArguments({"-n", "2"}).has_value());
+    REQUIRE_FALSE(parseWatchArguments({"-n"}).has_value());
+    REQUIRE_FALSE(parseWatchArguments({"-n", "0.01", "pods"}).has_value());
+    REQUIRE_FALSE(parseWatchArguments({"-n", "2s", "pods"}).has_value());
+}
+
+TEST_CASE("Lines are compared with the same line of the previous output") {
+    const auto unchanged = diffLines("a\nb\n", "a\nb\n");
+    REQUIRE(unchanged.IsEmpty());
+
+    const auto changed = diffLines("a\nb\nc\n", "a\nB\nc\nd\n");
+    const std::vector<size_t> secondAndLast{1, 3};
+    REQUIRE_EQ(changed.changedLines, secondAndLast);
+    REQUIRE_EQ(changed.removedLines, 0);
+
+    const auto shorter = diffLines("a\nb\nc", "a\n");
+    REQUIRE(shorter.changedLines.empty());
+    REQUIRE_EQ(shorter.removedLines, 2);
+
+    const auto fromNothing = diffLines("", "a\nb");
+    REQUIRE_EQ(fromNothing.changedLines.size(), 2);
+}
+
+TEST_CASE("Headers tell what changed since the previous run") {
+    const WatchArguments watch{.interval = std::chrono::duration<double>{2}, .commandWords = {"pods", "prod"}};
+    const auto now = std::chrono::system_clock::now();
+
+    const auto first = formatWatchHeader(watch, 1, diffLines("", "a\n"), now);
+    REQUIRE(first.starts_with("Every 2.0s: pods prod  run 1 at "));
+    REQUIRE(first.ends_with("\n"));
+    REQUIRE(formatWatchHeader(watch, 2, diffLines("a\n", "a\n"), now).ends_with(", no changes\n"));
+    REQUIRE(formatWatchHeader(watch, 3, diffLines("a\nb\nc\n", "A\nb\n"), now).ends_with(", 1 changed line (1), 1 line fewer\n"));
+    REQUIRE(formatWatchHeader(watch, 4, diffLines("", "1\n2\n3\n4\n5\n6\n7\n8\n9\n10\n11\n"), now).ends_with(", 11 changed lines\n"));
+}
+
+TEST_CASE("Runs repeat on every tick until cancelled") {
+    ExecutionControl control;
+    control.BeginCommand();
+
+    std::vector<std::chrono::steady_clock::time_point> runTimes;
+    const auto runs = runWatch(std::chrono::duration<double>{0.1}, control, [&control, &runTimes](size_t run) {
+        runTimes.push_back(std::chrono::steady_clock::now());
+        if (run == 3) {
+            control.RequestCancel();
+        }
+    });
+    REQUIRE(runs.has_value());
+    REQUIRE_EQ(runs.value(), 3);
+    REQUIRE_EQ(runTimes.size(), 3);
+    REQUIRE_GE(runTimes.back() - runTimes.front(), std::chrono::milliseconds{190});
+
+    // cancelled while waiting for the next tick
+    control.BeginCommand();
+    std::jthread canceller{[&control]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds{100});
+        control.RequestCancel();
+    }};
+    const auto startTime = std::chrono::steady_clock::now();
+    REQUIRE_EQ(runWatch(std::chrono::duration<double>{60}, control, [](size_t) {}).value(), 1);
+    REQUIRE_LT(std::chrono::steady_clock::now() - startTime, std::chrono::seconds{5});
+}
+
+TEST_CASE("Waiting for the next tick keeps the interface going") {
+    ExecutionControl control;
+    int idleCalls = 0;
+    // the interface reads Ctrl+C while it is given its turn
+    control.SetOnIdle([&control, &idleCalls]() {
+        if (++idleCalls == 3) {
+            control.RequestCancel();
+        }
+    });
+    control.BeginCommand();
+    REQUIRE_EQ(runWatch(std::chrono::duration<double>{60}, control, [](size_t) {}).value(), 1);
+    REQUIRE_EQ(idleCalls, 3);
+}
+
+TEST_SUITE_END();
+//NOLINTEND(readability-function-cognitive-complexity,cppcoreguidelines-avoid-do-while)
@@ -0,0 +1,197 @@
+#include <doctest/doctest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../src/ExecutionControl.h"
+#include "../src/Workflow.h"
+
+using namespace replmk;
+
+//NOLINTBEGIN(readability-function-cognitive-complexity,cppcoreguidelines-avoid-do-while)
+TEST_SUITE_BEGIN("Workflow");
+
+namespace {
+auto MakeWorkflow(WorkflowPolicy policy) -> Workflow {
+    // lint and test are independent, package needs both and publish needs package
+    return Workflow{
+        .name = "release",
+        .description = "",
+        .policy = policy,
+        .steps = {
+            {.name = "lint", .commandLine = "lint", .dependsOn = {}},
+            {.name = "test", .commandLine = "test", .dependsOn = {}},
+            {.name = "package", .commandLine = "package", .dependsOn = {"lint", "test"}},
+            {.name = "publish", .commandLine = "publish", .dependsOn = {"package"}},
+            {.name = "docs", .commandLine = "docs", .dependsOn = {"lint"}}
+        }
+    };
+}
+}
+
+TEST_CASE("Dependencies resolve to step indices") {
+    const auto dependencies = resolveWorkflowDependencies(MakeWorkflow(WorkflowPolicy::FailFast));
+    REQUIRE(dependencies.has_value());
+    const std::vector<std::vector<size_t>> expected{{}, {}, {0, 1}, {2}, {0}};
+    REQUIRE_EQ(dependencies.value(), expected);
+}
+
+TEST_CASE("Workflows that are not a DAG are rejected") {
+    auto cyclic = MakeWorkflow(WorkflowPolicy::FailFast);
+    cyclic.steps.at(0).dependsOn = {"publish"};
+    const auto cycle = resolveWorkflowDependencies(cyclic);
+    REQUIRE_FALSE(cycle.has_value());
+    REQUIRE_NE(cycle.error().find("cycle: lint, package, publish, docs"), std::string::npos);
+
+    auto selfDependent = MakeWorkflow(WorkflowPolicy::FailFast);
+    selfDependent.steps.at(1).dependsOn = {"test"};
+    REQUIRE_FALSE(resolveWorkflowDependencies(selfDependent).has_value());
+
+    auto unknown = MakeWorkflow(WorkflowPolicy::FailFast);
+    unknown.steps.at(1).dependsOn = {"build"};
+    REQUIRE_NE(resolveWorkflowDependencies(unknown).error().find("'build'"), std::string::npos);
+
+    auto duplicated = MakeWorkflow(WorkflowPolicy::FailFast);
+    duplicated.steps.at(1).name = "lint";
+    REQUIRE_FALSE(resolveWorkflowDependencies(duplicated).has_value());
+
+    REQUIRE_FALSE(resolveWorkflowDependencies(Workflow{.name = "empty", .description = "", .policy = WorkflowPolicy::FailFast, .steps = {}}).has_value());
+}
+
+TEST_CASE("Steps start once their dependencies succeed, independent ones in parallel") {
+    const auto workflow = MakeWorkflow(WorkflowPolicy::FailFast);
+    ExecutionControl control;
+
+    std::atomic<size_t> running{0};
+    std::atomic<size_t> maxRunning{0};
+    std::vector<size_t> done;
+
+    const auto summary = runWorkflow(workflow, resolveWorkflowDependencies(workflow).value(), [&](size_t index, const CommandOutputCallbacks& callbacks) {
+        const auto nowRunning = running.fetch_add(1) + 1;
+        auto seen = maxRunning.load();
+        while (seen < nowRunning and not maxRunning.compare_exchange_weak(seen, nowRunning)) {
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds{20});
+        callbacks.onStdOut(workflow.steps.at(index).name);
+        running.fetch_sub(1);
+        return true;
+    }, control, [&done, &workflow](const WorkflowStepResult& result) {
+        REQUIRE_EQ(result.status, WorkflowStepStatus::Succeeded);
+        REQUIRE_EQ(result.stdOut, workflow.steps.at(result.index).name);
+        done.push_back(result.index);
+    });
+
+    REQUIRE_EQ(summary.succeeded, 5);
+    REQUIRE_EQ(summary.failed, 0);
+    REQUIRE_EQ(summary.skipped, 0);
+    REQUIRE_EQ(summary.maxParallel, 2);
+    REQUIRE_EQ(maxRunning.load(), 2);
+
+    // every step finished after the ones it depends on
+    const auto position = [&done](size_t index) {
+        return std::ranges::find(done, index) - done.begin();
+    };
+    REQUIRE_EQ(done.size(), 5);
+    REQUIRE_LT(position(0), position(2));
+    REQUIRE_LT(position(1), position(2));
+    REQUIRE_LT(position(2), position(3));
+    REQUIRE_LT(position(0), position(4));
+}
+
+TEST_CASE("Failures stop the workflow or only what depends on them") {
+    ExecutionControl control;
+    const auto failTest = [](size_t index, const CommandOutputCallbacks&) {
+        return index != 1;
+    };
+
+    std::vector<std::string> failFastSkips;
+    const auto failFast = MakeWorkflow(WorkflowPolicy::FailFast);
+    auto summary = runWorkflow(failFast, resolveWorkflowDependencies(failFast).value(), failTest, control, [&failFastSkips](const WorkflowStepResult& result) {
+        if (result.status == WorkflowStepStatus::Skipped) {
+            failFastSkips.push_back(result.stdErr);
+        }
+    });
+    REQUIRE_EQ(summary.failed, 1);
+    REQUIRE_EQ(summary.succeeded + summary.skipped, 4);
+    REQUIRE_EQ(failFastSkips.front(), "not run, 'test' failed\n");
+
+    std::vector<size_t> succeeded;
+    std::vector<std::string> keepGoingSkips;
+    const auto keepGoing = MakeWorkflow(WorkflowPolicy::KeepGoing);
+    summary = runWorkflow(keepGoing, resolveWorkflowDependencies(keepGoing).value(), failTest, control, [&](const WorkflowStepResult& result) {
+        if (result.status == WorkflowStepStatus::Succeeded) {
+            succeeded.push_back(result.index);
+        } else if (result.status == WorkflowStepStatus::Skipped) {
+            keepGoingSkips.push_back(result.stdErr);
+        }
+    });
+    REQUIRE_EQ(summary.succeeded, 2);
+    REQUIRE_EQ(summary.failed, 1);
+    REQUIRE_EQ(summary.skipped, 2);
+    std::ranges::sort(succeeded);
+    const std::vector<size_t> independentOfTest{0, 4};
+    REQUIRE_EQ(succeeded, independentOfTest);
+    REQUIRE_EQ(keepGoingSkips.at(0), "not run, 'test' failed\n");
+    REQUIRE_EQ(keepGoingSkips.at(1), "not run, 'package' did not run\n");
+}
+
+TEST_CASE("Cancelled workflows start no more steps") {
+    const auto workflow = MakeWorkflow(WorkflowPolicy::KeepGoing);
+    ExecutionControl control;
+    control.BeginCommand();
+
+    const auto summary = runWorkflow(workflow, resolveWorkflowDependencies(workflow).value(), [&control](size_t index, const CommandOutputCallbacks&) {
+        if (index == 0) {
+            control.RequestCancel();
+        }
+        return true;
+    }, control, [](const WorkflowStepResult&) {});
+    REQUIRE_GT(summary.skipped, 0);
+    REQUIRE_EQ(summary.succeeded + summary.skipped, 5);
+}
+
+TEST_CASE("Long steps leave the interface its events, so they can be cancelled") {
+    const auto workflow = MakeWorkflow(WorkflowPolicy::KeepGoing);
+    ExecutionControl control;
+    int idleCalls = 0;
+    control.SetOnIdle([&control, &idleCalls]() {
+        if (++idleCalls == 3) {
+            control.RequestCancel();
+        }
+    });
+    control.BeginCommand();
+
+    // steps that only end once cancelled
+    const auto summary = runWorkflow(workflow, resolveWorkflowDependencies(workflow).value(), [&control](size_t, const CommandOutputCallbacks&) {
+        while (not control.IsCancelRequested()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds{5});
+        }
+        return false;
+    }, control, [](const WorkflowStepResult&) {});
+    REQUIRE_GE(idleCalls, 3);
+    REQUIRE_EQ(summary.failed, 2);
+    REQUIRE_EQ(summary.skipped, 3);
+}
+
+TEST_CASE("Step results and summaries are formatted") {
+    const WorkflowStep step{.name = "test", .commandLine = "make test", .dependsOn = {}};
+    const WorkflowStepResult failed{.index = 1, .status = WorkflowStepStatus::Failed, .stdOut = "", .stdErr = "", .elapsed = std::chrono::milliseconds{1500}};
+    REQUIRE_EQ(formatWorkflowStepHeader(step, failed), "[failed 1.500s] test: make test\n");
+    const WorkflowStepResult skipped{.index = 1, .status = WorkflowStepStatus::Skipped, .stdOut = "", .stdErr = "", .elapsed = {}};
+    REQUIRE_EQ(formatWorkflowStepHeader(step, skipped), "[skipped] test: make test\n");
+
+    const WorkflowSummary summary{.succeeded = 3, .failed = 1, .skipped = 2, .maxParallel = 2, .elapsed = std::chrono::seconds{4}};
+    REQUIRE_EQ(formatWorkflowSummary(MakeWorkflow(WorkflowPolicy::FailFast), summary),
+               "release: 3 succeeded, 1 failed, 2 skipped in 4.000s, up to 2 at a time\n");
+
+    REQUIRE_EQ(toWorkflowPolicy("keep_going"), WorkflowPolicy::KeepGoing);
+    REQUIRE_EQ(toWorkflowPolicy("fail_fast"), WorkflowPolicy::FailFast);
+    REQUIRE_FALSE(toWorkflowPolicy("sometimes").has_value());
+}
+
+TEST_SUITE_END();
+//NOLINTEND(readability-function-cognitive-complexity,cppcoreguidelines-avoid-do-while)